@@ -78,6 +78,7 @@ static void write_tests(void);
 static void set_tests(void);
 static void iterator_tests(void);
 static void clone_tests(void);
+static void writer_tests(void);
 
 static struct {
     const char *name;
@@ -90,6 +91,7 @@ static struct {
     { "Set", set_tests },
     { "Iterator", iterator_tests },
     { "Clone", clone_tests },
+    { "Writer", writer_tests },
     { NULL, NULL }
 };
 
@@ -836,6 +838,8 @@ set_tests(void)
 {
     json_t *j = NULL;
     json_t *k;
+    json_parse_error_t *e = NULL;
+    int i;
 
     /* Construct a Boolean. */
     j = json_boolean(true);
@@ -885,6 +889,37 @@ set_tests(void)
     } SIGABRT_END;
     CLEAN_UP;
 
+    /* Construct a large object, so its members are hashed. */
+    j = json_object();
+    for (i = 0; i < 100; i++) {
+	char key[16];
+
+	snprintf(key, sizeof(key), "k%d", i);
+	json_object_set(j, key, NT, json_integer(i));
+    }
+    json_object_set(j, "k42", NT, json_integer(-42));
+    assert(json_object_length(j) == 100);
+    assert(json_object_member(j, "k99", NT, &k));
+    assert(json_integer_value(k) == 99);
+    assert(json_object_member(j, "k42", NT, &k));
+    assert(json_integer_value(k) == -42);
+    assert(!json_object_member(j, "k100", NT, &k));
+    CLEAN_UP;
+
+    /* With duplicate keys, the first member wins, hashed or not. */
+    json_parse_s("{\"a\":1,\"a\":2}", &j, &e);
+    assert(json_object_member(j, "a", NT, &k));
+    assert(json_integer_value(k) == 1);
+    CLEAN_UP_BOTH;
+    json_parse_s("{\"a\":1,\"b\":2,\"c\":3,\"d\":4,\"e\":5,\"f\":6,"
+	    "\"g\":7,\"h\":8,\"i\":9,\"j\":10,\"k\":11,\"l\":12,\"m\":13,"
+	    "\"n\":14,\"o\":15,\"p\":16,\"q\":17,\"a\":18}", &j, &e);
+    assert(json_object_member(j, "a", NT, &k));
+    assert(json_integer_value(k) == 1);
+    assert(json_object_member(j, "q", NT, &k));
+    assert(json_integer_value(k) == 17);
+    CLEAN_UP_BOTH;
+
     /* Construct an array. */
     j = json_array();
     assert(json_is_array(j));
@@ -1047,3 +1082,75 @@ clone_tests(void)
     json_free(k);
     CLEAN_UP;
 }
+
+/* Check a writer's accumulated text. */
+static bool
+writer_is(json_writer_t *w, const char *expected)
+{
+    size_t len;
+    const char *buf = json_writer_buf(w, &len);
+
+    return len == strlen(expected) && !memcmp(buf, expected, len);
+}
+
+/* Streaming writer tests. */
+static void
+writer_tests(void)
+{
+    json_writer_t *w;
+    json_t *j = NULL;
+    json_parse_error_t *e = NULL;
+    char *s;
+
+    /* Test writing a nested object with no whitespace. */
+    w = json_writer_new(JW_ONE_LINE);
+    json_writer_begin_object(w, NULL);
+    json_writer_boolean(w, "a", false);
+    json_writer_begin_object(w, "b");
+    json_writer_end_object(w);
+    json_writer_begin_object(w, "c");
+    json_writer_integer(w, "d", 3);
+    json_writer_end_object(w);
+    json_writer_end_object(w);
+    assert(json_writer_depth(w) == 0);
+    assert(writer_is(w, "{\"a\":false,\"b\":{},\"c\":{\"d\":3}}"));
+
+    /* Test re-using the writer for a nested array. */
+    json_writer_reset(w);
+    json_writer_begin_array(w, NULL);
+    json_writer_integer(w, NULL, 1);
+    json_writer_string(w, NULL, "a", NT);
+    json_writer_begin_array(w, NULL);
+    assert(json_writer_in_array(w));
+    json_writer_integer(w, NULL, 3);
+    json_writer_begin_array(w, NULL);
+    json_writer_end_array(w);
+    json_writer_end_array(w);
+    json_writer_end_array(w);
+    assert(writer_is(w, "[1,\"a\",[3,[]]]"));
+    json_writer_free(w);
+    assert(w == NULL);
+    CLEAN_UP;
+
+    /* Test indented output against json_write(). */
+    json_parse_s(TEST_WOBJECT_NEST, &j, &e);
+    s = json_write(j);
+    w = json_writer_new(JW_NONE);
+    json_writer_node(w, NULL, j);
+    assert(writer_is(w, s));
+    Free(s);
+    json_writer_free(w);
+    CLEAN_UP_BOTH;
+
+    /* Test a nested node, a funky string and a double. */
+    json_parse_s(TEST_WARRAY_NEST, &j, &e);
+    w = json_writer_new(JW_NONE);
+    json_writer_begin_object(w, NULL);
+    json_writer_node(w, "x", j);
+    json_writer_string(w, "s\n", "abc\r\n\037\"s", NT);
+    json_writer_double(w, "f", 1.2);
+    json_writer_end_object(w);
+    assert(writer_is(w, "{\n  \"x\": [\n    1,\n    \"a\",\n    [\n      3,\n      [\n      ]\n    ]\n  ],\n  \"s\\n\": \"abc\\r\\n\\u001f\\\"s\",\n  \"f\": 1.2\n}"));
+    json_writer_free(w);
+    CLEAN_UP_BOTH;
+}
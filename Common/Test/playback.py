@@ -40,6 +40,7 @@ class playback():
     conn = None
     file = None
     thread = None
+    pending = b''
 
     # Initialization.
     def __init__(self, ct:cti.cti, trace_file:str, port=4001, ipv6=False):
@@ -98,21 +99,33 @@ class playback():
     def send_tm(self) -> str:
         '''Send a timing mark'''
         self.conn.send(b'\xff\xfd\x06')
-        # Wait for it to come back. This code assumes that the emulator will do
-        # a TCP PUSH after the IAC WONT TM.
-        accum = ''
+        # Wait for it to come back. The emulator may send more data right
+        # after the IAC WONT TM, so save anything that follows it for the
+        # next read.
+        accum = self.pending
+        self.pending = b''
         while True:
+            ix = accum.find(b'\xff\xfc\x06')
+            if ix >= 0:
+                self.pending = accum[ix + 3:]
+                return bytes.hex(accum[:ix + 3])
             r, _, _ = select.select([self.conn], [], [], 2)
             self.ct.assertNotEqual([], r, 'Emulator did not send TM response')
-            accum += bytes.hex(self.conn.recv(1024))
-            if accum.endswith('fffc06'):
-                break
-        return accum
+            accum += self.conn.recv(1024)
+
+    def recv(self, n: int):
+        '''Read up to n bytes, starting with anything saved by send_tm'''
+        if self.pending != b'':
+            ret = self.pending[:n]
+            self.pending = self.pending[n:]
+            return ret
+        return self.conn.recv(n)
 
     def recv_to_end(self, timeout=2):
         '''Return everything sent on the socket'''
         self.wait_accept()
-        ret = b''
+        ret = self.pending
+        self.pending = b''
         while True:
             r, _, _ = select.select([self.conn], [], [], timeout)
             self.ct.assertNotEqual([], r, 'Receive timed out')
@@ -179,9 +192,10 @@ class playback():
         nleft = n
         ret = b''
         while nleft > 0:
-            r, _, _ = select.select([self.conn], [], [], timeout)
-            self.ct.assertNotEqual([], r, f'Emulator read timed out after {len(ret)} bytes read')
-            chunk = self.conn.recv(nleft)
+            if self.pending == b'':
+                r, _, _ = select.select([self.conn], [], [], timeout)
+                self.ct.assertNotEqual([], r, f'Emulator read timed out after {len(ret)} bytes read')
+            chunk = self.recv(nleft)
             self.ct.assertNotEqual(chunk, b'', 'Unexpected emulator EOF')
             ret += chunk
             nleft -= len(chunk)
@@ -32,6 +32,9 @@
 #include "globals.h"
 #include "glue.h"
 #include "appres.h"
+#if !defined(_WIN32) /*[*/
+# include "iomux.h"
+#endif /*]*/
 #include "latin1.h"
 #include "task.h"
 #include "trace.h"
@@ -51,14 +54,14 @@
 # include <sys/wait.h>
 #endif /*]*/
 
-#if defined(SEPARATE_SELECT_H) /*[*/
-# include <sys/select.h>
+#if defined(_WIN32) /*[*/
+# define InputReadMask	0x1
+#else /*][*/
+# define InputReadMask	IOMUX_READ
+# define InputExceptMask	IOMUX_EXCEPT
+# define InputWriteMask	IOMUX_WRITE
 #endif /*]*/
 
-#define InputReadMask	0x1
-#define InputExceptMask	0x2
-#define InputWriteMask	0x4
-
 #define MILLION		1000000L
 
 void (*Error_redirect)(const char *) = NULL;
@@ -426,82 +429,118 @@ key_to_string(ks_t k)
 
 /* Timeouts. */
 
-#if defined(_WIN32) /*[*/
+/*
+ * Pending timeouts are kept in a binary min-heap ordered by expiration time,
+ * so adding and removing one is O(log n). Expiration times come from a
+ * monotonic clock, so stepping the wall clock does not fire or stall them.
+ */
+typedef struct timeout {
+    uint64_t ts;	/* expiration time, in microseconds */
+    unsigned long seq;	/* sequence number, to keep equal times in order */
+    size_t ix;		/* index in the heap */
+    tofn_t proc;
+    bool in_play;
+} timeout_t;
+static timeout_t **timeouts = NULL;
+static size_t n_timeouts = 0;
+static size_t max_timeouts = 0;
+static unsigned long timeout_seq = 0;
+
+/* Returns true if timeout a expires before timeout b. */
+static bool
+timeout_before(timeout_t *a, timeout_t *b)
+{
+    return a->ts < b->ts || (a->ts == b->ts && a->seq < b->seq);
+}
+
+/* Put a timeout into a heap slot. */
+static void
+timeout_place(timeout_t *t, size_t ix)
+{
+    timeouts[ix] = t;
+    t->ix = ix;
+}
+
+/* Move a timeout toward the top of the heap. */
 static void
-ms_ts(unsigned long long *u)
+timeout_sift_up(size_t ix)
 {
-    FILETIME t;
+    timeout_t *t = timeouts[ix];
 
-    /* Get the system time, in 100ns units. */
-    GetSystemTimeAsFileTime(&t);
-    memcpy(u, &t, sizeof(unsigned long long));
+    while (ix > 0) {
+	size_t parent = (ix - 1) / 2;
 
-    /* Divide by 10,000 to get ms. */
-    *u /= 10000ULL;
+	if (!timeout_before(t, timeouts[parent])) {
+	    break;
+	}
+	timeout_place(timeouts[parent], ix);
+	ix = parent;
+    }
+    timeout_place(t, ix);
 }
-#endif /*]*/
 
-typedef struct timeout {
-    struct timeout *next;
-#if defined(_WIN32) /*[*/
-    unsigned long long ts;
-#else /*][*/
-    struct timeval tv;
-#endif /*]*/
-    tofn_t proc;
-    bool in_play;
-} timeout_t;
-static timeout_t *timeouts = NULL;
+/* Move a timeout toward the bottom of the heap. */
+static void
+timeout_sift_down(size_t ix)
+{
+    timeout_t *t = timeouts[ix];
+
+    for (;;) {
+	size_t child = (2 * ix) + 1;
+
+	if (child >= n_timeouts) {
+	    break;
+	}
+	if (child + 1 < n_timeouts &&
+		timeout_before(timeouts[child + 1], timeouts[child])) {
+	    child++;
+	}
+	if (!timeout_before(timeouts[child], t)) {
+	    break;
+	}
+	timeout_place(timeouts[child], ix);
+	ix = child;
+    }
+    timeout_place(t, ix);
+}
+
+/* Remove a timeout from the heap. */
+static void
+timeout_unlink(timeout_t *t)
+{
+    size_t ix = t->ix;
+
+    n_timeouts--;
+    if (ix == n_timeouts) {
+	return;
+    }
+    timeout_place(timeouts[n_timeouts], ix);
+    if (ix > 0 && timeout_before(timeouts[ix], timeouts[(ix - 1) / 2])) {
+	timeout_sift_up(ix);
+    } else {
+	timeout_sift_down(ix);
+    }
+}
 
 ioid_t
 AddTimeOut(unsigned long interval_ms, tofn_t proc)
 {
     timeout_t *t_new;
-    timeout_t *t;
-    timeout_t *prev = NULL;
 
     t_new = (timeout_t *)Malloc(sizeof(timeout_t));
     t_new->proc = proc;
     t_new->in_play = false;
-#if defined(_WIN32) /*[*/
-    ms_ts(&t_new->ts);
-    t_new->ts += interval_ms;
-#else /*][*/
-    gettimeofday(&t_new->tv, NULL);
-    t_new->tv.tv_sec += interval_ms / 1000L;
-    t_new->tv.tv_usec += (interval_ms % 1000L) * 1000L;
-    if (t_new->tv.tv_usec > MILLION) {
-	t_new->tv.tv_sec += t_new->tv.tv_usec / MILLION;
-	t_new->tv.tv_usec %= MILLION;
-    }
-#endif /*]*/
-
-    /* Find where to insert this item. */
-    for (t = timeouts; t != NULL; t = t->next) {
-#if defined(_WIN32) /*[*/
-	if (t->ts > t_new->ts)
-#else /*][*/
-	if (t->tv.tv_sec > t_new->tv.tv_sec ||
-	    (t->tv.tv_sec == t_new->tv.tv_sec &&
-	     t->tv.tv_usec > t_new->tv.tv_usec))
-#endif /*]*/
-	{
-	    break;
-	}
-	prev = t;
-    }
+    t_new->ts = monotonic_us() + ((uint64_t)interval_ms * 1000ULL);
+    t_new->seq = timeout_seq++;
 
     /* Insert it. */
-    if (prev == NULL) {	/* Front. */
-	t_new->next = timeouts;
-	timeouts = t_new;
-    } else if (t == NULL) {	/* Rear. */
-	t_new->next = NULL;
-	prev->next = t_new;
-    } else {			/* Middle. */
-	t_new->next = t;
-	prev->next = t_new;
+    if (n_timeouts >= max_timeouts) {
+	max_timeouts = max_timeouts? max_timeouts * 2: 32;
+	timeouts = (timeout_t **)Realloc(timeouts,
+		max_timeouts * sizeof(timeout_t *));
     }
+    timeout_place(t_new, n_timeouts++);
+    timeout_sift_up(t_new->ix);
 
     return (ioid_t)t_new;
 }
@@ -509,37 +548,101 @@ AddTimeOut(unsigned long interval_ms, tofn_t proc)
 void
 RemoveTimeOut(ioid_t timer)
 {
-    timeout_t *st = (timeout_t *)timer;
-    timeout_t *t;
-    timeout_t *prev = NULL;
+    timeout_t *t = (timeout_t *)timer;
 
-    if (st->in_play) {
+    if (t->in_play) {
 	return;
     }
-    for (t = timeouts; t != NULL; t = t->next) {
-	if (t == st) {
-	    if (prev != NULL) {
-		prev->next = t->next;
-	    } else {
-		timeouts = t->next;
-	    }
-	    Free(t);
-	    return;
-	}
-	prev = t;
+    if (t->ix < n_timeouts && timeouts[t->ix] == t) {
+	timeout_unlink(t);
+	Free(t);
     }
 }
 
 /* Input events. */ 
 typedef struct input {  
     struct input *next;
+#if !defined(_WIN32) /*[*/
+    struct input *fd_next;	/* next input on the same descriptor */
+#endif /*]*/
     iosrc_t source; 
     int condition;
     iofn_t proc;
+    iodatafn_t data_proc;	/* callback with user data, instead of proc */
+    void *data;
 } input_t;          
 static input_t *inputs = NULL;
 static bool inputs_changed = false;
 
+/* Call an input's callback. */
+static void
+input_call(input_t *ip)
+{
+    if (ip->data_proc != NULL) {
+	(*ip->data_proc)(ip->source, (ioid_t)ip, ip->data);
+    } else {
+	(*ip->proc)(ip->source, (ioid_t)ip);
+    }
+}
+
+#if !defined(_WIN32) /*[*/
+/* Inputs indexed by descriptor, for dispatching multiplexer events. */
+static input_t **fd_inputs = NULL;
+static int fd_inputs_size = 0;
+static int n_conditions = 0;
+
+/* Tell the multiplexer what conditions to wait for on a descriptor. */
+static void
+fd_update(iosrc_t fd)
+{
+    input_t *ip;
+    unsigned mask = 0;
+
+    for (ip = fd_inputs[fd]; ip != NULL; ip = ip->fd_next) {
+	mask |= (unsigned)ip->condition;
+    }
+    iomux_set(fd, mask);
+}
+
+/* Add an input to the per-descriptor index. */
+static void
+fd_link(input_t *ip)
+{
+    if (ip->source >= fd_inputs_size) {
+	int new_size = fd_inputs_size? fd_inputs_size: 64;
+
+	while (new_size <= ip->source) {
+	    new_size *= 2;
+	}
+	fd_inputs = (input_t **)Realloc(fd_inputs,
+		new_size * sizeof(input_t *));
+	memset(fd_inputs + fd_inputs_size, 0,
+		(new_size - fd_inputs_size) * sizeof(input_t *));
+	fd_inputs_size = new_size;
+    }
+    ip->fd_next = fd_inputs[ip->source];
+    fd_inputs[ip->source] = ip;
+    n_conditions++;
+    fd_update(ip->source);
+}
+
+/* Remove an input from the per-descriptor index. */
+static void
+fd_unlink(input_t *ip)
+{
+    input_t **ipp;
+
+    for (ipp = &fd_inputs[ip->source]; *ipp != NULL; ipp = &(*ipp)->fd_next) {
+	if (*ipp == ip) {
+	    *ipp = ip->fd_next;
+	    break;
+	}
+    }
+    n_conditions--;
+    fd_update(ip->source);
+}
+#endif /*]*/
+
 ioid_t
 AddInput(iosrc_t source, iofn_t fn)
 {
@@ -551,8 +654,38 @@ AddInput(iosrc_t source, iofn_t fn)
     ip->source = source;
     ip->condition = InputReadMask;
     ip->proc = fn;
+    ip->data_proc = NULL;
     ip->next = inputs;
     inputs = ip;
+#if !defined(_WIN32) /*[*/
+    fd_link(ip);
+#endif /*]*/
+    inputs_changed = true;
+    return (ioid_t)ip;
+}
+
+/*
+ * Add an input whose callback is passed a user data pointer, so it does not
+ * need to search for its own state.
+ */
+ioid_t
+AddInputData(iosrc_t source, iodatafn_t fn, void *data)
+{
+    input_t *ip;
+
+    assert(source != INVALID_IOSRC);
+
+    ip = (input_t *)Malloc(sizeof(input_t));
+    ip->source = source;
+    ip->condition = InputReadMask;
+    ip->proc = NULL;
+    ip->data_proc = fn;
+    ip->data = data;
+    ip->next = inputs;
+    inputs = ip;
+#if !defined(_WIN32) /*[*/
+    fd_link(ip);
+#endif /*]*/
     inputs_changed = true;
     return (ioid_t)ip;
 }
@@ -569,8 +702,10 @@ AddExcept(iosrc_t source, iofn_t fn)
     ip->source = source;
     ip->condition = InputExceptMask;
     ip->proc = fn;
+    ip->data_proc = NULL;
     ip->next = inputs;
     inputs = ip;
+    fd_link(ip);
     inputs_changed = true;
     return (ioid_t)ip;
 #endif /*]*/
@@ -586,8 +721,10 @@ AddOutput(iosrc_t source, iofn_t fn)
     ip->source = source;
     ip->condition = InputWriteMask;
     ip->proc = fn;
+    ip->data_proc = NULL;
     ip->next = inputs;
     inputs = ip;
+    fd_link(ip);
     inputs_changed = true;
     return (ioid_t)ip;
 }
@@ -613,6 +750,9 @@ RemoveInput(ioid_t id)
     } else {
 	inputs = ip->next;
     }
+#if !defined(_WIN32) /*[*/
+    fd_unlink(ip);
+#endif /*]*/
     Free(ip);
     inputs_changed = true;
 }
@@ -700,30 +840,23 @@ process_some_events(bool block, bool *processed_any)
     DWORD nha;
     DWORD tmo;
     DWORD ret;
-    unsigned long long now;
     int i;
 #else /*][*/
-    int ne = 0;
-    fd_set rfds, wfds, xfds;
     int ns;
-    struct timeval now, twait, *tp;
+    struct timeval twait, *tp;
+    int fd;
+    unsigned mask;
 #endif /*]*/
     input_t *ip, *ip_next;
-    struct timeout *t;
+    timeout_t *t;
+    uint64_t now;
     bool any_events_pending;
 
 #   if defined(_WIN32) /*[*/
 #    define SOURCE_READY    (ret == WAIT_OBJECT_0 + i)
 #    define WAIT_BAD        (ret == WAIT_FAILED)
-#    define GET_TS(v)       ms_ts(v)
-#    define EXPIRED(t, now) (t->ts <= now)
 #   else /*][*/
-#    define SOURCE_READY    FD_ISSET(ip->source, &rfds)
 #    define WAIT_BAD        (ns < 0)
-#    define GET_TS(v)       gettimeofday(v, NULL);
-#    define EXPIRED(t, now) (t->tv.tv_sec < now.tv_sec || \
-			     (t->tv.tv_sec == now.tv_sec && \
-			      t->tv.tv_usec < now.tv_usec))
 #   endif /*]*/
 
     *processed_any = false;
@@ -732,60 +865,30 @@ process_some_events(bool block, bool *processed_any)
 
 #if defined(_WIN32) /*[*/
     nha = 0;
-#else /*][*/
-    FD_ZERO(&rfds);
-    FD_ZERO(&wfds);
-    FD_ZERO(&xfds);
-#endif /*]*/
-
     for (ip = inputs; ip != NULL; ip = ip->next) {
 	/* Set pending input event. */
 	if ((unsigned long)ip->condition & InputReadMask) {
-#if defined(_WIN32) /*[*/
 	    ha[nha++] = ip->source;
-#else /*][*/
-	    FD_SET(ip->source, &rfds);
-	    ne++;
-#endif /*]*/
-	    any_events_pending = true;
-	}
-
-#if !defined(_WIN32) /*[*/
-	/* Set pending output event. */
-	if ((unsigned long)ip->condition & InputWriteMask) {
-	    FD_SET(ip->source, &wfds);
-	    ne++;
 	    any_events_pending = true;
 	}
-	/* Set pending exception event. */
-	if ((unsigned long)ip->condition & InputExceptMask) {
-	    FD_SET(ip->source, &xfds);
-	    ne++;
-	    any_events_pending = true;
-	}
-#endif /*]*/
     }
+#else /*][*/
+    /* The multiplexer already knows what to wait for. */
+    any_events_pending = (inputs != NULL);
+#endif /*]*/
 
     if (block) {
-	if (timeouts != NULL) {
+	if (n_timeouts != 0) {
+	    uint64_t delta;
+
 	    /* Compute how long to wait for the first event. */
-	    GET_TS(&now);
+	    now = monotonic_us();
+	    delta = (timeouts[0]->ts > now)? timeouts[0]->ts - now: 0;
 #if defined(_WIN32) /*[*/
-	    if (now > timeouts->ts) {
-		tmo = 0;
-	    } else {
-		tmo = (DWORD)(timeouts->ts - now);
-	    }
+	    tmo = (DWORD)((delta + 999) / 1000);
 #else /*][*/
-	    twait.tv_sec = timeouts->tv.tv_sec - now.tv_sec;
-	    twait.tv_usec = timeouts->tv.tv_usec - now.tv_usec;
-	    if (twait.tv_usec < 0L) {
-		twait.tv_sec--;
-		twait.tv_usec += MILLION;
-	    }
-	    if (twait.tv_sec < 0L) {
-		twait.tv_sec = twait.tv_usec = 0L;
-	    }
+	    twait.tv_sec = delta / MILLION;
+	    twait.tv_usec = delta % MILLION;
 	    tp = &twait;
 #endif /*]*/
 	    any_events_pending = true;
@@ -835,8 +938,8 @@ process_some_events(bool block, bool *processed_any)
 #else /*][*/
     if (tp == NULL) {
 	vtrace("Waiting for %d event%s\n",
-		ne,
-		(ne == 1)? "": "s");
+		n_conditions,
+		(n_conditions == 1)? "": "s");
     } else {
 	unsigned msec = (tp->tv_usec + 500) / 1000;
 	unsigned sec = tp->tv_sec;
@@ -847,17 +950,19 @@ process_some_events(bool block, bool *processed_any)
 	    msec -= 1000;
 	}
 	vtrace("Waiting for %d event%s or %u.%03us\n",
-		ne,
-		(ne == 1)? "": "s",
+		n_conditions,
+		(n_conditions == 1)? "": "s",
 		sec, msec);
     }
-    ns = select(FD_SETSIZE, &rfds, &wfds, &xfds, tp);
+    ns = iomux_wait((tp == NULL)? -1:
+	    (int)(tp->tv_sec * 1000L + (tp->tv_usec + 999L) / 1000L));
 #endif /*[*/
 
     if (WAIT_BAD) {
 #if !defined(_WIN32) /*[*/
 	if (errno != EINTR) {
-	    xs_warning("process_events: select() failed: %s", strerror(errno));
+	    xs_warning("process_events: %s() failed: %s", iomux_name(),
+		    strerror(errno));
 	}
 #else /*][*/
 	xs_warning("WaitForMultipleObjects failed: %s",
@@ -876,55 +981,48 @@ process_some_events(bool block, bool *processed_any)
 
     /* Process the event(s) that occurred. */
 #if defined(_WIN32) /*[*/
-    for (i = 0, ip = inputs; ip != NULL; ip = ip_next, i++)
-#else /*][*/
-    for (ip = inputs; ip != NULL; ip = ip_next)
-#endif /*]*/
-    {
+    for (i = 0, ip = inputs; ip != NULL; ip = ip_next, i++) {
 	ip_next = ip->next;
 
 	/* Check for input ready. */
 	if (((unsigned long)ip->condition & InputReadMask) &&
 		SOURCE_READY) {
-	    (*ip->proc)(ip->source, (ioid_t)ip);
-	    *processed_any = true;
-	    if (inputs_changed) {
-		/* Other events may no longer be valid. Try again. */
-		return false;
-	    }
-	}
-
-#if !defined(_WIN32) /*[*/
-	/* Check for output ready. */
-	if (((unsigned long)ip->condition & InputWriteMask) &&
-		FD_ISSET(ip->source, &wfds)) {
-	    (*ip->proc)(ip->source, (ioid_t)ip);
+	    input_call(ip);
 	    *processed_any = true;
 	    if (inputs_changed) {
 		/* Other events may no longer be valid. Try again. */
 		return false;
 	    }
 	}
+    }
+#else /*][*/
+    while (iomux_next(&fd, &mask)) {
+	for (ip = fd_inputs[fd]; ip != NULL; ip = ip_next) {
+	    ip_next = ip->fd_next;
 
-	/* Check for exception ready. */
-	if (((unsigned long)ip->condition & InputExceptMask) &&
-		FD_ISSET(ip->source, &xfds)) {
-	    (*ip->proc)(ip->source, (ioid_t)ip);
-	    *processed_any = true;
-	    if (inputs_changed) {
-		/* Other events may no longer be valid. Try again. */
-		return false;
+	    /* Check for input, output or exception ready. */
+	    if ((unsigned)ip->condition & mask) {
+		input_call(ip);
+		*processed_any = true;
+		if (inputs_changed) {
+		    /* Other events may no longer be valid. Try again. */
+		    return false;
+		}
 	    }
 	}
-#endif /*]*/
     }
+#endif /*]*/
 
     /* See what's expired. */
-    if (timeouts != NULL) {
-	GET_TS(&now);
-	while ((t = timeouts) != NULL) {
-	    if (EXPIRED(t, now)) {
-		timeouts = t->next;
+    if (n_timeouts != 0) {
+	unsigned long seq_limit = timeout_seq;
+
+	/* Timeouts added by these callbacks wait for the next pass. */
+	now = monotonic_us();
+	while (n_timeouts != 0) {
+	    t = timeouts[0];
+	    if (t->ts <= now && t->seq < seq_limit) {
+		timeout_unlink(t);
 		t->in_play = true;
 		(*t->proc)((ioid_t)t);
 		*processed_any = true;
@@ -35,6 +35,7 @@
  */
 
 #include "globals.h"
+#include <ctype.h>
 #include "appres.h"
 
 #include "actions.h"
@@ -50,6 +51,11 @@
 llist_t actions_list = LLIST_INIT(actions_list);
 unsigned actions_list_count;
 
+/* Action lookup indices. */
+static action_elt_t **action_hash;	/* by case-insensitive name hash */
+static unsigned action_hash_size;	/* slots in action_hash (power of 2) */
+static action_elt_t **action_sorted;	/* sorted by case-insensitive name */
+
 enum iaction ia_cause;
 const char *ia_name[] = {
     "none", "string", "paste", "screen-redraw", "keypad", "default", "macro",
@@ -82,8 +88,6 @@ init_suppressed(const char *actions)
     a = txdFree(NewString(actions));
     while ((action = strtok(a, " \t\r\n")) != NULL) {
 	size_t sl = strlen(action);
-	action_elt_t *e;
-	bool found = false;
 
 	/* Prime for the next strtok() call. */
 	a = NULL;
@@ -95,13 +99,7 @@ init_suppressed(const char *actions)
 	}
 
 	/* Make sure the action they are suppressing is real. */
-	FOREACH_LLIST(&actions_list, e, action_elt_t *) {
-	    if (!strcasecmp(e->t.name, action)) {
-		found = true;
-		break;
-	    }
-	} FOREACH_LLIST_END(&actions_list, e, action_elt_t *);
-	if (!found) {
+	if (find_action(action) == NULL) {
 	    vtrace("Warning: action '%s' in %s not found\n", action,
 		    ResSuppressActions);
 	    continue;
@@ -324,6 +322,158 @@ run_action_entry(action_elt_t *e, enum iaction cause, unsigned count,
     return ret;
 }
 
+/**
+ * Hash an action name, case-insensitively (FNV-1a).
+ *
+ * @param[in] name	Action name
+ *
+ * @returns hash value
+ */
+static unsigned
+action_name_hash(const char *name)
+{
+    unsigned h = 2166136261U;
+
+    while (*name) {
+	h ^= (unsigned char)tolower((unsigned char)*name++);
+	h *= 16777619U;
+    }
+    return h;
+}
+
+/**
+ * Add an action to the name hash table.
+ *
+ * @param[in] e		Action to add
+ */
+static void
+action_hash_insert(action_elt_t *e)
+{
+    unsigned mask = action_hash_size - 1;
+    unsigned h = action_name_hash(e->t.name) & mask;
+
+    while (action_hash[h] != NULL) {
+	h = (h + 1) & mask;
+    }
+    action_hash[h] = e;
+}
+
+/**
+ * Add a newly-registered action to the lookup indices.
+ * Must be called after actions_list_count has been incremented.
+ *
+ * @param[in] e		Action to add
+ */
+static void
+action_index_add(action_elt_t *e)
+{
+    unsigned lo = 0;
+    unsigned hi = actions_list_count - 1;
+
+    /* Add it to the hash table, growing it if needed. */
+    if (actions_list_count * 2 > action_hash_size) {
+	action_elt_t *f;
+
+	Free(action_hash);
+	action_hash_size = action_hash_size? action_hash_size * 2: 256;
+	action_hash = (action_elt_t **)Calloc(action_hash_size,
+		sizeof(action_elt_t *));
+	FOREACH_LLIST(&actions_list, f, action_elt_t *) {
+	    action_hash_insert(f);
+	} FOREACH_LLIST_END(&actions_list, f, action_elt_t *);
+    } else {
+	action_hash_insert(e);
+    }
+
+    /* Insert it into the sorted array. */
+    action_sorted = (action_elt_t **)Realloc(action_sorted,
+	    actions_list_count * sizeof(action_elt_t *));
+    while (lo < hi) {
+	unsigned mid = (lo + hi) / 2;
+
+	if (strcasecmp(action_sorted[mid]->t.name, e->t.name) < 0) {
+	    lo = mid + 1;
+	} else {
+	    hi = mid;
+	}
+    }
+    memmove(action_sorted + lo + 1, action_sorted + lo,
+	    (actions_list_count - 1 - lo) * sizeof(action_elt_t *));
+    action_sorted[lo] = e;
+}
+
+/**
+ * Find an action by its exact name (case-insensitive).
+ *
+ * @param[in] name	Action name
+ *
+ * @returns action, or NULL
+ */
+action_elt_t *
+find_action(const char *name)
+{
+    unsigned mask = action_hash_size - 1;
+    unsigned h;
+
+    if (action_hash == NULL) {
+	return NULL;
+    }
+    for (h = action_name_hash(name) & mask;
+	 action_hash[h] != NULL;
+	 h = (h + 1) & mask) {
+	if (!strcasecmp(action_hash[h]->t.name, name)) {
+	    return action_hash[h];
+	}
+    }
+    return NULL;
+}
+
+/**
+ * Find an action by its name or a unique abbreviation (case-insensitive).
+ *
+ * @param[in] name	Action name or abbreviation
+ * @param[out] ambiguous Returned true if the abbreviation matches more than
+ *			 one action
+ *
+ * @returns action, or NULL
+ */
+action_elt_t *
+find_action_abbrev(const char *name, bool *ambiguous)
+{
+    action_elt_t *e;
+    size_t len = strlen(name);
+    unsigned lo = 0;
+    unsigned hi = actions_list_count;
+
+    *ambiguous = false;
+    if ((e = find_action(name)) != NULL) {
+	return e;
+    }
+
+    /* Find the first action that sorts at or after the abbreviation. */
+    while (lo < hi) {
+	unsigned mid = (lo + hi) / 2;
+
+	if (strcasecmp(action_sorted[mid]->t.name, name) < 0) {
+	    lo = mid + 1;
+	} else {
+	    hi = mid;
+	}
+    }
+
+    /* Actions starting with the abbreviation follow it contiguously. */
+    if (lo >= actions_list_count ||
+	    strncasecmp(action_sorted[lo]->t.name, name, len)) {
+	return NULL;
+    }
+    if (lo + 1 < actions_list_count &&
+	    !strncasecmp(action_sorted[lo + 1]->t.name, name, len)) {
+	*ambiguous = true;
+	return NULL;
+    }
+    return action_sorted[lo];
+}
+
 /*
  * Register a group of actions.
  *
@@ -369,6 +519,7 @@ register_actions(action_table_t *new_actions, unsigned count)
 	}
 
 	actions_list_count++;
+	action_index_add(e);
     }
 }
 
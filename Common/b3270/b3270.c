@@ -751,6 +751,7 @@ POSSIBILITY OF SUCH DAMAGE.", cyear),
 
     /* Process events forever. */
     while (1) {
+	ui_flush();
 	process_events(true);
 	screen_disp(false);
     }
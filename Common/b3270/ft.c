@@ -59,21 +59,33 @@ void ft_gui_clear_progress(void)
 void
 ft_gui_complete_popup(const char *msg, bool is_error)
 {
+    const ft_stats_t *stats = ft_get_stats();
+
     ui_leaf(IndFt,
 	    AttrState, AT_STRING, "complete",
 	    AttrSuccess, AT_BOOLEAN, !is_error,
 	    AttrText, AT_STRING, msg,
 	    AttrCause, AT_STRING, ia_name[ft_cause],
+	    AttrBuffers, AT_INT, (int64_t)stats->buffers,
+	    AttrTime, AT_DOUBLE, (double)stats->elapsed_us / 1.0e6,
+	    AttrHostWait, AT_DOUBLE, (double)stats->host_us / 1.0e6,
+	    AttrHostWaitMax, AT_DOUBLE, (double)stats->host_max_us / 1.0e6,
+	    AttrLocalTime, AT_DOUBLE, (double)stats->local_us / 1.0e6,
 	    NULL);
 }
 
 void
 ft_gui_update_length(size_t length)
 {
+    const ft_stats_t *stats = ft_get_stats();
+
     ui_leaf(IndFt,
 	    AttrState, AT_STRING, "running",
 	    AttrBytes, AT_INT, (int64_t)length,
 	    AttrCause, AT_STRING, ia_name[ft_cause],
+	    AttrBuffers, AT_INT, (int64_t)stats->buffers,
+	    AttrHostWait, AT_DOUBLE, (double)stats->host_us / 1.0e6,
+	    AttrLocalTime, AT_DOUBLE, (double)stats->local_us / 1.0e6,
 	    NULL);
 }
 
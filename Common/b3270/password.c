@@ -132,17 +132,9 @@ password_done(task_cbh handle, bool success, bool abort)
 bool
 push_password(bool again)
 {
-    action_elt_t *e;
-    bool found = false;
     char *cmd;
 
-    FOREACH_LLIST(&actions_list, e, action_elt_t *) {
-	if (!strcasecmp(e->t.name, PASSWORD_PASSTHRU_NAME)) {
-	    found = true;
-	    break;
-	}
-    } FOREACH_LLIST_END(&actions_list, e, action_elt_t *);
-    if (!found) {
+    if (find_action(PASSWORD_PASSTHRU_NAME) == NULL) {
 	return false;
     }
 
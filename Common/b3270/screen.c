@@ -94,7 +94,10 @@ static int last_rows = 0;
 static int last_cols = 0;
 static struct ea *saved_ea = NULL;
 static screen_t *saved_s = NULL;
+static screen_t *render_s = NULL;
+static bool *row_dirty = NULL;
 static bool saved_ea_is_empty = false;
+static bool render_all = true;
 
 static int sent_baddr = 0;
 static int saved_baddr = 0;
@@ -205,6 +208,11 @@ save_empty(void)
 	saved_s[i].fg = mode3279? HOST_COLOR_BLUE: HOST_COLOR_NEUTRAL_WHITE;
 	saved_s[i].bg = HOST_COLOR_NEUTRAL_BLACK;
     }
+
+    /* Allocate the render buffer and the dirty-row map. */
+    Replace(render_s, (screen_t *)Malloc(ss));
+    Replace(row_dirty, (bool *)Malloc(maxROWS * sizeof(bool)));
+    render_all = true;
 }
 
 /* Emit an erase indication. */
@@ -348,17 +356,60 @@ uncircle(unsigned long uc)
 }
 
 /*
- * Render the screen into a buffer.
+ * Blank out a range of rows in a rendered screen buffer.
+ */
+static void
+blank_rows(screen_t *s, int first_row, int nrows)
+{
+    int i;
+
+    s += first_row * maxCOLS;
+    memset(s, 0, nrows * maxCOLS * sizeof(screen_t));
+    for (i = 0; i < nrows * maxCOLS; i++) {
+	s[i].ccode = ' ';
+	s[i].fg = mode3279? HOST_COLOR_BLUE : HOST_COLOR_NEUTRAL_WHITE;
+	s[i].bg = HOST_COLOR_NEUTRAL_BLACK;
+    }
+}
+
+/*
+ * Find the field attribute in effect at the start of a row, the same way a
+ * render of the whole screen would.
+ */
+static int
+row_field_attribute(struct ea *ea, int baddr)
+{
+    if (formatted) {
+	return find_field_attribute(baddr);
+    }
+
+    /*
+     * The screen can be marked unformatted while it still holds field
+     * attributes. A full render starts with the default attribute and
+     * picks them up as it goes.
+     */
+    while (--baddr >= 0) {
+	if (ea[baddr].fa) {
+	    return baddr;
+	}
+    }
+    return -1;
+}
+
+/*
+ * Render a range of rows into a buffer.
  *
  * ea: ROWS*COLS screen buffer to render
  * s: maxROWS*maxCOLS screen_t to render into
+ * first_row: first row to render
+ * nrows: number of rows to render
  */
-void
-render_screen(struct ea *ea, screen_t *s)
+static void
+render_rows(struct ea *ea, screen_t *s, int first_row, int nrows)
 {
     int i;
     ucs4_t uc;
-    int fa_addr = find_field_attribute(0);
+    int fa_addr = row_field_attribute(ea, first_row * COLS);
     unsigned char fa = ea[fa_addr].fa;
     int fa_fg;
     int fa_bg;
@@ -366,12 +417,7 @@ render_screen(struct ea *ea, screen_t *s)
     bool fa_high;
 
     /* Start with all blanks, blue on black. */
-    memset(s, 0, maxROWS * maxCOLS * sizeof(screen_t));
-    for (i = 0; i < maxROWS * maxCOLS; i++) {
-	s[i].ccode = ' ';
-	s[i].fg = mode3279? HOST_COLOR_BLUE : HOST_COLOR_NEUTRAL_WHITE;
-	s[i].bg = HOST_COLOR_NEUTRAL_BLACK;
-    }
+    blank_rows(s, first_row, nrows);
 
     if (ea[fa_addr].fg) {
 	fa_fg = ea[fa_addr].fg & 0x0f;
@@ -393,7 +439,7 @@ render_screen(struct ea *ea, screen_t *s)
 
     fa_gr = ea[fa_addr].gr;
 
-    for (i = 0; i < ROWS * COLS; i++) {
+    for (i = first_row * COLS; i < (first_row + nrows) * COLS; i++) {
 	int fg_color, bg_color;
 	bool high;
 	bool dbcs = false;
@@ -597,6 +643,97 @@ render_screen(struct ea *ea, screen_t *s)
     }
 }
 
+/*
+ * Render the screen into a buffer.
+ *
+ * ea: ROWS*COLS screen buffer to render
+ * s: maxROWS*maxCOLS screen_t to render into
+ */
+void
+render_screen(struct ea *ea, screen_t *s)
+{
+    blank_rows(s, ROWS, maxROWS - ROWS);
+    render_rows(ea, s, 0, ROWS);
+}
+
+/*
+ * Find the rows that need to be re-rendered, by comparing the saved buffer
+ * with the current one.
+ *
+ * A changed field attribute changes the rendering of every cell up to the
+ * next field attribute, and a change to the right half of a DBCS character
+ * changes the rendering of the left half, so the set of dirty rows is widened
+ * to cover both.
+ *
+ * Returns the number of dirty rows, or -1 if the whole screen needs to be
+ * rendered.
+ */
+static int
+find_dirty_rows(void)
+{
+    int row, col;
+    int ndirty = 0;
+    int fa_first = -1;
+    int fa_last = -1;
+
+    for (row = 0; row < ROWS; row++) {
+	row_dirty[row] = false;
+    }
+    for (row = 0; row < ROWS; row++) {
+	struct ea *o = saved_ea + (row * COLS);
+	struct ea *n = ea_buf + (row * COLS);
+
+	if (!memcmp(o, n, COLS * sizeof(struct ea))) {
+	    continue;
+	}
+	row_dirty[row] = true;
+	ndirty++;
+
+	/* Look for changed field attributes. */
+	for (col = 0; col < COLS; col++) {
+	    if ((o[col].fa || n[col].fa) &&
+		    memcmp(&o[col], &n[col], sizeof(struct ea))) {
+		if (fa_first < 0) {
+		    fa_first = (row * COLS) + col;
+		}
+		fa_last = (row * COLS) + col;
+	    }
+	}
+
+	/* Check for a DBCS character split across rows. */
+	if (row > 0 && !row_dirty[row - 1] &&
+		ctlr_dbcs_state((row * COLS) - 1) == DBCS_LEFT) {
+	    row_dirty[row - 1] = true;
+	    ndirty++;
+	}
+    }
+
+    if (fa_first >= 0) {
+	int baddr;
+	int last_row = -1;
+
+	/* Extend the dirty region to the next field attribute. */
+	for (baddr = fa_last + 1; baddr < ROWS * COLS; baddr++) {
+	    if (ea_buf[baddr].fa) {
+		last_row = baddr / COLS;
+		break;
+	    }
+	}
+	if (last_row < 0) {
+	    /* The field wraps around the end of the screen. */
+	    return -1;
+	}
+	for (row = fa_first / COLS; row <= last_row; row++) {
+	    if (!row_dirty[row]) {
+		row_dirty[row] = true;
+		ndirty++;
+	    }
+	}
+    }
+
+    return ndirty;
+}
+
 /* Generate one row's worth of raw diffs. */
 static rowdiff_t *
 generate_rowdiffs(screen_t *oldr, screen_t *newr)
@@ -895,7 +1032,7 @@ emit_cursor_cond(bool with_screen)
  * Emit the diff between two screens.
  */
 static void
-emit_diff(screen_t *old, screen_t *new)
+emit_diff(screen_t *old, screen_t *new, bool *dirty)
 {
     int row;
 
@@ -912,7 +1049,7 @@ emit_diff(screen_t *old, screen_t *new)
 
     for (row = 0; row < maxROWS; row++) {
 
-	if (memcmp(old + (row * maxCOLS), new + (row * maxCOLS),
+	if (dirty[row] && memcmp(old + (row * maxCOLS), new + (row * maxCOLS),
 		sizeof(screen_t) * maxCOLS)) {
 	    if (XML_MODE) {
 		uix_push(IndRow,
@@ -960,9 +1097,11 @@ screen_disp_cond(bool always)
 {
     bool sent_erase = false;
     size_t se = ROWS * COLS * sizeof(struct ea);
-    size_t ss = maxROWS * maxCOLS * sizeof(screen_t);
     bool empty;
     int i;
+    int ndirty = -1;
+    int row;
+    bool full;
     screen_t *s;
     static bool xformatted = false;
 
@@ -977,12 +1116,12 @@ screen_disp_cond(bool always)
     }
 
     /* Check for no change. */
-    if (!always &&
-	saved_rows == ROWS &&
-	saved_cols == COLS &&
-	!memcmp(saved_ea, ea_buf, se)) {
-	emit_cursor_cond(true);
-	return;
+    if (saved_rows == ROWS && saved_cols == COLS) {
+	ndirty = find_dirty_rows();
+	if (!always && ndirty == 0) {
+	    emit_cursor_cond(true);
+	    return;
+	}
     }
 
     /* Check for now empty. */
@@ -1012,22 +1151,60 @@ screen_disp_cond(bool always)
 		AttrState, AT_BOOLEAN, formatted,
 		NULL);
 	xformatted = formatted;
+	render_all = true;
     }
 
-    /* Render the new screen. */
-    s = Malloc(ss);
-    render_screen(ea_buf, s);
+    full = always || render_all || saved_ea_is_empty || ndirty < 0;
+    if (full) {
+	/* Render the whole screen. */
+	render_screen(ea_buf, render_s);
+	for (row = 0; row < maxROWS; row++) {
+	    row_dirty[row] = true;
+	}
+    } else {
+	/* Render just the rows that changed. */
+	for (row = 0; row < ROWS; row++) {
+	    int nrows = 0;
+
+	    while (row + nrows < ROWS && row_dirty[row + nrows]) {
+		nrows++;
+	    }
+	    if (nrows) {
+		render_rows(ea_buf, render_s, row, nrows);
+		row += nrows;
+	    }
+	}
+	for (row = ROWS; row < maxROWS; row++) {
+	    row_dirty[row] = false;
+	}
+    }
 
     /* Tell them what the screen looks like now. */
-    emit_diff(saved_s, s);
+    emit_diff(saved_s, render_s, row_dirty);
 
     /* Save the screen for next time. */
-    Replace(saved_ea, Malloc(se));
-    memcpy(saved_ea, ea_buf, se);
+    if (saved_rows != ROWS || saved_cols != COLS) {
+	Replace(saved_ea, Malloc(se));
+    }
+    if (full) {
+	memcpy(saved_ea, ea_buf, se);
+	s = saved_s;
+	saved_s = render_s;
+	render_s = s;
+    } else {
+	for (row = 0; row < ROWS; row++) {
+	    if (row_dirty[row]) {
+		memcpy(saved_ea + (row * COLS), ea_buf + (row * COLS),
+			COLS * sizeof(struct ea));
+		memcpy(saved_s + (row * maxCOLS), render_s + (row * maxCOLS),
+			maxCOLS * sizeof(screen_t));
+	    }
+	}
+    }
     saved_ea_is_empty = false;
-    Replace(saved_s, s);
     saved_rows = ROWS;
     saved_cols = COLS;
+    render_all = false;
 }
 
 /*
@@ -1065,7 +1242,8 @@ screen_scroll(unsigned char fg, unsigned char bg)
 	}
     }
 
-    /* Scroll saved_s. */
+    /* Scroll saved_s, and re-render everything next time. */
+    render_all = true;
     memmove(saved_s, saved_s + COLS,
 	    (maxROWS - 1) * maxCOLS * sizeof(screen_t));
     memset(saved_s + (maxROWS - 1) * maxCOLS, 0, maxCOLS * sizeof(screen_t));
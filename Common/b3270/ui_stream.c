@@ -36,8 +36,11 @@
 
 #if !defined(_WIN32) /*[*/
 # include <unistd.h>
+# include <fcntl.h>
+# include <limits.h>
 # include <netinet/in.h>
-# include <sys/select.h>
+# include <poll.h>
+# include <sys/uio.h>
 # include <arpa/inet.h>
 #endif /*]*/
 #include <assert.h>
@@ -57,10 +60,12 @@
 #include "resources.h"
 #include "screen.h"
 #include "task.h"
+#include "toggles.h"
 #include "trace.h"
 #include "txa.h"
 #include "utf8.h"
 #include "utils.h"
+#include "varbuf.h"
 #include "xio.h"
 
 #if defined(_WIN32) /*[*/
@@ -104,15 +109,9 @@ static struct {
     bool need_reset;
 } uix;
 
-/* JSON container stack. */
-typedef struct _uij_container {
-    struct _uij_container *next;
-    json_t *j;	/* object or array */
-} uij_container_t;
-
 /* JSON state. */
 static struct {
-    uij_container_t *container;
+    json_writer_t *writer;	/* output writer */
     char *pending_input;
     int line;
     int column;
@@ -178,54 +177,307 @@ static void xml_start(void *userData, const XML_Char *name,
 	const XML_Char **atts);
 static void xml_end(void *userData, const XML_Char *name);
 static void xml_data(void *userData, const XML_Char *s, int len);
-static void uij_add_to_parent(const char *name, json_t *j);
+static json_writer_t *uij_writer(void);
+
+/*
+ * UI output buffering.
+ *
+ * Output is accumulated in a chain of chunks and written out once per pass
+ * through the main loop, so a whole indication (or several) goes out in one
+ * system call. If the peer is slow to read, the rest is written when the
+ * output side becomes writable again.
+ *
+ * A callback socket belongs to the emulator and is made non-blocking.
+ * Standard output is shared with whoever started the emulator, so its flags
+ * are left alone; instead, it is polled for writability first and given no
+ * more than PIPE_BUF bytes at a time, which a writable pipe can always take.
+ */
+
+/* Output chunk. */
+typedef struct ui_chunk {
+    struct ui_chunk *next;
+    size_t size;	/* allocated size of buf */
+    size_t len;		/* bytes stored in buf */
+    size_t off;		/* bytes already written */
+    char *buf;
+} ui_chunk_t;
+
+#define UI_CHUNK_SIZE		16384
+#define UI_FLUSH_THRESHOLD	(4 * UI_CHUNK_SIZE)
+#define UI_MAX_PENDING		(16 * 1024 * 1024)
+#define UI_MAX_IOV		64
+
+static struct {
+    ui_chunk_t *head;		/* first chunk */
+    ui_chunk_t *tail;		/* last chunk */
+    size_t pending;		/* bytes not yet written */
+    varbuf_t trace_line;	/* partial line for tracing */
+#if !defined(_WIN32) /*[*/
+    ioid_t output_id;		/* output-possible callback */
+    bool nonblocking;		/* output side is non-blocking */
+#endif /*]*/
+} uo;
+
+static void ui_flush_out(bool block);
+
+/* Allocate a new output chunk big enough for len bytes. */
+static ui_chunk_t *
+ui_new_chunk(size_t len)
+{
+    size_t size = (len < UI_CHUNK_SIZE)? UI_CHUNK_SIZE: len;
+    ui_chunk_t *c = (ui_chunk_t *)Malloc(sizeof(ui_chunk_t) + size);
+
+    c->next = NULL;
+    c->size = size;
+    c->len = 0;
+    c->off = 0;
+    c->buf = (char *)(c + 1);
+    if (uo.tail != NULL) {
+	uo.tail->next = c;
+    } else {
+	uo.head = c;
+    }
+    uo.tail = c;
+    return c;
+}
+
+/* Trace output, one line at a time. */
+static void
+ui_trace_out(const char *s, size_t len)
+{
+    const char *newline;
+
+    if (!toggled(TRACING)) {
+	vb_reset(&uo.trace_line);
+	return;
+    }
+
+    while ((newline = memchr(s, '\n', len)) != NULL) {
+	size_t n = newline - s + 1;
+
+	if (vb_len(&uo.trace_line)) {
+	    vb_append(&uo.trace_line, s, n);
+	    vtrace("ui> %.*s", (int)vb_len(&uo.trace_line),
+		    vb_buf(&uo.trace_line));
+	    vb_reset(&uo.trace_line);
+	} else {
+	    vtrace("ui> %.*s", (int)n, s);
+	}
+	s += n;
+	len -= n;
+    }
+    if (len) {
+	vb_append(&uo.trace_line, s, len);
+    }
+}
 
 /* Write to the UI socket. */
 static void
 uprintf(const char *fmt, ...)
 {
     va_list ap;
-    char *s;
-    static char *pending_trace = NULL;
-    ssize_t nw;
-
-    va_start(ap, fmt);
-    s = Vasprintf(fmt, ap);
-    va_end(ap);
-    if (ui_socket != INVALID_SOCKET) {
-	nw = send(ui_socket, s, (int)strlen(s), 0);
+    ui_chunk_t *c = uo.tail;
+    size_t room = (c != NULL)? c->size - c->len: 0;
+    int n;
+
+    /* Try formatting directly into the last chunk. */
+    if (room > 0) {
+	va_start(ap, fmt);
+	n = vsnprintf(c->buf + c->len, room, fmt, ap);
+	va_end(ap);
+	if (n < 0) {
+	    return;
+	}
     } else {
-	nw = write(fileno(stdout), s, (int)strlen(s));
+	n = -1;
     }
 
-    if (pending_trace != NULL) {
-	char *pt = Asprintf("%s%s", pending_trace, s);
+    if (n < 0 || (size_t)n >= room) {
+	/* It didn't fit. Start a new chunk. */
+	va_start(ap, fmt);
+	n = vsnprintf(NULL, 0, fmt, ap);
+	va_end(ap);
+	if (n < 0) {
+	    return;
+	}
+	c = ui_new_chunk((size_t)n + 1);
+	va_start(ap, fmt);
+	vsnprintf(c->buf, c->size, fmt, ap);
+	va_end(ap);
+    }
 
-	Replace(pending_trace, pt);
-	Free(s);
-    } else {
-	pending_trace = s;
+    ui_trace_out(c->buf + c->len, (size_t)n);
+    c->len += n;
+    uo.pending += n;
+
+    /* Don't let too much pile up. */
+    if (uo.pending >= UI_MAX_PENDING) {
+	ui_flush_out(true);
+    } else if (uo.pending >= UI_FLUSH_THRESHOLD) {
+	ui_flush_out(false);
     }
-    if (strlen(pending_trace) > 0 &&
-	    pending_trace[strlen(pending_trace) - 1] == '\n') {
-	char *t = pending_trace;
+}
 
-	while (*t) {
-	    char *newline = strchr(t, '\n');
+/* Discard written (or unwritable) output. */
+static void
+ui_consume(size_t n, bool all)
+{
+    while (uo.head != NULL) {
+	ui_chunk_t *c = uo.head;
+	size_t avail = c->len - c->off;
 
-	    vtrace("ui> %.*s", (int)(newline - t) + 1, t);
-	    t = newline + 1;
+	if (!all && n < avail) {
+	    c->off += n;
+	    uo.pending -= n;
+	    return;
+	}
+	if (!all) {
+	    n -= avail;
 	}
-	Replace(pending_trace, NULL);
+	uo.pending -= avail;
+	uo.head = c->next;
+	if (uo.head == NULL) {
+	    uo.tail = NULL;
+	}
+	Free(c);
     }
+}
 
-    if (nw < 0) {
+#if !defined(_WIN32) /*[*/
+/* The UI output side is writable again. */
+static void
+ui_output_possible(iosrc_t fd _is_unused, ioid_t id _is_unused)
+{
+    ui_flush_out(false);
+}
+
+/*
+ * Wait for the UI output side to become writable.
+ * Returns true if it is writable, false if the wait timed out.
+ */
+static bool
+ui_wait_output(int fd, int timeout_ms)
+{
+    struct pollfd pfd;
+
+    pfd.fd = fd;
+    pfd.events = POLLOUT;
+    pfd.revents = 0;
+    while (poll(&pfd, 1, timeout_ms) < 0) {
+	if (errno != EINTR) {
+	    /* Let the write report the problem. */
+	    return true;
+	}
+    }
+    return pfd.revents != 0;
+}
+#endif /*]*/
+
+/*
+ * Write out buffered output.
+ * If block is true, wait until it has all been written.
+ */
+static void
+ui_flush_out(bool block)
+{
+#if !defined(_WIN32) /*[*/
+    int fd = (ui_socket != INVALID_SOCKET)? ui_socket: fileno(stdout);
+    struct iovec iov[UI_MAX_IOV];
+
+    while (uo.pending > 0) {
+	ui_chunk_t *c;
+	int niov = 0;
+	size_t limit = SIZE_MAX;
+	ssize_t nw;
+
+	if (!uo.nonblocking && !block) {
+	    /* Write only what can be written without blocking. */
+	    if (!ui_wait_output(fd, 0)) {
+		if (uo.output_id == NULL_IOID) {
+		    uo.output_id = AddOutput(fd, ui_output_possible);
+		}
+		return;
+	    }
+	    limit = PIPE_BUF;
+	}
+
+	for (c = uo.head; c != NULL && niov < UI_MAX_IOV && limit > 0;
+		c = c->next) {
+	    if (c->len > c->off) {
+		size_t len = c->len - c->off;
+
+		if (len > limit) {
+		    len = limit;
+		}
+		iov[niov].iov_base = c->buf + c->off;
+		iov[niov].iov_len = len;
+		niov++;
+		limit -= len;
+	    }
+	}
+	nw = writev(fd, iov, niov);
+	if (nw < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+		if (block) {
+		    ui_wait_output(fd, -1);
+		    continue;
+		}
+		if (uo.output_id == NULL_IOID) {
+		    uo.output_id = AddOutput(fd, ui_output_possible);
+		}
+		return;
+	    }
+	    vtrace("UI write failure: %s\n", strerror(errno));
+	    ui_consume(0, true);
+	    break;
+	}
+	ui_consume((size_t)nw, false);
+    }
+
+    if (uo.output_id != NULL_IOID) {
+	RemoveInput(uo.output_id);
+	uo.output_id = NULL_IOID;
+    }
+#else /*][*/
+    while (uo.head != NULL) {
+	ui_chunk_t *c = uo.head;
+	ssize_t nw;
+
+	if (ui_socket != INVALID_SOCKET) {
+	    nw = send(ui_socket, c->buf + c->off, (int)(c->len - c->off), 0);
+	} else {
+	    nw = write(fileno(stdout), c->buf + c->off,
+		    (int)(c->len - c->off));
+	}
+	if (nw < 0) {
 	    vtrace("UI write failure: %s\n",
-#if defined(_WIN32) /*[*/
 		    (ui_socket != INVALID_SOCKET)?
 			win32_strerror(GetLastError()):
+			strerror(errno));
+	    ui_consume(0, true);
+	    break;
+	}
+	ui_consume((size_t)nw, false);
+    }
+#endif /*]*/
+}
+
+/**
+ * Write out whatever UI output has been buffered. Called once per pass
+ * through the main loop.
+ */
+void
+ui_flush(void)
+{
+    if (uo.pending > 0
+#if !defined(_WIN32) /*[*/
+	    && uo.output_id == NULL_IOID
 #endif /*]*/
-		    strerror(errno));
+	    ) {
+	ui_flush_out(false);
     }
 }
 
@@ -370,7 +622,8 @@ ui_leaf(const char *name, ...)
 	const char *tag;
 	bool toplevel = false;
 
-	if (uij.container == NULL || json_is_array(uij.container->j)) {
+	if (!json_writer_depth(uij_writer()) ||
+		json_writer_in_array(uij_writer())) {
 	    uij_open_object(NULL);
 	    toplevel = true;
 	}
@@ -516,87 +769,56 @@ ui_add_element(const char *tag, ui_attr_t attr, ...)
 	}
 	va_end(ap);
     } else {
-	json_t *j = NULL;
-	assert(uij.container != NULL);
-	bool add = true;
+	json_writer_t *w = uij_writer();
+	json_t *j;
 
+	assert(json_writer_depth(w) > 0);
 	va_start(ap, attr);
 	switch (attr) {
 	case AT_STRING:
 	    value = va_arg(ap, const char *);
-	    if (value == NULL) {
-		va_end(ap);
-		return;
+	    if (value != NULL) {
+		json_writer_string(w, tag, value, NT);
 	    }
-	    j = json_string(value, NT);
 	    break;
 	case AT_INT:
-	    j = json_integer(va_arg(ap, int64_t));
+	    json_writer_integer(w, tag, va_arg(ap, int64_t));
 	    break;
 	case AT_SKIP_INT:
 	    (void) va_arg(ap, int64_t);
-	    add = false;
 	    break;
 	case AT_DOUBLE:
-	    j = json_double(va_arg(ap, double));
+	    json_writer_double(w, tag, va_arg(ap, double));
 	    break;
 	case AT_BOOLEAN:
-	    j = json_boolean(va_arg(ap, int));
+	    json_writer_boolean(w, tag, va_arg(ap, int));
 	    break;
 	case AT_SKIP_BOOLEAN:
 	    (void) va_arg(ap, int);
-	    add = false;
 	    break;
 	case AT_NODE:
+	    /* The node is consumed. */
 	    j = va_arg(ap, json_t *);
-	    if (j == NULL) {
-		va_end(ap);
-		return;
+	    if (j != NULL) {
+		json_writer_node(w, tag, j);
+		json_free(j);
 	    }
+	    break;
 	}
-
 	va_end(ap);
-	if (add) {
-	    uij_add_to_parent(tag, j);
-	}
     }
 }
 
 /* JSON-specific functions. */
 
-/* Add to a parent. */
-static void
-uij_add_to_parent(const char *name, json_t *j)
+/* Get the JSON writer, creating it if needed. */
+static json_writer_t *
+uij_writer(void)
 {
-    json_t *parent = uij.container->j;
-
-    /* Add to the parent container. */
-    if (json_is_object(parent)) {
-	assert(name != NULL);
-	json_object_set(parent, name, NT, j);
-    } else {
-	assert(name == NULL);
-	json_array_append(parent, j);
+    if (uij.writer == NULL) {
+	uij.writer = json_writer_new(JW_OPTS);
     }
-}
-
-/*
- * Add an empty container, and leave it open.
- */
-static void
-uij_open(const char *name, json_t *j)
-{
-    uij_container_t *jc;
-
-    if (uij.container != NULL) {
-	uij_add_to_parent(name, j);
-    }
-
-    /* Push this on the stack. */
-    jc = Malloc(sizeof(uij_container_t));
-    jc->j = j;
-    jc->next = uij.container;
-    uij.container = jc;
+    return uij.writer;
 }
 
 /*
@@ -605,7 +827,7 @@ uij_open(const char *name, json_t *j)
 void
 uij_open_object(const char *name)
 {
-    uij_open(name, json_object());
+    json_writer_begin_object(uij_writer(), name);
 }
 
 /*
@@ -614,42 +836,38 @@ uij_open_object(const char *name)
 void
 uij_open_array(const char *name)
 {
-    uij_open(name, json_array());
+    json_writer_begin_array(uij_writer(), name);
 }
 
-/* Close an open container. */
+/* Write out a completed top-level container. */
 static void
-uij_close(void)
+uij_complete(void)
 {
-    uij_container_t *jc = uij.container;
-
-    if (jc->next == NULL) {
-	char *s = json_write_o(jc->j, JW_OPTS);
+    if (!json_writer_depth(uij.writer)) {
+	size_t len;
+	const char *buf = json_writer_buf(uij.writer, &len);
 
-	uprintf("%s\n", s);
-	Free(s);
-	json_free(jc->j);
+	uprintf("%.*s\n", (int)len, buf);
+	json_writer_reset(uij.writer);
     }
-    uij.container = jc->next;
-    Free(jc);
 }
 
 /* Close an open object. */
 void
 uij_close_object(void)
 {
-    assert(uij.container != NULL);
-    assert(json_is_object(uij.container->j));
-    uij_close();
+    assert(uij.writer != NULL);
+    json_writer_end_object(uij.writer);
+    uij_complete();
 }
 
 /* Close an open array. */
 void
 uij_close_array(void)
 {
-    assert(uij.container != NULL);
-    assert(json_is_array(uij.container->j));
-    uij_close();
+    assert(uij.writer != NULL);
+    json_writer_end_array(uij.writer);
+    uij_complete();
 }
 
 /* Action execution support. */
@@ -1628,6 +1846,9 @@ ui_exiting(bool ignored)
 	    uix_pop();
 	}
     }
+
+    /* Write out anything that is still buffered. */
+    ui_flush_out(true);
 }
 
 /**
@@ -1770,6 +1991,19 @@ ui_io_init(void)
 
 #if !defined(_WIN32) /*[*/
     AddInput((ui_socket != INVALID_SOCKET)? ui_socket: fileno(stdin), ui_input);
+
+    /*
+     * Make the callback socket non-blocking, so a slow peer cannot stall the
+     * emulator. Standard output is shared, so it is polled instead.
+     */
+    if (ui_socket != INVALID_SOCKET) {
+	int f;
+
+	if ((f = fcntl(ui_socket, F_GETFL, 0)) != -1 &&
+		fcntl(ui_socket, F_SETFL, f | O_NONBLOCK) == 0) {
+	    uo.nonblocking = true;
+	}
+    }
 #else /*][*/
     /* Set up the peer thread. */
     if (ui_socket != INVALID_SOCKET) {
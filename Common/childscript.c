@@ -431,26 +431,17 @@ close_child(child_t *c)
  * Read the next command from a child pipe.
  * @param[in] fd	File descriptor
  * @param[in] id	I/O identifier
+ * @param[in] data	Child
  */
 static void
-child_input(iosrc_t fd _is_unused, ioid_t id)
+child_input(iosrc_t fd _is_unused, ioid_t id _is_unused, void *data)
 {
-    child_t *c;
-    bool found_child = false;
+    child_t *c = (child_t *)data;
     char buf[8192];
     size_t n2r;
     size_t nr;
     size_t i;
 
-    /* Find the child. */
-    FOREACH_LLIST(&child_scripts, c, child_t *) {
-	if (c->id == id) {
-	    found_child = true;
-	    break;
-	}
-    } FOREACH_LLIST_END(&child_scripts, c, child_t *);
-    assert(found_child);
-
     /* Read input. */
     n2r = sizeof(buf);
     nr = read(c->infd, buf, (int)n2r);
@@ -489,7 +480,7 @@ child_input(iosrc_t fd _is_unused, ioid_t id)
     /* Run the next command, if we have it all. */
     if (!run_next(c) && c->id == NULL_IOID) {
 	/* Get more input. */
-	c->id = AddInput(c->infd, child_input);
+	c->id = AddInputData(c->infd, child_input, c);
     }
 }
 
@@ -497,26 +488,17 @@ child_input(iosrc_t fd _is_unused, ioid_t id)
  * Read output from a child script.
  * @param[in] fd	File descriptor
  * @param[in] id	I/O identifier
+ * @param[in] data	Child
  */
 static void
-child_stdout(iosrc_t fd _is_unused, ioid_t id)
+child_stdout(iosrc_t fd _is_unused, ioid_t id _is_unused, void *data)
 {
-    child_t *c;
-    bool found_child = false;
+    child_t *c = (child_t *)data;
     char buf[8192];
     size_t n2r;
     size_t nr;
     size_t new_buflen;
 
-    /* Find the child. */
-    FOREACH_LLIST(&child_scripts, c, child_t *) {
-	if (c->stdout_id == id) {
-	    found_child = true;
-	    break;
-	}
-    } FOREACH_LLIST_END(&child_scripts, c, child_t *);
-    assert(found_child);
-
     /* Read input. */
     n2r = sizeof(buf);
     nr = read(fd, buf, (int)n2r);
@@ -641,7 +623,7 @@ child_done(task_cbh handle, bool success, bool abort)
     new_child = run_next(c);
     if (!new_child && c->id == NULL_IOID && c->infd != -1) {
 	/* Allow more input. */
-	c->id = AddInput(c->infd, child_input);
+	c->id = AddInputData(c->infd, child_input, c);
     }
 
     /*
@@ -980,24 +962,11 @@ child_exited(ioid_t id, int status)
 #if defined(_WIN32) /*[*/
 /* Process an event on a child script handle (a process exit). */
 static void
-child_exited(iosrc_t fd _is_unused, ioid_t id _is_unused)
+child_exited(iosrc_t fd _is_unused, ioid_t id _is_unused, void *data)
 {
-    child_t *c;
-    bool found_child = false;
+    child_t *c = (child_t *)data;
     DWORD status;
 
-    FOREACH_LLIST(&child_scripts, c, child_t *) {
-	if (c->exit_id == id) {
-	    found_child = true;
-	    break;
-	}
-    } FOREACH_LLIST_END(&child_scripts, c, child_t *);
-
-    if (!found_child) {
-	vtrace("child_exited: no match\n");
-	return;
-    }
-
     status = 0;
     if (GetExitCodeProcess(c->child_handle, &status) == 0) {
 	popup_an_error("GetExitCodeProcess failed: %s",
@@ -1058,22 +1027,10 @@ child_read_thread(LPVOID parameter)
 
 /* The child stdout/stderr thread produced output. */
 static void
-cr_output(iosrc_t fd, ioid_t id)
+cr_output(iosrc_t fd _is_unused, ioid_t id _is_unused, void *data)
 {
-    child_t *c;
-    bool found_child = false;
-
-    /* Find the descriptor. */
-    FOREACH_LLIST(&child_scripts, c, child_t *) {
-	if (c->cr.done_id == id) {
-	    found_child = true;
-	    break;
-	}
-    } FOREACH_LLIST_END(&child_scripts, c, child_t *);
-    assert(found_child);
-
     /* Collect the output. */
-    cr_collect(c);
+    cr_collect((child_t *)data);
 }
 
 /* Set up the stdout reader context. */
@@ -1114,7 +1071,7 @@ setup_cr(child_t *c)
     cr->enable_event = CreateEvent(NULL, FALSE, FALSE, NULL);
     cr->done_event = CreateEvent(NULL, FALSE, FALSE, NULL);
     cr->read_thread = CreateThread(NULL, 0, child_read_thread, c, 0, NULL);
-    cr->done_id = AddInput(cr->done_event, cr_output);
+    cr->done_id = AddInputData(cr->done_event, cr_output, c);
 
     return true;
 }
@@ -1353,11 +1310,11 @@ Script_action(ia_t ia, unsigned argc, const char **argv)
     c->listeners = listeners; /* struct copy */
 
     /* Allow child pipe input. */
-    c->id = AddInput(c->infd, child_input);
+    c->id = AddInputData(c->infd, child_input, c);
 
     /* Capture child output. */
     c->stdout_id = interactive? NULL_IOID:
-	AddInput(c->stdoutpipe, child_stdout);
+	AddInputData(c->stdoutpipe, child_stdout, c);
 
 #else /*]*/
 
@@ -1443,7 +1400,8 @@ Script_action(ia_t ia, unsigned argc, const char **argv)
      * Note that this is an asynchronous event -- exits for multiple
      * children can happen in any order.
      */
-    c->exit_id = AddInput(process_information.hProcess, child_exited);
+    c->exit_id = AddInputData(process_information.hProcess, child_exited,
+	    c);
 
 #endif /*]*/
 
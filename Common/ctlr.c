@@ -120,6 +120,28 @@ static bool ctlr_initted = false;
 
 static void ticking_stop(struct timeval *tp);
 
+/*
+ * Field attribute map for ea_buf.
+ *
+ * fa_map[baddr] is the address of the field attribute that governs baddr, or
+ * -1 if there are no field attributes. fa_next[faddr] is the address of the
+ * next field attribute after faddr, wrapping around the end of the buffer.
+ *
+ * Adding or removing a single field attribute updates the map in place.
+ * Bulk changes to ea_buf just mark it invalid, and it is rebuilt on the next
+ * lookup. It is not consulted or rebuilt while a host write is in progress,
+ * because field attributes are added in bulk and looked up close by.
+ */
+static int *fa_map = NULL;
+static int *fa_next = NULL;
+static int fa_map_size = 0;		/* allocated entries */
+static int fa_map_cells = 0;		/* ROWS*COLS when built */
+static bool fa_map_valid = false;
+static bool fa_map_deferred = false;
+
+#define FA_MAP_INVALIDATE	{ fa_map_valid = false; }
+#define FA_MAP_CURRENT		(fa_map_valid && fa_map_cells == ROWS * COLS)
+
 /*
  * code_table is used to translate buffer addresses and attributes to the 3270
  * datastream representation
@@ -218,6 +240,7 @@ ctlr_reinit(unsigned cmask)
 
 	ea_buf[-1].fa  = FA_PRINTABLE | FA_MODIFY;
 	ea_buf[-1].ic  = 1;
+	FA_MAP_INVALIDATE;
 	aea_buf[-1].fa = FA_PRINTABLE | FA_MODIFY;
 	aea_buf[-1].ic = 1;
     }
@@ -427,6 +450,113 @@ ctlr_connect(bool ignored _is_unused)
     }
 }
 
+/*
+ * Rebuild the field attribute map from ea_buf.
+ */
+static void
+fa_map_build(void)
+{
+    int n = ROWS * COLS;
+    int baddr;
+    int owner = -1;
+    int prev;
+
+    if (n > fa_map_size) {
+	fa_map = (int *)Realloc(fa_map, n * sizeof(int));
+	fa_next = (int *)Realloc(fa_next, n * sizeof(int));
+	fa_map_size = n;
+    }
+
+    /* The last field attribute governs the start of the buffer. */
+    for (baddr = n - 1; baddr >= 0; baddr--) {
+	if (ea_buf[baddr].fa) {
+	    owner = baddr;
+	    break;
+	}
+    }
+
+    prev = owner;
+    for (baddr = 0; baddr < n; baddr++) {
+	if (ea_buf[baddr].fa) {
+	    fa_next[prev] = baddr;
+	    prev = owner = baddr;
+	}
+	fa_map[baddr] = owner;
+    }
+
+    fa_map_cells = n;
+    fa_map_valid = true;
+}
+
+/*
+ * Make sure the field attribute map is usable.
+ *
+ * @return true if fa_map and fa_next can be consulted
+ */
+static bool
+fa_map_ready(void)
+{
+    if (fa_map_deferred) {
+	return false;
+    }
+    if (!FA_MAP_CURRENT) {
+	fa_map_build();
+    }
+    return true;
+}
+
+/*
+ * Update the field attribute map after a field attribute has been added.
+ *
+ * @param[in] baddr	Address of the new field attribute
+ */
+static void
+fa_map_add(int baddr)
+{
+    int prev = fa_map[baddr];
+    int c;
+
+    if (prev == baddr) {
+	/* Already in the list; just refresh the addresses it governs. */
+    } else if (prev < 0) {
+	fa_next[baddr] = baddr;
+    } else {
+	fa_next[baddr] = fa_next[prev];
+	fa_next[prev] = baddr;
+    }
+
+    c = baddr;
+    do {
+	fa_map[c] = baddr;
+	INC_BA(c);
+    } while (c != baddr && !ea_buf[c].fa);
+}
+
+/*
+ * Update the field attribute map after a field attribute has been removed.
+ *
+ * @param[in] baddr	Address of the former field attribute
+ */
+static void
+fa_map_remove(int baddr)
+{
+    int owner = -1;
+    int c;
+
+    if (fa_next[baddr] != baddr) {
+	c = baddr;
+	DEC_BA(c);
+	owner = fa_map[c];
+	fa_next[owner] = fa_next[baddr];
+    }
+
+    c = baddr;
+    do {
+	fa_map[c] = owner;
+	INC_BA(c);
+    } while (c != baddr && !ea_buf[c].fa);
+}
+
 /*
  * Find the buffer address of the field attribute for a given buffer address.
  * Returns -1 if the screen isn't formatted.
@@ -436,6 +566,10 @@ find_field_attribute_ea(int baddr, struct ea *ea)
 {
     int sbaddr;
 
+    if (ea == ea_buf && fa_map_ready()) {
+	return fa_map[baddr];
+    }
+
     sbaddr = baddr;    
     do {   
 	if (ea[baddr].fa) {
@@ -486,6 +620,28 @@ get_bounded_field_attribute(register int baddr, register int bound,
 	return true;
     }
 
+    if (fa_map_ready()) {
+	int n = ROWS * COLS;
+	int faddr = fa_map[baddr];
+	int bound_dist = (bound == baddr)? n: (baddr - bound + n) % n;
+
+	if (faddr < 0) {
+	    /* Screen is unformatted (and 'formatted' is inaccurate). */
+	    if (bound == baddr) {
+		*fa_out = ea_buf[-1].fa;
+		return true;
+	    }
+	    return false;
+	}
+	if ((baddr - faddr + n) % n < bound_dist) {
+	    *fa_out = ea_buf[faddr].fa;
+	    return true;
+	}
+
+	/* Wrapped to boundary. */
+	return false;
+    }
+
     sbaddr = baddr;
     do {
 	if (ea_buf[baddr].fa) {
@@ -525,6 +681,29 @@ next_unprotected(int baddr0)
 {
     register int baddr, nbaddr;
 
+    if (fa_map_ready()) {
+	int first;
+
+	/* Walk the field attributes, starting at or after baddr0. */
+	if (ea_buf[baddr0].fa) {
+	    first = baddr0;
+	} else if (fa_map[baddr0] >= 0) {
+	    first = fa_next[fa_map[baddr0]];
+	} else {
+	    return 0;
+	}
+	baddr = first;
+	do {
+	    nbaddr = baddr;
+	    INC_BA(nbaddr);
+	    if (!FA_IS_PROTECTED(ea_buf[baddr].fa) && !ea_buf[nbaddr].fa) {
+		return nbaddr;
+	    }
+	    baddr = fa_next[baddr];
+	} while (baddr != first);
+	return 0;
+    }
+
     nbaddr = baddr0;
     do {
 	baddr = nbaddr;
@@ -1373,6 +1552,10 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
     default_ic = 0;
     trace_primed = true;
     buffer_addr = cursor_addr;
+
+    /* Rebuild the field attribute map once, after the write. */
+    FA_MAP_INVALIDATE;
+    fa_map_deferred = true;
     if (WCC_RESET(buf[1])) {
 	if (erase) {
 	    reply_mode = SF_SRM_FIELD;
@@ -2111,6 +2294,7 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 	    break;
 	}
     }
+    fa_map_deferred = false;
     set_formatted();
     END_TEXT0;
     trace_ds("\n");
@@ -2655,6 +2839,7 @@ ctlr_clear(bool can_snap)
 
     /* Clear the screen. */
     memset((char *)ea_buf, 0, ROWS*COLS*sizeof(struct ea));
+    FA_MAP_INVALIDATE;
     ALL_CHANGED;
     cursor_move(0);
     buffer_addr = 0;
@@ -2710,7 +2895,12 @@ ctlr_add(int baddr, unsigned char c, unsigned char cs)
 	ONE_CHANGED(baddr);
 	ea_buf[baddr].ec = c;
 	ea_buf[baddr].cs = cs;
-	ea_buf[baddr].fa = 0;
+	if (ea_buf[baddr].fa) {
+	    ea_buf[baddr].fa = 0;
+	    if (FA_MAP_CURRENT) {
+		fa_map_remove(baddr);
+	    }
+	}
 	ea_buf[baddr].ucs4 = 0;
     }
 }
@@ -2740,7 +2930,12 @@ ctlr_add_nvt(int baddr, ucs4_t ucs4, unsigned char cs)
 	ea_buf[baddr].ucs4 = ucs4;
 	ea_buf[baddr].ec = 0;
 	ea_buf[baddr].cs = cs;
-	ea_buf[baddr].fa = 0;
+	if (ea_buf[baddr].fa) {
+	    ea_buf[baddr].fa = 0;
+	    if (FA_MAP_CURRENT) {
+		fa_map_remove(baddr);
+	    }
+	}
 
 	if (cs == CS_DBCS) {
 	    ea_buf[baddr].db = ucs4 == ' '? DBCS_RIGHT: DBCS_LEFT;
@@ -2762,6 +2957,9 @@ ctlr_add_fa(int baddr, unsigned char fa, unsigned char cs)
      * value will be non-zero.
      */
     ea_buf[baddr].fa = FA_PRINTABLE | (fa & FA_MASK);
+    if (FA_MAP_CURRENT) {
+	fa_map_add(baddr);
+    }
 }
 
 /* 
@@ -2895,6 +3093,7 @@ ctlr_bcopy(int baddr_from, int baddr_to, int count, int move_ea)
 		count * sizeof(struct ea))) {
 	memmove(&ea_buf[baddr_to], &ea_buf[baddr_from],
 		count * sizeof(struct ea));
+	FA_MAP_INVALIDATE;
 	REGION_CHANGED(baddr_to, baddr_to + count);
 	/*
 	 * For the time being, if any selected text shifts around on
@@ -2919,6 +3118,7 @@ ctlr_aclear(int baddr, int count, int clear_ea)
     if (memcmp((char *)&ea_buf[baddr], (char *)zero_buf,
 		count * sizeof(struct ea))) {
 	memset((char *) &ea_buf[baddr], 0, count * sizeof(struct ea));
+	FA_MAP_INVALIDATE;
 	REGION_CHANGED(baddr, baddr + count);
 	if (area_is_selected(baddr, count)) {
 	    unselect(baddr, count);
@@ -2954,6 +3154,7 @@ ctlr_scroll(unsigned char fg, unsigned char bg)
 
     /* Clear the last line. */
     memset((char *) &ea_buf[qty], 0, COLS * sizeof(struct ea));
+    FA_MAP_INVALIDATE;
     if ((fg & 0xf0) != 0xf0) {
 	fg = 0;
     }
@@ -2979,6 +3180,7 @@ ctlr_scroll(unsigned char fg, unsigned char bg)
 void
 ctlr_changed(int bstart, int bend)
 {
+    FA_MAP_INVALIDATE;
     REGION_CHANGED(bstart, bend);
 }
 
@@ -3016,6 +3218,7 @@ ctlr_altbuffer(bool alt)
 	etmp = ea_buf;
 	ea_buf = aea_buf;
 	aea_buf = etmp;
+	FA_MAP_INVALIDATE;
 
 #if defined(CHECK_AEA_BUF) /*[*/
 	stmp = ea_sum;
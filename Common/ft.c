@@ -51,9 +51,11 @@
 #include "kybd.h"
 #include "names.h"
 #include "popups.h"
+#include "query.h"
 #include "resources.h"
 #include "task.h"
 #include "toggles.h"
+#include "txa.h"
 #include "utils.h"
 #include "varbuf.h"
 #include <stdio.h>
@@ -84,6 +86,9 @@ char* add_closing_parenthesis(const char* input) {
 
 /* Macros. */
 
+/* True if a transfer is running and collecting statistics. */
+#define STATS_ACTIVE	(stats.valid && ft_state != FT_NONE)
+
 /* Globals. */
 enum ft_state ft_state = FT_NONE;	/* File transfer state */
 ft_conf_t *ftc;				/* Current file transfer config */
@@ -95,7 +100,14 @@ static ft_conf_t gui_ft_conf;		/* FT config for GUI (actually just
 					   c3270; x3270 uses its own) */
 static bool gui_conf_initted = false;
 
-static struct timeval t0;		/* Starting time */
+static uint64_t t0;			/* Starting time */
+static uint64_t request_us;		/* When the current host request
+					   arrived */
+static uint64_t reply_us;		/* When the last reply was sent, 0 if
+					   none yet */
+static bool request_pending;		/* A host request awaits a reply */
+static ft_stats_t stats;		/* Statistics for the current or most
+					   recent transfer */
 
 /* Translation table: "ASCII" to EBCDIC, as seen by IND$FILE. */
 unsigned char i_asc2ft[256] = {
@@ -193,6 +205,7 @@ static void ft_connected(bool ignored);
 static void ft_in3270(bool ignored);
 
 static action_t Transfer_action;
+static const char *ft_query_stats(void);
 
 /*
  * Toggle the buffer size.
@@ -231,6 +244,9 @@ ft_register(void)
     static action_table_t ft_actions[] = {
 	{ AnTransfer,	Transfer_action,	ACTION_KE }
     };
+    static query_t ft_queries[] = {
+	{ KwFtStats, ft_query_stats, NULL, false, false }
+    };
 
     /* Register for state changes. */
     register_schange(ST_CONNECT, ft_connected);
@@ -239,6 +255,9 @@ ft_register(void)
     /* Register actions. */
     register_actions(ft_actions, array_count(ft_actions));
 
+    /* Register queries. */
+    register_queries(ft_queries, array_count(ft_queries));
+
     /* Register the toggles. */
     register_extended_toggle(ResFtBufferSize, toggle_ft_buffer_size, NULL,
 	    NULL, (void **)&appres.ft.dft_buffer_size, XRM_INT);
@@ -533,6 +552,12 @@ ft_didnt_start(ioid_t id _is_unused)
 void
 ft_complete(const char *errmsg)
 {
+    /* Finish the statistics. */
+    if (STATS_ACTIVE) {
+	stats.elapsed_us = monotonic_us() - t0;
+	stats.length = fts.length;
+    }
+
     /* Close the local file. */
     if (fts.local_file != NULL && fclose(fts.local_file) < 0) {
 	popup_an_errno(errno, "close(%s)", fts.resolved_local_filename);
@@ -541,6 +566,7 @@ ft_complete(const char *errmsg)
 
     /* Clean up the state. */
     ft_state = FT_NONE;
+    request_pending = false;
     kybd_ft(false);
     if (ft_start_id != NULL_IOID) {
 	RemoveTimeOut(ft_start_id);
@@ -570,14 +596,11 @@ ft_complete(const char *errmsg)
 	ft_gui_complete_popup(msg_copy, true);
 	Free(msg_copy);
     } else {
-	struct timeval t1;
 	double bytes_sec;
 	char *buf;
+	char *action_buf;
 
-	gettimeofday(&t1, NULL);
-	bytes_sec = (double)fts.length /
-		((double)(t1.tv_sec - t0.tv_sec) + 
-		 (double)(t1.tv_usec - t0.tv_usec) / 1.0e6);
+	bytes_sec = (double)fts.length / ((double)stats.elapsed_us / 1.0e6);
 	buf = Asprintf(get_message("ftComplete"), fts.length,
 		display_scale(bytes_sec),
 		fts.is_cut ? "CUT" : "DFT");
@@ -586,8 +609,12 @@ ft_complete(const char *errmsg)
 	ft_gui_clear_progress();
 	ft_gui_complete_popup(buf, false);
 
-	/* Send the completion message to any waiting action. */
-	task_ft_complete(buf, false);
+	/* Send the completion message and statistics to any waiting action. */
+	action_buf = Asprintf("%s, %lu buffers, host wait %.3fs, local %.3fs",
+		buf, stats.buffers, (double)stats.host_us / 1.0e6,
+		(double)stats.local_us / 1.0e6);
+	task_ft_complete(action_buf, false);
+	Free(action_buf);
 	Free(buf);
     }
 }
@@ -611,12 +638,110 @@ ft_running(bool is_cut)
 	}
     }
     fts.is_cut = is_cut;
-    gettimeofday(&t0, NULL);
+    t0 = monotonic_us();
     fts.length = 0;
 
+    /* Start the statistics. */
+    memset(&stats, 0, sizeof(stats));
+    stats.valid = true;
+    stats.is_cut = is_cut;
+    reply_us = 0;
+
     ft_gui_running(fts.length);
 }
 
+/*
+ * Note the arrival of a request from the host.
+ * The time since the previous reply is the host's turnaround time. Further
+ * structured fields or frames before the reply are part of the same request.
+ */
+void
+ft_stats_request(void)
+{
+    uint64_t wait;
+    int bucket;
+    uint64_t limit;
+
+    if (request_pending) {
+	return;
+    }
+    request_pending = true;
+    request_us = monotonic_us();
+    if (!STATS_ACTIVE || !reply_us) {
+	return;
+    }
+
+    wait = request_us - reply_us;
+    stats.host_us += wait;
+    if (wait > stats.host_max_us) {
+	stats.host_max_us = wait;
+    }
+    for (bucket = 0, limit = 1000;
+	 bucket < FT_LATENCY_BUCKETS - 1 && wait >= limit;
+	 bucket++, limit *= 10) {
+    }
+    stats.latency[bucket]++;
+}
+
+/*
+ * Note that a host request has been processed and answered.
+ * The time since the request arrived was spent locally.
+ */
+void
+ft_stats_reply(void)
+{
+    bool pending = request_pending;
+
+    request_pending = false;
+    if (!STATS_ACTIVE || !pending) {
+	return;
+    }
+    reply_us = monotonic_us();
+    stats.local_us += reply_us - request_us;
+    stats.buffers++;
+}
+
+/* Return the statistics for the current or most recent transfer. */
+const ft_stats_t *
+ft_get_stats(void)
+{
+    if (STATS_ACTIVE) {
+	stats.elapsed_us = monotonic_us() - t0;
+	stats.length = fts.length;
+    }
+    return &stats;
+}
+
+/* Query the transfer statistics. */
+static const char *
+ft_query_stats(void)
+{
+    const ft_stats_t *s = ft_get_stats();
+    double elapsed;
+
+    if (!s->valid) {
+	return NULL;
+    }
+
+    elapsed = (double)s->elapsed_us / 1.0e6;
+    return txAsprintf("mode %s state %s bytes %lu buffers %lu "
+	    "elapsed %.6f bytes-per-sec %.0f buffers-per-sec %.1f "
+	    "host-wait %.6f host-wait-max %.6f local %.6f "
+	    "latency-1ms %lu latency-10ms %lu latency-100ms %lu "
+	    "latency-1s %lu latency-over-1s %lu",
+	    s->is_cut? "CUT": "DFT",
+	    (ft_state == FT_NONE)? "complete": "running",
+	    (unsigned long)s->length, s->buffers,
+	    elapsed,
+	    elapsed? (double)s->length / elapsed: 0.0,
+	    elapsed? (double)s->buffers / elapsed: 0.0,
+	    (double)s->host_us / 1.0e6,
+	    (double)s->host_max_us / 1.0e6,
+	    (double)s->local_us / 1.0e6,
+	    s->latency[0], s->latency[1], s->latency[2], s->latency[3],
+	    s->latency[4]);
+}
+
 /* Process a protocol-generated abort. */
 void
 ft_aborting(void)
@@ -842,6 +967,7 @@ ft_go(ft_conf_t *p, enum iaction cause)
     fts.is_cut = false;
     fts.last_dbcs = false;
     fts.dbcs_state = FT_DBCS_NONE;
+    memset(&stats, 0, sizeof(stats));
 
     ft_state = FT_AWAIT_ACK;
     kybd_ft(true);
@@ -392,6 +392,7 @@ void
 ft_cut_data(void)
 {
     if (ea_buf[O_SF].fa && FA_IS_SKIP(ea_buf[O_SF].fa)) {
+	ft_stats_request();
 	switch (ea_buf[O_FRAME_TYPE].ec) {
 	case FT_CONTROL_CODE:
 	    cut_control_code();
@@ -565,6 +566,7 @@ cut_data_request(void)
     ft_update_length();
     expanded_length += count;
     run_action(AnEnter, IA_FT, NULL, NULL);
+    ft_stats_reply();
 }
 
 /*
@@ -654,6 +656,7 @@ cut_ack(void)
 {
     trace_ds("> FT ACK\n");
     run_action(AnEnter, IA_FT, NULL, NULL);
+    ft_stats_reply();
 }
 
 /*
@@ -672,6 +675,7 @@ cut_abort(const char *s, unsigned short reason)
     ctlr_add(RO_REASON_CODE+1, LOW8(reason), 0);
     trace_ds("> FT CONTROL_CODE ABORT\n");
     run_action(AnPF, IA_FT, "2", NULL);
+    ft_stats_reply();
 
     /* Update the in-progress pop-up. */
     ft_aborting();
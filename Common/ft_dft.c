@@ -54,6 +54,8 @@
 #define END_TRANSFER	"TRANS03"	/* Message for xfer complete */
 
 #define DFT_MAX_UNGETC	32
+#define DFT_RBUF_SIZE	16384	/* local file read buffer size */
+#define DFT_MB_MAX	8	/* longest cached multi-byte expansion */
 
 /* Typedefs. */
 struct data_buffer {
@@ -78,6 +80,24 @@ static size_t dft_savebuf_len = 0;
 static size_t dft_savebuf_max = 0;
 static unsigned char dft_ungetc_cache[DFT_MAX_UNGETC];
 static size_t dft_ungetc_count = 0;
+static unsigned char dft_rbuf[DFT_RBUF_SIZE];	/* local file read buffer */
+static size_t dft_rbuf_len = 0;
+static size_t dft_rbuf_ix = 0;
+static char *dft_obuf = NULL;		/* download conversion buffer */
+static size_t dft_obuf_size = 0;
+
+/*
+ * Per-transfer translation caches. The code page and the host maps do not
+ * change during a transfer, so the result of converting a single byte can be
+ * computed once.
+ */
+static int dft_upmap[256];		/* upload: local byte to EBCDIC, -1 if
+					   not yet known */
+static struct {
+    int len;				/* -1 if not yet known */
+    char mb[DFT_MB_MAX];
+} dft_downmap[256];			/* download: host byte to local
+					   multi-byte */
 
 static void dft_abort(const char *s, unsigned short code);
 static void dft_close_request(void);
@@ -85,6 +105,7 @@ static void dft_data_insert(struct data_buffer *data_bufr);
 static void dft_get_request(void);
 static void dft_insert_request(void);
 static void dft_open_request(unsigned short len, unsigned char *cp);
+static void dft_reset_maps(void);
 static void dft_set_cur_req(void);
 
 /* Process a Transfer Data structured field from the host. */
@@ -99,6 +120,7 @@ ft_dft_data(unsigned char *data, int length _is_unused)
 	trace_ds(" (no transfer in progress)\n");
 	return;
     }
+    ft_stats_request();
 
     /* Get the length. */
     cp = (unsigned char *)(data_bufr->sf_length);
@@ -134,6 +156,18 @@ ft_dft_data(unsigned char *data, int length _is_unused)
     }
 }
 
+/* Invalidate the translation caches. */
+static void
+dft_reset_maps(void)
+{
+    int i;
+
+    for (i = 0; i < 256; i++) {
+	dft_upmap[i] = -1;
+	dft_downmap[i].len = -1;
+    }
+}
+
 /* Process an Open request. */
 static void
 dft_open_request(unsigned short len, unsigned char *cp)
@@ -177,6 +211,9 @@ dft_open_request(unsigned short len, unsigned char *cp)
     dft_eof = false;
     recnum = 1;
     dft_ungetc_count = 0;
+    dft_rbuf_len = 0;
+    dft_rbuf_ix = 0;
+    dft_reset_maps();
 
     /* Acknowledge the Open. */
     trace_ds("> WriteStructuredField FileTransferData OpenAck\n");
@@ -187,6 +224,7 @@ dft_open_request(unsigned short len, unsigned char *cp)
     *obptr++ = SF_TRANSFER_DATA;
     SET16(obptr, 9);
     net_output();
+    ft_stats_reply();
 }
 
 /* Process an Insert request. */
@@ -213,6 +251,7 @@ dft_data_ack(void)
     SET32(obptr, recnum);
     recnum++;
     net_output();
+    ft_stats_reply();
 }
 
 /* Process a Data Insert request. */
@@ -287,12 +326,19 @@ dft_data_insert(struct data_buffer *data_bufr)
 	/* Write the data out to the file. */
 	if (ftc->ascii_flag && (ftc->remap_flag || ftc->cr_flag)) {
 	    size_t obuf_len = 4 * my_length;
-	    char *ob0 = Malloc(obuf_len);
-	    char *ob = ob0;
+	    char *ob0;
+	    char *ob;
 	    unsigned char *s = (unsigned char *)data_bufr->data;
 	    unsigned len = my_length;
 	    size_t nx;
 
+	    /* Reuse the conversion buffer from the last record. */
+	    if (obuf_len > dft_obuf_size) {
+		dft_obuf_size = obuf_len;
+		Replace(dft_obuf, Malloc(dft_obuf_size));
+	    }
+	    ob0 = ob = dft_obuf;
+
 	    /* Copy and convert data_bufr->data to ob0. */
 	    while (len-- && obuf_len) {
 		unsigned char c = *s++;
@@ -351,6 +397,15 @@ dft_data_insert(struct data_buffer *data_bufr)
 		    continue;
 		}
 
+		/* Use the cached translation, if there is one. */
+		if (dft_downmap[c].len >= 0 &&
+			(size_t)dft_downmap[c].len <= obuf_len) {
+		    memcpy(ob, dft_downmap[c].mb, dft_downmap[c].len);
+		    ob += dft_downmap[c].len;
+		    obuf_len -= dft_downmap[c].len;
+		    continue;
+		}
+
 		if (c < 0x20 || (c >= 0x80 && c < 0xa0 && c != 0x9f)) {
 		    /*
 		     * Control code, treat it as Unicode.
@@ -368,12 +423,16 @@ dft_data_insert(struct data_buffer *data_bufr)
 		    nx = ft_unicode_to_multibyte(0x9f, ob, obuf_len);
 		} else {
 		    /* Displayable character, remap. */
-		    c = i_asc2ft[c];
-		    nx = ft_ebcdic_to_multibyte(c, (char *)ob, obuf_len);
+		    nx = ft_ebcdic_to_multibyte(i_asc2ft[c], (char *)ob,
+			    obuf_len);
 		}
 		if (nx && (ob[nx - 1] == '\0')) {
 		    nx--;
 		}
+		if (nx <= DFT_MB_MAX) {
+		    dft_downmap[c].len = (int)nx;
+		    memcpy(dft_downmap[c].mb, ob, nx);
+		}
 		ob += nx;
 		obuf_len -= nx;
 	    }
@@ -383,7 +442,6 @@ dft_data_insert(struct data_buffer *data_bufr)
 		rv = fwrite(ob0, ob - ob0, (size_t)1, fts.local_file);
 		fts.length += ob - ob0;
 	    }
-	    Free(ob0);
 	} else {
 	    /* Write the buffer to the file directly. */
 	    rv = fwrite((char *)data_bufr->data, my_length, (size_t)1,
@@ -431,6 +489,23 @@ store_inbyte(unsigned char c, unsigned char **bufptr, size_t *numbytes)
     }
 }
 
+/*
+ * Read a byte from the local file, a buffer at a time.
+ * Returns EOF at end of file or on error.
+ */
+static int
+dft_getc(void)
+{
+    if (dft_rbuf_ix >= dft_rbuf_len) {
+	dft_rbuf_len = fread(dft_rbuf, 1, sizeof(dft_rbuf), fts.local_file);
+	dft_rbuf_ix = 0;
+	if (dft_rbuf_len == 0) {
+	    return EOF;
+	}
+    }
+    return dft_rbuf[dft_rbuf_ix++];
+}
+
 /*
  * Read a character from a local file in ASCII mode.
  * Stores the data in 'bufptr' and returns the number of bytes stored.
@@ -443,7 +518,7 @@ dft_ascii_read(unsigned char *bufptr, size_t numbytes)
     int in_ix = 0;
     int c;
     enum me_fail error;
-    ebc_t e;
+    int e;
     int consumed;
     ucs4_t u;
 
@@ -473,7 +548,7 @@ dft_ascii_read(unsigned char *bufptr, size_t numbytes)
 	do {
 	    int consumed;
 
-	    c = fgetc(fts.local_file);
+	    c = dft_getc();
 	    if (c == EOF) {
 		if (fts.last_dbcs) {
 		    *bufptr = EBC_si;
@@ -482,6 +557,11 @@ dft_ascii_read(unsigned char *bufptr, size_t numbytes)
 		}
 		return -1;
 	    }
+	    if (in_ix == 0 && dft_upmap[c] >= 0) {
+		/* Known single-byte sequence. */
+		inbuf[in_ix++] = c;
+		break;
+	    }
 	    error = ME_NONE;
 	    inbuf[in_ix++] = c;
 	    ft_multibyte_to_unicode(inbuf, in_ix, &consumed, &error);
@@ -493,7 +573,7 @@ dft_ascii_read(unsigned char *bufptr, size_t numbytes)
 	} while (error == ME_SHORT);
     } else {
 	/* Get a byte from the file. */
-	c = fgetc(fts.local_file);
+	c = dft_getc();
 	if (c == EOF) {
 	    return -1;
 	}
@@ -529,13 +609,20 @@ dft_ascii_read(unsigned char *bufptr, size_t numbytes)
      * Control codes are treated as Unicode and mapped directly.
      * We also handle DBCS here.
      */
-    u = ft_multibyte_to_unicode(inbuf, in_ix, &consumed, &error);
-    if (u < 0x20 || ((u >= 0x80 && u < 0x9f))) {
-	e = i_asc2ft[u];
-    } else if (u == 0x9f) {
-	e = 0xff;
+    if (in_ix == 1 && dft_upmap[(unsigned char)inbuf[0]] >= 0) {
+	e = dft_upmap[(unsigned char)inbuf[0]];
     } else {
-	e = unicode_to_ebcdic(u);
+	u = ft_multibyte_to_unicode(inbuf, in_ix, &consumed, &error);
+	if (u < 0x20 || ((u >= 0x80 && u < 0x9f))) {
+	    e = i_asc2ft[u];
+	} else if (u == 0x9f) {
+	    e = 0xff;
+	} else {
+	    e = unicode_to_ebcdic(u);
+	}
+	if (in_ix == 1 && (unsigned char)inbuf[0] == c) {
+	    dft_upmap[c] = e;
+	}
     }
     if (e & 0xff00) {
 	unsigned char *bp0 = bufptr;
@@ -665,6 +752,7 @@ dft_get_request(void)
 
     /* Write the data. */
     net_output();
+    ft_stats_reply();
     ft_update_length();
 }
 
@@ -685,6 +773,7 @@ dft_close_request(void)
     *obptr++ = SF_TRANSFER_DATA;
     SET16(obptr, TR_CLOSE_REPLY);
     net_output();
+    ft_stats_reply();
 }
 
 /* Abort a transfer. */
@@ -705,6 +794,7 @@ dft_abort(const char *s, unsigned short code)
     SET16(obptr, TR_ERROR_HDR);
     SET16(obptr, TR_ERR_CMDFAIL);
     net_output();
+    ft_stats_reply();
 
     /* Update the pop-up and state. */
     ft_aborting();
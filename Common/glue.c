@@ -927,6 +927,8 @@ static res_t base_resources[] = {
     { ResTraceDir,	aoffset(trace_dir),	XRM_STRING },
     { ResTraceFile,	aoffset(trace_file),	XRM_STRING },
     { ResTraceFileSize,aoffset(trace_file_size),	XRM_STRING },
+    { ResTraceFlushInterval,aoffset(trace_flush_interval),XRM_INT },
+    { ResTraceFormat,aoffset(trace_format),	XRM_STRING },
     { ResTraceMonitor,aoffset(trace_monitor),	XRM_BOOLEAN },
     { ResUnlockDelay,aoffset(unlock_delay),	XRM_BOOLEAN },
     { ResUnlockDelayMs,aoffset(unlock_delay_ms),	XRM_INT },
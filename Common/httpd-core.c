@@ -54,8 +54,8 @@
 
 /* Typedefs */
 typedef enum {		/* Print mode: */
-    HP_SEND,		/*  Send directly */
-    HP_BUFFER		/*  Buffer */
+    HP_SEND,		/*  Send with the response */
+    HP_BUFFER		/*  Buffer, to compute the Content-Length */
 } httpd_print_t;
 
 typedef enum {		/* Error type: */
@@ -115,6 +115,8 @@ typedef struct {
     /* Global state */
     void *mhandle;	/* the handle from the main procedure */
     unsigned long seq;	/* connection sequence number, for tracing */
+    varbuf_t out_buf;	/* response output, sent once per response */
+    varbuf_t queued;	/* pipelined input held while a request is pending */
 
     /* Per-request state */
     request_t request;
@@ -254,6 +256,9 @@ httpd_data_trace(httpd_t *h, const char *direction, const char *buf,
 /**
  * Send data on a connection.
  *
+ * The data is accumulated in the session output buffer, which is written to
+ * the socket by httpd_flush() when the response is complete.
+ *
  * @param[in] h		State
  * @param[in] buf	Data buffer
  * @param[in] len	Data buffer length
@@ -262,11 +267,25 @@ static void
 httpd_send(httpd_t *h, const char *buf, size_t len)
 {
     httpd_data_trace(h, ">", buf, len, &h->request.ot_offset);
-    hio_send(h->mhandle, buf, len);
+    vb_append(&h->out_buf, buf, len);
+}
+
+/**
+ * Write the accumulated response to the socket.
+ *
+ * @param[in,out] h	State
+ */
+static void
+httpd_flush(httpd_t *h)
+{
+    if (vb_len(&h->out_buf)) {
+	hio_send(h->mhandle, vb_buf(&h->out_buf), vb_len(&h->out_buf));
+	vb_reset(&h->out_buf);
+    }
 }
 
 /**
- * Transfer data to the HTTPD socket or the deferred output buffer.
+ * Transfer data to the response or the deferred output buffer.
  *
  * @param[in,out] h	State
  * @param[in] type	How to print (send immediate or buffer)
@@ -367,10 +386,8 @@ httpd_print(httpd_t *h, httpd_print_t type, const char *format, ...)
 /**
  * Dump out a Content-Length string.
  *
- * This helps ensure that a typical response comes in just three chunks:
- *  HTTP header (except for Content-Length)
- *  Content-Length and the double CR+LF
- *  Body
+ * This is sent after the rest of the HTTP header and just before the
+ * buffered body, whose length is then known.
  *
  * @param[in] h		State
  * @param[in] len	Length
@@ -495,6 +512,8 @@ httpd_init_state(httpd_t *h, void *mhandle)
 
     h->mhandle = mhandle;
     h->seq = httpd_seq++;
+    vb_init(&h->out_buf);
+    vb_init(&h->queued);
 }
 
 /**
@@ -1576,6 +1595,7 @@ httpd_waiting(void *dhandle, ioid_t id)
 
     if (r->cookie_timeout_id == id) {
 	(void) httpd_error(h, ERRMODE_FATAL, CT_HTML, 403, "Invalid x3270-security cookie.");
+	httpd_flush(h);
 	return true;
     }
     return false;
@@ -1816,76 +1836,142 @@ httpd_digest_request(httpd_t *h)
 }
 
 /**
- * Process a byte of incoming HTTP data.
+ * Store a run of request body (content) bytes.
  *
  * @param[in,out] h	State
- * @param[in] c		Next input character
+ * @param[in] data	Input data
+ * @param[in] len	Length of input data
+ * @param[out] np	Returned number of bytes consumed
  *
  * @return httpd_status_t
  */
-static int
-httpd_input_char(httpd_t *h, char c)
+static httpd_status_t
+httpd_input_content(httpd_t *h, const char *data, size_t len, size_t *np)
 {
     request_t *r = &h->request;
+    size_t room = MAX_HTTPD_REQUEST - r->nr;
+    size_t n = len;
 
-    /* If there's no room to store the character, we're done. */
-    if (r->nr >= MAX_HTTPD_REQUEST) {
-	return httpd_error(h,
-		r->saw_first? ERRMODE_FATAL: ERRMODE_NON_HTTP,
-		CT_HTML, 400, "The request is too big.");
+    /* If there's no room to store the content, we're done. */
+    if (room == 0) {
+	*np = 1;
+	return httpd_error(h, ERRMODE_FATAL, CT_HTML, 400,
+		"The request is too big.");
     }
 
-    if (!r->content_length_left && c == '\r') {
-	return HS_CONTINUE;
+    /* Copy as much as is wanted and will fit, in one piece. */
+    if (r->content_length_left > 0 && n > (size_t)r->content_length_left) {
+	n = r->content_length_left;
     }
+    if (n > room) {
+	n = room;
+    }
+    memcpy(r->request_buf + r->nr, data, n);
+    r->nr += n;
+    r->content_length_left -= n;
+    *np = n;
 
-    /* Store the character. */
-    r->request_buf[r->nr++] = c;
+    if (!r->content_length_left) {
+	r->request_buf[r->nr] = '\0';
+	return httpd_digest_request(h);
+    }
+    return HS_CONTINUE;
+}
 
-    /* Check for content. */
-    if (r->content_length_left) {
-	if (!--r->content_length_left) {
-	    r->request_buf[r->nr] = '\0';
-	    return httpd_digest_request(h);
+/**
+ * Process a line (or partial line) of request header input.
+ *
+ * Text up to the next newline is copied in bulk, skipping CRs. A newline
+ * completes the request line, a field, or (if empty) the header block.
+ *
+ * @param[in,out] h	State
+ * @param[in] data	Input data
+ * @param[in] len	Length of input data
+ * @param[out] np	Returned number of bytes consumed
+ *
+ * @return httpd_status_t
+ */
+static httpd_status_t
+httpd_input_header(httpd_t *h, const char *data, size_t len, size_t *np)
+{
+    request_t *r = &h->request;
+    const char *nl = memchr(data, '\n', len);
+    size_t line_len = (nl != NULL)? (size_t)(nl - data): len;
+    size_t i = 0;
+
+    /* Store the text of the line, skipping CRs. */
+    while (i < line_len) {
+	const char *cr;
+	size_t run;
+
+	/* If there's no room to store the character, we're done. */
+	if (r->nr >= MAX_HTTPD_REQUEST) {
+	    *np = i + 1;
+	    return httpd_error(h,
+		    r->saw_first? ERRMODE_FATAL: ERRMODE_NON_HTTP,
+		    CT_HTML, 400, "The request is too big.");
+	}
+
+	if (data[i] == '\r') {
+	    i++;
+	    continue;
+	}
+
+	cr = memchr(data + i, '\r', line_len - i);
+	run = ((cr != NULL)? (size_t)(cr - data): line_len) - i;
+	if (run > (size_t)(MAX_HTTPD_REQUEST - r->nr)) {
+	    run = MAX_HTTPD_REQUEST - r->nr;
 	}
+	memcpy(r->request_buf + r->nr, data + i, run);
+	r->nr += run;
+	r->rll += run;
+	i += run;
+    }
+
+    if (nl == NULL) {
+	/* Not done yet. */
+	*np = len;
 	return HS_CONTINUE;
     }
+    *np = line_len + 1;
 
-    /* Check for a newline. */
-    if (c == '\n') {
-	if (r->rll == 0) {
-	    httpd_status_t rv;
+    /* Store the newline. */
+    if (r->nr >= MAX_HTTPD_REQUEST) {
+	return httpd_error(h,
+		r->saw_first? ERRMODE_FATAL: ERRMODE_NON_HTTP,
+		CT_HTML, 400, "The request is too big.");
+    }
+    r->request_buf[r->nr++] = '\n';
 
-	    /* Empty line: digest the fields. */
-	    if (!r->saw_first) {
-		return httpd_error(h, ERRMODE_FATAL, CT_HTML, 400,
-			"Missing request.");
-	    }
-	    r->request_buf[r->nr] = '\0';
-	    rv = httpd_digest_fields(h);
-	    if (rv != HS_CONTINUE) {
-		return rv;
-	    }
-	    if (!r->content_length) {
-		/* No content, process the entire request. */
-		return httpd_digest_request(h);
-	    }
+    if (r->rll == 0) {
+	httpd_status_t rv;
+
+	/* Empty line: digest the fields. */
+	if (!r->saw_first) {
+	    return httpd_error(h, ERRMODE_FATAL, CT_HTML, 400,
+		    "Missing request.");
+	}
+	r->request_buf[r->nr] = '\0';
+	rv = httpd_digest_fields(h);
+	if (rv != HS_CONTINUE) {
 	    return rv;
-	} else {
-	    /* Beginning of new line; set the length to 0. */
-	    r->rll = 0;
-
-	    /* If this is the first line, validate it. */
-	    if (!r->saw_first) {
-		r->request_buf[r->nr - 1] = '\0';
-		r->fields_start = &r->request_buf[r->nr];
-		r->saw_first = true;
-		return httpd_digest_request_line(h);
-	    }
 	}
-    } else {
-	/* Non-newline character: increment the line length. */
-	r->rll++;
+	if (!r->content_length) {
+	    /* No content, process the entire request. */
+	    return httpd_digest_request(h);
+	}
+	return rv;
+    }
+
+    /* Beginning of new line; set the length to 0. */
+    r->rll = 0;
+
+    /* If this is the first line, validate it. */
+    if (!r->saw_first) {
+	r->request_buf[r->nr - 1] = '\0';
+	r->fields_start = &r->request_buf[r->nr];
+	r->saw_first = true;
+	return httpd_digest_request_line(h);
     }
 
     /* Not done yet. */
@@ -2093,45 +2179,54 @@ httpd_new(void *mhandle, const char *client_name)
 }
 
 /**
- * Process incoming HTTP data.
+ * Process HTTP data, without tracing it.
  *
- * Called with data read from the HTTP socket.
+ * Each complete response is flushed to the socket as soon as it has been
+ * generated. If a request is left pending, any pipelined requests that
+ * follow it are queued until it completes.
  *
- * @param[in] dhandle	handle returned by httpd_new
+ * @param[in,out] h	State
  * @param[in] data	data buffer
  * @param[in] len	length of data in buffer
  *
  * @return httpd_status_t
  */
-httpd_status_t
-httpd_input(void *dhandle, const char *data, size_t len)
+static httpd_status_t
+httpd_input_run(httpd_t *h, const char *data, size_t len)
 {
-    httpd_t *h = (httpd_t *)dhandle;
     request_t *r = &h->request;
     size_t i;
+    size_t n;
     httpd_status_t rv = HS_CONTINUE;
 
-    httpd_data_trace(h, "<", data, len, &r->it_offset);
-
-    /* Process a byte at a time, skipping CRs. */
-    for (i = 0; i < len; i++) {
-	switch ((rv = httpd_input_char(h, data[i]))) {
+    /* Process a header line or a run of content at a time. */
+    for (i = 0; i < len; i += n) {
+	if (r->content_length_left) {
+	    rv = httpd_input_content(h, data + i, len - i, &n);
+	} else {
+	    rv = httpd_input_header(h, data + i, len - i, &n);
+	}
+	switch (rv) {
 	case HS_CONTINUE:
 	    /* Keep parsing. */
 	    continue;
 	case HS_SUCCESS_OPEN:
-	    httpd_reinit_request(r);
-	    return rv;
+	    /* Request succeeded, go on to any pipelined request. */
 	case HS_ERROR_OPEN:
 	    /* Request failed, but keep the socket open. */
+	    httpd_flush(h);
 	    httpd_reinit_request(r);
-	    /* fall through */
+	    continue;
+	case HS_PENDING:
+	    /* Request pending, hold off further input. */
+	    httpd_flush(h);
+	    vb_append(&h->queued, data + i + n, len - (i + n));
+	    return rv;
 	case HS_ERROR_CLOSE:
 	    /* Request failed, close the socket. */
 	case HS_SUCCESS_CLOSE:
 	    /* Request succeeded, close the socket. */
-	case HS_PENDING:
-	    /* Request pending, hold off further input. */
+	    httpd_flush(h);
 	    return rv;
 	}
     }
@@ -2140,6 +2235,61 @@ httpd_input(void *dhandle, const char *data, size_t len)
     return rv;
 }
 
+/**
+ * Process incoming HTTP data.
+ *
+ * Called with data read from the HTTP socket.
+ *
+ * @param[in] dhandle	handle returned by httpd_new
+ * @param[in] data	data buffer
+ * @param[in] len	length of data in buffer
+ *
+ * @return httpd_status_t
+ */
+httpd_status_t
+httpd_input(void *dhandle, const char *data, size_t len)
+{
+    httpd_t *h = (httpd_t *)dhandle;
+
+    httpd_data_trace(h, "<", data, len, &h->request.it_offset);
+    return httpd_input_run(h, data, len);
+}
+
+/**
+ * Check for pipelined input queued behind a pending request.
+ *
+ * @param[in] dhandle	handle returned by httpd_new
+ *
+ * @return true if there is queued input
+ */
+bool
+httpd_queued(void *dhandle)
+{
+    httpd_t *h = (httpd_t *)dhandle;
+
+    return vb_len(&h->queued) > 0;
+}
+
+/**
+ * Process pipelined input queued behind a request that has now completed.
+ *
+ * @param[in] dhandle	handle returned by httpd_new
+ *
+ * @return httpd_status_t
+ */
+httpd_status_t
+httpd_input_queued(void *dhandle)
+{
+    httpd_t *h = (httpd_t *)dhandle;
+    size_t len = vb_len(&h->queued);
+    char *data = vb_consume(&h->queued);
+    httpd_status_t rv;
+
+    rv = httpd_input_run(h, data, len);
+    Free(data);
+    return rv;
+}
+
 /**
  * Close the HTTPD connection.
  *
@@ -2155,6 +2305,8 @@ httpd_close(void *dhandle, const char *why)
 
     /* Wipe the existing request state. */
     httpd_free_request(&h->request);
+    vb_free(&h->out_buf);
+    vb_free(&h->queued);
 
     /* Free it. */
     memset(h, 0, sizeof(*h));
@@ -2239,6 +2391,9 @@ httpd_dyn_complete(void *dhandle, const char *format, ...)
 	break;
     }
 
+    /* Write the response. */
+    httpd_flush(h);
+
     /* Return status. */
     if (!r->persistent) {
 	return HS_SUCCESS_CLOSE;
@@ -2279,6 +2434,7 @@ httpd_dyn_error(void *dhandle, content_t content_type, int status_code,
     rv = httpd_verror(h, ERRMODE_NONFATAL, content_type, status_code, r->verb,
 	    jresult, format, ap);
     va_end(ap);
+    httpd_flush(h);
 
     return rv;
 }
@@ -67,6 +67,7 @@
 #endif /*]*/
 
 #define IDLE_MAX	15
+#define HIO_RBUF_SIZE	16384	/* receive buffer size */
 
 struct hio_listener {
     llist_t link;	/* list linkage */
@@ -93,6 +94,7 @@ typedef struct {
     int idle;
     ioid_t ioid;	/* AddInput ID */
     ioid_t toid;	/* AddTimeOut ID */
+    ioid_t qid;		/* queued input AddTimeOut ID */
 
     struct {		/* pending command state: */
 	sendto_callback_t *callback; /* callback function */
@@ -136,6 +138,9 @@ hio_socket_close(session_t *session)
     if (session->toid != NULL_IOID) {
 	RemoveTimeOut(session->toid);
     }
+    if (session->qid != NULL_IOID) {
+	RemoveTimeOut(session->qid);
+    }
 #if defined(_WIN32) /*[*/
     CloseHandle(session->event);
 #endif /*]*/
@@ -207,28 +212,24 @@ hio_timeout(ioid_t id)
  *
  * @param[in] fd	socket file descriptor
  * @param[in] id	I/O ID
+ * @param[in] data	session
  */
 void
-hio_socket_input(iosrc_t fd, ioid_t id)
+hio_socket_input(iosrc_t fd, ioid_t id, void *data)
 {
-    session_t *session;
-    char buf[1024];
+    session_t *session = data;
     ssize_t nr;
 
-    session = NULL;
-    FOREACH_LLIST(&sessions, session, session_t *) {
-	if (session->ioid == id) {
-	    break;
-	}
-    } FOREACH_LLIST_END(&sessions, session, session_t *);
-    if (session == NULL) {
-	vtrace("httpd mystery input\n");
-	return;
-    }
+    /*
+     * One receive buffer is shared by all sessions, because input is
+     * processed completely before the next read. It is big enough to hold
+     * a maximum-size request in one read.
+     */
+    static char *rbuf = NULL;
 
-    /* Move this session to the front of the list. */
-    llist_unlink(&session->link);
-    LLIST_PREPEND(&session->link, sessions);
+    if (rbuf == NULL) {
+	rbuf = Malloc(HIO_RBUF_SIZE);
+    }
 
     session->idle = 0;
 
@@ -237,7 +238,7 @@ hio_socket_input(iosrc_t fd, ioid_t id)
 	session->toid = NULL_IOID;
     }
 
-    nr = recv(session->s, buf, sizeof(buf), 0);
+    nr = recv(session->s, rbuf, HIO_RBUF_SIZE, 0);
     if (nr <= 0) {
 	const char *ebuf;
 	bool harmless = false;
@@ -258,7 +259,7 @@ hio_socket_input(iosrc_t fd, ioid_t id)
     } else {
 	httpd_status_t rv;
 
-	rv = httpd_input(session->dhandle, buf, nr);
+	rv = httpd_input(session->dhandle, rbuf, nr);
 	if (rv < 0) {
 	    httpd_close(session->dhandle, "protocol error");
 	    hio_socket_close(session);
@@ -273,17 +274,71 @@ hio_socket_input(iosrc_t fd, ioid_t id)
     }
 }
 
+/**
+ * Allow more input on a session, and set a timeout for it to arrive.
+ *
+ * @param[in,out] session	Session
+ */
+static void
+hio_enable_input(session_t *session)
+{
+    if (session->ioid == NULL_IOID) {
+#if !defined(_WIN32) /*[*/
+	session->ioid = AddInputData(session->s, hio_socket_input, session);
+#else /*][*/
+	session->ioid = AddInputData(session->event, hio_socket_input,
+		session);
+#endif /*]*/
+    }
+
+    if (session->toid == NULL_IOID) {
+	session->toid = AddTimeOut(IDLE_MAX * 1000, hio_timeout);
+    }
+}
+
+/**
+ * Process the pipelined requests queued behind a request that has completed.
+ *
+ * @param[in] id	timeout ID
+ */
+static void
+hio_queued_input(ioid_t id)
+{
+    session_t *session;
+    httpd_status_t rv;
+
+    session = NULL;
+    FOREACH_LLIST(&sessions, session, session_t *) {
+	if (session->qid == id) {
+	    break;
+	}
+    } FOREACH_LLIST_END(&sessions, session, session_t *);
+    if (session == NULL) {
+	vtrace("httpd mystery queued input\n");
+	return;
+    }
+    session->qid = NULL_IOID;
+
+    rv = httpd_input_queued(session->dhandle);
+    if (rv < 0) {
+	httpd_close(session->dhandle, "protocol error");
+	hio_socket_close(session);
+    } else if (rv != HS_PENDING) {
+	hio_enable_input(session);
+    }
+}
+
 /**
  * New inbound connection for httpd.
  *
  * @param[in] fd	socket file descriptor
  * @param[in] id	I/O ID
+ * @param[in] data	listener
  */
 void
-hio_connection(iosrc_t fd, ioid_t id)
+hio_connection(iosrc_t fd, ioid_t id, void *data)
 {
-    hio_listener_t *l;
-    bool found = false;
+    hio_listener_t *l = data;
     socket_t t;
     union {
 	struct sockaddr sa;
@@ -294,18 +349,6 @@ hio_connection(iosrc_t fd, ioid_t id)
     char hostbuf[128];
     session_t *session;
 
-    /* Find the listener. */
-    FOREACH_LLIST(&listeners, l, hio_listener_t *) {
-	if (l->listen_id == id) {
-	    found = true;
-	    break;
-	}
-    } FOREACH_LLIST_END(&sessions, session, session_t *);
-    if (!found) {
-	vtrace("httpd accept: session not found\n");
-	return;
-    }
-
     /* Accept the connection. */
     len = sizeof(sa);
     t = accept(l->listen_s, &sa.sa, &len);
@@ -363,9 +406,9 @@ hio_connection(iosrc_t fd, ioid_t id)
 	session->dhandle = httpd_new(session, "???");
     }
 #if !defined(_WIN32) /*[*/
-    session->ioid = AddInput(t, hio_socket_input);
+    session->ioid = AddInputData(t, hio_socket_input, session);
 #else /*][*/
-    session->ioid = AddInput(session->event, hio_socket_input);
+    session->ioid = AddInputData(session->event, hio_socket_input, session);
 #endif /*]*/
 
     /* Set the timeout for the first line of input. */
@@ -447,9 +490,9 @@ hio_init_x(struct sockaddr *sa, socklen_t sa_len)
 	l->listen_s = INVALID_SOCKET;
 	goto fail;
     }
-    l->listen_id = AddInput(l->listen_event, hio_connection);
+    l->listen_id = AddInputData(l->listen_event, hio_connection, l);
 #else /*][*/
-    l->listen_id = AddInput(l->listen_s, hio_connection);
+    l->listen_id = AddInputData(l->listen_s, hio_connection, l);
 #endif /*]*/
     LLIST_APPEND(&l->link, listeners);
 
@@ -807,23 +850,24 @@ hio_async_done(void *dhandle, httpd_status_t rv)
 	return;
     }
 
-    /* Allow more input. */
-    if (session->ioid == NULL_IOID) {
-#if !defined(_WIN32) /*[*/
-	session->ioid = AddInput(session->s, hio_socket_input);
-#else /*][*/
-	session->ioid = AddInput(session->event, hio_socket_input);
-#endif /*]*/
+    /*
+     * If more requests arrived with the one that just completed, process
+     * them before reading anything else. This is done from a timeout, so
+     * the next command is not started from inside this one's completion.
+     */
+    if (httpd_queued(session->dhandle)) {
+	if (session->qid == NULL_IOID) {
+	    session->qid = AddTimeOut(0, hio_queued_input);
+	}
+	return;
     }
 
     /*
-     * Set a timeout for that input to arrive. We didn't set this timeout
-     * as soon as the last input arrived, because it might have taken us a
-     * long time to proces the last request.
+     * Allow more input and set a timeout for it to arrive. We didn't set
+     * this timeout as soon as the last input arrived, because it might
+     * have taken us a long time to proces the last request.
      */
-    if (session->toid == NULL_IOID) {
-	session->toid = AddTimeOut(IDLE_MAX * 1000, hio_timeout);
-    }
+    hio_enable_input(session);
 }
 
 /**
@@ -0,0 +1,508 @@
+/*
+ * Copyright (c) 2024 Paul Mattes.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of Paul Mattes nor the names of his contributors
+ *       may be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *	iomux.c
+ *		Persistent I/O event multiplexer.
+ *
+ * Registrations are kept across calls, so the cost of a wait is
+ * proportional to the number of ready descriptors rather than the number
+ * of registered ones. On Linux, epoll is used; otherwise (or if epoll
+ * cannot be initialized), a persistent poll() array is used.
+ */
+
+#include "globals.h"
+
+#include <errno.h>
+#include <poll.h>
+#if defined(HAVE_SYS_EPOLL_H) /*[*/
+# include <sys/epoll.h>
+#endif /*]*/
+
+#include "iomux.h"
+#include "utils.h"
+
+/* Backend operations. */
+typedef struct {
+    const char *name;
+    bool (*init)(void);
+    void (*set)(int fd, unsigned old_mask, unsigned new_mask);
+    int (*wait)(int timeout_ms);
+    bool (*next)(int *fd, unsigned *mask);
+} iomux_backend_t;
+
+/* Per-descriptor state. */
+typedef struct {
+    unsigned mask;	/* registered conditions */
+    int slot;		/* poll array slot, or always-ready slot (epoll) */
+    unsigned gen;	/* registration generation (epoll) */
+    bool armed;		/* true if armed (epoll) */
+} fdinfo_t;
+
+/* Statics */
+static fdinfo_t *fdinfo = NULL;
+static int fdinfo_size = 0;
+static const iomux_backend_t *backend = NULL;
+
+/* Make sure the fdinfo array covers fd. */
+static void
+fdinfo_grow(int fd)
+{
+    int new_size;
+    int i;
+
+    if (fd < fdinfo_size) {
+	return;
+    }
+    new_size = fdinfo_size? fdinfo_size: 64;
+    while (new_size <= fd) {
+	new_size *= 2;
+    }
+    fdinfo = (fdinfo_t *)Realloc(fdinfo, new_size * sizeof(fdinfo_t));
+    for (i = fdinfo_size; i < new_size; i++) {
+	fdinfo[i].mask = 0;
+	fdinfo[i].slot = -1;
+	fdinfo[i].gen = 0;
+	fdinfo[i].armed = false;
+    }
+    fdinfo_size = new_size;
+}
+
+/* Translate poll() results into conditions, the way select() would. */
+static unsigned
+poll_to_mask(short revents)
+{
+    unsigned mask = 0;
+
+    if (revents & POLLIN) {
+	mask |= IOMUX_READ;
+    }
+    if (revents & POLLOUT) {
+	mask |= IOMUX_WRITE;
+    }
+    if (revents & POLLPRI) {
+	mask |= IOMUX_EXCEPT;
+    }
+    if (revents & (POLLHUP | POLLERR | POLLNVAL)) {
+	/* select() reports these as readable and writable. */
+	mask |= IOMUX_READ | IOMUX_WRITE;
+    }
+    return mask;
+}
+
+/* poll() backend. */
+
+static struct pollfd *pfds = NULL;
+static int n_pfds = 0;
+static int max_pfds = 0;
+static int poll_cursor = 0;
+
+static bool
+poll_init(void)
+{
+    return true;
+}
+
+static void
+poll_set(int fd, unsigned old_mask, unsigned new_mask)
+{
+    fdinfo_t *f = &fdinfo[fd];
+    short events = 0;
+
+    if (new_mask == 0) {
+	/* Remove, moving the last slot into the hole. */
+	if (f->slot < 0) {
+	    return;
+	}
+	if (f->slot != n_pfds - 1) {
+	    pfds[f->slot] = pfds[n_pfds - 1];
+	    fdinfo[pfds[f->slot].fd].slot = f->slot;
+	}
+	n_pfds--;
+	f->slot = -1;
+	return;
+    }
+
+    if (new_mask & IOMUX_READ) {
+	events |= POLLIN;
+    }
+    if (new_mask & IOMUX_WRITE) {
+	events |= POLLOUT;
+    }
+    if (new_mask & IOMUX_EXCEPT) {
+	events |= POLLPRI;
+    }
+
+    if (f->slot < 0) {
+	if (n_pfds >= max_pfds) {
+	    max_pfds = max_pfds? max_pfds * 2: 32;
+	    pfds = (struct pollfd *)Realloc(pfds,
+		    max_pfds * sizeof(struct pollfd));
+	}
+	f->slot = n_pfds++;
+	pfds[f->slot].fd = fd;
+	pfds[f->slot].revents = 0;
+    }
+    pfds[f->slot].events = events;
+}
+
+static int
+poll_wait(int timeout_ms)
+{
+    poll_cursor = 0;
+    return poll(pfds, n_pfds, timeout_ms);
+}
+
+static bool
+poll_next(int *fd, unsigned *mask)
+{
+    while (poll_cursor < n_pfds) {
+	struct pollfd *p = &pfds[poll_cursor++];
+
+	if (p->revents) {
+	    unsigned m = poll_to_mask(p->revents) & fdinfo[p->fd].mask;
+
+	    p->revents = 0;
+	    if (m) {
+		*fd = p->fd;
+		*mask = m;
+		return true;
+	    }
+	}
+    }
+    return false;
+}
+
+static iomux_backend_t poll_backend = {
+    "poll", poll_init, poll_set, poll_wait, poll_next
+};
+
+#if defined(HAVE_SYS_EPOLL_H) /*[*/
+/*
+ * epoll() backend.
+ *
+ * Descriptors are registered one-shot and re-armed before the next wait,
+ * which gives the same level-triggered behavior as select(). Tagging each
+ * registration with a generation number means that a stale registration
+ * (one whose descriptor was closed before RemoveInput, while a child
+ * process still holds a copy of it) fires at most once and is then ignored.
+ *
+ * Regular files cannot be registered with epoll; they are always ready, as
+ * they would be with select().
+ */
+
+#define EP_MAX_EVENTS	256
+
+static int epfd = -1;
+static struct epoll_event ep_events[EP_MAX_EVENTS];
+static int ep_nready = 0;
+static int ep_cursor = 0;
+static unsigned ep_gen = 0;
+static int *rearm = NULL;
+static int n_rearm = 0;
+static int max_rearm = 0;
+static int *always = NULL;
+static int n_always = 0;
+static int max_always = 0;
+static int always_cursor = 0;
+
+static bool
+epoll_init(void)
+{
+    epfd = epoll_create1(EPOLL_CLOEXEC);
+    return epfd >= 0;
+}
+
+static uint32_t
+mask_to_epoll(unsigned mask)
+{
+    uint32_t events = EPOLLONESHOT;
+
+    if (mask & IOMUX_READ) {
+	events |= EPOLLIN;
+    }
+    if (mask & IOMUX_WRITE) {
+	events |= EPOLLOUT;
+    }
+    if (mask & IOMUX_EXCEPT) {
+	events |= EPOLLPRI;
+    }
+    return events;
+}
+
+/* Re-arm a descriptor. */
+static bool
+epoll_arm(int fd, int op)
+{
+    fdinfo_t *f = &fdinfo[fd];
+    struct epoll_event ev;
+
+    if (op == EPOLL_CTL_ADD) {
+	if (++ep_gen == 0) {
+	    ep_gen++;
+	}
+	f->gen = ep_gen;
+    }
+    ev.events = mask_to_epoll(f->mask);
+    ev.data.u64 = ((uint64_t)f->gen << 32) | (uint32_t)fd;
+    if (epoll_ctl(epfd, op, fd, &ev) < 0) {
+	if (op == EPOLL_CTL_ADD && errno == EEXIST) {
+	    return epoll_arm(fd, EPOLL_CTL_MOD);
+	}
+	if (op == EPOLL_CTL_MOD && errno == ENOENT) {
+	    return epoll_arm(fd, EPOLL_CTL_ADD);
+	}
+	return false;
+    }
+    f->armed = true;
+    return true;
+}
+
+static void
+epoll_set(int fd, unsigned old_mask, unsigned new_mask)
+{
+    fdinfo_t *f = &fdinfo[fd];
+
+    if (f->slot >= 0) {
+	/* Always-ready descriptor. */
+	if (new_mask == 0) {
+	    if (f->slot != n_always - 1) {
+		always[f->slot] = always[n_always - 1];
+		fdinfo[always[f->slot]].slot = f->slot;
+	    }
+	    n_always--;
+	    f->slot = -1;
+	}
+	return;
+    }
+
+    if (new_mask == 0) {
+	struct epoll_event ev;
+
+	/* This can fail if the descriptor is already closed. */
+	memset(&ev, 0, sizeof(ev));
+	(void) epoll_ctl(epfd, EPOLL_CTL_DEL, fd, &ev);
+	f->gen = 0;
+	f->armed = false;
+	return;
+    }
+
+    if (epoll_arm(fd, old_mask? EPOLL_CTL_MOD: EPOLL_CTL_ADD)) {
+	return;
+    }
+    if (errno == EPERM) {
+	/* Regular file. */
+	if (n_always >= max_always) {
+	    max_always = max_always? max_always * 2: 8;
+	    always = (int *)Realloc(always, max_always * sizeof(int));
+	}
+	f->slot = n_always++;
+	always[f->slot] = fd;
+	f->gen = 0;
+    } else {
+	xs_warning("epoll_ctl(%d) failed: %s", fd, strerror(errno));
+    }
+}
+
+static int
+epoll_wait_events(int timeout_ms)
+{
+    int i;
+
+    /* Re-arm whatever fired last time. */
+    for (i = 0; i < n_rearm; i++) {
+	int fd = rearm[i];
+
+	if (fdinfo[fd].mask && !fdinfo[fd].armed && fdinfo[fd].slot < 0) {
+	    (void) epoll_arm(fd, EPOLL_CTL_MOD);
+	}
+    }
+    n_rearm = 0;
+
+    ep_cursor = 0;
+    always_cursor = 0;
+    ep_nready = epoll_wait(epfd, ep_events, EP_MAX_EVENTS,
+	    n_always? 0: timeout_ms);
+    if (ep_nready < 0) {
+	return ep_nready;
+    }
+
+    /*
+     * Everything that fired is now disarmed, whether or not the caller gets
+     * around to processing it, so queue it up for re-arming.
+     */
+    for (i = 0; i < ep_nready; i++) {
+	int efd = (int)(ep_events[i].data.u64 & 0xffffffff);
+	unsigned gen = (unsigned)(ep_events[i].data.u64 >> 32);
+
+	if (efd >= fdinfo_size || gen == 0 || fdinfo[efd].gen != gen) {
+	    /* Stale registration. */
+	    ep_events[i].events = 0;
+	    continue;
+	}
+	fdinfo[efd].armed = false;
+	if (n_rearm >= max_rearm) {
+	    max_rearm = max_rearm? max_rearm * 2: EP_MAX_EVENTS;
+	    rearm = (int *)Realloc(rearm, max_rearm * sizeof(int));
+	}
+	rearm[n_rearm++] = efd;
+    }
+
+    return ep_nready + n_always;
+}
+
+static bool
+epoll_next(int *fd, unsigned *mask)
+{
+    while (ep_cursor < ep_nready) {
+	struct epoll_event *ev = &ep_events[ep_cursor++];
+	int efd = (int)(ev->data.u64 & 0xffffffff);
+	unsigned gen = (unsigned)(ev->data.u64 >> 32);
+	uint32_t e = ev->events;
+	unsigned m = 0;
+
+	if (e == 0 || fdinfo[efd].gen != gen) {
+	    /* Stale, or removed since the wait. */
+	    continue;
+	}
+
+	if (e & EPOLLIN) {
+	    m |= IOMUX_READ;
+	}
+	if (e & EPOLLOUT) {
+	    m |= IOMUX_WRITE;
+	}
+	if (e & EPOLLPRI) {
+	    m |= IOMUX_EXCEPT;
+	}
+	if (e & (EPOLLHUP | EPOLLERR)) {
+	    m |= IOMUX_READ | IOMUX_WRITE;
+	}
+	m &= fdinfo[efd].mask;
+	if (m) {
+	    *fd = efd;
+	    *mask = m;
+	    return true;
+	}
+    }
+
+    while (always_cursor < n_always) {
+	int afd = always[always_cursor++];
+
+	*fd = afd;
+	*mask = fdinfo[afd].mask;
+	return true;
+    }
+
+    return false;
+}
+
+static iomux_backend_t epoll_backend = {
+    "epoll", epoll_init, epoll_set, epoll_wait_events, epoll_next
+};
+#endif /*]*/
+
+/* Choose a backend. */
+static void
+iomux_init(void)
+{
+#if defined(HAVE_SYS_EPOLL_H) /*[*/
+    if (epoll_backend.init()) {
+	backend = &epoll_backend;
+	return;
+    }
+#endif /*]*/
+    poll_backend.init();
+    backend = &poll_backend;
+}
+
+/**
+ * Set the conditions to wait for on a descriptor.
+ *
+ * @param[in] fd	Descriptor
+ * @param[in] mask	Conditions (IOMUX_XXX); 0 to stop waiting
+ */
+void
+iomux_set(int fd, unsigned mask)
+{
+    unsigned old_mask;
+
+    if (backend == NULL) {
+	iomux_init();
+    }
+    fdinfo_grow(fd);
+    old_mask = fdinfo[fd].mask;
+    if (mask == old_mask) {
+	return;
+    }
+    fdinfo[fd].mask = mask;
+    backend->set(fd, old_mask, mask);
+}
+
+/**
+ * Wait for events.
+ *
+ * @param[in] timeout_ms	Timeout in milliseconds, or -1 to block
+ *
+ * @return Number of events ready, or -1 for error (errno set)
+ */
+int
+iomux_wait(int timeout_ms)
+{
+    if (backend == NULL) {
+	iomux_init();
+    }
+    return backend->wait(timeout_ms);
+}
+
+/**
+ * Return the next ready descriptor from the last wait.
+ *
+ * @param[out] fd	Returned descriptor
+ * @param[out] mask	Returned ready conditions
+ *
+ * @return true if a descriptor was returned, false if there are no more
+ */
+bool
+iomux_next(int *fd, unsigned *mask)
+{
+    return backend != NULL && backend->next(fd, mask);
+}
+
+/**
+ * Return the name of the backend.
+ *
+ * @return Name
+ */
+const char *
+iomux_name(void)
+{
+    if (backend == NULL) {
+	iomux_init();
+    }
+    return backend->name;
+}
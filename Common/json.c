@@ -60,6 +60,12 @@
 #define SURROGATE_OFFSET	(SURR_BASE - (HS_START << SHIFT_BITS) - \
 					LS_START)
 
+#define JSON_HASH_MIN	16	/* Object size at which members are hashed */
+
+/* A string byte that can be copied as-is, without decoding. */
+#define PLAIN_STRING_BYTE(c) \
+    ((c) >= ' ' && (c) < 0x80 && (c) != '"' && (c) != '\\')
+
 /* Sub-states for parsing tokens. */
 typedef enum {
     JK_BASE,		/* ground state */
@@ -83,11 +89,6 @@ typedef enum {
     SP_FAILURE		/* unsuccessful parsing */
 } sp_ret_t;
 
-/* Barewords. */
-static ucs4_t u_null[] = { 'n', 'u', 'l', 'l', 0 };
-static ucs4_t u_true[] = { 't', 'r', 'u', 'e', 0 };
-static ucs4_t u_false[] = { 'f', 'a', 'l', 's', 'e', 0 };
-
 /**
  * Check is a character is a JSON whitespace character.
  * @param[in] ucs4	Character to inspect
@@ -109,31 +110,23 @@ is_json_space(ucs4_t ucs4)
 }
 
 /**
- * Validate and parse a UCS-4 string as an integer.
- * @param[in] s		String to parse
+ * Validate and parse a string as an integer.
+ * @param[in] s		String to parse (NUL-terminated)
  * @param[in] len	Length of string
  * @param[out] ret	Returned integer
  * @returns np_ret_t
  */
 static np_ret_t
-valid_integer(ucs4_t *s, size_t len, int64_t *ret)
+valid_integer(const char *s, size_t len, int64_t *ret)
 {
-    char *str;
-    size_t i;
     long long l;
     char *end;
 
     if (!*s) {
 	return NP_FAILURE;
     }
-    str = Malloc(len + 1);
-    for (i = 0; i < len; i++) {
-	str[i] = (char)s[i];
-    }
-    str[len] = '\0';
-    l = strtoll(str, &end, 10);
-    Free(str);
-    if (end != &str[len]) {
+    l = strtoll(s, &end, 10);
+    if (end != s + len) {
 	return NP_FAILURE;
     }
     if ((l == LLONG_MIN || l == LLONG_MAX) && errno == ERANGE) {
@@ -159,27 +152,19 @@ valid_integer(ucs4_t *s, size_t len, int64_t *ret)
 }
 
 /**
- * Validate and parse a UCS-4 string as a double.
- * @param[in] s		String to parse
+ * Validate and parse a string as a double.
+ * @param[in] s		String to parse (NUL-terminated)
  * @param[in] len	Length of string
  * @param[out] ret	Returned double
  * @returns np_ret_t
  */
 static np_ret_t
-valid_double(ucs4_t *s, size_t len, double *ret)
+valid_double(const char *s, size_t len, double *ret)
 {
-    char *str;
-    size_t i;
     char *end;
 
-    str = Malloc(len + 1);
-    for (i = 0; i < len; i++) {
-	str[i] = (char)s[i];
-    }
-    str[len] = '\0';
-    *ret = strtod(str, &end);
-    Free(str);
-    if (end != &str[len])
+    *ret = strtod(s, &end);
+    if (end != s + len)
     {
 	return NP_FAILURE;
     }
@@ -190,7 +175,8 @@ valid_double(ucs4_t *s, size_t len, double *ret)
 }
 
 /**
- * Validate and parse a UCS-4 string as a string.
+ * Expand the backslash escapes in a UTF-8 string.
+ * Text between escapes is copied in bulk.
  * @param[in] s		String to parse
  * @param[in] len	Length of string
  * @param[out] s_ret	Returned string
@@ -198,116 +184,112 @@ valid_double(ucs4_t *s, size_t len, double *ret)
  * @returns sp_ret_t
  */
 static sp_ret_t
-valid_string(ucs4_t *s, size_t len, char **s_ret, size_t *len_ret)
+valid_string(const char *s, size_t len, char **s_ret, size_t *len_ret)
 {
-    char *ret = NULL;
-    size_t rlen = 0;
-    ucs4_t c;
-    bool backslash = false;
-    size_t i;
+    varbuf_t r;
+    const char *bs;
+    size_t n;
+    char c;
     char xbuf[5];
     ucs4_t u;
     char ubuf[6];
     int j;
     int nr;
     ucs4_t surrogate_lead = 0;
-#   define STASH(c) do { \
-    ret = (char *)Realloc(ret, rlen + 1); \
-    ret[rlen++] = c; \
-} while (false)
 #   define DUMP_LEAD do { \
     nr = unicode_to_utf8(surrogate_lead, ubuf); \
-    for (j = 0; j < nr; j++) { \
-	STASH(ubuf[j]); \
+    if (nr > 0) { \
+	vb_append(&r, ubuf, nr); \
     } \
     surrogate_lead = 0; \
 } while (false)
 
-    for (i = 0; i < len; i++) {
-	c = s[i];
-	if (backslash) {
-	    if ((surrogate_lead != 0) && c != 'u') {
+    vb_init(&r);
+    while (len > 0) {
+	/* Copy everything up to the next backslash. */
+	bs = memchr(s, '\\', len);
+	n = (bs != NULL)? (size_t)(bs - s): len;
+	if (n > 0) {
+	    if (surrogate_lead != 0) {
 		DUMP_LEAD;
 	    }
-	    switch (c) {
-	    case '\\':
-		STASH('\\');
-		break;
-	    case '/':
-		STASH('/');
-		break;
-	    case 'r':
-		STASH('\r');
-		break;
-	    case 'n':
-		STASH('\n');
-		break;
-	    case 't':
-		STASH('\t');
-		break;
-	    case 'f':
-		STASH('\f');
-		break;
-	    case 'u':
-		/* We need 4 hex digits. */
-		for (j = 0; j < 4; j++) {
-		    if (++i >= len || !isxdigit((int)s[i])) {
-			Free(ret);
-			return SP_FAILURE;
-		    }
-		    xbuf[j] = (char)s[i];
-		}
-		xbuf[j] = '\0';
-		u = (ucs4_t)strtoul(xbuf, NULL, 16);
-		if ((surrogate_lead != 0) &&
-			!LOW_SURROGATE(u) &&
-			!HIGH_SURROGATE(u)) {
-		    DUMP_LEAD;
-		}
-		if (HIGH_SURROGATE(u)) {
-		    if (surrogate_lead != 0) {
-			DUMP_LEAD;
-		    }
-		    surrogate_lead = u;
-		    break;
-		}
-		if (LOW_SURROGATE(u)) {
-		    if (surrogate_lead != 0) {
-			/* Encode the surrogate pair as a single codepoint. */
-			u += SURROGATE_OFFSET + (surrogate_lead << SHIFT_BITS);
-			surrogate_lead = 0;
-		    }
-		}
-		nr = unicode_to_utf8(u, ubuf);
-		if (nr < 0) {
-		    Free(ret);
+	    vb_append(&r, s, n);
+	    s += n;
+	    len -= n;
+	    continue;
+	}
+
+	/* Decode the escape. */
+	if (len < 2) {
+	    break;
+	}
+	c = s[1];
+	s += 2;
+	len -= 2;
+	if ((surrogate_lead != 0) && c != 'u') {
+	    DUMP_LEAD;
+	}
+	switch (c) {
+	case '\\':
+	    vb_append(&r, "\\", 1);
+	    break;
+	case '/':
+	    vb_append(&r, "/", 1);
+	    break;
+	case 'r':
+	    vb_append(&r, "\r", 1);
+	    break;
+	case 'n':
+	    vb_append(&r, "\n", 1);
+	    break;
+	case 't':
+	    vb_append(&r, "\t", 1);
+	    break;
+	case 'f':
+	    vb_append(&r, "\f", 1);
+	    break;
+	case 'u':
+	    /* We need 4 hex digits. */
+	    for (j = 0; j < 4; j++) {
+		if ((size_t)j >= len || !isxdigit((unsigned char)s[j])) {
+		    vb_free(&r);
 		    return SP_FAILURE;
 		}
-		for (j = 0; j < nr; j++) {
-		    STASH(ubuf[j]);
-		}
-		break;
-	    default:
-		Free(ret);
-		return SP_FAILURE;
+		xbuf[j] = s[j];
 	    }
-	    backslash = false;
-	} else {
-	    if (c == '\\') {
-		backslash = true;
-	    } else {
+	    xbuf[j] = '\0';
+	    s += 4;
+	    len -= 4;
+	    u = (ucs4_t)strtoul(xbuf, NULL, 16);
+	    if ((surrogate_lead != 0) &&
+		    !LOW_SURROGATE(u) &&
+		    !HIGH_SURROGATE(u)) {
+		DUMP_LEAD;
+	    }
+	    if (HIGH_SURROGATE(u)) {
 		if (surrogate_lead != 0) {
 		    DUMP_LEAD;
 		}
-		nr = unicode_to_utf8(c, ubuf);
-		if (nr < 0) {
-		    Free(ret);
-		    return SP_FAILURE;
-		}
-		for (j = 0; j < nr; j++) {
-		    STASH(ubuf[j]);
+		surrogate_lead = u;
+		break;
+	    }
+	    if (LOW_SURROGATE(u)) {
+		if (surrogate_lead != 0) {
+		    /* Encode the surrogate pair as a single codepoint. */
+		    u += SURROGATE_OFFSET + (surrogate_lead << SHIFT_BITS);
+		    surrogate_lead = 0;
 		}
 	    }
+	    nr = unicode_to_utf8(u, ubuf);
+	    if (nr < 0) {
+		vb_free(&r);
+		return SP_FAILURE;
+	    }
+	    vb_append(&r, ubuf, nr);
+	    break;
+	default:
+	    vb_free(&r);
+	    return SP_FAILURE;
 	}
     }
 
@@ -315,35 +297,127 @@ valid_string(ucs4_t *s, size_t len, char **s_ret, size_t *len_ret)
 	DUMP_LEAD;
     }
 
-    STASH('\0');
-    *s_ret = ret;
-    *len_ret = rlen - 1;
+    *len_ret = vb_len(&r);
+    *s_ret = vb_consume(&r);
     return SP_SUCCESS;
-#   undef STASH
 #   undef DUMP_LEAD
 }
 
 /**
- * Compare two null-terminated UCS-4 strings.
- * @param[in] a		First string
- * @param[in] b		Second string
- * @returns true if equal
+ * Hash an object key (FNV-1a).
+ * @param[in] key	Key
+ * @param[in] key_length Key length
+ * @returns hash value
  */
-static bool
-ucs4streq(ucs4_t *a, ucs4_t *b)
+static unsigned
+json_key_hash(const char *key, size_t key_length)
 {
-    ucs4_t ac, bc;
+    unsigned h = 2166136261U;
+    size_t i;
 
-    while (true) {
-	ac = *a++;
-	bc = *b++;
-	if (ac == 0 && bc == 0) {
-	    return true;
+    for (i = 0; i < key_length; i++) {
+	h ^= (unsigned char)key[i];
+	h *= 16777619U;
+    }
+    return h;
+}
+
+/**
+ * Add a member to an object's hash index.
+ * The first member with a given key wins, matching a linear search.
+ * @param[in,out] json	Object
+ * @param[in] index	Member index
+ */
+static void
+json_object_hash_insert(json_t *json, unsigned index)
+{
+    const key_value_t *kv = &json->value.v_object.key_values[index];
+    unsigned mask = json->value.v_object.hash_size - 1;
+    unsigned h = json_key_hash(kv->key, kv->key_length) & mask;
+    unsigned slot;
+
+    while ((slot = json->value.v_object.hash[h]) != 0) {
+	const key_value_t *other = &json->value.v_object.key_values[slot - 1];
+
+	if (other->key_length == kv->key_length &&
+		!memcmp(other->key, kv->key, kv->key_length)) {
+	    return;
 	}
-	if (ac != bc) {
-	    return false;
+	h = (h + 1) & mask;
+    }
+    json->value.v_object.hash[h] = index + 1;
+}
+
+/**
+ * Account for a member just appended to an object.
+ * Builds (or grows) the hash index once the object is large enough to need
+ * one.
+ * @param[in,out] json	Object
+ */
+static void
+json_object_hash_add(json_t *json)
+{
+    unsigned length = json->value.v_object.length;
+    unsigned i;
+
+    if (length < JSON_HASH_MIN) {
+	return;
+    }
+    if (json->value.v_object.hash != NULL &&
+	    length * 2 <= json->value.v_object.hash_size) {
+	json_object_hash_insert(json, length - 1);
+	return;
+    }
+
+    /* (Re-)build the index. */
+    Free(json->value.v_object.hash);
+    json->value.v_object.hash_size = JSON_HASH_MIN * 2;
+    while (json->value.v_object.hash_size < length * 4) {
+	json->value.v_object.hash_size *= 2;
+    }
+    json->value.v_object.hash = (unsigned *)Calloc(
+	    json->value.v_object.hash_size, sizeof(unsigned));
+    for (i = 0; i < length; i++) {
+	json_object_hash_insert(json, i);
+    }
+}
+
+/**
+ * Find an object member.
+ * @param[in] json	Object
+ * @param[in] key	Key
+ * @param[in] key_length Key length
+ * @returns member index, or -1
+ */
+static int
+json_object_find(const json_t *json, const char *key, size_t key_length)
+{
+    const key_value_t *kv;
+    unsigned i;
+
+    if (json->value.v_object.hash != NULL) {
+	unsigned mask = json->value.v_object.hash_size - 1;
+	unsigned h = json_key_hash(key, key_length) & mask;
+	unsigned slot;
+
+	while ((slot = json->value.v_object.hash[h]) != 0) {
+	    kv = &json->value.v_object.key_values[slot - 1];
+	    if (kv->key_length == key_length &&
+		    !memcmp(kv->key, key, key_length)) {
+		return (int)(slot - 1);
+	    }
+	    h = (h + 1) & mask;
+	}
+	return -1;
+    }
+
+    for (i = 0; i < json->value.v_object.length; i++) {
+	kv = &json->value.v_object.key_values[i];
+	if (kv->key_length == key_length && !memcmp(kv->key, key, key_length)) {
+	    return (int)i;
 	}
     }
+    return -1;
 }
 
 /**
@@ -380,19 +454,21 @@ json_parse_internal(int *line, int *column, const char *text, size_t *offset,
 	ucs4_t *stop_token, bool *any)
 {
     json_token_state_t token_state = JK_BASE;
-    ucs4_t *token_buf = NULL;
-    size_t token_buf_len = 0;
+    varbuf_t token;		/* token text, in UTF-8 */
+    bool token_escaped = false;	/* true if string token has escapes */
+    bool token_invalid = false;	/* true if string token is not encodable */
     json_errcode_t e;
     unsigned length;
     ucs4_t internal_stop;
 
+    vb_init(&token);
     *result = NULL;
     *error = NULL;
     *stop_token = 0;
     *any = false;
 
 #   define FAIL(e, m) do { \
-    Replace(token_buf, NULL); \
+    vb_free(&token); \
     *error = (json_parse_error_t *)Malloc(sizeof(json_parse_error_t)); \
     (*error)->errcode = e; \
     (*error)->line = *line; \
@@ -404,22 +480,30 @@ json_parse_internal(int *line, int *column, const char *text, size_t *offset,
 } while (false)
 
 #   define ADD_TOKEN(u) do { \
-    token_buf = (ucs4_t *)Realloc(token_buf, \
-	    (token_buf_len + 1) * sizeof(ucs4_t)); \
-    token_buf[token_buf_len++] = u; \
+    char c_ = (char)(u); \
+    vb_append(&token, &c_, 1); \
+} while (false)
+
+#   define ADD_UTF8(u) do { \
+    char ubuf_[6]; \
+    int nu_ = unicode_to_utf8(u, ubuf_); \
+    if (nu_ < 0) { \
+	token_invalid = true; \
+    } else { \
+	vb_append(&token, ubuf_, nu_); \
+    } \
 } while (false)
 
 #   define BAREWORD_DONE do { \
-    ADD_TOKEN(0); \
-    if (ucs4streq(token_buf, u_null)) { \
+    if (!strcmp(vb_buf(&token), "null")) { \
 	*any = true; \
 	*result = NULL; \
-    } else if (ucs4streq(token_buf, u_true)) { \
+    } else if (!strcmp(vb_buf(&token), "true")) { \
 	*any = true; \
 	*result = (json_t *)Calloc(1, sizeof(json_t)); \
 	(*result)->type = JT_BOOLEAN; \
 	(*result)->value.v_boolean = true; \
-    } else if (ucs4streq(token_buf, u_false)) { \
+    } else if (!strcmp(vb_buf(&token), "false")) { \
 	*any = true; \
 	*result = (json_t *)Calloc(1, sizeof(json_t)); \
 	(*result)->type = JT_BOOLEAN; \
@@ -427,28 +511,26 @@ json_parse_internal(int *line, int *column, const char *text, size_t *offset,
     } else { \
 	FAIL(JE_SYNTAX, NewString("Invalid bareword")); \
     } \
-    Replace(token_buf, NULL); \
+    vb_free(&token); \
 } while (false)
 
 #   define NUMBER_DONE do { \
     int64_t i_ret; \
     double d_ret; \
     np_ret_t np; \
-    np = valid_integer(token_buf, token_buf_len, &i_ret); \
+    np = valid_integer(vb_buf(&token), vb_len(&token), &i_ret); \
     if (np == NP_OVERFLOW) { \
 	FAIL(JE_OVERFLOW, NewString("Integer overflow")); \
     } else if (np == NP_SUCCESS) { \
-	Replace(token_buf, NULL); \
 	*any = true; \
 	*result = (json_t *)Calloc(1, sizeof(json_t)); \
 	(*result)->type = JT_INTEGER; \
 	(*result)->value.v_integer = i_ret; \
     } else { \
-	np = valid_double(token_buf, token_buf_len, &d_ret); \
+	np = valid_double(vb_buf(&token), vb_len(&token), &d_ret); \
 	if (np == NP_OVERFLOW) { \
 	    FAIL(JE_OVERFLOW, NewString("Floating-point overflow")); \
 	} else if (np == NP_SUCCESS) { \
-	    Replace(token_buf, NULL); \
 	    *any = true; \
 	    *result = (json_t *)Calloc(1, sizeof(json_t)); \
 	    (*result)->type = JT_DOUBLE; \
@@ -457,18 +539,37 @@ json_parse_internal(int *line, int *column, const char *text, size_t *offset,
 	    FAIL(JE_SYNTAX, NewString("Invalid number")); \
 	} \
     } \
-    Replace(token_buf, NULL); \
+    vb_free(&token); \
 } while (false)
 
     /* Start parsing. */
     while (*offset < len) {
 	int nr;
 	ucs4_t ucs4;
+	unsigned char c = (unsigned char)text[*offset];
+
+	/* Copy a run of plain string text in one piece. */
+	if (token_state == JK_STRING && PLAIN_STRING_BYTE(c)) {
+	    size_t start = *offset;
+
+	    do {
+		(*offset)++;
+	    } while (*offset < len &&
+		    PLAIN_STRING_BYTE((unsigned char)text[*offset]));
+	    vb_append(&token, text + start, *offset - start);
+	    *column += (int)(*offset - start);
+	    continue;
+	}
 
-	/* Decode the next UTF-8 character. */
-	nr = utf8_to_unicode(text + *offset, len - *offset, &ucs4);
-	if (nr <= 0) {
-	    FAIL(JE_UTF8, NewString("UTF-8 decoding error"));
+	/* Decode the next UTF-8 character. ASCII needs no decoding. */
+	if (c < 0x80) {
+	    ucs4 = c;
+	    nr = 1;
+	} else {
+	    nr = utf8_to_unicode(text + *offset, len - *offset, &ucs4);
+	    if (nr <= 0) {
+		FAIL(JE_UTF8, NewString("UTF-8 decoding error"));
+	    }
 	}
 
 	/* Account for it. */
@@ -539,12 +640,10 @@ json_parse_internal(int *line, int *column, const char *text, size_t *offset,
 				FAIL(JE_SYNTAX, NewString("Expected string"));
 			    }
 
-			    /* Save the key. */
+			    /* Save the key, taking over the string's text. */
 			    key_length = element->value.v_string.length;
-			    key = Malloc(key_length + 1);
-			    memcpy(key, element->value.v_string.text,
-				    key_length);
-			    key[key_length] = '\0';
+			    key = (char *)element->value.v_string.text;
+			    element->value.v_string.text = NULL;
 			    json_free(element);
 
 			    /* Parse the value, followed by ',' or '}'. */
@@ -586,6 +685,7 @@ json_parse_internal(int *line, int *column, const char *text, size_t *offset,
 					length * sizeof(key_value_t));
 			    (*result)->value.v_object.key_values[length - 1] =
 				kv; /* struct copy */
+			    json_object_hash_add(*result);
 			} while (internal_stop == ',');
 			token_state = JK_TERMINAL;
 			break;
@@ -683,12 +783,21 @@ json_parse_internal(int *line, int *column, const char *text, size_t *offset,
 		    char *s_ret;
 		    size_t len_ret;
 
-		    sp = valid_string(token_buf, token_buf_len, &s_ret,
-			    &len_ret);
-		    if (sp == SP_FAILURE) {
+		    if (token_invalid) {
 			FAIL(JE_SYNTAX, NewString("Invalid string"));
 		    }
-		    Replace(token_buf, NULL);
+		    if (token_escaped) {
+			sp = valid_string(vb_buf(&token), vb_len(&token),
+				&s_ret, &len_ret);
+			if (sp == SP_FAILURE) {
+			    FAIL(JE_SYNTAX, NewString("Invalid string"));
+			}
+			vb_free(&token);
+		    } else {
+			/* No escapes: the token is the string. */
+			len_ret = vb_len(&token);
+			s_ret = vb_consume(&token);
+		    }
 		    *any = true;
 		    *result = (json_t *)Calloc(1, sizeof(json_t));
 		    (*result)->type = JT_STRING;
@@ -696,7 +805,7 @@ json_parse_internal(int *line, int *column, const char *text, size_t *offset,
 		    (*result)->value.v_string.text = s_ret;
 		    token_state = JK_TERMINAL;
 		} else {
-		    ADD_TOKEN(ucs4);
+		    ADD_UTF8(ucs4);
 		}
 		break;
 	    case JK_STRING_BS:
@@ -704,8 +813,9 @@ json_parse_internal(int *line, int *column, const char *text, size_t *offset,
 		if (ucs4 == '"') {
 		    ADD_TOKEN(ucs4);
 		} else {
+		    token_escaped = true;
 		    ADD_TOKEN('\\');
-		    ADD_TOKEN(ucs4);
+		    ADD_UTF8(ucs4);
 		}
 		token_state = JK_STRING;
 		break;
@@ -733,6 +843,7 @@ json_parse_internal(int *line, int *column, const char *text, size_t *offset,
     }
 
 #   undef ADD_TOKEN
+#   undef ADD_UTF8
 #   undef FAIL
 #   undef BAREWORD_DONE
 #   undef NUMBER_DONE
@@ -809,6 +920,7 @@ _json_free(json_t *json)
 		    json->value.v_object.key_values[i].value = NULL;
 		}
 		Replace(json->value.v_object.key_values, NULL);
+		Replace(json->value.v_object.hash, NULL);
 		break;
 	    default:
 		break;
@@ -837,17 +949,17 @@ _json_free_error(json_parse_error_t *error)
 }
 
 /**
- * Expand a JSON string into something safe to display.
+ * Expand a JSON string into something safe to display, appending it to a
+ * buffer.
+ * @param[in,out] r	Buffer to append to
  * @param[in] s		String to expand
  * @param[in] len	String length
  * @param[in] options	Option flags
  */
-static char *
-json_expand_string(const char *s, size_t len, unsigned options)
+static void
+json_expand_string_vb(varbuf_t *r, const char *s, size_t len,
+	unsigned options)
 {
-    varbuf_t r;
-
-    vb_init(&r);
     while (len > 0) {
 	int nr;
 	ucs4_t ucs4;
@@ -855,40 +967,40 @@ json_expand_string(const char *s, size_t len, unsigned options)
 	/* Decode the next UTF-8 character. */
 	nr = utf8_to_unicode(s, len, &ucs4);
 	if (nr <= 0) {
-	    vb_append(&r, s, 1);
+	    vb_append(r, s, 1);
 	    s++;
 	    len--;
 	    continue;
 	}
 	switch (ucs4) {
 	case '\r':
-	    vb_appends(&r, "\\r");
+	    vb_appends(r, "\\r");
 	    break;
 	case '\n':
-	    vb_appends(&r, "\\n");
+	    vb_appends(r, "\\n");
 	    break;
 	case '\t':
-	    vb_appends(&r, "\\t");
+	    vb_appends(r, "\\t");
 	    break;
 	case '\f':
-	    vb_appends(&r, "\\f");
+	    vb_appends(r, "\\f");
 	    break;
 	case '\\':
-	    vb_appends(&r, "\\\\");
+	    vb_appends(r, "\\\\");
 	    break;
 	case '"':
-	    vb_appends(&r, "\\\"");
+	    vb_appends(r, "\\\"");
 	    break;
 	default:
 	    if (ucs4 < ' ') {
-		vb_appendf(&r, "\\u%04x", ucs4);
+		vb_appendf(r, "\\u%04x", ucs4);
 	    } else if ((options & JW_EXPAND_SURROGATES) && ucs4 >= 0x10000) {
 		/* Not strictly necessary, but helpful. */
-		vb_appendf(&r, "\\u%04x\\u%04x",
+		vb_appendf(r, "\\u%04x\\u%04x",
 			LEAD_OFFSET + (ucs4 >> 10),
 			0xdc00 + (ucs4 & 0x3ff));
 	    } else {
-		vb_append(&r, s, nr);
+		vb_append(r, s, nr);
 	    }
 	    break;
 	}
@@ -896,6 +1008,22 @@ json_expand_string(const char *s, size_t len, unsigned options)
 	s += nr;
 	len -= nr;
     }
+}
+
+/**
+ * Expand a JSON string into something safe to display.
+ * @param[in] s		String to expand
+ * @param[in] len	String length
+ * @param[in] options	Option flags
+ * @returns Expanded string
+ */
+static char *
+json_expand_string(const char *s, size_t len, unsigned options)
+{
+    varbuf_t r;
+
+    vb_init(&r);
+    json_expand_string_vb(&r, s, len, options);
     return vb_consume(&r);
 }
 
@@ -977,6 +1105,340 @@ json_write_o(const json_t *json, unsigned options)
     return json_write_indent(json, options, 0);
 }
 
+/**
+ * Create a streaming JSON writer.
+ * The writer formats JSON text directly into its own buffer, producing the
+ * same text json_write_o() would produce for the equivalent tree.
+ * @param[in] options	Option flags
+ * @returns New writer
+ */
+json_writer_t *
+json_writer_new(unsigned options)
+{
+    json_writer_t *w = (json_writer_t *)Calloc(1, sizeof(json_writer_t));
+
+    vb_init(&w->r);
+    w->options = options;
+    return w;
+}
+
+/**
+ * Free a streaming JSON writer.
+ * @param[in] w		Writer
+ * @returns NULL
+ */
+json_writer_t *
+_json_writer_free(json_writer_t *w)
+{
+    if (w != NULL) {
+	vb_free(&w->r);
+	Free(w->level);
+	Free(w);
+    }
+    return NULL;
+}
+
+/**
+ * Start a new member or array element.
+ * Emits the separator from the previous member, the indentation and the key.
+ * @param[in,out] w	Writer
+ * @param[in] key	Key, or NULL for array elements and the outermost value
+ * @param[in] key_length Key length
+ */
+static void
+json_writer_member(json_writer_t *w, const char *key, size_t key_length)
+{
+    json_writer_level_t *l;
+    bool one_line = (w->options & JW_ONE_LINE) != 0;
+
+    if (w->depth == 0) {
+	assert(key == NULL);
+	return;
+    }
+
+    l = &w->level[w->depth - 1];
+    if (l->any) {
+	vb_appends(&w->r, one_line? ",": ",\n");
+    }
+    l->any = true;
+    if (!one_line) {
+	vb_appendf(&w->r, "%*s", w->depth * 2, "");
+    }
+    if (!l->is_array) {
+	assert(key != NULL);
+	vb_appends(&w->r, "\"");
+	json_expand_string_vb(&w->r, key, key_length, w->options);
+	vb_appends(&w->r, one_line? "\":": "\": ");
+    } else {
+	assert(key == NULL);
+    }
+}
+
+/**
+ * Open a container.
+ * @param[in,out] w	Writer
+ * @param[in] key	Key, or NULL
+ * @param[in] key_length Key length
+ * @param[in] is_array	true for an array, false for an object
+ */
+static void
+json_writer_open(json_writer_t *w, const char *key, size_t key_length,
+	bool is_array)
+{
+    json_writer_member(w, key, key_length);
+    vb_appends(&w->r, is_array? "[": "{");
+    if (!(w->options & JW_ONE_LINE)) {
+	vb_appends(&w->r, "\n");
+    }
+
+    if (w->depth >= w->max_depth) {
+	w->max_depth += 8;
+	w->level = (json_writer_level_t *)Realloc(w->level,
+		w->max_depth * sizeof(json_writer_level_t));
+    }
+    w->level[w->depth].is_array = is_array;
+    w->level[w->depth].any = false;
+    w->depth++;
+}
+
+/**
+ * Close a container.
+ * @param[in,out] w	Writer
+ * @param[in] is_array	true for an array, false for an object
+ */
+static void
+json_writer_close(json_writer_t *w, bool is_array)
+{
+    assert(w->depth > 0);
+    assert(w->level[w->depth - 1].is_array == is_array);
+
+    w->depth--;
+    if (!(w->options & JW_ONE_LINE)) {
+	if (w->level[w->depth].any) {
+	    vb_appends(&w->r, "\n");
+	}
+	vb_appendf(&w->r, "%*s", w->depth * 2, "");
+    }
+    vb_appends(&w->r, is_array? "]": "}");
+}
+
+/**
+ * Open an object.
+ * @param[in,out] w	Writer
+ * @param[in] key	Key if the parent is an object, otherwise NULL
+ */
+void
+json_writer_begin_object(json_writer_t *w, const char *key)
+{
+    json_writer_open(w, key, key? strlen(key): 0, false);
+}
+
+/**
+ * Close an object.
+ * @param[in,out] w	Writer
+ */
+void
+json_writer_end_object(json_writer_t *w)
+{
+    json_writer_close(w, false);
+}
+
+/**
+ * Open an array.
+ * @param[in,out] w	Writer
+ * @param[in] key	Key if the parent is an object, otherwise NULL
+ */
+void
+json_writer_begin_array(json_writer_t *w, const char *key)
+{
+    json_writer_open(w, key, key? strlen(key): 0, true);
+}
+
+/**
+ * Close an array.
+ * @param[in,out] w	Writer
+ */
+void
+json_writer_end_array(json_writer_t *w)
+{
+    json_writer_close(w, true);
+}
+
+/**
+ * Write a string value.
+ * @param[in,out] w	Writer
+ * @param[in] key	Key if the parent is an object, otherwise NULL
+ * @param[in] value	String value
+ * @param[in] length	String length, or NT
+ */
+void
+json_writer_string(json_writer_t *w, const char *key, const char *value,
+	ssize_t length)
+{
+    json_writer_member(w, key, key? strlen(key): 0);
+    vb_appends(&w->r, "\"");
+    json_expand_string_vb(&w->r, value,
+	    (length < 0)? strlen(value): (size_t)length, w->options);
+    vb_appends(&w->r, "\"");
+}
+
+/**
+ * Write an integer value.
+ * @param[in,out] w	Writer
+ * @param[in] key	Key if the parent is an object, otherwise NULL
+ * @param[in] value	Integer value
+ */
+void
+json_writer_integer(json_writer_t *w, const char *key, int64_t value)
+{
+    json_writer_member(w, key, key? strlen(key): 0);
+    vb_appendf(&w->r, "%"JSON_INT_PRINT, value);
+}
+
+/**
+ * Write a floating-point value.
+ * @param[in,out] w	Writer
+ * @param[in] key	Key if the parent is an object, otherwise NULL
+ * @param[in] value	Double value
+ */
+void
+json_writer_double(json_writer_t *w, const char *key, double value)
+{
+    json_writer_member(w, key, key? strlen(key): 0);
+    vb_appendf(&w->r, "%g", value);
+}
+
+/**
+ * Write a Boolean value.
+ * @param[in,out] w	Writer
+ * @param[in] key	Key if the parent is an object, otherwise NULL
+ * @param[in] value	Boolean value
+ */
+void
+json_writer_boolean(json_writer_t *w, const char *key, bool value)
+{
+    json_writer_member(w, key, key? strlen(key): 0);
+    vb_appends(&w->r, value? "true": "false");
+}
+
+/**
+ * Write a JSON node, recursively.
+ * @param[in,out] w	Writer
+ * @param[in] key	Key
+ * @param[in] key_length Key length
+ * @param[in] json	Node to write
+ */
+static void
+json_writer_node_internal(json_writer_t *w, const char *key,
+	size_t key_length, const json_t *json)
+{
+    unsigned i;
+    const char *v;
+    size_t len;
+
+    switch (json_type(json)) {
+    case JT_NULL:
+    default:
+	json_writer_member(w, key, key_length);
+	vb_appends(&w->r, "null");
+	break;
+    case JT_BOOLEAN:
+	json_writer_member(w, key, key_length);
+	vb_appends(&w->r, json_boolean_value(json)? "true": "false");
+	break;
+    case JT_INTEGER:
+	json_writer_member(w, key, key_length);
+	vb_appendf(&w->r, "%"JSON_INT_PRINT, json_integer_value(json));
+	break;
+    case JT_DOUBLE:
+	json_writer_member(w, key, key_length);
+	vb_appendf(&w->r, "%g", json_double_value(json));
+	break;
+    case JT_STRING:
+	json_writer_member(w, key, key_length);
+	v = json_string_value(json, &len);
+	vb_appends(&w->r, "\"");
+	json_expand_string_vb(&w->r, v, len, w->options);
+	vb_appends(&w->r, "\"");
+	break;
+    case JT_OBJECT:
+	json_writer_open(w, key, key_length, false);
+	for (i = 0; i < json->value.v_object.length; i++) {
+	    key_value_t *kv = &json->value.v_object.key_values[i];
+
+	    json_writer_node_internal(w, kv->key, kv->key_length, kv->value);
+	}
+	json_writer_close(w, false);
+	break;
+    case JT_ARRAY:
+	json_writer_open(w, key, key_length, true);
+	for (i = 0; i < json->value.v_array.length; i++) {
+	    json_writer_node_internal(w, NULL, 0,
+		    json->value.v_array.array[i]);
+	}
+	json_writer_close(w, true);
+	break;
+    }
+}
+
+/**
+ * Write an existing JSON node.
+ * @param[in,out] w	Writer
+ * @param[in] key	Key if the parent is an object, otherwise NULL
+ * @param[in] json	Node to write
+ */
+void
+json_writer_node(json_writer_t *w, const char *key, const json_t *json)
+{
+    json_writer_node_internal(w, key, key? strlen(key): 0, json);
+}
+
+/**
+ * Returns the current nesting depth of a writer.
+ * @param[in] w		Writer
+ * @returns Number of open containers
+ */
+int
+json_writer_depth(const json_writer_t *w)
+{
+    return w->depth;
+}
+
+/**
+ * Checks whether the innermost open container is an array.
+ * @param[in] w		Writer
+ * @returns true if an array is open
+ */
+bool
+json_writer_in_array(const json_writer_t *w)
+{
+    return w->depth > 0 && w->level[w->depth - 1].is_array;
+}
+
+/**
+ * Returns the text accumulated by a writer.
+ * @param[in] w		Writer
+ * @param[out] len	Returned length
+ * @returns Text (not NUL-terminated)
+ */
+const char *
+json_writer_buf(const json_writer_t *w, size_t *len)
+{
+    *len = vb_len(&w->r);
+    return vb_buf(&w->r);
+}
+
+/**
+ * Discards the text accumulated by a writer, keeping its buffer.
+ * @param[in,out] w	Writer
+ */
+void
+json_writer_reset(json_writer_t *w)
+{
+    assert(w->depth == 0);
+    vb_reset(&w->r);
+}
+
 /**
  * Returns the type of a JSON node.
  * @param[in] json	JSON node.
@@ -1042,21 +1504,17 @@ bool
 json_object_member(const json_t *json, const char *key, ssize_t key_length,
 	json_t **ret)
 {
-    unsigned i;
+    int i;
 
     assert(json != NULL);
     assert(json->type == JT_OBJECT);
     if (key_length < 0)  {
 	key_length = strlen(key);
     }
-    for (i = 0; i < json->value.v_object.length; i++) {
-	if (json->value.v_object.key_values[i].key_length ==
-		(size_t)key_length &&
-		!memcmp(key, json->value.v_object.key_values[i].key,
-		    key_length)) {
-	    *ret = json->value.v_object.key_values[i].value;
-	    return true;
-	}
+    i = json_object_find(json, key, key_length);
+    if (i >= 0) {
+	*ret = json->value.v_object.key_values[i].value;
+	return true;
     }
     *ret = NULL;
     return false;
@@ -1272,7 +1730,7 @@ void
 json_object_set(json_t *json, const char *key, ssize_t key_length,
         json_t *value)
 {
-    unsigned i;
+    int i;
     key_value_t *kv;
     char *s;
 
@@ -1281,15 +1739,13 @@ json_object_set(json_t *json, const char *key, ssize_t key_length,
     if (key_length < 0) {
 	key_length = strlen(key);
     }
-    for (i = 0; i < json->value.v_object.length; i++) {
+    i = json_object_find(json, key, key_length);
+    if (i >= 0) {
 	/* Replace. */
 	kv = &json->value.v_object.key_values[i];
-	if (kv->key_length == (size_t)key_length &&
-		!memcmp(kv->key, key, key_length)) {
-	    _json_free(kv->value);
-	    kv->value = value;
-	    return;
-	}
+	_json_free(kv->value);
+	kv->value = value;
+	return;
     }
 
     /* Extend. */
@@ -1303,6 +1759,7 @@ json_object_set(json_t *json, const char *key, ssize_t key_length,
     s[key_length] = '\0';
     kv->key = s;
     kv->value = value;
+    json_object_hash_add(json);
 }
 
 /**
@@ -291,9 +291,7 @@ linemode_buf_init(void)
 static void
 nvt_process_s(const char *data)
 {
-    while (*data) {
-	nvt_process((unsigned int)*data++);
-    }
+    nvt_process_n((const unsigned char *)data, strlen(data));
 }
 
 static void
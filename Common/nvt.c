@@ -1277,6 +1277,55 @@ ansi_printing(int ig1 _is_unused, int ig2 _is_unused)
     return DATA;
 }
 
+/*
+ * Fast path for ansi_printing: store a run of printable ASCII characters
+ * on the cursor row. The run stops short of the last column, so the wrap
+ * logic in ansi_printing() is never needed, and the cursor is moved once
+ * at the end.
+ *
+ * Returns the number of characters consumed, which may be 0.
+ */
+static size_t
+nvt_print_run(const unsigned char *buf, size_t len, bool tracing)
+{
+    int baddr = cursor_addr;
+    int end = cursor_addr - (cursor_addr % COLS) + COLS - 1;
+    size_t i;
+
+    if (state != DATA ||
+	    pmi != 0 ||
+	    held_wrap ||
+	    insert_mode ||
+	    once_cset != -1 ||
+	    csd[cset] != CSD_US ||
+	    cursor_addr / COLS >= scroll_bottom) {
+	return 0;
+    }
+
+    for (i = 0; i < len && baddr < end; i++, baddr++) {
+	unsigned char c = buf[i];
+
+	if (c < ' ' || c > '~' || ctlr_dbcs_state(baddr) != DBCS_NONE) {
+	    break;
+	}
+	if (tracing) {
+	    trace_char((char)c);
+	}
+	ctlr_add_nvt(baddr, c, CS_BASE);
+	ctlr_add_gr(baddr, gr);
+	ctlr_add_fg(baddr, fg);
+	ctlr_add_bg(baddr, bg);
+	task_store(c);
+    }
+
+    if (i > 0) {
+	nvt_ch = buf[i - 1];
+	pe = 0;
+	cursor_move(baddr);
+    }
+    return i;
+}
+
 static enum state
 ansi_multibyte(int ig1, int ig2)
 {
@@ -1810,6 +1859,27 @@ nvt_connect(bool connected)
     }
 }
 
+/* Run one character through the state machine. */
+static void
+nvt_process_char(unsigned int c)
+{
+    afn_t fn;
+
+    nvt_ch = c;
+    fn = nvt_fn[st[(int)state][c]];
+    state = (*fn)(n[0], n[1]);
+
+    /* Saving pending escape data. */
+    if (state == DATA) {
+	pe = 0;
+    } else if (pe < PE_MAX) {
+	ped[pe++] = c;
+    }
+
+    /* Save the character for Expect() and NvtText(). */
+    task_store(c);
+}
+
 /*
  * External entry points
  */
@@ -1817,10 +1887,7 @@ nvt_connect(bool connected)
 void
 nvt_process(unsigned int c)
 {
-    afn_t fn;
-
     c &= 0xff;
-    nvt_ch = c;
 
     scroll_to_bottom();
 
@@ -1828,18 +1895,45 @@ nvt_process(unsigned int c)
 	trace_char((char)c);
     }
 
-    fn = nvt_fn[st[(int)state][c]];
-    state = (*fn)(n[0], n[1]);
+    nvt_process_char(c);
 
-    /* Saving pending escape data. */
-    if (state == DATA) {
-	pe = 0;
-    } else if (pe < PE_MAX) {
-	ped[pe++] = c;
+    /* Let a blocked task go. */
+    task_host_output();
+}
+
+/*
+ * Process a buffer of NVT data.
+ *
+ * This is equivalent to calling nvt_process() for each byte, but runs of
+ * printable characters bypass the state machine, and the scroll and task
+ * notifications are done once for the whole buffer.
+ */
+void
+nvt_process_n(const unsigned char *buf, size_t len)
+{
+    bool tracing = toggled(SCREEN_TRACE);
+    size_t i = 0;
+
+    if (len == 0) {
+	return;
+    }
+
+    scroll_to_bottom();
+
+    while (i < len) {
+	size_t nr = nvt_print_run(buf + i, len - i, tracing);
+
+	if (nr > 0) {
+	    i += nr;
+	    continue;
+	}
+	if (tracing) {
+	    trace_char((char)buf[i]);
+	}
+	nvt_process_char(buf[i++]);
     }
 
     /* Let a blocked task go. */
-    task_store(c);
     task_host_output();
 }
 
@@ -42,7 +42,6 @@
 #endif /*]*/
 
 #include "wincmn.h"
-#include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
 
@@ -313,26 +312,17 @@ run_next(peer_t *p)
  * Read the next command from a peer socket.
  * @param[in] fd	File descriptor
  * @param[in] id	I/O identifier
+ * @param[in] data	Peer
  */
 static void
-peer_input(iosrc_t fd _is_unused, ioid_t id)
+peer_input(iosrc_t fd _is_unused, ioid_t id _is_unused, void *data)
 {
-    peer_t *p;
-    bool found_peer = false;
+    peer_t *p = (peer_t *)data;
     char buf[8192];
     size_t n2r;
     ssize_t nr;
     ssize_t i;
 
-    /* Find the peer. */
-    FOREACH_LLIST(&peer_scripts, p, peer_t *) {
-	if (p->id == id) {
-	    found_peer = true;
-	    break;
-	}
-    } FOREACH_LLIST_END(&peer_scripts, p, peer_t *);
-    assert(found_peer);
-
     /* Read input. */
     n2r = sizeof(buf);
     nr = recv(p->socket, buf, (int)n2r, 0);
@@ -375,9 +365,9 @@ peer_input(iosrc_t fd _is_unused, ioid_t id)
     if (!run_next(p) && p->id == NULL_IOID) {
 	/* Get more input. */
 #if defined(_WIN32) /*[*/
-	p->id = AddInput(p->event, peer_input);
+	p->id = AddInputData(p->event, peer_input, p);
 #else /*][*/
-	p->id = AddInput(p->socket, peer_input);
+	p->id = AddInputData(p->socket, peer_input, p);
 #endif /*]*/
     }
 }
@@ -492,9 +482,9 @@ peer_done(task_cbh handle, bool success, bool abort)
     if (!new_child && p->id == NULL_IOID) {
 	/* Allow more input. */
 #if defined(_WIN32) /*[*/
-	p->id = AddInput(p->event, peer_input);
+	p->id = AddInputData(p->event, peer_input, p);
 #else /*][*/
-	p->id = AddInput(p->socket, peer_input);
+	p->id = AddInputData(p->socket, peer_input, p);
 #endif /*]*/
     }
 
@@ -637,9 +627,10 @@ peer_getir_state(task_cbh handle, const char *name)
  *
  * @param[in] fd	File descriptor
  * @param[in] id	I/O identifier
+ * @param[in] data	Listener
  */
 static void
-peer_connection(iosrc_t fd _is_unused, ioid_t id)
+peer_connection(iosrc_t fd _is_unused, ioid_t id _is_unused, void *data)
 {
     socket_t accept_fd;
     union {
@@ -649,16 +640,7 @@ peer_connection(iosrc_t fd _is_unused, ioid_t id)
     } sa;
     socklen_t len = sizeof(sa);
     char hostbuf[128];
-    peer_listen_t listener;
-    bool found = false;
-
-    FOREACH_LLIST(&peer_listeners, listener, peer_listen_t) {
-	if (listener->id == id) {
-	    found = true;
-	    break;
-	}
-    } FOREACH_LLIST_END(&peer_listeners, listener, peer_listen_t);
-    assert(found);
+    peer_listen_t listener = (peer_listen_t)data;
 
     accept_fd = accept(listener->socket, &sa.sa, &len);
     if (accept_fd != INVALID_SOCKET) {
@@ -748,9 +730,9 @@ peer_accepted(socket_t s, void *listener)
     p->socket = s;
 #if defined(_WIN32) /*[*/
     p->event = event;
-    p->id = AddInput(p->event, peer_input);
+    p->id = AddInputData(p->event, peer_input, p);
 #else /*][*/
-    p->id = AddInput(p->socket, peer_input);
+    p->id = AddInputData(p->socket, peer_input, p);
 #endif /*]*/
     p->buf = NULL;
     p->buf_len = 0;
@@ -857,9 +839,9 @@ peer_init(struct sockaddr *sa, socklen_t sa_len, peer_listen_mode mode)
 		win32_strerror(GetLastError()));
 	goto fail;
     }
-    listener->id = AddInput(listener->event, peer_connection);
+    listener->id = AddInputData(listener->event, peer_connection, listener);
 #else /*][*/
-    listener->id = AddInput(listener->socket, peer_connection);
+    listener->id = AddInputData(listener->socket, peer_connection, listener);
 #endif/*]*/
 
     if (sa->sa_family == AF_INET) {
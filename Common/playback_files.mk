@@ -1,2 +1,5 @@
 # playback-specific object files
 PLAYBACK_OBJECTS = playback.o sa_malloc.o
+
+# binary trace decoder object files
+TRCDECODE_OBJECTS = trcdecode.o
@@ -46,6 +46,7 @@
 #include <sys/types.h>
 #if !defined(_WIN32) /*[*/
 #include <sys/wait.h>
+#include <fcntl.h>
 #endif /*]*/
 #include <signal.h>
 #include "globals.h"
@@ -57,6 +58,7 @@
 #include "sf.h"
 #include "tables.h"
 #include "unicodec.h"
+#include "utils.h"
 #include "xtablec.h"
 #if defined(_WIN32) /*[*/
 #include "wsc.h"
@@ -78,30 +80,24 @@
 
 #define BUFSZ		4096
 
+#define PRBUF_SIZE	65536	/* print output buffer size */
+
 #define FCORDER_NOP	0x0001	/* dummy filler for DBCS right half */
 
 static const char *ll_name[] = { "unformatted132", "formatted40", "formatted64", "formatted80" };
 static int ll_len[] = { 132, 40, 64, 80 };
 
-/* 3270 (formatted mode) data */
-static unsigned char default_gr;
-static unsigned char default_cs;
-static int line_length;
-static ucs4_t page_buf[MAX_BUF];
-static unsigned char *xlate_buf[MAX_BUF];
-int xlate_len[MAX_BUF];
-static int baddr = 0;
-static bool page_buf_initted = false;
-static bool any_3270_printable = false;
-static int any_3270_output = 0;
 #if !defined(_WIN32) /*[*/
-static FILE *prfile = NULL;
-static int prpid = -1;
-#else /*][*/
-static int ws_initted = 0;
-static int ws_needpre = 1;
+/* Spool commands not yet collected. */
+typedef struct spool_child {
+    struct spool_child *next;
+    pid_t pid;
+    char *command;
+} spool_child_t;
+static spool_child_t *spool_children = NULL;
+static volatile sig_atomic_t spool_sigchld = 0; /* SIGCHLD since last reap */
+static int spool_id = 0;	/* last session ID assigned */
 #endif /*]*/
-static unsigned char wcc_line_length;
 
 static int ctlr_erase(void);
 static int dump_formatted(void);
@@ -115,29 +111,95 @@ static int copyfile(const char *filename);
     (((c1) & 0x3F) << 8) | (c2) : \
     (((c1) & 0x3F) << 6) | ((c2) & 0x3F))
 
-/* SCS constants and data. */
+/* SCS constants. */
 #define MAX_MPP	132
 #define MAX_MPL	108
 
-static ucs4_t linebuf[MAX_MPP+1];
-static struct {
-    unsigned malloc_len;
-    unsigned data_len;
-    char *buf;
-} trnbuf[MAX_MPP+1];
-static char htabs[MAX_MPP+1];
-static char vtabs[MAX_MPL+1];
-static int lm, tm, bm, mpp, mpl, scs_any;
-static int pp;
-static int line;
-static bool scs_initted = false;
-static bool any_scs_output = false;
-static size_t scs_leftover_len = 0;
-static int scs_leftover_buf[256];
-static int scs_dbcs_subfield = 0;
-static unsigned char scs_dbcs_c1 = 0;
-static unsigned scs_cs = 0;
-static bool ffeoj_last = false;
+/* Per-session state. */
+struct ctlr_state {
+    const char *command;	/* print or spool command, or NULL */
+
+    /* 3270 (formatted mode) data */
+    unsigned char default_gr;
+    unsigned char default_cs;
+    int line_length;
+    ucs4_t page_buf[MAX_BUF];
+    unsigned char *xlate_buf[MAX_BUF];
+    int xlate_len[MAX_BUF];
+    int baddr;
+    bool page_buf_initted;
+    bool any_3270_printable;
+    int any_3270_output;
+#if !defined(_WIN32) /*[*/
+    int prfd;			/* pipe to print command, or spool file */
+    int prpid;
+    unsigned char prbuf[PRBUF_SIZE];	/* buffered print output */
+    size_t prbuf_len;
+    int spool_id;		/* session ID, for spool file names */
+    char *spool_tmpname;	/* spool file being written */
+    time_t spool_time;		/* when the spooled job started */
+#else /*][*/
+    int ws_initted;
+    int ws_needpre;
+#endif /*]*/
+    unsigned char wcc_line_length;
+
+    /* SCS data */
+    ucs4_t linebuf[MAX_MPP+1];
+    struct {
+	unsigned malloc_len;
+	unsigned data_len;
+	char *buf;
+    } trnbuf[MAX_MPP+1];
+    char htabs[MAX_MPP+1];
+    char vtabs[MAX_MPL+1];
+    int lm, tm, bm, mpp, mpl, scs_any;
+    int pp;
+    int line;
+    bool scs_initted;
+    bool any_scs_output;
+    size_t scs_leftover_len;
+    int scs_leftover_buf[256];
+    int scs_dbcs_subfield;
+    unsigned char scs_dbcs_c1;
+    unsigned scs_cs;
+    bool ffeoj_last;
+
+    /* Unformatted 3270 output */
+    struct {
+	char buf;		/* printable data */
+	unsigned char *trn;	/* transparent data */
+	unsigned trn_len;	/* length of transparent data */
+    } uo_data[MAX_UNF_MPP + 2];	/* room for full line plus carriage control */
+    unsigned uo_col;		/* current output column */
+    unsigned uo_maxcol;		/* maximum column buffered */
+    bool uo_last_cr;		/* last data was CR */
+};
+static ctlr_state_t *ctlr = NULL;	/* current session */
+
+/* Create the state for a session, with its own print command if not NULL. */
+ctlr_state_t *
+ctlr_state_new(const char *command)
+{
+    ctlr_state_t *c = (ctlr_state_t *)Calloc(1, sizeof(ctlr_state_t));
+
+    c->command = command;
+#if !defined(_WIN32) /*[*/
+    c->prfd = -1;
+    c->prpid = -1;
+    c->spool_id = spool_id++;
+#else /*][*/
+    c->ws_needpre = 1;
+#endif /*]*/
+    return c;
+}
+
+/* Make a session's state current. */
+void
+ctlr_state_select(ctlr_state_t *c)
+{
+    ctlr = c;
+}
 
 /*
 * Interpret an incoming 3270 command.
@@ -165,7 +227,7 @@ process_ds(unsigned char *buf, size_t buflen)
 	if (ctlr_erase() < 0 || prflush() < 0) {
 	    return PDS_FAILED;
 	}
-	baddr = 0;
+	ctlr->baddr = 0;
 	ctlr_write(buf, buflen, true);
 	return PDS_OKAY_NO_OUTPUT;
     case CMD_EW:	/* erase/write */
@@ -174,7 +236,7 @@ process_ds(unsigned char *buf, size_t buflen)
 	if (ctlr_erase() < 0 || prflush() < 0) {
 	    return PDS_FAILED;
 	}
-	baddr = 0;
+	ctlr->baddr = 0;
 	ctlr_write(buf, buflen, true);
 	return PDS_OKAY_NO_OUTPUT;
     case CMD_W:	/* write */
@@ -230,7 +292,7 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 #define END_TEXT(cmd)	{ END_TEXT0; trace_ds(" %s", cmd); }
 
 #define START_FIELD(fa) { \
-	    ctlr_add(0, FA_IS_ZERO(fa)?INVISIBLE:VISIBLE, 0, default_gr); \
+	    ctlr_add(0, FA_IS_ZERO(fa)?INVISIBLE:VISIBLE, 0, ctlr->default_gr); \
 	    trace_ds(see_attr(fa)); \
 	}
 
@@ -238,30 +300,30 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 	return;
     }
 
-    if (!page_buf_initted) {
-	memset(page_buf, '\0', MAX_BUF * sizeof(ucs4_t));
-	memset(xlate_buf, '\0', MAX_BUF * sizeof(unsigned char *));
-	memset(xlate_len, '\0', MAX_BUF * sizeof(int));
-	page_buf_initted = true;
-	baddr = 0;
+    if (!ctlr->page_buf_initted) {
+	memset(ctlr->page_buf, '\0', MAX_BUF * sizeof(ucs4_t));
+	memset(ctlr->xlate_buf, '\0', MAX_BUF * sizeof(unsigned char *));
+	memset(ctlr->xlate_len, '\0', MAX_BUF * sizeof(int));
+	ctlr->page_buf_initted = true;
+	ctlr->baddr = 0;
     }
 
-    default_gr = 0;
-    default_cs = 0;
+    ctlr->default_gr = 0;
+    ctlr->default_cs = 0;
 
     if (WCC_RESET(buf[1])) {
 	trace_ds("%sreset", paren);
 	paren = ",";
     }
-    wcc_line_length = WCC_LINE_LENGTH(buf[1]);
-    if (wcc_line_length) {
-	trace_ds("%s%s", paren, ll_name[wcc_line_length >> 4]);
+    ctlr->wcc_line_length = WCC_LINE_LENGTH(buf[1]);
+    if (ctlr->wcc_line_length) {
+	trace_ds("%s%s", paren, ll_name[ctlr->wcc_line_length >> 4]);
 	paren = ",";
     } else {
 	trace_ds("%sunformatted", paren);
 	paren = ",";
     }
-    line_length = ll_len[wcc_line_length >> 4];
+    ctlr->line_length = ll_len[ctlr->wcc_line_length >> 4];
     wcc_sound_alarm = WCC_SOUND_ALARM(buf[1]);
     if (wcc_sound_alarm) {
 	trace_ds("%salarm", paren);
@@ -298,24 +360,24 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 	    cp += 2;	/* skip buffer address */
 	    xbaddr = DECODE_BADDR(*(cp - 1), *cp);
 	    END_TEXT("SetBufferAddress");
-	    if (wcc_line_length) {
-		trace_ds("(%d,%d)", 1 + (xbaddr / line_length),
-			1 + (xbaddr % line_length));
+	    if (ctlr->wcc_line_length) {
+		trace_ds("(%d,%d)", 1 + (xbaddr / ctlr->line_length),
+			1 + (xbaddr % ctlr->line_length));
 	    } else {
-		    trace_ds("(%d[%+d])", xbaddr, xbaddr - baddr);
+		    trace_ds("(%d[%+d])", xbaddr, xbaddr - ctlr->baddr);
 	    }
 	    if (xbaddr >= MAX_BUF) {
 		/* Error! */
-		baddr = 0;
+		ctlr->baddr = 0;
 		return;
 	    }
-	    if (wcc_line_length) {
+	    if (ctlr->wcc_line_length) {
 		/* Formatted. */
-		baddr = xbaddr;
-	    } else if (xbaddr > baddr) {
+		ctlr->baddr = xbaddr;
+	    } else if (xbaddr > ctlr->baddr) {
 		/* Unformatted. */
-		while (baddr < xbaddr) {
-		    ctlr_add(0, ' ', default_cs, default_gr);
+		while (ctlr->baddr < xbaddr) {
+		    ctlr_add(0, ' ', ctlr->default_cs, ctlr->default_gr);
 		}
 	    }
 	    previous = SBA;
@@ -332,11 +394,11 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 	    cp += 2;	/* skip buffer address */
 	    xbaddr = DECODE_BADDR(*(cp-1), *cp);
 	    END_TEXT("RepeatToAddress");
-	    if (wcc_line_length) {
-		trace_ds("(%d,%d)", 1 + (xbaddr / line_length),
-			1 + (xbaddr % line_length));
+	    if (ctlr->wcc_line_length) {
+		trace_ds("(%d,%d)", 1 + (xbaddr / ctlr->line_length),
+			1 + (xbaddr % ctlr->line_length));
 	    } else {
-		trace_ds("(%d[%+d])", xbaddr, xbaddr - baddr);
+		trace_ds("(%d[%+d])", xbaddr, xbaddr - ctlr->baddr);
 	    }
 	    cp++;		/* skip char to repeat */
 	    if (*cp == ORDER_GE){
@@ -348,8 +410,8 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 	    }
 	    trace_ds("'%s'", see_ebc(*cp));
 	    previous = ORDER;
-	    if (xbaddr > MAX_BUF || xbaddr < baddr) {
-		baddr = 0;
+	    if (xbaddr > MAX_BUF || xbaddr < ctlr->baddr) {
+		ctlr->baddr = 0;
 		return;
 	    }
 	    /* Translate '*cp' once. */
@@ -369,9 +431,9 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 		}
 		break;
 	    }
-	    while (baddr < xbaddr) {
-		ctlr_add(ra_ge? 0: *cp, ra_xlate, ra_ge? CS_GE: default_cs,
-			default_gr);
+	    while (ctlr->baddr < xbaddr) {
+		ctlr_add(ra_ge? 0: *cp, ra_xlate, ra_ge? CS_GE: ctlr->default_cs,
+			ctlr->default_gr);
 	    }
 	    break;
 	case ORDER_EUA:	/* erase unprotected to address */
@@ -392,7 +454,7 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 		trace_ds("'");
 	    }
 	    ctlr_add(0, ebcdic_to_unicode(*cp, CS_GE, EUO_NONE), CS_GE,
-		    default_gr);
+		    ctlr->default_gr);
 	    break;
 	case ORDER_MF:	/* modify field */
 	    END_TEXT("ModifyField");
@@ -435,7 +497,7 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 	    if (!any_fa) {
 		START_FIELD(0);
 	    }
-	    ctlr_add(0, '\0', 0, default_gr);
+	    ctlr_add(0, '\0', 0, ctlr->default_gr);
 	    break;
 	case ORDER_SA:	/* set attribute */
 	    END_TEXT("SetAttribtue");
@@ -445,14 +507,14 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 		trace_ds("%s", see_efa(*cp, *(cp + 1)));
 	    } else if (*cp == XA_HIGHLIGHTING)  {
 		trace_ds("%s", see_efa(*cp, *(cp + 1)));
-		default_gr = *(cp + 1) & 0x07;
+		ctlr->default_gr = *(cp + 1) & 0x07;
 	    } else if (*cp == XA_ALL)  {
 		trace_ds("%s", see_efa(*cp, *(cp + 1)));
-		default_gr = 0;
-		default_cs = 0;
+		ctlr->default_gr = 0;
+		ctlr->default_cs = 0;
 	    } else if (*cp == XA_CHARSET) {
 		trace_ds("%s", see_efa(*cp, *(cp + 1)));
-		default_cs = (*(cp + 1) == 0xf1) ? 1 : 0;
+		ctlr->default_cs = (*(cp + 1) == 0xf1) ? 1 : 0;
 	    } else {
 		trace_ds("%s[unsupported]", see_efa(*cp, *(cp + 1)));
 	    }
@@ -461,45 +523,45 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 	case FCORDER_FF:	/* Form Feed */
 	    END_TEXT("FF");
 	    previous = ORDER;
-	    ctlr_add(0, FCORDER_FF, default_cs, default_gr);
+	    ctlr_add(0, FCORDER_FF, ctlr->default_cs, ctlr->default_gr);
 	    break;
 	case FCORDER_CR:	/* Carriage Return */
 	    END_TEXT("CR");
 	    previous = ORDER;
-	    ctlr_add(0, FCORDER_CR, default_cs, default_gr);
+	    ctlr_add(0, FCORDER_CR, ctlr->default_cs, ctlr->default_gr);
 	    break;
 	case FCORDER_NL:	/* New Line */
 	    END_TEXT("NL");
 	    previous = ORDER;
-	    ctlr_add(0, FCORDER_NL, default_cs, default_gr);
+	    ctlr_add(0, FCORDER_NL, ctlr->default_cs, ctlr->default_gr);
 	    break;
 	case FCORDER_EM:	/* End of Media */
 	    END_TEXT("EM");
 	    previous = ORDER;
-	    ctlr_add(0, FCORDER_EM, default_cs, default_gr);
+	    ctlr_add(0, FCORDER_EM, ctlr->default_cs, ctlr->default_gr);
 	    break;
 	case FCORDER_DUP:	/* Visible control characters */
 	case FCORDER_FM:
 	    END_TEXT(see_ebc(*cp));
 	    previous = ORDER;
-	    ctlr_add(0, ebc2asc0[*cp], default_cs, default_gr);
+	    ctlr_add(0, ebc2asc0[*cp], ctlr->default_cs, ctlr->default_gr);
 	    break;
 	case FCORDER_SUB:	/* misc format control orders */
 	case FCORDER_EO:
 	    END_TEXT(see_ebc(*cp));
 	    previous = ORDER;
-	    ctlr_add(0, '\0', default_cs, default_gr);
+	    ctlr_add(0, '\0', ctlr->default_cs, ctlr->default_gr);
 	    break;
 	case FCORDER_NULL:
 	    END_TEXT("NULL");
 	    previous = NULLCH;
-	    ctlr_add(0, '\0', default_cs, default_gr);
+	    ctlr_add(0, '\0', ctlr->default_cs, ctlr->default_gr);
 	    break;
 	default:	/* enter character */
 	    if (*cp <= 0x3F) {
 		END_TEXT("ILLEGAL-ORDER ");
 		previous = ORDER;
-		ctlr_add(0, '\0', default_cs, default_gr);
+		ctlr_add(0, '\0', ctlr->default_cs, ctlr->default_gr);
 		trace_ds("%s", see_ebc(*cp));
 		break;
 	    }
@@ -508,8 +570,8 @@ ctlr_write(unsigned char buf[], size_t buflen, bool erase)
 	    }
 	    previous = TEXT;
 	    trace_ds("%s", see_ebc(*cp));
-	    ctlr_add(*cp, ebcdic_to_unicode(*cp, default_cs, EUO_NONE),
-		    default_cs, default_gr);
+	    ctlr_add(*cp, ebcdic_to_unicode(*cp, ctlr->default_cs, EUO_NONE),
+		    ctlr->default_cs, ctlr->default_gr);
 	    break;
 	}
     }
@@ -533,11 +595,11 @@ init_scs_horiz(void)
 {
     int i;
 
-    mpp = MAX_MPP;
-    lm = 1;
-    htabs[1] = 1;
+    ctlr->mpp = MAX_MPP;
+    ctlr->lm = 1;
+    ctlr->htabs[1] = 1;
     for (i = 2; i <= MAX_MPP; i++) {
-	htabs[i] = 0;
+	ctlr->htabs[i] = 0;
     }
 }
 
@@ -546,12 +608,12 @@ init_scs_vert(void)
 {
     int i;
 
-    mpl = 1;
-    tm = 1;
-    bm = mpl;
-    vtabs[1] = 1;
+    ctlr->mpl = 1;
+    ctlr->tm = 1;
+    ctlr->bm = ctlr->mpl;
+    ctlr->vtabs[1] = 1;
     for (i = 0; i <= MAX_MPL; i++) {
-	vtabs[i] = 0;
+	ctlr->vtabs[i] = 0;
     }
 }
 
@@ -560,33 +622,33 @@ init_scs(void)
 {
     int i;
 
-    if (scs_initted) {
+    if (ctlr->scs_initted) {
 	return;
     }
 
     trace_ds("Initializing SCS virtual 3287.\n");
     init_scs_horiz();
     init_scs_vert();
-    pp = 1;
-    line = 1;
-    scs_any = 0;
+    ctlr->pp = 1;
+    ctlr->line = 1;
+    ctlr->scs_any = 0;
     for (i = 0; i < MAX_MPP+1; i++) {
-	linebuf[i] = ' ';
+	ctlr->linebuf[i] = ' ';
     }
     for (i = 0; i < MAX_MPP+1; i++) {
-	if (trnbuf[i].malloc_len != 0) {
-	    Free(trnbuf[i].buf);
-	    trnbuf[i].buf = NULL;
-	    trnbuf[i].malloc_len = 0;
+	if (ctlr->trnbuf[i].malloc_len != 0) {
+	    Free(ctlr->trnbuf[i].buf);
+	    ctlr->trnbuf[i].buf = NULL;
+	    ctlr->trnbuf[i].malloc_len = 0;
 	}
-	trnbuf[i].data_len = 0;
+	ctlr->trnbuf[i].data_len = 0;
     }
-    scs_leftover_len = 0;
-    scs_dbcs_subfield = 0;
-    scs_dbcs_c1 = 0;
-    scs_cs = 0;
+    ctlr->scs_leftover_len = 0;
+    ctlr->scs_dbcs_subfield = 0;
+    ctlr->scs_dbcs_c1 = 0;
+    ctlr->scs_cs = 0;
 
-    scs_initted = true;
+    ctlr->scs_initted = true;
 }
 
 #if defined(_WIN32) /*[*/
@@ -629,8 +691,8 @@ dump_scs_line(bool reset_pp, bool always_nl)
     bool any_data = false;
 
     /* Find the last non-space character in the line buffer. */
-    for (i = mpp; i >= 1; i--) {
-	if (trnbuf[i].data_len != 0 || linebuf[i] != ' ') {
+    for (i = ctlr->mpp; i >= 1; i--) {
+	if (ctlr->trnbuf[i].data_len != 0 || ctlr->linebuf[i] != ' ') {
 	    break;
 	}
     }
@@ -653,35 +715,35 @@ dump_scs_line(bool reset_pp, bool always_nl)
 	     * Dump and transparent data that precedes this
 	     * character.
 	     */
-	    if (trnbuf[j].data_len) {
+	    if (ctlr->trnbuf[j].data_len) {
 		unsigned k;
 
 #if defined(DEBUG_FF) /*[*/
-		n_trn += trnbuf[j].data_len;
+		n_trn += ctlr->trnbuf[j].data_len;
 #endif /*]*/
-		for (k = 0; k < trnbuf[j].data_len; k++) {
-		    if (stash(trnbuf[j].buf[k]) < 0) {
+		for (k = 0; k < ctlr->trnbuf[j].data_len; k++) {
+		    if (stash(ctlr->trnbuf[j].buf[k]) < 0) {
 			return -1;
 		    }
 		}
-		trnbuf[j].data_len = 0;
+		ctlr->trnbuf[j].data_len = 0;
 	    }
-	    if (j < i || linebuf[j] != ' ') {
+	    if (j < i || ctlr->linebuf[j] != ' ') {
 		char mb[16];
 		int len;
 
-		if (linebuf[j] == FCORDER_NOP) {
+		if (ctlr->linebuf[j] == FCORDER_NOP) {
 		    continue;
 		}
 #if defined(DEBUG_FF) /*[*/
 		n_data++;
 #endif /*]*/
 		any_data = true;
-		scs_any = true;
+		ctlr->scs_any = true;
 #if !defined(_WIN32) /*[*/
-		len = unicode_to_multibyte(linebuf[j], mb, sizeof(mb));
+		len = unicode_to_multibyte(ctlr->linebuf[j], mb, sizeof(mb));
 #else /*][*/
-		len = unicode_to_printer(linebuf[j], mb, sizeof(mb));
+		len = unicode_to_printer(ctlr->linebuf[j], mb, sizeof(mb));
 #endif /*]*/
 		if (len == 0) {
 		    mb[0] = ' ';
@@ -700,7 +762,7 @@ dump_scs_line(bool reset_pp, bool always_nl)
 	trace_ds(" [dumping %d+%dt]", n_data, n_trn);
 #endif /*]*/
 	for (k = 0; k < MAX_MPP+1; k++) {
-	    linebuf[k] = ' ';
+	    ctlr->linebuf[k] = ' ';
 	}
     }
     if (any_data || always_nl) {
@@ -711,15 +773,15 @@ dump_scs_line(bool reset_pp, bool always_nl)
 	}
 	if (stash('\n') < 0)
 	return -1;
-	line++;
+	ctlr->line++;
     }
 #if defined(DEBUG_FF) /*[*/
-    trace_ds(" [line=%d]", line);
+    trace_ds(" [line=%d]", ctlr->line);
 #endif /*]*/
     if (reset_pp) {
-	pp = lm;
+	ctlr->pp = ctlr->lm;
     }
-    any_scs_output = false;
+    ctlr->any_scs_output = false;
     return 0;
 }
 
@@ -735,7 +797,7 @@ scs_formfeed(bool explicit)
      * In ffskip mode, if it's an explicit formfeed, and we haven't
      * printed any non-transparent data, do nothing.
      */
-    if (options.ffskip && explicit && !scs_any) {
+    if (options.ffskip && explicit && !ctlr->scs_any) {
 	return 0;
     }
 
@@ -747,19 +809,19 @@ scs_formfeed(bool explicit)
 	    if (stash('\f') < 0) {
 		return -1;
 	    }
-	    scs_any = 0;
+	    ctlr->scs_any = 0;
 	}
-	line = 1;
+	ctlr->line = 1;
 	return 0;
     }
 
     if (explicit) {
-	scs_any = 0;
+	ctlr->scs_any = 0;
     }
 
-    if (mpl > 1) {
+    if (ctlr->mpl > 1) {
 	/* Skip to the end of the physical page. */
-	while (line <= mpl) {
+	while (ctlr->line <= ctlr->mpl) {
 	    if (options.crlf) {
 		if (stash('\r') < 0) {
 		    return -1;
@@ -771,12 +833,12 @@ scs_formfeed(bool explicit)
 #if defined(DEBUG_FF) /*[*/
 	    nls++;
 #endif /*]*/
-	    line++;
+	    ctlr->line++;
 	}
-	line = 1;
+	ctlr->line = 1;
 
 	/* Skip the top margin. */
-	while (line < tm) {
+	while (ctlr->line < ctlr->tm) {
 	    if (options.crlf) {
 		if (stash('\r') < 0) {
 		    return -1;
@@ -788,7 +850,7 @@ scs_formfeed(bool explicit)
 #if defined(DEBUG_FF) /*[*/
 	    nls++;
 #endif /*]*/
-	    line++;
+	    ctlr->line++;
 	}
 #if defined(DEBUG_FF) /*[*/
 	if (nls) {
@@ -797,7 +859,7 @@ scs_formfeed(bool explicit)
 	}
 #endif /*]*/
     } else {
-	line = 1;
+	ctlr->line = 1;
     }
     return 0;
 }
@@ -816,7 +878,7 @@ add_scs(ucs4_t c)
      * If the line is past the bottom margin, we need to skip to the
      * MPL, and then past the top margin.
      */
-    if (line > bm) {
+    if (ctlr->line > ctlr->bm) {
 	if (scs_formfeed(false) < 0) {
 	    return -1;
 	}
@@ -826,7 +888,7 @@ add_scs(ucs4_t c)
      * If this character would overflow the line, then dump the current
      * line and start over at the left margin.
      */
-    if (pp > mpp) {
+    if (ctlr->pp > ctlr->mpp) {
 	if (dump_scs_line(true, true) < 0) {
 	    return -1;
 	}
@@ -837,12 +899,12 @@ add_scs(ucs4_t c)
      * position.
      */
     if (c != ' ') {
-	linebuf[pp++] = c;
+	ctlr->linebuf[ctlr->pp++] = c;
     } else {
-	pp++;
+	ctlr->pp++;
     }
-    any_scs_output = true;
-    ffeoj_last = false;
+    ctlr->any_scs_output = true;
+    ctlr->ffeoj_last = false;
     return 0;
 }
 
@@ -860,15 +922,17 @@ add_scs_trn(unsigned char *cp, int cnt)
 	trace_ds(" %02x", cp[i]);
     }
 
-    new_malloc_len = trnbuf[pp].data_len + cnt;
-    while (trnbuf[pp].malloc_len < new_malloc_len) {
-	trnbuf[pp].malloc_len += BUFSZ;
-	trnbuf[pp].buf = Realloc(trnbuf[pp].buf, trnbuf[pp].malloc_len);
+    new_malloc_len = ctlr->trnbuf[ctlr->pp].data_len + cnt;
+    while (ctlr->trnbuf[ctlr->pp].malloc_len < new_malloc_len) {
+	ctlr->trnbuf[ctlr->pp].malloc_len += BUFSZ;
+	ctlr->trnbuf[ctlr->pp].buf = Realloc(ctlr->trnbuf[ctlr->pp].buf,
+		ctlr->trnbuf[ctlr->pp].malloc_len);
     }
-    memcpy(trnbuf[pp].buf + trnbuf[pp].data_len, cp, cnt);
-    trnbuf[pp].data_len += cnt;
-    any_scs_output = true;
-    ffeoj_last = true;
+    memcpy(ctlr->trnbuf[ctlr->pp].buf + ctlr->trnbuf[ctlr->pp].data_len, cp,
+	    cnt);
+    ctlr->trnbuf[ctlr->pp].data_len += cnt;
+    ctlr->any_scs_output = true;
+    ctlr->ffeoj_last = true;
 }
 
 /*
@@ -908,8 +972,8 @@ process_scs_contig(unsigned char *buf, size_t buflen)
     }
 #   define LEFTOVER { \
 	    trace_ds(" [pending]"); \
-	    scs_leftover_len = buflen - (cp - buf); \
-	    memcpy(scs_leftover_buf, cp, scs_leftover_len); \
+	    ctlr->scs_leftover_len = buflen - (cp - buf); \
+	    memcpy(ctlr->scs_leftover_buf, cp, ctlr->scs_leftover_len); \
 	    cp = buf + buflen; \
     }
 
@@ -921,16 +985,16 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 	switch (*cp) {
 	case SCS_BS:	/* back space */
 	    END_TEXT("BS");
-	    if (pp != 1) {
-		pp--;
+	    if (ctlr->pp != 1) {
+		ctlr->pp--;
 	    }
-	    if (scs_dbcs_subfield && pp != 1) {
-		pp--;
+	    if (ctlr->scs_dbcs_subfield && ctlr->pp != 1) {
+		ctlr->pp--;
 	    }
 	    break;
 	case SCS_CR:	/* carriage return */
 	    END_TEXT("CR");
-	    pp = lm;
+	    ctlr->pp = ctlr->lm;
 	    break;
 	case SCS_ENP:	/* enable presentation */
 	    END_TEXT("ENP");
@@ -952,13 +1016,13 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 	    break;
 	case SCS_HT:	/* horizontal tab */
 	    END_TEXT("HT");
-	    for (i = pp + 1; i <= mpp; i++) {
-		if (htabs[i]) {
+	    for (i = ctlr->pp + 1; i <= ctlr->mpp; i++) {
+		if (ctlr->htabs[i]) {
 		    break;
 		}
 	    }
-	    if (i <= mpp) {
-		pp = i;
+	    if (i <= ctlr->mpp) {
+		ctlr->pp = i;
 	    } else {
 		if (add_scs(' ') < 0) {
 		    return PDS_FAILED;
@@ -981,8 +1045,8 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 	    break;
 	case SCS_VT:	/* vertical tab */
 	    END_TEXT("VT");
-	    for (i = line + 1; i <= MAX_MPL; i++){
-		if (vtabs[i]) {
+	    for (i = ctlr->line + 1; i <= MAX_MPL; i++){
+		if (ctlr->vtabs[i]) {
 		    break;
 		}
 	    }
@@ -990,7 +1054,7 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 		if (dump_scs_line(false, true) < 0) {
 		    return PDS_FAILED;
 		}
-		while (line < i) {
+		while (ctlr->line < i) {
 		    if (options.crlf) {
 			if (stash('\r') < 0) {
 			    return PDS_FAILED;
@@ -999,7 +1063,7 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 		    if (stash('\n') < 0) {
 			return PDS_FAILED;
 		    }
-		    line++;
+		    ctlr->line++;
 		}
 		break;
 	    } else {
@@ -1039,21 +1103,21 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 	    switch (*(cp + 1)) {
 	    case SCS_SA_RESET:
 		trace_ds(" Reset(%02x)", *(cp + 2));
-		scs_dbcs_subfield = 0;
-		scs_cs = 0;
+		ctlr->scs_dbcs_subfield = 0;
+		ctlr->scs_cs = 0;
 		break;
 	    case SCS_SA_HIGHLIGHT:
 		trace_ds(" Highlight(%02x)", *(cp + 2));
 		break;
 	    case SCS_SA_CS:
 		trace_ds(" CharacterSet(%02x)", *(cp + 2));
-		if (scs_cs != *(cp + 2)) {
-		    if (scs_cs == 0xf8) {
-			scs_dbcs_subfield = 0;
+		if (ctlr->scs_cs != *(cp + 2)) {
+		    if (ctlr->scs_cs == 0xf8) {
+			ctlr->scs_dbcs_subfield = 0;
 		    } else if (*(cp + 2) == 0xf8) {
-			scs_dbcs_subfield = 1;
+			ctlr->scs_dbcs_subfield = 1;
 		    }
-		    scs_cs = *(cp + 2);
+		    ctlr->scs_cs = *(cp + 2);
 		}
 		break;
 	    case SCS_SA_GRID:
@@ -1089,7 +1153,7 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 	    /* Copy out the data literally. */
 	    add_scs_trn(cp+1, cnt);
 	    cp += cnt;
-	    scs_dbcs_subfield = 0;
+	    ctlr->scs_dbcs_subfield = 0;
 	    break;
 	case SCS_SET:	/* set... */
 	    /* Skip over the first byte of the order. */
@@ -1118,20 +1182,20 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 		    break;
 		}
 		/* The MPP is next. */
-		mpp = *++cp;
-		trace_ds(" mpp=%d", mpp);
-		if (!mpp || mpp > MAX_MPP) {
-		    mpp = MAX_MPP;
+		ctlr->mpp = *++cp;
+		trace_ds(" mpp=%d", ctlr->mpp);
+		if (!ctlr->mpp || ctlr->mpp > MAX_MPP) {
+		    ctlr->mpp = MAX_MPP;
 		}
 		/* Skip over the MPP. */
 		if (!--cnt || cp + 1 >= buf + buflen) {
 		    break;
 		}
 		/* The LM is next. */
-		lm = *++cp;
-		trace_ds(" lm=%d", lm);
-		if (lm < 1 || lm >= mpp) {
-		    lm = 1;
+		ctlr->lm = *++cp;
+		trace_ds(" lm=%d", ctlr->lm);
+		if (ctlr->lm < 1 || ctlr->lm >= ctlr->mpp) {
+		    ctlr->lm = 1;
 		}
 		/* Skip over the LM. */
 		if (!--cnt || cp + 1 >= buf + buflen) {
@@ -1144,8 +1208,8 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 		while (--cnt && cp + 1 < buf + buflen) {
 		    tab = *++cp;
 		    trace_ds(" tab=%d", tab);
-		    if (tab >= 1 && tab <= mpp) {
-			htabs[tab] = 1;
+		    if (tab >= 1 && tab <= ctlr->mpp) {
+			ctlr->htabs[tab] = 1;
 		    }
 		}
 		break;
@@ -1200,13 +1264,13 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 		    break;
 		}
 		/* The MPL is next. */
-		mpl = *cp;
-		trace_ds(" mpl=%d", mpl);
-		if (!mpl || mpl > MAX_MPL) {
-		    mpl = 1;
+		ctlr->mpl = *cp;
+		trace_ds(" mpl=%d", ctlr->mpl);
+		if (!ctlr->mpl || ctlr->mpl > MAX_MPL) {
+		    ctlr->mpl = 1;
 		}
 		if (cnt < 2) {
-		    bm = mpl;
+		    ctlr->bm = ctlr->mpl;
 		    break;
 		}
 		/* Skip over the MPL. */
@@ -1216,10 +1280,10 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 		    break;
 		}
 		/* The TM is next. */
-		tm = *cp;
-		trace_ds(" tm=%d", tm);
-		if (tm < 1 || tm >= mpl) {
-		    tm = 1;
+		ctlr->tm = *cp;
+		trace_ds(" tm=%d", ctlr->tm);
+		if (ctlr->tm < 1 || ctlr->tm >= ctlr->mpl) {
+		    ctlr->tm = 1;
 		}
 		if (cnt < 2) {
 		    break;
@@ -1231,10 +1295,10 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 		    break;
 		}
 		/* The BM is next. */
-		bm = *cp;
-		trace_ds(" bm=%d", bm);
-		if (bm < tm || bm >= mpl) {
-		    bm = mpl;
+		ctlr->bm = *cp;
+		trace_ds(" bm=%d", ctlr->bm);
+		if (ctlr->bm < ctlr->tm || ctlr->bm >= ctlr->mpl) {
+		    ctlr->bm = ctlr->mpl;
 		}
 		if (cnt < 2) {
 		    break;
@@ -1246,8 +1310,8 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 		while (cnt > 1 && cp < buf + buflen) {
 		    tab = *cp;
 		    trace_ds(" tab=%d", tab);
-		    if (tab >= 1 && tab <= mpp) {
-			vtabs[tab] = 1;
+		    if (tab >= 1 && tab <= ctlr->mpp) {
+			ctlr->vtabs[tab] = 1;
 		    }
 		    cp++;
 		    cnt--;
@@ -1262,11 +1326,11 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 	    break;
 	case SCS_SO:	/* DBCS subfield start */
 	    END_TEXT("SO");
-	    scs_dbcs_subfield = 1;
+	    ctlr->scs_dbcs_subfield = 1;
 	    break;
 	case SCS_SI:	/* DBCS subfield end */
 	    END_TEXT("SI");
-	    scs_dbcs_subfield = 0;
+	    ctlr->scs_dbcs_subfield = 0;
 	    break;
 	default:
 	    /*
@@ -1287,15 +1351,15 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 	    } else if (last == ORDER) {
 		trace_ds(" '");
 	    }
-	    if (scs_dbcs_subfield && dbcs) {
-		if (scs_dbcs_subfield % 2) {
-		    scs_dbcs_c1 = *cp;
+	    if (ctlr->scs_dbcs_subfield && dbcs) {
+		if (ctlr->scs_dbcs_subfield % 2) {
+		    ctlr->scs_dbcs_c1 = *cp;
 		} else {
-		    uc = ebcdic_to_unicode( (scs_dbcs_c1 << 8) | *cp, CS_BASE,
+		    uc = ebcdic_to_unicode( (ctlr->scs_dbcs_c1 << 8) | *cp, CS_BASE,
 			    EUO_NONE);
 		    if (uc == 0) {
 			/* No translation. */
-			trace_ds("?DBCS(X'%02x%02x')", scs_dbcs_c1, *cp);
+			trace_ds("?DBCS(X'%02x%02x')", ctlr->scs_dbcs_c1, *cp);
 			if (add_scs(' ') < 0) {
 			    return PDS_FAILED;
 			}
@@ -1308,7 +1372,7 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 			 * and a no-op to account for
 			 * the right-hand side.
 			 */
-			trace_ds("DBCS(X'%02x%02x')", scs_dbcs_c1, *cp);
+			trace_ds("DBCS(X'%02x%02x')", ctlr->scs_dbcs_c1, *cp);
 			if (add_scs(uc) < 0) {
 			    return PDS_FAILED;
 			}
@@ -1317,7 +1381,7 @@ process_scs_contig(unsigned char *buf, size_t buflen)
 			}
 		    }
 		}
-		scs_dbcs_subfield++;
+		ctlr->scs_dbcs_subfield++;
 		last = DATA;
 		break;
 	    }
@@ -1355,14 +1419,14 @@ process_scs(unsigned char *buf, size_t buflen)
 {
     enum pds r;
 
-    if (scs_leftover_len) {
-	unsigned char *contig = Malloc(scs_leftover_len + buflen);
+    if (ctlr->scs_leftover_len) {
+	unsigned char *contig = Malloc(ctlr->scs_leftover_len + buflen);
 	size_t total_len;
 
-	memcpy(contig, scs_leftover_buf, scs_leftover_len);
-	memcpy(contig + scs_leftover_len, buf, buflen);
-	total_len = scs_leftover_len + buflen;
-	scs_leftover_len = 0;
+	memcpy(contig, ctlr->scs_leftover_buf, ctlr->scs_leftover_len);
+	memcpy(contig + ctlr->scs_leftover_len, buf, buflen);
+	total_len = ctlr->scs_leftover_len + buflen;
+	ctlr->scs_leftover_len = 0;
 	r = process_scs_contig(contig, total_len);
 	Free(contig);
     } else {
@@ -1373,81 +1437,373 @@ process_scs(unsigned char *buf, size_t buflen)
 
 #if !defined(_WIN32) /*[*/
 /*
- * SIGCHLD handler.  Does nothing, but on systems that conform to the Single
- * Unix Specification, defining it ensures that the print command process will
- * become a zombie if it exits prematurely.
+ * SIGCHLD handler.  On systems that conform to the Single Unix Specification,
+ * defining it ensures that the print command process will become a zombie if
+ * it exits prematurely.  It also tells spool_reap() that a spool command may
+ * have finished.
  */
 static void
 sigchld_handler(int sig)
 {
+    spool_sigchld = 1;
+}
+
+/* Set up signals in a print or spool command process. */
+static void
+child_signals(void)
+{
+    sigset_t sigs;
+
+    /* -lufile keeps signals blocked while it works; don't pass that on. */
+    sigemptyset(&sigs);
+    sigprocmask(SIG_SETMASK, &sigs, NULL);
+    signal(SIGINT, SIG_IGN);
 }
 
 /*
  * Special version of popen where the child ignores SIGINT.
+ * Returns the write end of the pipe, or -1 for failure.
  */
-static FILE *
+static int
 popen_no_sigint(const char *command)
 {
     int fds[2];
-    FILE *f;
 
     /* Create a pipe. */
     if (pipe(fds) < 0) {
-	return NULL;
+	return -1;
     }
 
-    /* Create a stdio stream from the write end. */
-    f = fdopen(fds[1], "w");
-    if (f == NULL) {
-	close(fds[0]);
-	close(fds[1]);
-	return NULL;
-    }
+    /*
+     * Keep other sessions' print commands from holding the pipe open, so
+     * this one sees EOF when the job ends.
+     */
+    fcntl(fds[1], F_SETFD, FD_CLOEXEC);
 
     /* Handle SIGCHLD signals. */
     signal(SIGCHLD, sigchld_handler);
 
     /* Fork a child process. */
-    switch ((prpid = fork())) {
+    switch ((ctlr->prpid = fork())) {
     case 0:		/* child */
-	fclose(f);
 	dup2(fds[0], 0);
+	close(fds[0]);
 	close(fds[1]);
-	signal(SIGINT, SIG_IGN);
+	child_signals();
 	execl("/bin/sh", "sh", "-c", command, NULL);
 
 	/* execl failed, return nonzero status */
 	exit(1);
 	break;
     case -1:	/* parent, error */
-	fclose(f);
 	close(fds[0]);
-	return NULL;
+	close(fds[1]);
+	return -1;
     default:	/* parent, success */
 	close(fds[0]);
 	break;
     }
 
-    return f;
+    return fds[1];
 }
 
 static int
-pclose_no_sigint(FILE *f)
+pclose_no_sigint(int fd)
 {
     int rc;
     int status;
 
-    fclose(f);
+    close(fd);
     do {
-	rc = waitpid(prpid, &status, 0);
+	rc = waitpid(ctlr->prpid, &status, 0);
     } while (rc < 0 && errno == EINTR);
-    prpid = -1;
+    ctlr->prpid = -1;
     if (rc < 0) {
 	return rc;
     } else {
 	return status;
     }
 }
+
+/* Report a print command that failed. */
+static void
+report_status(const char *command, int status)
+{
+    if (WIFEXITED(status)) {
+	errmsg("'%s' exited with status %d", command, WEXITSTATUS(status));
+    } else if (WIFSIGNALED(status)) {
+	errmsg("'%s' terminated by signal %d", command, WTERMSIG(status));
+    } else {
+	errmsg("'%s' returned status %d", command, status);
+    }
+}
+
+/* The print command for the current session. */
+static const char *
+print_command(void)
+{
+    return (ctlr->command != NULL)? ctlr->command: options.command;
+}
+
+/* The spool command for the current session, or NULL. */
+static const char *
+spool_command(void)
+{
+    return (ctlr->command != NULL)? ctlr->command: options.spoolcommand;
+}
+
+/*
+ * Collect spool commands that have finished, and report the ones that failed.
+ * If 'wait' is true, waits for all of them; otherwise does nothing unless
+ * SIGCHLD has arrived since the last call.
+ *
+ * Each command is waited for by its process ID, so the print commands of
+ * other sessions in this process are left for pclose_no_sigint().
+ */
+void
+spool_reap(bool wait)
+{
+    spool_child_t **prev = &spool_children;
+    spool_child_t *c;
+
+    if (!wait && !spool_sigchld) {
+	return;
+    }
+    spool_sigchld = 0;
+    while ((c = *prev) != NULL) {
+	int status;
+	pid_t pid = waitpid(c->pid, &status, wait? 0: WNOHANG);
+
+	if (pid == 0) {
+	    prev = &c->next;
+	    continue;
+	}
+	if (pid < 0 && errno == EINTR) {
+	    continue;
+	}
+	if (pid > 0 && status) {
+	    report_status(c->command, status);
+	}
+	*prev = c->next;
+	Free(c->command);
+	Free(c);
+    }
+}
+
+/*
+ * Hand a finished spool file to the spool command, without waiting for it.
+ * The command reads the file on its standard input, and gets its name as $1.
+ */
+static int
+spool_handoff(const char *path)
+{
+    const char *command = spool_command();
+    int fd;
+    pid_t pid;
+    spool_child_t *c;
+
+    signal(SIGCHLD, sigchld_handler);
+    switch ((pid = fork())) {
+    case 0:		/* child */
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+	    exit(1);
+	}
+	dup2(fd, 0);
+	close(fd);
+	child_signals();
+	execl("/bin/sh", "sh", "-c", command, "sh", path, NULL);
+
+	/* execl failed, return nonzero status */
+	exit(1);
+	break;
+    case -1:	/* parent, error */
+	errmsg("%s: fork: %s", command, strerror(errno));
+	return -1;
+    default:	/* parent, success */
+	c = (spool_child_t *)Malloc(sizeof(spool_child_t));
+	c->pid = pid;
+	c->command = NewString(command);
+	c->next = spool_children;
+	spool_children = c;
+	break;
+    }
+    return 0;
+}
+
+/* Describe where print output is going, for error messages. */
+static const char *
+prdest(void)
+{
+    return (ctlr->spool_tmpname != NULL)? ctlr->spool_tmpname:
+	print_command();
+}
+
+/* Abandon the current print job after an error. */
+static void
+prjob_abort(void)
+{
+    ctlr->prbuf_len = 0;
+    if (ctlr->prfd < 0) {
+	return;
+    }
+    if (ctlr->spool_tmpname != NULL) {
+	close(ctlr->prfd);
+	unlink(ctlr->spool_tmpname);
+	Replace(ctlr->spool_tmpname, NULL);
+    } else {
+	pclose_no_sigint(ctlr->prfd);
+    }
+    ctlr->prfd = -1;
+}
+
+/* Write out buffered print output. */
+static int
+prbuf_write(void)
+{
+    size_t off = 0;
+
+    while (off < ctlr->prbuf_len) {
+	ssize_t nw = write(ctlr->prfd, ctlr->prbuf + off, ctlr->prbuf_len - off);
+
+	if (nw < 0) {
+	    if (errno == EINTR) {
+		continue;
+	    }
+	    errmsg("Write error to '%s': %s", prdest(), strerror(errno));
+	    prjob_abort();
+	    return -1;
+	}
+	off += nw;
+    }
+    ctlr->prbuf_len = 0;
+    return 0;
+}
+
+/* Add a byte to the print output buffer. */
+static int
+prbuf_add(unsigned char c)
+{
+    if (ctlr->prbuf_len >= PRBUF_SIZE && prbuf_write() < 0) {
+	return -1;
+    }
+    ctlr->prbuf[ctlr->prbuf_len++] = c;
+    return 0;
+}
+
+/*
+ * Start a print job, by running the print command or creating a spool file.
+ */
+static int
+prjob_start(void)
+{
+    if (options.spooldir != NULL) {
+	spool_reap(false);
+	ctlr->spool_time = time(NULL);
+	ctlr->spool_tmpname = ctlr->spool_id?
+	    Asprintf("%s/.print-%d.%d.tmp", options.spooldir, (int)getpid(),
+		ctlr->spool_id):
+	    Asprintf("%s/.print-%d.tmp", options.spooldir, (int)getpid());
+	ctlr->prfd = open(ctlr->spool_tmpname, O_WRONLY | O_CREAT | O_TRUNC,
+		0666);
+	if (ctlr->prfd < 0) {
+	    errmsg("%s: %s", ctlr->spool_tmpname, strerror(errno));
+	    Replace(ctlr->spool_tmpname, NULL);
+	    return -1;
+	}
+    } else {
+	ctlr->prfd = popen_no_sigint(print_command());
+	if (ctlr->prfd < 0) {
+	    errmsg("%s: %s", print_command(), strerror(errno));
+	    return -1;
+	}
+    }
+
+    if ((options.trnpre != NULL) && copyfile(options.trnpre) < 0) {
+	prjob_abort();
+	return -1;
+    }
+    return 0;
+}
+
+/*
+ * Give a finished spool file its permanent name, unique within the spool
+ * directory, and pass it to the spool command.
+ */
+static int
+spool_finish(void)
+{
+    struct tm *tm = localtime(&ctlr->spool_time);
+    char *path;
+    int iter;
+    int rc = 0;
+
+    if (close(ctlr->prfd) < 0) {
+	errmsg("Close error on '%s': %s", ctlr->spool_tmpname, strerror(errno));
+	ctlr->prfd = -1;
+	unlink(ctlr->spool_tmpname);
+	Replace(ctlr->spool_tmpname, NULL);
+	return -1;
+    }
+    ctlr->prfd = -1;
+
+    /* Same naming scheme as prtodir; link() fails if the name is taken. */
+    for (iter = 0; ; iter++) {
+	path = Asprintf(iter? "%s/print-%04d%02d%02d-%02d%02d%02d.%d":
+			      "%s/print-%04d%02d%02d-%02d%02d%02d",
+		options.spooldir,
+		tm->tm_year + 1900, tm->tm_mon + 1, tm->tm_mday,
+		tm->tm_hour, tm->tm_min, tm->tm_sec,
+		iter);
+	if (link(ctlr->spool_tmpname, path) == 0) {
+	    break;
+	}
+	if (errno != EEXIST) {
+	    errmsg("link(%s, %s): %s", ctlr->spool_tmpname, path, strerror(errno));
+	    Free(path);
+	    unlink(ctlr->spool_tmpname);
+	    Replace(ctlr->spool_tmpname, NULL);
+	    return -1;
+	}
+	Free(path);
+    }
+    unlink(ctlr->spool_tmpname);
+    Replace(ctlr->spool_tmpname, NULL);
+    trace_ds("Spooled to %s.\n", path);
+
+    if (spool_command() != NULL && spool_handoff(path) < 0) {
+	rc = -1;
+    }
+    Free(path);
+    return rc;
+}
+
+/* Finish a print job. */
+static int
+prjob_end(void)
+{
+    int rc;
+
+    if (prbuf_write() < 0) {
+	return -1;
+    }
+    if (ctlr->spool_tmpname != NULL) {
+	return spool_finish();
+    }
+
+    rc = pclose_no_sigint(ctlr->prfd);
+    ctlr->prfd = -1;
+    if (rc) {
+	if (rc < 0) {
+	    errmsg("Close error on '%s': %s", print_command(),
+		    strerror(errno));
+	} else {
+	    report_status(print_command(), rc);
+	}
+	rc = -1;
+    }
+    return rc;
+}
 #endif /*]*/
 
 /*
@@ -1457,17 +1813,17 @@ static int
 stash(unsigned char c)
 {
 #if defined(_WIN32) /*[*/
-    if (!ws_initted) {
+    if (!ctlr->ws_initted) {
 	if (ws_start(options.printer) < 0) {
 	    return -1;
 	}
-	ws_initted = 1;
+	ctlr->ws_initted = 1;
     }
-    if (ws_needpre) {
+    if (ctlr->ws_needpre) {
 	if ((options.trnpre != NULL) && copyfile(options.trnpre) < 0) {
 	    return -1;
 	}
-	ws_needpre = 0;
+	ctlr->ws_needpre = 0;
     }
 
     trace_pdc(c);
@@ -1475,24 +1831,12 @@ stash(unsigned char c)
 	return -1;
     }
 #else /*][*/
-    if (prfile == NULL) {
-	prfile = popen_no_sigint(options.command);
-	if (prfile == NULL) {
-	    errmsg("%s: %s", options.command, strerror(errno));
-	    return -1;
-	}
-	if ((options.trnpre != NULL) && copyfile(options.trnpre) < 0) {
-	    pclose_no_sigint(prfile);
-	    prfile = NULL;
-	    return -1;
-	}
+    if (ctlr->prfd < 0 && prjob_start() < 0) {
+	return -1;
     }
 
     trace_pdc(c);
-    if (fputc(c, prfile) == EOF) {
-	errmsg("Write error to '%s': %s", options.command, strerror(errno));
-	pclose_no_sigint(prfile);
-	prfile = NULL;
+    if (prbuf_add(c) < 0) {
 	return -1;
     }
 #endif /*]*/
@@ -1501,24 +1845,19 @@ stash(unsigned char c)
 }
 
 /*
- * Flush the pipe going to the printer process, to try to flush out any
- * pending errors.
+ * Flush buffered output to the printer process or spool file, to try to
+ * flush out any pending errors.
  */
 static int
 prflush(void)
 {
 #if defined(_WIN32) /*[*/
-    if (ws_initted && ws_flush() < 0) {
+    if (ctlr->ws_initted && ws_flush() < 0) {
 	return -1;
     }
 #else /*][*/
-    if (prfile != NULL) {
-	if (fflush(prfile) < 0) {
-	    errmsg("Flush error to '%s': %s", options.command, strerror(errno));
-	    pclose_no_sigint(prfile);
-	    prfile = NULL;
-	    return -1;
-	}
+    if (ctlr->prfd >= 0 && prbuf_write() < 0) {
+	return -1;
     }
 #endif /*]*/
     return 0;
@@ -1532,7 +1871,7 @@ ctlr_add(unsigned char ebc, ucs4_t c, unsigned char cs, unsigned char gr)
 {
     /* Map control characters, according to the write mode. */
     if (c < ' ') {
-	if (wcc_line_length) {
+	if (ctlr->wcc_line_length) {
 	    /*
 	     * When formatted, all control characters but FFs and
 	     * the funky VISIBLE/INVISIBLE controls are translated
@@ -1555,31 +1894,23 @@ ctlr_add(unsigned char ebc, ucs4_t c, unsigned char cs, unsigned char gr)
     }
 
     /* Add the character. */
-    page_buf[baddr] = c;
+    ctlr->page_buf[ctlr->baddr] = c;
     if (ebc >= 0x40)
-	    xlate_len[baddr] = xtable_lookup(ebc, &xlate_buf[baddr]);
-    baddr = (baddr + 1) % MAX_BUF;
-    any_3270_output = 1;
-    ffeoj_last = false;
+	    ctlr->xlate_len[ctlr->baddr] = xtable_lookup(ebc,
+		    &ctlr->xlate_buf[ctlr->baddr]);
+    ctlr->baddr = (ctlr->baddr + 1) % MAX_BUF;
+    ctlr->any_3270_output = 1;
+    ctlr->ffeoj_last = false;
 
     /* Implement -emflush mode. */
-    if (options.emflush && !wcc_line_length && c == FCORDER_EM) {
+    if (options.emflush && !ctlr->wcc_line_length && c == FCORDER_EM) {
 	/* XXX: Unfortunately, we do not return error status here. */
 	dump_unformatted();
-	baddr = 1;
-	any_3270_output = 0;
+	ctlr->baddr = 1;
+	ctlr->any_3270_output = 0;
     }
 }
 
-static struct {
-    char buf;			/* printable data */
-    unsigned char *trn;		/* transparent data */
-    unsigned trn_len;		/* length of transparent data */
-} uo_data[MAX_UNF_MPP + 2];	/* room for full line plus carriage control */
-static unsigned uo_col;		/* current output column */
-static unsigned uo_maxcol;	/* maximum column buffered */
-static bool uo_last_cr = false; /* last data was CR */
-
 /*
  * Dump and free any transparent unformatted data at col.
  */
@@ -1589,16 +1920,16 @@ dump_uo_trn(unsigned col)
     unsigned i;
     int rv = 0;
 
-    if (uo_data[col].trn != NULL) {
-	for (i = 0; i < uo_data[col].trn_len; i++) {
-	    if (stash(uo_data[col].trn[i]) < 0) {
+    if (ctlr->uo_data[col].trn != NULL) {
+	for (i = 0; i < ctlr->uo_data[col].trn_len; i++) {
+	    if (stash(ctlr->uo_data[col].trn[i]) < 0) {
 		rv = -1;
 		break;
 	    }
 	}
-	Free(uo_data[col].trn);
-	uo_data[col].trn = NULL;
-	uo_data[col].trn_len = 0;
+	Free(ctlr->uo_data[col].trn);
+	ctlr->uo_data[col].trn = NULL;
+	ctlr->uo_data[col].trn_len = 0;
     }
     return rv;
 }
@@ -1611,19 +1942,19 @@ dump_uo(void)
 {
     unsigned i;
 
-    for (i = 0; i < uo_maxcol; i++) {
+    for (i = 0; i < ctlr->uo_maxcol; i++) {
 	if (dump_uo_trn(i) < 0) {
 	    return -1;
 	}
 	if (!i && options.skipcc) {
 	    continue;
 	}
-	if (stash(uo_data[i].buf) < 0) {
+	if (stash(ctlr->uo_data[i].buf) < 0) {
 	    return -1;
 	}
     }
-    if (uo_maxcol < MAX_UNF_MPP + 2) {
-	if (dump_uo_trn(uo_maxcol) < 0) {
+    if (ctlr->uo_maxcol < MAX_UNF_MPP + 2) {
+	if (dump_uo_trn(ctlr->uo_maxcol) < 0) {
 	    return -1;
 	}
     }
@@ -1654,17 +1985,17 @@ uoutput(char c)
 	    if (stash(c) < 0) {
 		return -1;
 	    }
-	    uo_col = uo_maxcol = 0;
-	    uo_last_cr = true;
+	    ctlr->uo_col = ctlr->uo_maxcol = 0;
+	    ctlr->uo_last_cr = true;
 	} else {
-	    uo_col = 0;
+	    ctlr->uo_col = 0;
 	}
 	break;
     case '\n':
 	if (dump_uo() < 0) {
 	    return -1;
 	}
-	if (options.crlf && !uo_last_cr) {
+	if (options.crlf && !ctlr->uo_last_cr) {
 	    if (stash('\r') < 0) {
 		return -1;
 	    }
@@ -1672,12 +2003,12 @@ uoutput(char c)
 	if (stash(c) < 0) {
 	    return -1;
 	}
-	uo_col = uo_maxcol = 0;
-	uo_last_cr = false;
+	ctlr->uo_col = ctlr->uo_maxcol = 0;
+	ctlr->uo_last_cr = false;
 	break;
     case '\f':
-	uo_last_cr = false;
-	if (any_3270_printable || !options.ffskip) {
+	ctlr->uo_last_cr = false;
+	if (ctlr->any_3270_printable || !options.ffskip) {
 	    if (dump_uo() < 0) {
 		return -1;
 	    }
@@ -1685,24 +2016,24 @@ uoutput(char c)
 		return -1;
 	    }
 	}
-	uo_col = uo_maxcol = 0;
+	ctlr->uo_col = ctlr->uo_maxcol = 0;
 	break;
     default:
-	uo_last_cr = false;
+	ctlr->uo_last_cr = false;
 
 	/* Don't overwrite with spaces. */
 	if (c == ' ') {
-	    if (uo_col >= uo_maxcol) {
-		uo_data[uo_col++].buf = c;
+	    if (ctlr->uo_col >= ctlr->uo_maxcol) {
+		ctlr->uo_data[ctlr->uo_col++].buf = c;
 	    } else {
-		uo_col++;
+		ctlr->uo_col++;
 	    }
 	} else {
-	    uo_data[uo_col++].buf = c;
-	    any_3270_printable = true;
+	    ctlr->uo_data[ctlr->uo_col++].buf = c;
+	    ctlr->any_3270_printable = true;
 	}
-	if (uo_col > uo_maxcol) {
-	    uo_maxcol = uo_col;
+	if (ctlr->uo_col > ctlr->uo_maxcol) {
+	    ctlr->uo_maxcol = ctlr->uo_col;
 	}
 	break;
     }
@@ -1720,13 +2051,15 @@ uoutput_trn(const unsigned char *s, int len)
     if (len <= 0) {
 	return;
     }
-    new = Realloc(uo_data[uo_col].trn, uo_data[uo_col].trn_len + len);
-    if (uo_data[uo_col].trn != NULL) {
-	memcpy(new, uo_data[uo_col].trn, uo_data[uo_col].trn_len);
+    new = Realloc(ctlr->uo_data[ctlr->uo_col].trn,
+	    ctlr->uo_data[ctlr->uo_col].trn_len + len);
+    if (ctlr->uo_data[ctlr->uo_col].trn != NULL) {
+	memcpy(new, ctlr->uo_data[ctlr->uo_col].trn,
+		ctlr->uo_data[ctlr->uo_col].trn_len);
     }
-    memcpy(new + uo_data[uo_col].trn_len, s, len);
-    uo_data[uo_col].trn = new;
-    uo_data[uo_col].trn_len += len;
+    memcpy(new + ctlr->uo_data[ctlr->uo_col].trn_len, s, len);
+    ctlr->uo_data[ctlr->uo_col].trn = new;
+    ctlr->uo_data[ctlr->uo_col].trn_len += len;
 }
 
 /*
@@ -1749,12 +2082,12 @@ dump_unformatted(void)
     int len;
     int j;
 
-    if (!any_3270_output) {
+    if (!ctlr->any_3270_output) {
 	return 0;
     }
 
     for (i = 0; i < MAX_BUF && !done; i++) {
-	switch (c = page_buf[i]) {
+	switch (c = ctlr->page_buf[i]) {
 	case '\0':
 	    break;
 	case FCORDER_NOP:
@@ -1801,8 +2134,8 @@ dump_unformatted(void)
 	    }
 
 	    /* Handle transparent data. */
-	    if (xlate_buf[i] != NULL) {
-		uoutput_trn(xlate_buf[i], xlate_len[i]);
+	    if (ctlr->xlate_buf[i] != NULL) {
+		uoutput_trn(ctlr->xlate_buf[i], ctlr->xlate_len[i]);
 		break;
 	    }
 
@@ -1836,32 +2169,32 @@ dump_unformatted(void)
     }
 
     /* Clear out the buffer. */
-    memset(page_buf, '\0', MAX_BUF * sizeof(ucs4_t));
-    memset(xlate_buf, '\0', MAX_BUF * sizeof(unsigned char *));
-    memset(xlate_len, '\0', MAX_BUF * sizeof(int));
+    memset(ctlr->page_buf, '\0', MAX_BUF * sizeof(ucs4_t));
+    memset(ctlr->xlate_buf, '\0', MAX_BUF * sizeof(unsigned char *));
+    memset(ctlr->xlate_len, '\0', MAX_BUF * sizeof(int));
 
     /* Clear the output state. */
     for (i = 0; i < MAX_UNF_MPP + 2; i++) {
-	uo_data[i].buf = 0;
-	if (uo_data[i].trn != NULL) {
-	    Free(uo_data[i].trn);
+	ctlr->uo_data[i].buf = 0;
+	if (ctlr->uo_data[i].trn != NULL) {
+	    Free(ctlr->uo_data[i].trn);
 	}
-	uo_data[i].trn = NULL;
-	uo_data[i].trn_len = 0;
+	ctlr->uo_data[i].trn = NULL;
+	ctlr->uo_data[i].trn_len = 0;
     }
-    uo_col = 0;
-    uo_maxcol = 0;
-    uo_last_cr = false;
+    ctlr->uo_col = 0;
+    ctlr->uo_maxcol = 0;
+    ctlr->uo_last_cr = false;
 
     /* Flush buffered data. */
 #if defined(_WIN32) /*[*/
-    if (ws_initted) {
+    if (ctlr->ws_initted) {
 	ws_flush();
     }
 #else /*][*/
-    fflush(prfile);
+    prflush();
 #endif /*]*/
-    any_3270_output = 0;
+    ctlr->any_3270_output = 0;
 
     return 0;
 }
@@ -1884,12 +2217,12 @@ static int
 dump_formatted(void)
 {
     int i;
-    ucs4_t *cp = page_buf;
+    ucs4_t *cp = ctlr->page_buf;
     int visible = 1;
     int newlines = 0;
     bool data_without_newline = false;
 
-    if (!any_3270_output) {
+    if (!ctlr->any_3270_output) {
 	return 0;
     }
     for (i = 0; i < MAX_UNF_MPP; i++) {
@@ -1897,7 +2230,9 @@ dump_formatted(void)
 	int any_data = 0;
 	int j;
 
-	for (j = 0; j < line_length && ((i * line_length) + j) < MAX_BUF; j++) {
+	for (j = 0;
+	     j < ctlr->line_length && ((i * ctlr->line_length) + j) < MAX_BUF;
+	     j++) {
 	    char c = *cp++;
 
 	    switch (c) {
@@ -1922,7 +2257,7 @@ dump_formatted(void)
 		    newlines--;
 		    data_without_newline = false;
 		}
-		if (any_3270_printable || !options.ffskip) {
+		if (ctlr->any_3270_printable || !options.ffskip) {
 		    if (stash('\f') < 0) {
 			return -1;
 		    }
@@ -1986,7 +2321,7 @@ dump_formatted(void)
 
 		}
 		if (visible) {
-		    any_3270_printable = true;
+		    ctlr->any_3270_printable = true;
 		}
 		break;
 	    }
@@ -2009,15 +2344,15 @@ dump_formatted(void)
     }
 
     /* Clear the buffer. */
-    memset(page_buf, '\0', MAX_BUF * sizeof(ucs4_t));
+    memset(ctlr->page_buf, '\0', MAX_BUF * sizeof(ucs4_t));
 #if defined(_WIN32) /*[*/
-    if (ws_initted) {
+    if (ctlr->ws_initted) {
 	    ws_flush();
     }
 #else /*][*/
-    fflush(prfile);
+    prflush();
 #endif /*]*/
-    any_3270_output = 0;
+    ctlr->any_3270_output = 0;
 
     return 0;
 }
@@ -2028,8 +2363,8 @@ print_eoj(void)
     int rc = 0;
 
     /* Dump any pending 3270-mode output. */
-    if (any_3270_output) {
-	if (wcc_line_length) {
+    if (ctlr->any_3270_output) {
+	if (ctlr->wcc_line_length) {
 	    if (dump_formatted() < 0) {
 		rc = -1;
 	    }
@@ -2041,15 +2376,15 @@ print_eoj(void)
     }
 
     /* Dump any pending SCS-mode output. */
-    if (any_scs_output) {
+    if (ctlr->any_scs_output) {
 	if (dump_scs_line(true, false) < 0) {
 	    rc = -1;
 	}
     }
 
     /* Handle -ffeoj, which blindly adds a formfeed to every page. */
-    if (options.ffeoj && !ffeoj_last) {
-	if (scs_any) {
+    if (options.ffeoj && !ctlr->ffeoj_last) {
+	if (ctlr->scs_any) {
 	    trace_ds("Automatic SCS EOJ formfeed.\n");
 	    scs_formfeed(true);
 	    if (dump_scs_line(true, false) < 0) {
@@ -2057,9 +2392,9 @@ print_eoj(void)
 	    }
 	} else {
 	    trace_ds("Automatic 3270 %s EOJ formfeed.\n",
-		    wcc_line_length? "formatted": "unformatted");
-	    ctlr_add(0, FCORDER_FF, default_cs, default_gr);
-	    if (wcc_line_length) {
+		    ctlr->wcc_line_length? "formatted": "unformatted");
+	    ctlr_add(0, FCORDER_FF, ctlr->default_cs, ctlr->default_gr);
+	    if (ctlr->wcc_line_length) {
 		if (dump_formatted() < 0) {
 		    rc = -1;
 		}
@@ -2069,12 +2404,12 @@ print_eoj(void)
 		}
 	    }
 	}
-	ffeoj_last = true;
+	ctlr->ffeoj_last = true;
     }
 
     /* Close the stream to the print process. */
 #if defined(_WIN32) /*[*/
-    if (ws_initted) {
+    if (ctlr->ws_initted) {
 	trace_ds("End of print job.\n");
 	if (options.trnpost != NULL && copyfile(options.trnpost) < 0) {
 	    rc = -1;
@@ -2082,39 +2417,25 @@ print_eoj(void)
 	if (ws_endjob() < 0) {
 	    rc = -1;
 	}
-	ws_needpre = 1;
+	ctlr->ws_needpre = 1;
     }
 #else /*]*/
-    if (prfile != NULL) {
+    if (ctlr->prfd >= 0) {
 	trace_ds("End of print job.\n");
 	if (options.trnpost != NULL && copyfile(options.trnpost) < 0) {
 	    rc = -1;
 	}
-	rc = pclose_no_sigint(prfile);
-	if (rc) {
-	    if (rc < 0) {
-		errmsg("Close error on '%s': %s", options.command,
-			strerror(errno));
-	    } else if (WIFEXITED(rc)) {
-		errmsg("'%s' exited with status %d", options.command,
-			WEXITSTATUS(rc));
-	    } else if (WIFSIGNALED(rc)) {
-		errmsg("'%s' terminated by signal %d", options.command,
-			WTERMSIG(rc));
-	    } else {
-		errmsg("'%s' returned status %d", options.command, rc);
-	    }
+	if (ctlr->prfd >= 0 && prjob_end() < 0) {
 	    rc = -1;
 	}
-	prfile = NULL;
     }
 #endif /*]*/
 
     /* Make sure the next 3270 job starts with clean conditions. */
-    page_buf_initted = 0;
+    ctlr->page_buf_initted = 0;
 
     /* Reset the FF suprpession logic. */
-    any_3270_printable = false;
+    ctlr->any_3270_printable = false;
 
     return rc;
 }
@@ -2125,7 +2446,7 @@ print_unbind(void)
     /*
      * Make sure that the next SCS job starts with clean conditions.
      */
-    scs_initted = false;
+    ctlr->scs_initted = false;
 }
 
 static int
@@ -2133,7 +2454,7 @@ ctlr_erase(void)
 {
     /* Dump whatever we've got so far. */
     /* Dump any pending 3270-mode output. */
-    if (wcc_line_length) {
+    if (ctlr->wcc_line_length) {
 	if (dump_formatted() < 0) {
 		return -1;
 	}
@@ -2144,16 +2465,16 @@ ctlr_erase(void)
     }
 
     /* Dump any pending SCS-mode output. */
-    if (any_scs_output) {
+    if (ctlr->any_scs_output) {
 	if (dump_scs_line(true, false) < 0) { /* XXX: 1st true? */
 	    return -1;
 	}
     }
 
     /* Make sure the buffer is clean. */
-    memset(page_buf, '\0', MAX_BUF * sizeof(ucs4_t));
-    any_3270_output = 0;
-    baddr = 0;
+    memset(ctlr->page_buf, '\0', MAX_BUF * sizeof(ucs4_t));
+    ctlr->any_3270_output = 0;
+    ctlr->baddr = 0;
     return 0;
 }
 
@@ -2178,8 +2499,7 @@ copyfile(const char *filename)
 #if defined(_WIN32) /*[*/
 	if (ws_putc(c) < 0) {
 #else /*][*/
-	if (fputc(c, prfile) < 0) {
-	    errmsg("write(%s): %s", options.command, strerror(errno));
+	if (prbuf_add((unsigned char)c) < 0) {
 #endif /*]*/
 	    rc = -1;
 	    break;
@@ -38,9 +38,16 @@ enum pds {
     PDS_FAILED = -3		/* command failed */
 };
 
+typedef struct ctlr_state ctlr_state_t;	/* per-session state */
+
+ctlr_state_t *ctlr_state_new(const char *command);
+void ctlr_state_select(ctlr_state_t *c);
 void ctlr_add(unsigned char ebc, ucs4_t c, unsigned char cs, unsigned char gr);
 void ctlr_write(unsigned char buf[], size_t buflen, bool erase);
 int print_eoj(void);
 void print_unbind(void);
 enum pds process_ds(unsigned char *buf, size_t buflen);
 enum pds process_scs(unsigned char *buf, size_t buflen);
+#if !defined(_WIN32) /*[*/
+void spool_reap(bool wait);
+#endif /*]*/
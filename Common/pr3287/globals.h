@@ -39,6 +39,7 @@
 #include <ctype.h>			/* Character classes */
 #include <string.h>			/* String manipulations */
 #include <sys/types.h>			/* Basic system data types */
+#include <stdint.h>			/* Integer types */
 #if !defined(_MSC_VER) /*[*/
 # include <sys/time.h>			/* System time-related data types */
 #endif /*]*/
@@ -73,6 +73,9 @@
  *          -keyfile file
  *          -keyfiletype type
  *          -keypasswd type:text
+ *	    -lufile file
+ *		run a session for each [lu@]host[:port] [command] line in file
+ *		(POSIX only)
  *          -mpp n
  *              set the maximum presentation position (unformatted line length)
  *          -nocrlf
@@ -92,6 +95,12 @@
  *	        allow self-signed host certificates
  *	    -skipcc
  *	    	skip ASA carriage control characters in host output
+ *	    -spooldir dir
+ *		write each job to a file in dir instead of running a command
+ *		(POSIX only)
+ *	    -spoolcommand "string"
+ *		command to run in the background for each spooled file
+ *		(POSIX only)
  *          -syncport port
  *              TCP port for login session synchronization
  *	    -trace
@@ -121,8 +130,10 @@
 #if !defined(_WIN32) /*[*/
 # include <syslog.h>
 # include <netdb.h>
+# include <sys/wait.h>
 #endif /*]*/
 #include <sys/types.h>
+#include <sys/stat.h>
 #if !defined(_MSC_VER) /*[*/
 # include <unistd.h>
 #endif /*]*/
@@ -152,6 +163,7 @@
 #include "sio.h"
 #include "split_host.h"
 #include "telnet_core.h"
+#include "txa.h"
 #include "unicodec.h"
 #include "utf8.h"
 #include "utils.h"
@@ -201,6 +213,11 @@ usage(const char *errmsg)
     fprintf(stderr,
 	    "Usage: %s [options] [lu[,lu...]@]host[:port]\n",
 	    programname);
+#if !defined(_WIN32) /*[*/
+    fprintf(stderr,
+	    "       %s [options] -lufile <file>\n",
+	    programname);
+#endif /*]*/
     fprintf(stderr, "Use " OptHelp1 " for the list of options\n");
     pr3287_exit(1);
 }
@@ -220,6 +237,11 @@ cmdline_help(void)
     fprintf(stderr,
 	    "Usage: %s [options] [lu[,lu...]@]host[:port]\n",
 	    programname);
+#if !defined(_WIN32) /*[*/
+    fprintf(stderr,
+	    "       %s [options] -lufile <file>\n",
+	    programname);
+#endif /*]*/
     fprintf(stderr, "Options:\n");
     fprintf(stderr,
 "  " OptPreferIpv4 "               prefer IPv4 host addresses\n"
@@ -298,6 +320,10 @@ cmdline_help(void)
     }
     fprintf(stderr,
 "  -ignoreeoj       ignore PRINT-EOJ commands\n"
+#if !defined(_WIN32) /*[*/
+"  -lufile <file>   run a session for each [lu@]host[:port] [command] line\n"
+"                   in <file>, instead of a single host\n"
+#endif /*]*/
 "  -mpp <n>         define the Maximum Presentation Position (unformatted\n"
 "                   line length)\n");
     if (tls_options & TLS_OPT_VERIFY_HOST_CERT) {
@@ -317,6 +343,12 @@ cmdline_help(void)
     fprintf(stderr,
 "  -skipcc          skip ASA carriage control characters in unformatted host\n"
 "                   output\n"
+#if !defined(_WIN32) /*[*/
+"  -spooldir <dir>  write each job to a file in <dir> instead of running a\n"
+"                   command\n"
+"  -spoolcommand \"<cmd>\"\n"
+"                   run <cmd> in the background for each spooled file\n"
+#endif /*]*/
 "  -syncport port   TCP port for login session synchronization\n"
 #if defined(_WIN32) /*[*/
 "  " OptTrace "           trace data stream to <wc3270appData>/x3trc.<pid>.txt\n"
@@ -455,6 +487,9 @@ fatal_signal(int sig)
     /* Flush any pending data and exit. */
     vtrace("Fatal signal %d\n", sig);
     print_eoj();
+#if !defined(_WIN32) /*[*/
+    spool_reap(true);
+#endif /*]*/
     errmsg("Exiting on signal %d", sig);
     exit(0);
 }
@@ -470,9 +505,604 @@ flush_signal(int sig)
 }
 #endif /*]*/
 
+#if !defined(_WIN32) /*[*/
+/* Fork into the background and break away from the TTY. */
+static void
+become_daemon(void)
+{
+    switch (fork()) {
+    case -1:
+	perror("fork");
+	exit(1);
+	break;
+    case 0:
+	/* Child: Break away from the TTY. */
+	if (setsid() < 0) {
+	    exit(1);
+	}
+	options.bdaemon = AM_DAEMON;
+	break;
+    default:
+	/* Parent: We're all done. */
+	exit(0);
+	break;
+    }
+}
+#endif /*]*/
+
+/*
+ * Pick apart a host specification: the hostname, LUs, port and prefixes.
+ * We allow "L:" and "<luname>@" in either order.
+ * Returns false for failure, with an error message in *error, or NULL if
+ * the specification uses a prefix that pr3287 does not support.
+ */
+static bool
+split_hostspec(char *spec, char **lu, char **host, char **port,
+	bool *tls_host, tls_config_t *tls, char **error)
+{
+    char *accept = NULL;
+    unsigned prefixes;
+
+    if (!new_split_host(spec, lu, host, port, &accept, &prefixes, error)) {
+	return false;
+    }
+    if (*port == NULL) {
+	*port = "23";
+    }
+
+    if (HOST_nFLAG(prefixes, TLS_HOST)) {
+	*tls_host = true;
+    }
+    if (HOST_nFLAG(prefixes, NO_VERIFY_CERT_HOST)) {
+	tls->verify_host_cert = false;
+    }
+    if (accept != NULL) {
+	tls->accept_hostname = accept;
+    }
+
+    if (HOST_nFLAG(prefixes, NO_LOGIN_HOST) ||
+	    HOST_nFLAG(prefixes, NON_TN3270E_HOST) ||
+	    HOST_nFLAG(prefixes, PASSTHRU_HOST) ||
+	    HOST_nFLAG(prefixes, STD_DS_HOST) ||
+	    HOST_nFLAG(prefixes, BIND_LOCK_HOST)) {
+	*error = NULL;
+	return false;
+    }
+    return true;
+}
+
+/*
+ * Connect to a host, directly or through the proxy.
+ * Returns the socket, or INVALID_SOCKET for failure. Returns the port
+ * connected to in *pp.
+ */
+static socket_t
+host_connect(const char *host, char *port, unsigned short *pp)
+{
+    typedef union {
+	struct sockaddr sa;
+	struct sockaddr_in sin;
+	struct sockaddr_in6 sin6;
+    } sockaddr_46_t;
+#   define NUM_HA 4
+    sockaddr_46_t ha[NUM_HA];
+    socklen_t ha_len[NUM_HA];
+    int ha_ix;
+    char *errtxt;
+    int n_ha;
+    unsigned short p;
+    socket_t s = INVALID_SOCKET;
+    char hn[256];
+    char pn[256];
+
+    /* Resolve the host name. */
+    if (proxy_type > 0) {
+	unsigned long lport;
+	char *ptr;
+	struct servent *sp;
+
+	if (resolve_host_and_port(proxy_host, proxy_portname, &proxy_port,
+		    &ha[0].sa, sizeof(sockaddr_46_t), ha_len, &errtxt,
+		    NUM_HA, &n_ha) < 0) {
+	    popup_an_error("%s", errtxt);
+	    return INVALID_SOCKET;
+	}
+
+	lport = strtoul(port, &ptr, 0);
+	if (ptr == port || *ptr != '\0' || lport == 0L || lport & ~0xffff) {
+	    if (!(sp = getservbyname(port, "tcp"))) {
+		popup_an_error("Unknown port number or service: %s", port);
+		return INVALID_SOCKET;
+	    }
+	    p = ntohs(sp->s_port);
+	} else {
+	    p = (unsigned short)lport;
+	}
+    } else {
+	if (resolve_host_and_port(host, port, &p, &ha[0].sa,
+		    sizeof(sockaddr_46_t), ha_len, &errtxt, NUM_HA,
+		    &n_ha) < 0) {
+	    popup_an_error("%s", errtxt);
+	    return INVALID_SOCKET;
+	}
+    }
+
+    for (ha_ix = 0; ha_ix < n_ha; ha_ix++) {
+
+	/* Connect to the host. */
+	s = socket(ha[ha_ix].sa.sa_family, SOCK_STREAM, 0);
+	if (s == INVALID_SOCKET) {
+	    popup_a_sockerr("socket");
+	    pr3287_exit(1);
+	}
+#if !defined(_WIN32) /*[*/
+	/* Keep print commands from holding the connection open. */
+	fcntl(s, F_SETFD, FD_CLOEXEC);
+#endif /*]*/
+
+	if (numeric_host_and_port(&ha[ha_ix].sa, ha_len[ha_ix], hn,
+		    sizeof(hn), pn, sizeof(pn), &errtxt)) {
+	    vtrace("Trying %s, port %s...\n", hn, pn);
+	}
+	if (connect(s, &ha[ha_ix].sa, ha_len[ha_ix]) == 0) {
+	    /* Success! */
+	    if (ha[ha_ix].sa.sa_family == AF_INET) {
+		p = htons(ha[ha_ix].sin.sin_port);
+	    } else {
+		p = htons(ha[ha_ix].sin6.sin6_port);
+	    }
+	    break;
+	}
+
+	popup_a_sockerr("%s", (proxy_type > 0)? proxy_host: host);
+	SOCK_CLOSE(s);
+	s = INVALID_SOCKET;
+    }
+    if (s == INVALID_SOCKET) {
+	return INVALID_SOCKET;
+    }
+
+    if (proxy_type > 0) {
+	/* Connect to the host through the proxy. */
+	if (options.verbose) {
+	    fprintf(stderr, "Connected to proxy server %s, port %u\n",
+		    proxy_host, proxy_port);
+	}
+	if (proxy_negotiate(s, proxy_user, host, p, true) != PX_SUCCESS) {
+	    SOCK_CLOSE(s);
+	    return INVALID_SOCKET;
+	}
+    }
+
+    *pp = p;
+    return s;
+}
+
+/* Say hello. */
+static void
+report_connect(const char *host, unsigned short p, const char *lu,
+	bool tls_host, const char *command)
+{
+    if (options.verbose) {
+	fprintf(stderr, "Connected to %s, port %u%s\n", host, p,
+		tls_host? " via TLS": "");
+	if (options.assoc != NULL) {
+	    fprintf(stderr, "Associating with LU %s\n", options.assoc);
+	} else if (lu != NULL) {
+	    fprintf(stderr, "Connecting to LU %s\n", lu);
+	}
+#if !defined(_WIN32) /*[*/
+	fprintf(stderr, "Command: %s\n", command);
+#else /*][*/
+	fprintf(stderr, "Printer: %s\n",
+		options.printer? options.printer: "(none)");
+#endif /*]*/
+    }
+    vtrace("Connected to %s, port %u%s\n", host, p,
+	    tls_host? " via TLS": "");
+    if (options.assoc != NULL) {
+	vtrace("Associating with LU %s\n", options.assoc);
+    } else if (lu != NULL) {
+	vtrace("Connecting to LU %s\n", lu);
+    }
+#if !defined(_WIN32) /*[*/
+    vtrace("Command: %s\n", command);
+#else /*][*/
+    vtrace("Printer: %s\n", options.printer? options.printer: "(none)");
+#endif /*]*/
+}
+
+#if !defined(_WIN32) /*[*/
+/*
+ * -lufile support.
+ *
+ * Each line of the LU file is a [lu[,lu...]@]host[:port] specification,
+ * optionally followed by a print command for that session (or a spool
+ * command, if -spooldir is in effect). Blank lines and lines beginning with
+ * '#' are ignored.
+ *
+ * All of the sessions run in this process, sharing the one-time setup (code
+ * page, translation table, proxy and TLS options). Each has its own telnet
+ * and printer state, and a single pselect() loop reads from all of their
+ * sockets. Connecting (including any proxy and TLS tunnel negotiation) is
+ * still done one session at a time.
+ */
+typedef struct {
+    char *spec;			/* host specification */
+    char *command;		/* print or spool command, or NULL */
+    char *name;			/* program name for error messages */
+    char *lu;			/* LU name(s) */
+    char *host;			/* host name */
+    char *port;			/* port */
+    unsigned short p;		/* port connected to */
+    socket_t s;			/* socket, while connected */
+    bool tls_host;		/* L: */
+    tls_config_t tls;		/* TLS options */
+    net_state_t *net;		/* telnet state */
+    ctlr_state_t *ctlr;		/* printer state */
+    enum {
+	LU_WAITING,		/* waiting to connect */
+	LU_CONNECTED,		/* connected */
+	LU_DONE			/* finished */
+    } state;
+    bool negotiated;		/* TN3270 negotiation is complete */
+    bool report_success;	/* report the next successful connection */
+    time_t retry_time;		/* when to connect */
+    time_t eoj_time;		/* when to time out the print job */
+} lu_session_t;
+static lu_session_t *lu_sessions = NULL;
+static int lu_nsessions = 0;
+static lu_session_t *lu_current = NULL;
+static char *lu_programname = NULL;
+static int lu_rc = 0;
+static volatile sig_atomic_t lu_exit_signal = 0;
+static volatile sig_atomic_t lu_flush_signal = 0;
+
+/* Read the LU file. */
+static void
+lu_read(const char *path)
+{
+    FILE *f;
+    char buf[1024];
+
+    if ((f = fopen(path, "r")) == NULL) {
+	perror(path);
+	pr3287_exit(1);
+    }
+    while (fgets(buf, sizeof(buf), f) != NULL) {
+	char *s = buf;
+	char *t;
+	size_t sl;
+	lu_session_t *l;
+
+	while (isspace((unsigned char)*s)) {
+	    s++;
+	}
+	sl = strlen(s);
+	while (sl && isspace((unsigned char)s[sl - 1])) {
+	    s[--sl] = '\0';
+	}
+	if (!*s || *s == '#') {
+	    continue;
+	}
+
+	/* Split off the command. */
+	t = s + strcspn(s, " \t");
+	if (*t) {
+	    *t++ = '\0';
+	    while (isspace((unsigned char)*t)) {
+		t++;
+	    }
+	}
+
+	lu_sessions = Realloc(lu_sessions,
+		(lu_nsessions + 1) * sizeof(lu_session_t));
+	l = &lu_sessions[lu_nsessions++];
+	memset(l, 0, sizeof(lu_session_t));
+	l->spec = NewString(s);
+	l->command = *t? NewString(t): NULL;
+    }
+    fclose(f);
+
+    if (!lu_nsessions) {
+	fprintf(stderr, "%s: No sessions defined\n", path);
+	pr3287_exit(1);
+    }
+}
+
+/*
+ * Make a session current, or go back to no session if l is NULL.
+ * Error messages are prefixed with the current session's host
+ * specification.
+ */
+static void
+lu_select(lu_session_t *l)
+{
+    if (l == NULL) {
+	programname = lu_programname;
+	return;
+    }
+    net_state_select(l->net);
+    ctlr_state_select(l->ctlr);
+    programname = l->name;
+    if (l != lu_current) {
+	vtrace("Session %s:\n", l->spec);
+	lu_current = l;
+    }
+}
+
+/* Signal handler for the -lufile sessions. */
+static void
+lu_signal(int sig)
+{
+    if (sig == SIGUSR1) {
+	lu_flush_signal = sig;
+    } else {
+	lu_exit_signal = sig;
+    }
+}
+
+/* Finish with a session, reporting it if it failed. */
+static void
+lu_done(lu_session_t *l, int rc)
+{
+    l->state = LU_DONE;
+    if (rc) {
+	lu_select(NULL);
+	errmsg("Session %s exited with status %d", l->spec, rc);
+	lu_rc = 1;
+    }
+}
+
+/* Finish with a session's connection, and decide whether to try again. */
+static void
+lu_disconnect(lu_session_t *l, int rc)
+{
+    lu_select(l);
+
+    /* Flush any pending data. */
+    print_eoj();
+    net_disconnect(true);
+    l->s = INVALID_SOCKET;
+
+    if (options.reconnect && !pr_net_fatal()) {
+	l->state = LU_WAITING;
+	l->report_success = true;
+
+	/* Wait a while, to reduce thrash. */
+	l->retry_time = time(NULL) + (rc? 5: 0);
+    } else {
+	lu_done(l, rc);
+    }
+}
+
+/* Connect a session to its host. */
+static void
+lu_connect(lu_session_t *l)
+{
+    lu_select(l);
+    l->negotiated = false;
+    l->s = host_connect(l->host, l->port, &l->p);
+    if (l->s == INVALID_SOCKET) {
+	lu_disconnect(l, 1);
+	return;
+    }
+    report_connect(l->host, l->p, l->lu, l->tls_host,
+	    (l->command != NULL && options.spooldir == NULL)?
+		l->command: options.command);
+    l->state = LU_CONNECTED;
+    l->eoj_time = time(NULL) + options.eoj_timeout;
+    if (!pr_net_start(l->host, l->s, l->lu, NULL, l->tls_host, &l->tls)) {
+	lu_disconnect(l, 1);
+    }
+}
+
+/* Process input from a session's host. */
+static void
+lu_input(lu_session_t *l)
+{
+    lu_select(l);
+    l->eoj_time = time(NULL) + options.eoj_timeout;
+    if (!pr_net_input()) {
+	if (options.verbose) {
+	    fprintf(stderr, "Disconnected (error).\n");
+	}
+	lu_disconnect(l, 1);
+	return;
+    }
+    if (!pr_net_connected()) {
+	if (options.verbose) {
+	    fprintf(stderr, "Disconnected (eof).\n");
+	}
+	lu_disconnect(l, 0);
+	return;
+    }
+
+    /* Report sudden success. */
+    if (!l->negotiated && pr_net_negotiated()) {
+	l->negotiated = true;
+	if (l->report_success) {
+	    errmsg("Connected to %s, port %u", l->host, l->p);
+	    l->report_success = false;
+	}
+    }
+}
+
+/* Handle a signal caught while waiting for input. */
+static void
+lu_handle_signals(void)
+{
+    int i;
+
+    if (lu_flush_signal) {
+	int sig = lu_flush_signal;
+
+	lu_flush_signal = 0;
+	for (i = 0; i < lu_nsessions; i++) {
+	    if (lu_sessions[i].state == LU_CONNECTED) {
+		lu_select(&lu_sessions[i]);
+		vtrace("Flush signal %d\n", sig);
+		print_eoj();
+	    }
+	}
+    }
+
+    if (lu_exit_signal) {
+	int sig = lu_exit_signal;
+
+	/* Flush any pending data and exit. */
+	for (i = 0; i < lu_nsessions; i++) {
+	    if (lu_sessions[i].state == LU_CONNECTED) {
+		lu_select(&lu_sessions[i]);
+		vtrace("Fatal signal %d\n", sig);
+		print_eoj();
+	    }
+	}
+	lu_select(NULL);
+	errmsg("Exiting on signal %d", sig);
+	pr3287_exit(0);
+    }
+}
+
+/*
+ * Run the sessions in the LU file until they are all finished, then exit.
+ */
+static void
+lu_run(void)
+{
+    sigset_t sigs;
+    sigset_t osigs;
+    int i;
+
+    /*
+     * Keep the signals blocked except while waiting in pselect(), so their
+     * work is done between data stream records.
+     */
+    sigemptyset(&sigs);
+    sigaddset(&sigs, SIGTERM);
+    sigaddset(&sigs, SIGINT);
+    sigaddset(&sigs, SIGHUP);
+    sigaddset(&sigs, SIGUSR1);
+    sigprocmask(SIG_BLOCK, &sigs, &osigs);
+    signal(SIGTERM, lu_signal);
+    signal(SIGINT, lu_signal);
+    signal(SIGHUP, lu_signal);
+    signal(SIGUSR1, lu_signal);
+
+    /* Set up the sessions. */
+    lu_programname = programname;
+    for (i = 0; i < lu_nsessions; i++) {
+	lu_session_t *l = &lu_sessions[i];
+	char *error;
+
+	l->name = Asprintf("%s %s", lu_programname, l->spec);
+	l->net = net_state_new();
+	l->ctlr = ctlr_state_new(l->command);
+	l->s = INVALID_SOCKET;
+	l->tls = options.tls;
+	l->state = LU_WAITING;
+	lu_select(l);
+	if (!split_hostspec(l->spec, &l->lu, &l->host, &l->port,
+		    &l->tls_host, &l->tls, &error)) {
+	    errmsg("%s", (error != NULL)? error: "Unsupported host prefix");
+	    lu_done(l, 1);
+	} else if (l->tls_host && !sio_supported()) {
+	    errmsg("Secure connections not supported");
+	    lu_done(l, 1);
+	}
+    }
+
+    for (;;) {
+	fd_set rfds;
+	int maxfd = -1;
+	time_t now = time(NULL);
+	time_t next = 0;
+	struct timespec ts;
+	int nr;
+
+	/* Connect the sessions that are due. */
+	for (i = 0; i < lu_nsessions; i++) {
+	    lu_session_t *l = &lu_sessions[i];
+
+	    if (l->state == LU_WAITING && l->retry_time <= now) {
+		lu_connect(l);
+	    }
+	}
+
+	/* Figure out what to wait for. */
+	FD_ZERO(&rfds);
+	for (i = 0; i < lu_nsessions; i++) {
+	    lu_session_t *l = &lu_sessions[i];
+
+	    switch (l->state) {
+	    case LU_WAITING:
+		if (!next || l->retry_time < next) {
+		    next = l->retry_time;
+		}
+		break;
+	    case LU_CONNECTED:
+		FD_SET(l->s, &rfds);
+		if ((int)l->s > maxfd) {
+		    maxfd = (int)l->s;
+		}
+		if (options.eoj_timeout &&
+			(!next || l->eoj_time < next)) {
+		    next = l->eoj_time;
+		}
+		break;
+	    case LU_DONE:
+		break;
+	    }
+	}
+	if (maxfd < 0 && !next) {
+	    /* All done. */
+	    break;
+	}
+
+	/* Wait for input, a timeout or a signal. */
+	now = time(NULL);
+	ts.tv_sec = (next > now)? next - now: 0;
+	ts.tv_nsec = 0;
+	nr = pselect(maxfd + 1, &rfds, NULL, NULL, next? &ts: NULL, &osigs);
+	lu_handle_signals();
+
+	/* Collect any spool commands that have finished. */
+	spool_reap(false);
+
+	/* Process input and print job timeouts. */
+	now = time(NULL);
+	for (i = 0; i < lu_nsessions; i++) {
+	    lu_session_t *l = &lu_sessions[i];
+
+	    if (l->state != LU_CONNECTED) {
+		continue;
+	    }
+	    if (nr > 0 && FD_ISSET(l->s, &rfds)) {
+		lu_input(l);
+	    } else if (options.eoj_timeout && l->eoj_time <= now) {
+		lu_select(l);
+		print_eoj();
+		l->eoj_time = now + options.eoj_timeout;
+	    }
+	}
+
+	/* Free transaction memory. */
+	txflush();
+    }
+
+    lu_select(NULL);
+    pr3287_exit(lu_rc);
+}
+#endif /*]*/
+
 void
 pr3287_exit(int status)
 {
+#if !defined(_WIN32) /*[*/
+    /* Wait for any spool commands, so failures are reported. */
+    spool_reap(true);
+#endif /*]*/
+
     fflush(stdout);
     fflush(stderr);
 #if defined(_WIN32) && defined(NEED_PAUSE) /*[*/
@@ -531,6 +1161,11 @@ init_options(void)
     options.proxy_spec		= NULL;
     options.reconnect		= 0;
     options.skipcc		= 0;
+#if !defined(_WIN32) /*[*/
+    options.lufile		= NULL;
+    options.spooldir		= NULL;
+    options.spoolcommand	= NULL;
+#endif /*]*/
     options.mpp			= DEFAULT_UNF_MPP;
     options.tls.accept_hostname	= NULL;
     options.tls.ca_dir		= NULL;
@@ -564,8 +1199,6 @@ main(int argc, char *argv[])
     char *lu = NULL;
     char *host = NULL;
     char *port = "23";
-    char *accept = NULL;
-    unsigned prefixes;
     char *error;
     char *xtable = NULL;
     unsigned short p;
@@ -573,8 +1206,6 @@ main(int argc, char *argv[])
     int rc = 0;
     int report_success = 0;
     unsigned tls_options = sio_all_options_supported();
-    char hn[256];
-    char pn[256];
     const char *bo;
 
     /* Learn our name. */
@@ -835,6 +1466,26 @@ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n", cyear);
 	    i++;
 	} else if (!strcmp(argv[i], "-skipcc")) {
 	    options.skipcc = 1;
+#if !defined(_WIN32) /*[*/
+	} else if (!strcmp(argv[i], "-lufile")) {
+	    if (argc <= i + 1 || !argv[i + 1][0]) {
+		missing_value("-lufile");
+	    }
+	    options.lufile = argv[i + 1];
+	    i++;
+	} else if (!strcmp(argv[i], "-spooldir")) {
+	    if (argc <= i + 1 || !argv[i + 1][0]) {
+		missing_value("-spooldir");
+	    }
+	    options.spooldir = argv[i + 1];
+	    i++;
+	} else if (!strcmp(argv[i], "-spoolcommand")) {
+	    if (argc <= i + 1 || !argv[i + 1][0]) {
+		missing_value("-spoolcommand");
+	    }
+	    options.spoolcommand = argv[i + 1];
+	    i++;
+#endif /*]*/
 	} else if (!strcmp(argv[i], OptHelp1)
 		|| !strcmp(argv[i], OptHelp2)
 #if defined(_WIN32) /*[*/
@@ -848,45 +1499,32 @@ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n", cyear);
 	    usage(NULL);
 	}
     }
+#if !defined(_WIN32) /*[*/
+    if (options.lufile != NULL) {
+	if (argc != i) {
+	    usage("Cannot specify both -lufile and a host");
+	}
+	if (options.assoc != NULL || options.syncport) {
+	    usage("-lufile cannot be used with -assoc or -syncport");
+	}
+    } else
+#endif /*]*/
     if (argc != i + 1) {
 	usage("Too many command-line options");
     }
-
-    /*
-     * Pick apart the hostname, LUs and port.
-     * We allow "L:" and "<luname>@" in either order.
-     */
-    if (!new_split_host(argv[i],  &lu, &host, &port, &accept, &prefixes,
-		&error)) {
-	fprintf(stderr, "%s\n", error);
-	pr3287_exit(1);
-    }
-    if (port == NULL) {
-	port = "23";
-    }
-
-    if (HOST_nFLAG(prefixes, TLS_HOST)) {
-	options.tls_host = true;
-    }
-    if (HOST_nFLAG(prefixes, NO_VERIFY_CERT_HOST)) {
-	options.tls.verify_host_cert = false;
-    }
-    if (accept != NULL) {
-	options.tls.accept_hostname = accept;
-    }
-
-    if (HOST_nFLAG(prefixes, NO_LOGIN_HOST) ||
-	    HOST_nFLAG(prefixes, NON_TN3270E_HOST) ||
-	    HOST_nFLAG(prefixes, PASSTHRU_HOST) ||
-	    HOST_nFLAG(prefixes, STD_DS_HOST) ||
-	    HOST_nFLAG(prefixes, BIND_LOCK_HOST)) {
-	usage(NULL);
+#if !defined(_WIN32) /*[*/
+    if (options.spoolcommand != NULL && options.spooldir == NULL) {
+	usage("-spoolcommand requires -spooldir");
     }
+    if (options.spooldir != NULL) {
+	struct stat st;
 
-    if (options.tls_host && !sio_supported()) {
-	fprintf(stderr, "Secure connections not supported.\n");
-	pr3287_exit(1);
+	if (stat(options.spooldir, &st) < 0 || !S_ISDIR(st.st_mode)) {
+	    fprintf(stderr, "No such directory: %s\n", options.spooldir);
+	    pr3287_exit(1);
+	}
     }
+#endif /*]*/
 
 #if defined(_WIN32) /*[*/
     /* Set the printer code page. */
@@ -905,6 +1543,33 @@ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n", cyear);
 	pr3287_exit(1);
     }
 
+#if !defined(_WIN32) /*[*/
+    if (options.lufile != NULL) {
+	/* Read the LU file. The sessions are set up in lu_run(). */
+	lu_read(options.lufile);
+    } else
+#endif /*]*/
+    {
+	/* Pick apart the hostname, LUs and port. */
+	if (!split_hostspec(argv[i], &lu, &host, &port, &options.tls_host,
+		    &options.tls, &error)) {
+	    if (error == NULL) {
+		usage(NULL);
+	    }
+	    fprintf(stderr, "%s\n", error);
+	    pr3287_exit(1);
+	}
+
+	if (options.tls_host && !sio_supported()) {
+	    fprintf(stderr, "Secure connections not supported.\n");
+	    pr3287_exit(1);
+	}
+
+	/* Set up the session state. */
+	net_state_select(net_state_new());
+	ctlr_state_select(ctlr_state_new(NULL));
+    }
+
     /* Try opening the trace file, if there is one. */
     if (options.tracing) {
 	char tracefile[4096];
@@ -1014,35 +1679,24 @@ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n", cyear);
 
 #if !defined(_WIN32) /*[*/
     /* Become a daemon. */
-    if (options.bdaemon != NOT_DAEMON) {
-	switch (fork()) {
-	case -1:
-	    perror("fork");
-	    exit(1);
-	    break;
-	case 0:
-	    /* Child: Break away from the TTY. */
-	    if (setsid() < 0) {
-		exit(1);
-	    }
-	    options.bdaemon = AM_DAEMON;
-	    break;
-	default:
-	    /* Parent: We're all done. */
-	    exit(0);
-	    break;
-	}
+    if (options.bdaemon == WILL_DAEMON) {
+	become_daemon();
     }
 #endif /*]*/
 
     /* Handle signals. */
-    signal(SIGTERM, fatal_signal);
-    signal(SIGINT, fatal_signal);
 #if !defined(_WIN32) /*[*/
-    signal(SIGHUP, fatal_signal);
-    signal(SIGUSR1, flush_signal);
     signal(SIGPIPE, SIG_IGN);
+    if (options.lufile == NULL)
+#endif /*]*/
+    {
+	signal(SIGTERM, fatal_signal);
+	signal(SIGINT, fatal_signal);
+#if !defined(_WIN32) /*[*/
+	signal(SIGHUP, fatal_signal);
+	signal(SIGUSR1, flush_signal);
 #endif /*]*/
+    }
 
     /* Set up the proxy. */
     if (options.proxy_spec != NULL) {
@@ -1077,135 +1731,31 @@ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n", cyear);
     /* Set up -4/-6 host lookup preference. */
     set_46(options.prefer_ipv4, options.prefer_ipv6);
 
+#if !defined(_WIN32) /*[*/
+    /* Run the sessions in the LU file. This does not return. */
+    if (options.lufile != NULL) {
+	lu_run();
+    }
+#endif /*]*/
+
     /*
      * One-time initialization is now complete.
      * (Most) everything beyond this will now be retried, if the -reconnect
      * option is in effect.
      */
     for (;;) {
-	typedef union {
-	    struct sockaddr sa;
-	    struct sockaddr_in sin;
-	    struct sockaddr_in6 sin6;
-	} sockaddr_46_t;
-#       define NUM_HA 4
-	sockaddr_46_t ha[NUM_HA];
-	socklen_t ha_len[NUM_HA];
-	int ha_ix;
-	char *errtxt;
-	int n_ha;
-
-	/* Resolve the host name. */
-	if (proxy_type > 0) {
-	    unsigned long lport;
-	    char *ptr;
-	    struct servent *sp;
-
-	    if (resolve_host_and_port(proxy_host, proxy_portname, &proxy_port,
-			&ha[0].sa, sizeof(sockaddr_46_t), ha_len, &errtxt,
-			NUM_HA, &n_ha) < 0) {
-		popup_an_error("%s", errtxt);
-		rc = 1;
-		goto retry;
-	    }
-
-	    lport = strtoul(port, &ptr, 0);
-	    if (ptr == port || *ptr != '\0' || lport == 0L || lport & ~0xffff) {
-		if (!(sp = getservbyname(port, "tcp"))) {
-		    popup_an_error("Unknown port number or service: %s", port);
-		    rc = 1;
-		    goto retry;
-		}
-		p = ntohs(sp->s_port);
-	    } else {
-		p = (unsigned short)lport;
-	    }
-	} else {
-	    if (resolve_host_and_port(host, port, &p, &ha[0].sa,
-			sizeof(sockaddr_46_t), ha_len, &errtxt, NUM_HA,
-			&n_ha) < 0) {
-		popup_an_error("%s", errtxt);
-		rc = 1;
-		goto retry;
-	    }
-	}
-
-	for (ha_ix = 0; ha_ix < n_ha; ha_ix++) {
-
-	    /* Connect to the host. */
-	    s = socket(ha[ha_ix].sa.sa_family, SOCK_STREAM, 0);
-	    if (s == INVALID_SOCKET) {
-		popup_a_sockerr("socket");
-		pr3287_exit(1);
-	    }
-
-	    if (numeric_host_and_port(&ha[ha_ix].sa, ha_len[ha_ix], hn,
-			sizeof(hn), pn, sizeof(pn), &errtxt)) {
-		vtrace("Trying %s, port %s...\n", hn, pn);
-	    }
-	    if (connect(s, &ha[ha_ix].sa, ha_len[ha_ix]) == 0) {
-		/* Success! */
-		if (ha[ha_ix].sa.sa_family == AF_INET) {
-		    p = htons(ha[ha_ix].sin.sin_port);
-		} else {
-		    p = htons(ha[ha_ix].sin6.sin6_port);
-		}
-		break;
-	    }
-
-	    popup_a_sockerr("%s", (proxy_type > 0)? proxy_host: host);
-	    SOCK_CLOSE(s);
-	    s = INVALID_SOCKET;
-	}
+	/* Connect to the host. */
+	s = host_connect(host, port, &p);
 	if (s == INVALID_SOCKET) {
 	    rc = 1;
 	    goto retry;
 	}
 
-	if (proxy_type > 0) {
-	    /* Connect to the host through the proxy. */
-	    if (options.verbose) {
-		fprintf(stderr, "Connected to proxy server %s, port %u\n",
-			proxy_host, proxy_port);
-	    }
-	    if (proxy_negotiate(s, proxy_user, host, p, true) != PX_SUCCESS) {
-		rc = 1;
-		goto retry;
-	    }
-	}
-
 	/* Say hello. */
-	if (options.verbose) {
-	    fprintf(stderr, "Connected to %s, port %u%s\n", host, p,
-		    options.tls_host? " via TLS": "");
-	    if (options.assoc != NULL) {
-		fprintf(stderr, "Associating with LU %s\n", options.assoc);
-	    } else if (lu != NULL) {
-		fprintf(stderr, "Connecting to LU %s\n", lu);
-	    }
-#if !defined(_WIN32) /*[*/
-	    fprintf(stderr, "Command: %s\n", options.command);
-#else /*][*/
-	    fprintf(stderr, "Printer: %s\n",
-		    options.printer? options.printer: "(none)");
-#endif /*]*/
-	}
-	vtrace("Connected to %s, port %u%s\n", host, p,
-		options.tls_host? " via TLS": "");
-	if (options.assoc != NULL) {
-	    vtrace("Associating with LU %s\n", options.assoc);
-	} else if (lu != NULL) {
-	    vtrace("Connecting to LU %s\n", lu);
-	}
-#if !defined(_WIN32) /*[*/
-	vtrace("Command: %s\n", options.command);
-#else /*][*/
-	vtrace("Printer: %s\n", options.printer? options.printer: "(none)");
-#endif /*]*/
+	report_connect(host, p, lu, options.tls_host, options.command);
 
 	/* Negotiate. */
-	if (!pr_net_negotiate(host, &ha[ha_ix].sa, ha_len[ha_ix], s, lu,
-		    options.assoc)) {
+	if (!pr_net_negotiate(host, s, lu, options.assoc)) {
 	    rc = 1;
 	    goto retry;
 	}
@@ -1238,7 +1788,7 @@ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.\n", cyear);
 	    s = INVALID_SOCKET;
 	}
 
-	if (!options.reconnect) {
+	if (!options.reconnect || pr_net_fatal()) {
 	    break;
 	}
 	report_success = 1;
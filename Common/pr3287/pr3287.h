@@ -60,6 +60,11 @@ typedef struct {
 	const char *proxy_spec;	/* proxy specification */
 	int reconnect;		/* -reconnect */
 	int skipcc;		/* -skipcc */
+#if !defined(_WIN32) /*[*/
+	const char *lufile;	/* -lufile */
+	const char *spooldir;	/* -spooldir */
+	const char *spoolcommand; /* -spoolcommand */
+#endif /*]*/
 	int mpp;		/* -mpp */
 	bool tls_host;		/* L: */
 	tls_config_t tls;	/* TLS options */
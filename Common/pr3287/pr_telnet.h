@@ -1,5 +1,5 @@
 /*
- * Copyright (c) 1995-2013, 2015, 2017, 2020 Paul Mattes.
+ * Copyright (c) 1995-2013, 2015, 2017, 2020, 2024 Paul Mattes.
  * All rights reserved.
  *
  * Redistribution and use in source and binary forms, with or without
@@ -31,6 +31,17 @@
  *		from) what is declared in telnet_core.h.
  */
 
-extern bool pr_net_negotiate(const char *host, struct sockaddr *sa,
-	socklen_t len, socket_t s, char *lu, const char *assoc);
+typedef struct net_state net_state_t;	/* per-session state */
+
+extern net_state_t *net_state_new(void);
+extern void net_state_select(net_state_t *n);
+
+extern bool pr_net_start(const char *host, socket_t s, char *lu,
+	const char *assoc, bool tls_host, tls_config_t *tls);
+extern bool pr_net_negotiate(const char *host, socket_t s, char *lu,
+	const char *assoc);
+extern bool pr_net_input(void);
+extern bool pr_net_negotiated(void);
+extern bool pr_net_connected(void);
+extern bool pr_net_fatal(void);
 extern bool pr_net_process(socket_t s);
@@ -51,7 +51,12 @@
 #include "telnet_core.h"
 #include "trace.h"
 
-/* Statics */
+/*
+ * Statics
+ *
+ * A query reply is built and sent within one Read Partition, and
+ * query_reply_end() clears qr_in_progress, so -lufile sessions can share it.
+ */
 static bool  qr_in_progress = false;
 static enum pds sf_read_part(unsigned char buf[], unsigned buflen);
 static enum pds sf_erase_reset(unsigned char buf[], int buflen);
@@ -663,4 +668,5 @@ static void
 query_reply_end(void)
 {
     net_output();
+    qr_in_progress = false;
 }
@@ -100,70 +100,90 @@ enum cstate {
     CONNECTED_TN3270E,	/* connected in TN3270E mode, 3270 mode */
     NUM_CSTATE		/* number of cstates */
 };
-enum cstate cstate = NOT_CONNECTED;
 
-#define PCONNECTED	((int)cstate >= (int)TCP_PENDING)
-#define HALF_CONNECTED	(cstate == TCP_PENDING)
-#define CONNECTED	((int)cstate >= (int)CONNECTED_INITIAL)
-#define IN_NVT		(cstate == CONNECTED_NVT || cstate == CONNECTED_E_NVT)
-#define IN_3270		(cstate == CONNECTED_3270 || cstate == CONNECTED_TN3270E || cstate == CONNECTED_SSCP)
-#define IN_SSCP		(cstate == CONNECTED_SSCP)
-#define IN_TN3270E	(cstate == CONNECTED_TN3270E)
-#define IN_E		(cstate >= CONNECTED_INITIAL_E)
-
-static char *connected_lu = NULL;
-static char *connected_type = NULL;
-static char *hostname = NULL;
+#define PCONNECTED	((int)net->cstate >= (int)TCP_PENDING)
+#define HALF_CONNECTED	(net->cstate == TCP_PENDING)
+#define CONNECTED	((int)net->cstate >= (int)CONNECTED_INITIAL)
+#define IN_NVT		(net->cstate == CONNECTED_NVT || \
+			 net->cstate == CONNECTED_E_NVT)
+#define IN_3270		(net->cstate == CONNECTED_3270 || \
+			 net->cstate == CONNECTED_TN3270E || \
+			 net->cstate == CONNECTED_SSCP)
+#define IN_SSCP		(net->cstate == CONNECTED_SSCP)
+#define IN_TN3270E	(net->cstate == CONNECTED_TN3270E)
+#define IN_E		(net->cstate >= CONNECTED_INITIAL_E)
 
 #define BUFSZ		4096
 
 #define N_OPTS		256
 
+#define LU_MAX		32
+
 static int on = 1;
 
 /* Globals */
-time_t          ns_time;
-size_t          ns_brcvd;
-int             ns_rrcvd;
-size_t          ns_bsent;
-int             ns_rsent;
 unsigned char  *obuf;		/* 3270 output buffer */
 int             obuf_size = 0;
 unsigned char  *obptr = (unsigned char *) NULL;
 bool            linemode = true;
 const char     *termtype = "IBM-3287-1";
 
+/*
+ * Per-session state.
+ *
+ * The output buffer and the network read buffer are not part of it: each is
+ * filled and drained within a single call, so the sessions can share them.
+ */
+struct net_state {
+    enum cstate cstate;		/* connection state */
+    char *connected_lu;
+    char *connected_type;
+    char *hostname;
+    char reported_lu[LU_MAX + 1];
+    char reported_type[LU_MAX + 1];
+    time_t ns_time;
+    size_t ns_brcvd;
+    int ns_rrcvd;
+    size_t ns_bsent;
+    int ns_rsent;
+    struct timeval ds_ts;
+    socket_t sock;		/* active socket */
+    unsigned char myopts[N_OPTS], hisopts[N_OPTS];
+				/* telnet option flags */
+    unsigned char *ibuf;	/* 3270 input buffer */
+    unsigned char *ibptr;
+    int ibuf_size;		/* size of ibuf */
+    unsigned char *sbbuf;	/* telnet sub-option buffer */
+    unsigned char *sbptr;
+    unsigned char telnet_state;
+    int syncing;
+    unsigned long e_funcs;	/* negotiated TN3270E functions */
+    unsigned short e_xmit_seq;	/* transmit sequence number */
+    int response_required;
+    int tn3270e_negotiated;
+    enum { E_NONE, E_3270, E_NVT, E_SSCP } tn3270e_submode;
+    int tn3270e_bound;
+    char **lus;
+    char **curr_lu;
+    char *try_lu;
+    char *try_assoc;
+    tls_config_t *tls;		/* TLS options */
+    bool secure_connection;
+    bool secure_unverified;
+    sio_t sio;
+    bool need_tls_follows;
+    bool refused_tls;
+    bool ever_3270;
+    bool fatal;			/* cannot continue, even with -reconnect */
+};
 
 /* Statics */
-static struct timeval ds_ts;
-static socket_t sock = INVALID_SOCKET;	/* active socket */
-static unsigned char myopts[N_OPTS], hisopts[N_OPTS];
-			/* telnet option flags */
-static unsigned char *ibuf = (unsigned char *) NULL;
-			/* 3270 input buffer */
-static unsigned char *ibptr;
-static int      ibuf_size = 0;	/* size of ibuf */
+static net_state_t *net = NULL;	/* current session */
 static unsigned char *obuf_base = NULL;
 static unsigned char *netrbuf = NULL;
 			/* network input buffer */
-static unsigned char *sbbuf = NULL;
-			/* telnet sub-option buffer */
-static unsigned char *sbptr;
-static unsigned char telnet_state;
-static int      syncing;
 
-static unsigned long e_funcs;	/* negotiated TN3270E functions */
 #define E_OPT(n)	(1 << (n))
-static unsigned short e_xmit_seq; /* transmit sequence number */
-static int response_required;
-
-static int tn3270e_negotiated = 0;
-static enum { E_NONE, E_3270, E_NVT, E_SSCP } tn3270e_submode = E_NONE;
-static int tn3270e_bound = 0;
-static char **lus = NULL;
-static char **curr_lu = NULL;
-static char *try_lu = NULL;
-static char *try_assoc = NULL;
 
 static void setup_lus(char *luname, const char *assoc);
 static bool telnet_fsm(unsigned char c);
@@ -180,7 +200,6 @@ static void tn3270_nak(enum pds);
 static void tn3270e_ack(void);
 static void tn3270e_nak(enum pds);
 static void tn3270e_cleared(void);
-static bool net_input(socket_t s);
 
 #define trace_str(str)	vtrace("%s", (str))
 static const char *cmd(int c);
@@ -240,13 +259,7 @@ const char *neg_type[4] = { "COMMAND-REJECT", "INTERVENTION-REQUIRED",
 #define e_neg_type(n)	(((n) <= TN3270E_NEG_COMPONENT_DISCONNECTED) ? \
 			    neg_type[n]: "??")
 
-bool secure_connection = false;
-bool secure_unverified = false;
-static sio_t sio;
-static bool need_tls_follows = false;
 static int continue_tls(unsigned char *sbbuf, int len);
-static bool refused_tls = false;
-static bool ever_3270 = false;
 
 char *
 sockerrmsg(void)
@@ -283,22 +296,47 @@ popup_a_sockerr(const char *fmt, ...)
     Free(buf);
 }
 
+/* Create the state for a session. */
+net_state_t *
+net_state_new(void)
+{
+    net_state_t *n = (net_state_t *)Calloc(1, sizeof(net_state_t));
+
+    n->cstate = NOT_CONNECTED;
+    n->sock = INVALID_SOCKET;
+    n->tls = &options.tls;
+    return n;
+}
+
+/* Make a session's state current. */
+void
+net_state_select(net_state_t *n)
+{
+    net = n;
+}
+
 /*
- * pr_net_negotiate
- *	Initialize the connection, and negotiate TN3270 options with the host.
+ * pr_net_start
+ *	Initialize the connection, and start negotiating TN3270 options with
+ *	the host. The negotiation continues in pr_net_input().
  *
  * Returns true for success, false for failure.
  */
 bool
-pr_net_negotiate(const char *host, struct sockaddr *sa, socklen_t len,
-	socket_t s, char *lu, const char *assoc)
+pr_net_start(const char *host, socket_t s, char *lu, const char *assoc,
+	bool tls_host, tls_config_t *tls)
 {
     bool data = false;
 
     /* Save the hostname. */
     char *h = Malloc(strlen(host) + 1);
     strcpy(h, host);
-    Replace(hostname, h);
+    Replace(net->hostname, h);
+
+    /* Remember the socket, so net_disconnect() will close it. */
+    net->sock = s;
+    net->tls = tls;
+    net->fatal = false;
 
     /* Set options for inline out-of-band data and keepalives. */
     if (setsockopt(s, SOL_SOCKET, SO_OOBINLINE, (char *)&on, sizeof(on)) < 0) {
@@ -316,21 +354,21 @@ pr_net_negotiate(const char *host, struct sockaddr *sa, socklen_t len,
 #endif /*]*/
 
     /* Init TLS */
-    if (options.tls_host && !secure_connection) {
+    if (tls_host && !net->secure_connection) {
 	char *session, *cert;
 
-	if (sio_init(&options.tls, NULL, &sio) != SI_SUCCESS) {
+	if (sio_init(net->tls, NULL, &net->sio) != SI_SUCCESS) {
 	    errmsg("%s\n", sio_last_error());
 	    return false;
 	}
-	if (sio_negotiate(sio, s, host, &data) != SIG_SUCCESS) {
+	if (sio_negotiate(net->sio, s, host, &data) != SIG_SUCCESS) {
 	    errmsg("%s\n", sio_last_error());
 	    return false;
 	}
 
-	secure_connection = true;
-	session = indent_s(sio_session_info(sio));
-	cert = indent_s(sio_server_cert_info(sio));
+	net->secure_connection = true;
+	session = indent_s(sio_session_info(net->sio));
+	cert = indent_s(sio_server_cert_info(net->sio));
 	vtrace("TLS tunneled connection complete.  "
 		"Connection is now secure.\n"
 		"Session:\n%s\nServer certificate:\n%s\n",
@@ -343,47 +381,61 @@ pr_net_negotiate(const char *host, struct sockaddr *sa, socklen_t len,
     if (netrbuf == NULL) {
 	netrbuf = (unsigned char *)Malloc(BUFSZ);
     }
-    if (ibuf == NULL) {
-	ibuf = (unsigned char *)Malloc(BUFSIZ);
+    if (net->ibuf == NULL) {
+	net->ibuf = (unsigned char *)Malloc(BUFSIZ);
     }
-    ibuf_size = BUFSIZ;
-    ibptr = ibuf;
+    net->ibuf_size = BUFSIZ;
+    net->ibptr = net->ibuf;
 
     /* Set up the LU list. */
     setup_lus(lu, assoc);
 
     /* Set up telnet options. */
-    memset((char *) myopts, 0, sizeof(myopts));
-    memset((char *) hisopts, 0, sizeof(hisopts));
-    e_funcs = E_OPT(TN3270E_FUNC_BIND_IMAGE) |
+    memset((char *) net->myopts, 0, sizeof(net->myopts));
+    memset((char *) net->hisopts, 0, sizeof(net->hisopts));
+    net->e_funcs = E_OPT(TN3270E_FUNC_BIND_IMAGE) |
 	      E_OPT(TN3270E_FUNC_DATA_STREAM_CTL) |
 	      E_OPT(TN3270E_FUNC_RESPONSES) |
 	      E_OPT(TN3270E_FUNC_SCS_CTL_CODES) |
 	      E_OPT(TN3270E_FUNC_SYSREQ);
-    e_xmit_seq = 0;
-    response_required = TN3270E_RSF_NO_RESPONSE;
-    need_tls_follows = false;
-    telnet_state = TNS_DATA;
+    net->e_xmit_seq = 0;
+    net->response_required = TN3270E_RSF_NO_RESPONSE;
+    net->need_tls_follows = false;
+    net->telnet_state = TNS_DATA;
 
     /* Clear statistics and flags. */
-    time(&ns_time);
-    ns_brcvd = 0;
-    ns_rrcvd = 0;
-    ns_bsent = 0;
-    ns_rsent = 0;
-    syncing = 0;
-    tn3270e_negotiated = 0;
-    tn3270e_submode = E_NONE;
-    tn3270e_bound = 0;
+    time(&net->ns_time);
+    net->ns_brcvd = 0;
+    net->ns_rrcvd = 0;
+    net->ns_bsent = 0;
+    net->ns_rsent = 0;
+    net->syncing = 0;
+    net->tn3270e_negotiated = 0;
+    net->tn3270e_submode = E_NONE;
+    net->tn3270e_bound = 0;
+
+    net->cstate = CONNECTED_INITIAL;
+    return true;
+}
+
+/*
+ * pr_net_negotiate
+ *	Initialize the connection, and negotiate TN3270 options with the host.
+ *
+ * Returns true for success, false for failure.
+ */
+bool
+pr_net_negotiate(const char *host, socket_t s, char *lu, const char *assoc)
+{
+    if (!pr_net_start(host, s, lu, assoc, options.tls_host, &options.tls)) {
+	return false;
+    }
 
     /* Speak with the host until we suceed or give up. */
-    cstate = CONNECTED_INITIAL;
-    sock = s; /* hack! */
-    while (!tn3270e_negotiated &&	/* TN3270E */
-	   cstate != CONNECTED_3270 &&	/* TN3270 */
-	   cstate != NOT_CONNECTED) {	/* gave up */
+    while (!pr_net_negotiated() &&
+	   net->cstate != NOT_CONNECTED) {	/* gave up */
 
-	if (!net_input(s)) {
+	if (!pr_net_input()) {
 	    return false;
 	}
     }
@@ -392,10 +444,34 @@ pr_net_negotiate(const char *host, struct sockaddr *sa, socklen_t len,
     return true;
 }
 
+/* Returns true if TN3270 or TN3270E negotiation is complete. */
+bool
+pr_net_negotiated(void)
+{
+    return net->tn3270e_negotiated ||		/* TN3270E */
+	   net->cstate == CONNECTED_3270;	/* TN3270 */
+}
+
+/* Returns true if the host is still connected. */
+bool
+pr_net_connected(void)
+{
+    return net->cstate != NOT_CONNECTED;
+}
+
+/*
+ * Returns true if the session failed in a way that reconnecting will not fix.
+ */
+bool
+pr_net_fatal(void)
+{
+    return net->fatal;
+}
+
 bool
 pr_net_process(socket_t s)
 {
-    while (cstate != NOT_CONNECTED) {
+    while (net->cstate != NOT_CONNECTED) {
 	fd_set rfds;
 	struct timeval t;
 	struct timeval *tp;
@@ -421,8 +497,12 @@ pr_net_process(socket_t s)
 	if (nr == 0 && options.eoj_timeout) {
 	    print_eoj();
 	}
+#if !defined(_WIN32) /*[*/
+	/* Collect any spool commands that have finished. */
+	spool_reap(false);
+#endif /*]*/
 	if (nr > 0 && FD_ISSET(s, &rfds)) {
-	    if (!net_input(s)) {
+	    if (!pr_net_input()) {
 		return false;
 	    }
 	}
@@ -447,23 +527,23 @@ pr_net_process(socket_t s)
 void
 net_disconnect(bool including_tls)
 {
-    if (sock != INVALID_SOCKET) {
+    if (net->sock != INVALID_SOCKET) {
 	vtrace("SENT disconnect\n");
-	SOCK_CLOSE(sock);
-	sock = INVALID_SOCKET;
-	if (sio != NULL) {
-	    sio_close(sio);
-	    sio = NULL;
+	SOCK_CLOSE(net->sock);
+	net->sock = INVALID_SOCKET;
+	if (net->sio != NULL) {
+	    sio_close(net->sio);
+	    net->sio = NULL;
 	}               
-	secure_connection = false;
-	secure_unverified = false;
+	net->secure_connection = false;
+	net->secure_unverified = false;
 
-	if (refused_tls && !ever_3270) {
+	if (net->refused_tls && !net->ever_3270) {
 	    errmsg("Connection failed:\n"
 		    "Host requested TLS but TLS not supported");
 	}
-	refused_tls = false;
-	ever_3270 = false;
+	net->refused_tls = false;
+	net->ever_3270 = false;
     }
 }
 
@@ -476,18 +556,18 @@ setup_lus(char *luname, const char *assoc)
     int n_lus = 1;
     int i;
 
-    connected_lu = NULL;
-    connected_type = NULL;
-    curr_lu = NULL;
-    try_lu = NULL;
+    net->connected_lu = NULL;
+    net->connected_type = NULL;
+    net->curr_lu = NULL;
+    net->try_lu = NULL;
 
-    if (lus) {
-	Free(lus);
-	lus = NULL;
+    if (net->lus) {
+	Free(net->lus);
+	net->lus = NULL;
     }
 
     if (assoc != NULL) {
-	try_assoc = NewString(assoc);
+	net->try_assoc = NewString(assoc);
 	return;
     }
 
@@ -509,72 +589,73 @@ setup_lus(char *luname, const char *assoc)
      * Allocate enough memory to construct an argv[] array for
      * the LUs.
      */
-    lus = (char **)Malloc((n_lus+1) * sizeof(char *) + strlen(luname) + 1);
+    net->lus = (char **)Malloc((n_lus+1) * sizeof(char *) +
+	    strlen(luname) + 1);
 
     /* Copy each LU into the array. */
-    lu = (char *)(lus + n_lus + 1);
+    lu = (char *)(net->lus + n_lus + 1);
     strcpy(lu, luname);
     i = 0;
     do {
-	lus[i++] = lu;
+	net->lus[i++] = lu;
 	comma = strchr(lu, ',');
 	if (comma != NULL) {
 	    *comma = '\0';
 	    lu = comma + 1;
 	}
     } while (comma != NULL);
-    lus[i] = NULL;
-    curr_lu = lus;
-    try_lu = *curr_lu;
+    net->lus[i] = NULL;
+    net->curr_lu = net->lus;
+    net->try_lu = *net->curr_lu;
 }
 
 /*
- * net_input
- *	Called by the toolkit whenever there is input available on the
- *	socket.  Reads the data, processes the special telnet commands
- *	and calls process_ds to process the 3270 data stream.
+ * pr_net_input
+ *	Called whenever there is input available on the session's socket.
+ *	Reads the data, processes the special telnet commands and calls
+ *	process_ds to process the 3270 data stream.
  */
-static bool
-net_input(socket_t s)
+bool
+pr_net_input(void)
 {
     register unsigned char *cp;
     ssize_t nr;
 
-    if (sio != NULL) {
-	nr = sio_read(sio, (char *)netrbuf, BUFSZ);
+    if (net->sio != NULL) {
+	nr = sio_read(net->sio, (char *)netrbuf, BUFSZ);
     } else {
-	nr = recv(s, (char *)netrbuf, BUFSZ, 0);
+	nr = recv(net->sock, (char *)netrbuf, BUFSZ, 0);
     }
     if (nr < 0) {
-	if ((sio != NULL && nr == SIO_EWOULDBLOCK) ||
-	    (sio == NULL && socket_errno() == SE_EWOULDBLOCK)) {
+	if ((net->sio != NULL && nr == SIO_EWOULDBLOCK) ||
+	    (net->sio == NULL && socket_errno() == SE_EWOULDBLOCK)) {
 	    vtrace("EWOULDBLOCK\n");
 	    return true;
 	}
-	if (sio != NULL) {
+	if (net->sio != NULL) {
 	    vtrace("RCVD sio error %s\n", sio_last_error());
 	    errmsg("%s\n", sio_last_error());
-	    cstate = NOT_CONNECTED;
+	    net->cstate = NOT_CONNECTED;
 	    return false;
 	}
 	vtrace("RCVD socket error %s\n", sockerrmsg());
 	popup_a_sockerr("Socket read");
-	cstate = NOT_CONNECTED;
+	net->cstate = NOT_CONNECTED;
 	return false;
     } else if (nr == 0) {
 	/* Host disconnected. */
 	trace_str("RCVD disconnect\n");
-	cstate = NOT_CONNECTED;
+	net->cstate = NOT_CONNECTED;
 	return true;
     }
 
     /* Process the data. */
     trace_netdata('<', netrbuf, nr);
 
-    ns_brcvd += nr;
+    net->ns_brcvd += nr;
     for (cp = netrbuf; cp < (netrbuf + nr); cp++) {
-	if (!telnet_fsm(*cp)) {
-	    cstate = NOT_CONNECTED;
+	if (!telnet_fsm(*cp) || net->fatal) {
+	    net->cstate = NOT_CONNECTED;
 	    return false;
 	}
     }
@@ -585,8 +666,8 @@ net_input(socket_t s)
 static void
 next_lu(void)
 {
-    if (curr_lu != NULL && (try_lu = *++curr_lu) == NULL) {
-	curr_lu = NULL;
+    if (net->curr_lu != NULL && (net->try_lu = *++net->curr_lu) == NULL) {
+	net->curr_lu = NULL;
     }
 }
 
@@ -598,10 +679,10 @@ next_lu(void)
 static bool
 telnet_fsm(unsigned char c)
 {
-    switch (telnet_state) {
+    switch (net->telnet_state) {
     case TNS_DATA:	/* normal data processing */
 	if (c == IAC) {	/* got a telnet command */
-	    telnet_state = TNS_IAC;
+	    net->telnet_state = TNS_IAC;
 	    break;
 	}
 	if (IN_NVT && !IN_E) {
@@ -622,45 +703,45 @@ telnet_fsm(unsigned char c)
 	    } else {
 		store3270in(c);
 	    }
-	    telnet_state = TNS_DATA;
+	    net->telnet_state = TNS_DATA;
 	    break;
 	case EOR:	/* eor, process accumulated input */
 	    trace_str("RCVD EOR");
-	    if (IN_3270 || (IN_E && tn3270e_negotiated)) {
+	    if (IN_3270 || (IN_E && net->tn3270e_negotiated)) {
 		trace_str("\n");
-		ns_rrcvd++;
+		net->ns_rrcvd++;
 		process_eor();
 	    } else {
 		trace_str(" (ignored -- not in 3270 mode)\n");
 	    }
-	    ibptr = ibuf;
-	    telnet_state = TNS_DATA;
+	    net->ibptr = net->ibuf;
+	    net->telnet_state = TNS_DATA;
 	    break;
 	case WILL:
-	    telnet_state = TNS_WILL;
+	    net->telnet_state = TNS_WILL;
 	    break;
 	case WONT:
-	    telnet_state = TNS_WONT;
+	    net->telnet_state = TNS_WONT;
 	    break;
 	case DO:
-	    telnet_state = TNS_DO;
+	    net->telnet_state = TNS_DO;
 	    break;
 	case DONT:
-	    telnet_state = TNS_DONT;
+	    net->telnet_state = TNS_DONT;
 	    break;
 	case SB:
-	    telnet_state = TNS_SB;
-	    if (sbbuf == NULL) {
-		sbbuf = (unsigned char *)Malloc(1024);
+	    net->telnet_state = TNS_SB;
+	    if (net->sbbuf == NULL) {
+		net->sbbuf = (unsigned char *)Malloc(1024);
 	    }
-	    sbptr = sbbuf;
+	    net->sbptr = net->sbbuf;
 	    break;
 	case DM:
 	    trace_str("\n");
-	    if (syncing) {
-		syncing = 0;
+	    if (net->syncing) {
+		net->syncing = 0;
 	    }
-	    telnet_state = TNS_DATA;
+	    net->telnet_state = TNS_DATA;
 	    break;
 	case AO:
 	    if (IN_3270 && !IN_E) {
@@ -671,17 +752,17 @@ telnet_fsm(unsigned char c)
 	    } else {
 		trace_str(" (ignored -- not in TN3270 mode)\n");
 	    }
-	    ibptr = ibuf;
-	    telnet_state = TNS_DATA;
+	    net->ibptr = net->ibuf;
+	    net->telnet_state = TNS_DATA;
 	    break;
 	case GA:
 	case NOP:
 	    trace_str("\n");
-	    telnet_state = TNS_DATA;
+	    net->telnet_state = TNS_DATA;
 	    break;
 	default:
 	    trace_str(" (ignored -- unsupported)\n");
-	    telnet_state = TNS_DATA;
+	    net->telnet_state = TNS_DATA;
 	    break;
 	}
 	break;
@@ -694,15 +775,15 @@ telnet_fsm(unsigned char c)
 	    case TELOPT_TTYPE:
 	    case TELOPT_ECHO:
 	    case TELOPT_TN3270E:
-		if (!hisopts[c]) {
-		    hisopts[c] = 1;
+		if (!net->hisopts[c]) {
+		    net->hisopts[c] = 1;
 		    do_opt[2] = c;
 		    net_rawout(do_opt, sizeof(do_opt));
 		    vtrace("SENT %s %s\n", cmd(DO), opt(c));
 
 		    /* For UTS, volunteer to do EOR when they do. */
-		    if (c == TELOPT_EOR && !myopts[c]) {
-			myopts[c] = 1;
+		    if (c == TELOPT_EOR && !net->myopts[c]) {
+			net->myopts[c] = 1;
 			will_opt[2] = c;
 			net_rawout(will_opt, sizeof(will_opt));
 			vtrace("SENT %s %s\n", cmd(WILL), opt(c));
@@ -717,18 +798,18 @@ telnet_fsm(unsigned char c)
 		vtrace("SENT %s %s\n", cmd(DONT), opt(c));
 		break;
 	    }
-	    telnet_state = TNS_DATA;
+	    net->telnet_state = TNS_DATA;
 	    break;
 	case TNS_WONT:	/* telnet WONT DO OPTION command */
 	    vtrace("%s\n", opt(c));
-	    if (hisopts[c]) {
-		hisopts[c] = 0;
+	    if (net->hisopts[c]) {
+		net->hisopts[c] = 0;
 		dont_opt[2] = c;
 		net_rawout(dont_opt, sizeof(dont_opt));
 		vtrace("SENT %s %s\n", cmd(DONT), opt(c));
 		check_in3270();
 	    }
-	    telnet_state = TNS_DATA;
+	    net->telnet_state = TNS_DATA;
 	    break;
 	case TNS_DO:	/* telnet PLEASE DO OPTION command */
 	    vtrace("%s\n", opt(c));
@@ -741,12 +822,12 @@ telnet_fsm(unsigned char c)
 	    case TELOPT_TN3270E:
 	    case TELOPT_STARTTLS:
 		if (c == TELOPT_STARTTLS && !sio_supported()) {
-		    refused_tls = true;
+		    net->refused_tls = true;
 		    goto wont;
 		}
-		if (!myopts[c]) {
+		if (!net->myopts[c]) {
 		    if (c != TELOPT_TM) {
-			myopts[c] = 1;
+			net->myopts[c] = 1;
 		    }
 		    will_opt[2] = c;
 		    net_rawout(will_opt, sizeof(will_opt));
@@ -767,7 +848,7 @@ telnet_fsm(unsigned char c)
 			    cmd(SB),
 			    opt(TELOPT_STARTTLS),
 			    cmd(SE));
-		    need_tls_follows = true;
+		    net->need_tls_follows = true;
 		}
 		break;
 	    wont:
@@ -777,50 +858,50 @@ telnet_fsm(unsigned char c)
 		vtrace("SENT %s %s\n", cmd(WONT), opt(c));
 		break;
 	    }
-	    telnet_state = TNS_DATA;
+	    net->telnet_state = TNS_DATA;
 	    break;
 	case TNS_DONT:	/* telnet PLEASE DON'T DO OPTION command */
 	    vtrace("%s\n", opt(c));
-	    if (myopts[c]) {
-		myopts[c] = 0;
+	    if (net->myopts[c]) {
+		net->myopts[c] = 0;
 		wont_opt[2] = c;
 		net_rawout(wont_opt, sizeof(wont_opt));
 		vtrace("SENT %s %s\n", cmd(WONT), opt(c));
 		check_in3270();
 	    }
-	    telnet_state = TNS_DATA;
+	    net->telnet_state = TNS_DATA;
 	    break;
 	case TNS_SB:	/* telnet sub-option string command */
 	    if (c == IAC) {
-		telnet_state = TNS_SB_IAC;
+		net->telnet_state = TNS_SB_IAC;
 	    } else {
-		*sbptr++ = c;
+		*net->sbptr++ = c;
 	    }
 	    break;
 	case TNS_SB_IAC:	/* telnet sub-option string command */
-	    *sbptr++ = c;
+	    *net->sbptr++ = c;
 	    if (c == SE) {
-		telnet_state = TNS_DATA;
-		if (sbbuf[0] == TELOPT_TTYPE &&
-		    sbbuf[1] == TELQUAL_SEND) {
+		net->telnet_state = TNS_DATA;
+		if (net->sbbuf[0] == TELOPT_TTYPE &&
+		    net->sbbuf[1] == TELQUAL_SEND) {
 		    size_t tt_len, tb_len;
 		    char *tt_out;
 
-		    vtrace("%s %s\n", opt(sbbuf[0]), telquals[sbbuf[1]]);
+		    vtrace("%s %s\n", opt(net->sbbuf[0]), telquals[net->sbbuf[1]]);
 
-		    if (lus != NULL &&
-			try_assoc == NULL &&
-			try_lu == NULL) {
+		    if (net->lus != NULL &&
+			net->try_assoc == NULL &&
+			net->try_lu == NULL) {
 			/* None of the LUs worked. */
 			errmsg("Cannot connect to specified LU");
 			return false;
 		    }
 		    tt_len = strlen(termtype);
-		    if (try_lu != NULL && *try_lu) {
-			tt_len += strlen(try_lu) + 1;
-			connected_lu = try_lu;
+		    if (net->try_lu != NULL && *net->try_lu) {
+			tt_len += strlen(net->try_lu) + 1;
+			net->connected_lu = net->try_lu;
 		    } else {
-			connected_lu = NULL;
+			net->connected_lu = NULL;
 		    }
 
 		    tb_len = 4 + tt_len + 2;
@@ -828,8 +909,8 @@ telnet_fsm(unsigned char c)
 		    sprintf(tt_out, "%c%c%c%c%s%s%s%c%c",
 			    IAC, SB, TELOPT_TTYPE, TELQUAL_IS,
 			    termtype,
-			    (try_lu != NULL && *try_lu) ? "@" : "",
-			    (try_lu != NULL && *try_lu) ? try_lu : "",
+			    (net->try_lu != NULL && *net->try_lu) ? "@" : "",
+			    (net->try_lu != NULL && *net->try_lu) ? net->try_lu : "",
 			    IAC, SE);
 		    net_rawout((unsigned char *)tt_out, tb_len);
 
@@ -842,20 +923,20 @@ telnet_fsm(unsigned char c)
 
 		    /* Advance to the next LU name. */
 		    next_lu();
-		} else if (myopts[TELOPT_TN3270E] &&
-			   sbbuf[0] == TELOPT_TN3270E) {
+		} else if (net->myopts[TELOPT_TN3270E] &&
+			   net->sbbuf[0] == TELOPT_TN3270E) {
 		    if (tn3270e_negotiate()) {
 			return false;
 		    }
-		} else if (need_tls_follows &&
-				myopts[TELOPT_STARTTLS] &&
-				sbbuf[0] == TELOPT_STARTTLS) {
-		    if (continue_tls(sbbuf, (int)(sbptr - sbbuf)) < 0) {
+		} else if (net->need_tls_follows &&
+				net->myopts[TELOPT_STARTTLS] &&
+				net->sbbuf[0] == TELOPT_STARTTLS) {
+		    if (continue_tls(net->sbbuf, (int)(net->sbptr - net->sbbuf)) < 0) {
 			return false;
 		    }
 		}
 	    } else {
-		telnet_state = TNS_SB;
+		net->telnet_state = TNS_SB;
 	    }
 	    break;
     }
@@ -872,10 +953,10 @@ tn3270e_request(void)
     char *t;
 
     tt_len = strlen(termtype);
-    if (try_assoc != NULL) {
-	tt_len += strlen(try_assoc) + 1;
-    } else if (try_lu != NULL && *try_lu) {
-	tt_len += strlen(try_lu) + 1;
+    if (net->try_assoc != NULL) {
+	tt_len += strlen(net->try_assoc) + 1;
+    } else if (net->try_lu != NULL && *net->try_lu) {
+	tt_len += strlen(net->try_lu) + 1;
     }
 
     tb_len = 5 + tt_len + 2;
@@ -885,10 +966,10 @@ tn3270e_request(void)
 	    IAC, SB, TELOPT_TN3270E, TN3270E_OP_DEVICE_TYPE,
 	    TN3270E_OP_REQUEST, termtype);
 
-    if (try_assoc != NULL) {
-	t += sprintf(t, "%c%s", TN3270E_OP_ASSOCIATE, try_assoc);
-    } else if (try_lu != NULL && *try_lu) {
-	t += sprintf(t, "%c%s", TN3270E_OP_CONNECT, try_lu);
+    if (net->try_assoc != NULL) {
+	t += sprintf(t, "%c%s", TN3270E_OP_ASSOCIATE, net->try_assoc);
+    } else if (net->try_lu != NULL && *net->try_lu) {
+	t += sprintf(t, "%c%s", TN3270E_OP_CONNECT, net->try_lu);
     }
 
     sprintf(t, "%c%c", IAC, SE);
@@ -897,10 +978,10 @@ tn3270e_request(void)
 
     vtrace("SENT %s %s DEVICE-TYPE REQUEST %.*s%s%s%s%s %s\n",
 	    cmd(SB), opt(TELOPT_TN3270E), strlen(termtype), tt_out + 5,
-	    (try_assoc != NULL) ? " ASSOCIATE " : "",
-	    (try_assoc != NULL) ? try_assoc : "",
-	    (try_lu != NULL && *try_lu) ? " CONNECT " : "",
-	    (try_lu != NULL && *try_lu) ? try_lu : "",
+	    (net->try_assoc != NULL) ? " ASSOCIATE " : "",
+	    (net->try_assoc != NULL) ? net->try_assoc : "",
+	    (net->try_lu != NULL && *net->try_lu) ? " CONNECT " : "",
+	    (net->try_lu != NULL && *net->try_lu) ? net->try_lu : "",
 	    cmd(SE));
 
     Free(tt_out);
@@ -913,33 +994,30 @@ tn3270e_request(void)
 static int
 tn3270e_negotiate(void)
 {
-#define LU_MAX	32
-    static char reported_lu[LU_MAX + 1];
-    static char reported_type[LU_MAX + 1];
     int sblen;
     unsigned long e_rcvd;
 
     /* Find out how long the subnegotiation buffer is. */
     for (sblen = 0; ; sblen++) {
-	if (sbbuf[sblen] == SE) {
+	if (net->sbbuf[sblen] == SE) {
 	    break;
 	}
     }
 
     vtrace("TN3270E ");
 
-    switch (sbbuf[1]) {
+    switch (net->sbbuf[1]) {
 
     case TN3270E_OP_SEND:
 
-	if (sbbuf[2] == TN3270E_OP_DEVICE_TYPE) {
+	if (net->sbbuf[2] == TN3270E_OP_DEVICE_TYPE) {
 
 	    /* Host wants us to send our device type. */
 	    vtrace("SEND DEVICE-TYPE SE\n");
 
 	    tn3270e_request();
 	} else {
-	    vtrace("SEND ??%u SE\n", sbbuf[2]);
+	    vtrace("SEND ??%u SE\n", net->sbbuf[2]);
 	}
 	break;
 
@@ -948,7 +1026,7 @@ tn3270e_negotiate(void)
 	/* Device type negotiation. */
 	vtrace("DEVICE-TYPE ");
 
-	switch (sbbuf[2]) {
+	switch (net->sbbuf[2]) {
 	case TN3270E_OP_IS: {
 	    int tnlen, snlen;
 
@@ -956,40 +1034,40 @@ tn3270e_negotiate(void)
 
 	    /* Isolate the terminal type and session. */
 	    tnlen = 0;
-	    while (sbbuf[3 + tnlen] != SE &&
-		   sbbuf[3 + tnlen] != TN3270E_OP_CONNECT) {
+	    while (net->sbbuf[3 + tnlen] != SE &&
+		   net->sbbuf[3 + tnlen] != TN3270E_OP_CONNECT) {
 		tnlen++;
 	    }
 	    snlen = 0;
-	    if (sbbuf[3 + tnlen] == TN3270E_OP_CONNECT) {
-		while(sbbuf[3 + tnlen+1+snlen] != SE) {
+	    if (net->sbbuf[3 + tnlen] == TN3270E_OP_CONNECT) {
+		while(net->sbbuf[3 + tnlen+1+snlen] != SE) {
 		    snlen++;
 		}
 	    }
 	    vtrace("IS %.*s CONNECT %.*s SE\n",
-		    tnlen, &sbbuf[3],
-		    snlen, &sbbuf[3 + tnlen+1]);
+		    tnlen, &net->sbbuf[3],
+		    snlen, &net->sbbuf[3 + tnlen+1]);
 
 	    /* Remember the LU. */
 	    if (tnlen) {
 		if (tnlen > LU_MAX) {
 		    tnlen = LU_MAX;
 		}
-		strncpy(reported_type, (char *)&sbbuf[3], tnlen);
-		    reported_type[tnlen] = '\0';
-		    connected_type = reported_type;
+		strncpy(net->reported_type, (char *)&net->sbbuf[3], tnlen);
+		    net->reported_type[tnlen] = '\0';
+		    net->connected_type = net->reported_type;
 	    }
 	    if (snlen) {
 		if (snlen > LU_MAX) {
 		    snlen = LU_MAX;
 		}
-		strncpy(reported_lu, (char *)&sbbuf[3 + tnlen + 1], snlen);
-		reported_lu[snlen] = '\0';
-		connected_lu = reported_lu;
+		strncpy(net->reported_lu, (char *)&net->sbbuf[3 + tnlen + 1], snlen);
+		net->reported_lu[snlen] = '\0';
+		net->connected_lu = net->reported_lu;
 	    }
 
 	    /* Tell them what we can do. */
-	    tn3270e_subneg_send(TN3270E_OP_REQUEST, e_funcs);
+	    tn3270e_subneg_send(TN3270E_OP_REQUEST, net->e_funcs);
 	    break;
 	    }
 
@@ -997,29 +1075,29 @@ tn3270e_negotiate(void)
 
 	    /* Device type failure. */
 
-	    vtrace("REJECT REASON %s SE\n", rsn(sbbuf[4]));
+	    vtrace("REJECT REASON %s SE\n", rsn(net->sbbuf[4]));
 
-	    if (try_assoc != NULL) {
-		errmsg("Cannot associate with specified LU: %s", rsn(sbbuf[4]));
+	    if (net->try_assoc != NULL) {
+		errmsg("Cannot associate with specified LU: %s", rsn(net->sbbuf[4]));
 		return -1;
 	    }
 	    next_lu();
-	    if (try_lu != NULL) {
+	    if (net->try_lu != NULL) {
 		/* Try the next LU. */
 		tn3270e_request();
-	    } else if (lus != NULL) {
+	    } else if (net->lus != NULL) {
 		/* No more LUs to try.  Give up. */
-		errmsg("Cannot connect to specified LU: %s", rsn(sbbuf[4]));
+		errmsg("Cannot connect to specified LU: %s", rsn(net->sbbuf[4]));
 		return -1;
 	    } else {
 		errmsg("Device type rejected, cannot connect: %s",
-			rsn(sbbuf[4]));
+			rsn(net->sbbuf[4]));
 		return -1;
 	    }
 
 	    break;
 	default:
-	    vtrace("??%u SE\n", sbbuf[2]);
+	    vtrace("??%u SE\n", net->sbbuf[2]);
 	    break;
 	}
 	break;
@@ -1029,20 +1107,20 @@ tn3270e_negotiate(void)
 	/* Functions negotiation. */
 	vtrace("FUNCTIONS ");
 
-	switch (sbbuf[2]) {
+	switch (net->sbbuf[2]) {
 
 	case TN3270E_OP_REQUEST:
 
 	    /* Host is telling us what functions they want. */
 	    vtrace("REQUEST %s SE\n",
-		    tn3270e_function_names(sbbuf + 3, sblen - 3));
+		    tn3270e_function_names(net->sbbuf + 3, sblen - 3));
 
-	    e_rcvd = tn3270e_fdecode(sbbuf + 3, sblen - 3);
-	    if ((e_rcvd == e_funcs) || (e_funcs & ~e_rcvd)) {
+	    e_rcvd = tn3270e_fdecode(net->sbbuf + 3, sblen - 3);
+	    if ((e_rcvd == net->e_funcs) || (net->e_funcs & ~e_rcvd)) {
 		/* They want what we want, or less.  Done. */
-		e_funcs = e_rcvd;
-		tn3270e_subneg_send(TN3270E_OP_IS, e_funcs);
-		tn3270e_negotiated = 1;
+		net->e_funcs = e_rcvd;
+		tn3270e_subneg_send(TN3270E_OP_IS, net->e_funcs);
+		net->tn3270e_negotiated = 1;
 		vtrace("TN3270E option negotiation complete.\n");
 		check_in3270();
 	    } else {
@@ -1050,20 +1128,20 @@ tn3270e_negotiate(void)
 		 * They want us to do something we can't.
 		 * Request the common subset.
 		 */
-		e_funcs &= e_rcvd;
-		tn3270e_subneg_send(TN3270E_OP_REQUEST, e_funcs);
+		net->e_funcs &= e_rcvd;
+		tn3270e_subneg_send(TN3270E_OP_REQUEST, net->e_funcs);
 	    }
 	    break;
 
 	case TN3270E_OP_IS:
 
 	    /* They accept our last request. */
-	    vtrace("IS %s SE\n", tn3270e_function_names(sbbuf + 3, sblen - 3));
-	    e_rcvd = tn3270e_fdecode(sbbuf + 3, sblen - 3);
-	    if (e_rcvd != e_funcs) {
-		if (e_funcs & ~e_rcvd) {
+	    vtrace("IS %s SE\n", tn3270e_function_names(net->sbbuf + 3, sblen - 3));
+	    e_rcvd = tn3270e_fdecode(net->sbbuf + 3, sblen - 3);
+	    if (e_rcvd != net->e_funcs) {
+		if (net->e_funcs & ~e_rcvd) {
 		    /* They've removed something.  Fine. */
-		    e_funcs &= e_rcvd;
+		    net->e_funcs &= e_rcvd;
 		} else {
 		    /*
 		     * They've added something.  Abandon
@@ -1074,24 +1152,24 @@ tn3270e_negotiate(void)
 		    wont_opt[2] = TELOPT_TN3270E;
 		    net_rawout(wont_opt, sizeof(wont_opt));
 		    vtrace("SENT %s %s\n", cmd(WONT), opt(TELOPT_TN3270E));
-		    myopts[TELOPT_TN3270E] = 0;
+		    net->myopts[TELOPT_TN3270E] = 0;
 		    check_in3270();
 		    break;
 		}
 	    }
-	    tn3270e_negotiated = 1;
+	    net->tn3270e_negotiated = 1;
 	    vtrace("TN3270E option negotiation complete.\n");
 	    check_in3270();
 	    break;
 
 	default:
-	    vtrace("??%u SE\n", sbbuf[2]);
+	    vtrace("??%u SE\n", net->sbbuf[2]);
 	    break;
 	}
 	break;
 
     default:
-	vtrace("??%u SE\n", sbbuf[1]);
+	vtrace("??%u SE\n", net->sbbuf[1]);
     }
 
     /* Good enough for now. */
@@ -1167,12 +1245,12 @@ process_eor(void)
 {
     enum pds rv;
 
-    if (syncing || !(ibptr - ibuf)) {
+    if (net->syncing || !(net->ibptr - net->ibuf)) {
 	return;
     }
 
     if (IN_E) {
-	tn3270e_header *h = (tn3270e_header *)ibuf;
+	tn3270e_header *h = (tn3270e_header *)net->ibuf;
 
 	vtrace("RCVD TN3270E(%s%s %s %u)\n",
 		e_dt(h->data_type),
@@ -1183,42 +1261,43 @@ process_eor(void)
 	switch (h->data_type) {
 	case TN3270E_DT_3270_DATA:
 	case TN3270E_DT_SCS_DATA:
-	    if ((e_funcs & E_OPT(TN3270E_FUNC_BIND_IMAGE)) && !tn3270e_bound) {
+	    if ((net->e_funcs & E_OPT(TN3270E_FUNC_BIND_IMAGE)) &&
+		    !net->tn3270e_bound) {
 		return;
 	    }
-	    tn3270e_submode = E_3270;
+	    net->tn3270e_submode = E_3270;
 	    check_in3270();
-	    response_required = h->response_flag;
+	    net->response_required = h->response_flag;
 	    if (h->data_type == TN3270E_DT_3270_DATA) {
-		rv = process_ds(ibuf + EH_SIZE, (ibptr - ibuf) - EH_SIZE);
+		rv = process_ds(net->ibuf + EH_SIZE, (net->ibptr - net->ibuf) - EH_SIZE);
 	    } else {
-		rv = process_scs(ibuf + EH_SIZE, (ibptr - ibuf) - EH_SIZE);
+		rv = process_scs(net->ibuf + EH_SIZE, (net->ibptr - net->ibuf) - EH_SIZE);
 	    }
-	    if (rv < 0 && response_required != TN3270E_RSF_NO_RESPONSE) {
+	    if (rv < 0 && net->response_required != TN3270E_RSF_NO_RESPONSE) {
 		tn3270e_nak(rv);
 	    } else if (rv == PDS_OKAY_NO_OUTPUT &&
-		    response_required == TN3270E_RSF_ALWAYS_RESPONSE) {
+		    net->response_required == TN3270E_RSF_ALWAYS_RESPONSE) {
 		tn3270e_ack();
 	    }
-	    response_required = TN3270E_RSF_NO_RESPONSE;
+	    net->response_required = TN3270E_RSF_NO_RESPONSE;
 	    return;
 	case TN3270E_DT_BIND_IMAGE:
-	    if (!(e_funcs & E_OPT(TN3270E_FUNC_BIND_IMAGE))) {
+	    if (!(net->e_funcs & E_OPT(TN3270E_FUNC_BIND_IMAGE))) {
 		return;
 	    }
-	    tn3270e_bound = 1;
+	    net->tn3270e_bound = 1;
 	    check_in3270();
 	    if (h->response_flag) {
 		tn3270e_ack();
 	    }
 	    return;
 	case TN3270E_DT_UNBIND:
-	    if (!(e_funcs & E_OPT(TN3270E_FUNC_BIND_IMAGE))) {
+	    if (!(net->e_funcs & E_OPT(TN3270E_FUNC_BIND_IMAGE))) {
 		return;
 	    }
-	    tn3270e_bound = 0;
-	    if (tn3270e_submode == E_3270) {
-		tn3270e_submode = E_NONE;
+	    net->tn3270e_bound = 0;
+	    if (net->tn3270e_submode == E_3270) {
+		net->tn3270e_submode = E_NONE;
 	    }
 	    check_in3270();
 	    if (print_eoj() == 0) {
@@ -1261,7 +1340,7 @@ process_eor(void)
 	}
     } else {
 	/* Plain old 3270 mode. */
-	rv = process_ds(ibuf, ibptr - ibuf);
+	rv = process_ds(net->ibuf, net->ibptr - net->ibuf);
 	if (rv < 0) {
 	    tn3270_nak(rv);
 	} else {
@@ -1279,8 +1358,8 @@ void
 net_exception(void)
 {
     trace_str("RCVD urgent data indication\n");
-    if (!syncing) {
-	syncing = 1;
+    if (!net->syncing) {
+	net->syncing = 1;
     }
 }
 
@@ -1316,31 +1395,31 @@ net_rawout(unsigned const char *buf, size_t len)
 #else
 #	define n2w len
 #endif
-	if (sio != NULL) {
-	    nw = sio_write(sio, (const char *)buf, (int)n2w);
+	if (net->sio != NULL) {
+	    nw = sio_write(net->sio, (const char *)buf, (int)n2w);
 	} else {
-	    nw = send(sock, (const char *) buf, (int)n2w, 0);
+	    nw = send(net->sock, (const char *) buf, (int)n2w, 0);
 	}
 	if (nw < 0) {
-	    if (sio != NULL) {
+	    if (net->sio != NULL) {
 		vtrace("RCVD socket error: %s\n", sio_last_error());
 		errmsg("%s\n", sio_last_error());
-		cstate = NOT_CONNECTED;
+		net->cstate = NOT_CONNECTED;
 		return;
 	    }
 	    vtrace("RCVD socket error %s\n", sockerrmsg());
 	    if (socket_errno() == SE_EPIPE || socket_errno() == SE_ECONNRESET) {
-		cstate = NOT_CONNECTED;
+		net->cstate = NOT_CONNECTED;
 		return;
 	    } else if (socket_errno() == SE_EINTR) {
 		goto bot;
 	    } else {
 		popup_a_sockerr("Socket write");
-		cstate = NOT_CONNECTED;
+		net->cstate = NOT_CONNECTED;
 		return;
 	    }
 	}
-	ns_bsent += nw;
+	net->ns_bsent += nw;
 	len -= nw;
 	buf += nw;
 	bot:
@@ -1373,11 +1452,11 @@ check_in3270(void)
 	"TN3270E 3270"
     };
 
-    if (myopts[TELOPT_TN3270E]) {
-	if (!tn3270e_negotiated) {
+    if (net->myopts[TELOPT_TN3270E]) {
+	if (!net->tn3270e_negotiated) {
 	    new_cstate = CONNECTED_INITIAL_E;
 	} else {
-	    switch (tn3270e_submode) {
+	    switch (net->tn3270e_submode) {
 	    case E_NONE:
 		new_cstate = CONNECTED_INITIAL_E;
 		break;
@@ -1386,43 +1465,43 @@ check_in3270(void)
 		break;
 	    case E_3270:
 		new_cstate = CONNECTED_TN3270E;
-		ever_3270 = true;
+		net->ever_3270 = true;
 		break;
 	    case E_SSCP:
 		new_cstate = CONNECTED_SSCP;
 		break;
 	    }
 	}
-    } else if (myopts[TELOPT_BINARY] &&
-	       myopts[TELOPT_EOR] &&
-	       myopts[TELOPT_TTYPE] &&
-	       hisopts[TELOPT_BINARY] &&
-	       hisopts[TELOPT_EOR]) {
+    } else if (net->myopts[TELOPT_BINARY] &&
+	       net->myopts[TELOPT_EOR] &&
+	       net->myopts[TELOPT_TTYPE] &&
+	       net->hisopts[TELOPT_BINARY] &&
+	       net->hisopts[TELOPT_EOR]) {
 	new_cstate = CONNECTED_3270;
-	ever_3270 = true;
-    } else if (cstate == CONNECTED_INITIAL) {
+	net->ever_3270 = true;
+    } else if (net->cstate == CONNECTED_INITIAL) {
 	/* Nothing has happened, yet. */
 	return;
     } else {
 	new_cstate = CONNECTED_NVT;
     }
 
-    if (new_cstate != cstate) {
+    if (new_cstate != net->cstate) {
 	int was_in_e = IN_E;
 
 	vtrace("Now operating in %s mode.\n", state_name[new_cstate]);
-	cstate =  new_cstate;
+	net->cstate =  new_cstate;
 
 	/*
 	 * If the user specified an association, and the host has
 	 * entered TELNET NVT mode or TN3270 (non-TN3270E) mode,
 	 * give up.
 	 */
-	if (try_assoc != NULL && !IN_E) {
+	if (net->try_assoc != NULL && !IN_E) {
 	    errmsg("Host does not support TN3270E, cannot associate with "
 		    "specified LU");
-	    /* No return value, gotta abort here. */
-	    pr3287_exit(1);
+	    /* No return value; pr_net_input() will give up. */
+	    net->fatal = true;
 	}
 
 	/*
@@ -1430,23 +1509,23 @@ check_in3270(void)
 	 * TN3270E state, reset the LU list so we can try again
 	 * in the new mode.
 	 */
-	if (lus != NULL && was_in_e != IN_E) {
-	    curr_lu = lus;
-	    try_lu = *curr_lu;
+	if (net->lus != NULL && was_in_e != IN_E) {
+	    net->curr_lu = net->lus;
+	    net->try_lu = *net->curr_lu;
 	}
 
 	/* Allocate the initial 3270 input buffer. */
-	if (new_cstate >= CONNECTED_INITIAL && !ibuf_size) {
-	    ibuf = (unsigned char *)Malloc(BUFSIZ);
-	    ibuf_size = BUFSIZ;
-	    ibptr = ibuf;
+	if (new_cstate >= CONNECTED_INITIAL && !net->ibuf_size) {
+	    net->ibuf = (unsigned char *)Malloc(BUFSIZ);
+	    net->ibuf_size = BUFSIZ;
+	    net->ibptr = net->ibuf;
 	}
 
 	/* If we fell out of TN3270E, remove the state. */
-	if (!myopts[TELOPT_TN3270E]) {
-	    tn3270e_negotiated = 0;
-	    tn3270e_submode = E_NONE;
-	    tn3270e_bound = 0;
+	if (!net->myopts[TELOPT_TN3270E]) {
+	    net->tn3270e_negotiated = 0;
+	    net->tn3270e_submode = E_NONE;
+	    net->tn3270e_bound = 0;
 	}
     }
 }
@@ -1459,12 +1538,12 @@ check_in3270(void)
 static void
 store3270in(unsigned char c)
 {
-    if (ibptr - ibuf >= ibuf_size) {
-	ibuf_size += BUFSIZ;
-	ibuf = (unsigned char *)Realloc((char *)ibuf, ibuf_size);
-	ibptr = ibuf + ibuf_size - BUFSIZ;
+    if (net->ibptr - net->ibuf >= net->ibuf_size) {
+	net->ibuf_size += BUFSIZ;
+	net->ibuf = (unsigned char *)Realloc((char *)net->ibuf, net->ibuf_size);
+	net->ibptr = net->ibuf + net->ibuf_size - BUFSIZ;
     }
-    *ibptr++ = c;
+    *net->ibptr++ = c;
 }
 
 /*
@@ -1555,11 +1634,11 @@ trace_netdata(char direction, unsigned const char *buf, size_t len)
     }
     gettimeofday(&ts, NULL);
     if (IN_3270) {
-	double tdiff = ((1.0e6 * (double)(ts.tv_sec - ds_ts.tv_sec)) +
-		(double)(ts.tv_usec - ds_ts.tv_usec)) / 1.0e6;
+	double tdiff = ((1.0e6 * (double)(ts.tv_sec - net->ds_ts.tv_sec)) +
+		(double)(ts.tv_usec - net->ds_ts.tv_usec)) / 1.0e6;
 	vtrace_nts("%c +%gs\n", direction, tdiff);
     }
-    ds_ts = ts;
+    net->ds_ts = ts;
     for (offset = 0; offset < len; offset++) {
 	if (!(offset % LINEDUMP_MAX)) {
 	    vtrace_nts("%s%c 0x%-3x ",
@@ -1585,9 +1664,9 @@ net_output(void)
 	tn3270e_header *h = (tn3270e_header *)obuf_base;
 
 	/* Check for sending a TN3270E response. */
-	if (response_required == TN3270E_RSF_ALWAYS_RESPONSE) {
+	if (net->response_required == TN3270E_RSF_ALWAYS_RESPONSE) {
 	    tn3270e_ack();
-	    response_required = TN3270E_RSF_NO_RESPONSE;
+	    net->response_required = TN3270E_RSF_NO_RESPONSE;
 	}
 
 	/* Set the outbound TN3270E header. */
@@ -1595,8 +1674,8 @@ net_output(void)
 		TN3270E_DT_3270_DATA : TN3270E_DT_SSCP_LU_DATA;
 	h->request_flag = 0;
 	h->response_flag = 0;
-	h->seq_number[0] = (e_xmit_seq >> 8) & 0xff;
-	h->seq_number[1] = e_xmit_seq & 0xff;
+	h->seq_number[0] = (net->e_xmit_seq >> 8) & 0xff;
+	h->seq_number[1] = net->e_xmit_seq & 0xff;
     }
 
     /* Count the number of IACs in the message. */
@@ -1634,15 +1713,15 @@ net_output(void)
     *obptr++ = EOR;
     if (IN_TN3270E || IN_SSCP) {
 	vtrace("SENT TN3270E(%s NO-RESPONSE %u)\n",
-		IN_TN3270E ? "3270-DATA" : "SSCP-LU-DATA", e_xmit_seq);
-	if (e_funcs & E_OPT(TN3270E_FUNC_RESPONSES)) {
-	    e_xmit_seq = (e_xmit_seq + 1) & 0x7fff;
+		IN_TN3270E ? "3270-DATA" : "SSCP-LU-DATA", net->e_xmit_seq);
+	if (net->e_funcs & E_OPT(TN3270E_FUNC_RESPONSES)) {
+	    net->e_xmit_seq = (net->e_xmit_seq + 1) & 0x7fff;
 	}
     }
     net_rawout(BSTART, obptr - BSTART);
 
     trace_str("SENT EOR\n");
-    ns_rsent++;
+    net->ns_rsent++;
 #undef BSTART
 }
 
@@ -1712,7 +1791,7 @@ tn3270e_ack(void)
     int rsp_len = EH_SIZE;
 
     h = (tn3270e_header *)rsp_buf;
-    h_in = (tn3270e_header *)ibuf;
+    h_in = (tn3270e_header *)net->ibuf;
 
     h->data_type = TN3270E_DT_RESPONSE;
     h->request_flag = 0;
@@ -1739,7 +1818,7 @@ tn3270e_nak(enum pds rv)
     int rsp_len = EH_SIZE;
 
     h = (tn3270e_header *)rsp_buf;
-    h_in = (tn3270e_header *)ibuf;
+    h_in = (tn3270e_header *)net->ibuf;
 
     h->data_type = TN3270E_DT_RESPONSE;
     h->request_flag = 0;
@@ -1790,18 +1869,18 @@ tn3270e_cleared(void)
     h->data_type = TN3270E_OP_REQUEST;
     h->request_flag = TN3270E_RQF_ERR_COND_CLEARED;
     h->response_flag = 0;
-    h->seq_number[0] = (e_xmit_seq >> 8) & 0xff;
-    h->seq_number[1] = e_xmit_seq & 0xff;
+    h->seq_number[0] = (net->e_xmit_seq >> 8) & 0xff;
+    h->seq_number[1] = net->e_xmit_seq & 0xff;
 
     if (h->seq_number[1] == IAC) {
 	rsp_buf[rsp_len++] = IAC;
     }
     rsp_buf[rsp_len++] = IAC;
     rsp_buf[rsp_len++] = EOR;
-    vtrace("SENT TN3270E(REQUEST ERR-COND-CLEARED %u)\n", e_xmit_seq);
+    vtrace("SENT TN3270E(REQUEST ERR-COND-CLEARED %u)\n", net->e_xmit_seq);
     net_rawout(rsp_buf, rsp_len);
 
-    e_xmit_seq = (e_xmit_seq + 1) & 0x7fff;
+    net->e_xmit_seq = (net->e_xmit_seq + 1) & 0x7fff;
 }
 
 /* Add a dummy TN3270E header to the output buffer. */
@@ -1810,14 +1889,14 @@ net_add_dummy_tn3270e(void)
 {
     tn3270e_header *h;
 
-    if (!IN_E || tn3270e_submode == E_NONE) {
+    if (!IN_E || net->tn3270e_submode == E_NONE) {
 	return false;
     }
 
     space3270out(EH_SIZE);
     h = (tn3270e_header *)obptr;
 
-    switch (tn3270e_submode) {
+    switch (net->tn3270e_submode) {
     case E_NONE:
 	break;
     case E_NVT:
@@ -1856,7 +1935,7 @@ continue_tls(unsigned char *sbbuf, int len)
     char *session, *cert;
 
     /* Whatever happens, we're not expecting another SB STARTTLS. */
-    need_tls_follows = false;
+    net->need_tls_follows = false;
 
     /* Make sure the option is FOLLOWS. */
     if (len < 2 || sbbuf[1] != TLS_FOLLOWS) {
@@ -1870,20 +1949,21 @@ continue_tls(unsigned char *sbbuf, int len)
     vtrace("%s FOLLOWS %s\n", opt(TELOPT_STARTTLS), cmd(SE));
 
     /* Initialize the TLS library. */
-    if (sio_init(&options.tls, NULL, &sio) != SI_SUCCESS) {
+    if (sio_init(net->tls, NULL, &net->sio) != SI_SUCCESS) {
 	errmsg("%s\n", sio_last_error());
 	return -1;
     }
-    if (sio_negotiate(sio, sock, hostname, &data) != SIG_SUCCESS) {
+    if (sio_negotiate(net->sio, net->sock, net->hostname, &data) !=
+	    SIG_SUCCESS) {
 	errmsg("%s\n", sio_last_error());
 	return -1;
     }
 
-    secure_connection = true;
+    net->secure_connection = true;
 
     /* Success. */
-    session = indent_s(sio_session_info(sio));
-    cert = indent_s(sio_server_cert_info(sio));
+    session = indent_s(sio_session_info(net->sio));
+    cert = indent_s(sio_server_cert_info(net->sio));
     vtrace("TLS negotiated connection complete.  "
 	      "Connection is now secure.\n"
 	      "Session:\n%s\nServer certificate:\n%s\n",
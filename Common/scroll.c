@@ -57,8 +57,43 @@ bool	scroll_initted = false;
 
 /* Statics */
 
-/* Saved screens. */
-static struct ea **ea_save = (struct ea **) NULL;
+/*
+ * Saved rows are kept in compressed form: a run-length encoded list of
+ * attribute runs, followed by the EBCDIC codes and Unicode values up to the
+ * last non-zero one in the row. A row that is entirely default cells is
+ * represented by a single shared copy.
+ */
+typedef struct {
+    unsigned short count;	/* number of cells in this run */
+    unsigned char fa;		/* attributes common to the run */
+    unsigned char fg;
+    unsigned char bg;
+    unsigned char gr;
+    unsigned char cs;
+    unsigned char ic;
+    unsigned char db;
+} srun_t;
+
+typedef struct {
+    unsigned short n_runs;	/* number of attribute runs */
+    unsigned short n_ec;	/* number of EBCDIC codes stored */
+    unsigned short n_ucs4;	/* number of Unicode values stored */
+    unsigned short pad;
+    /* followed by n_ucs4 ucs4_t's, n_runs srun_t's, n_ec bytes */
+} srow_t;
+#define SROW_UCS4(r)	((ucs4_t *)((r) + 1))
+#define SROW_RUNS(r)	((srun_t *)(SROW_UCS4(r) + (r)->n_ucs4))
+#define SROW_EC(r)	((unsigned char *)(SROW_RUNS(r) + (r)->n_runs))
+
+/* Saved rows. NULL means a row of zeroes. */
+static srow_t **row_save = NULL;
+static int	n_row_save = 0;
+
+/* Shared row of default cells. */
+static srow_t  *blank_row = NULL;
+
+/* Saved screen image, maxROWS * maxCOLS cells. */
+static struct ea *image_save = NULL;
 
 /* Number of lines saved. */
 static int      n_saved = 0;
@@ -67,10 +102,8 @@ static int      scroll_next = 0;
 static int      scrolled_back = 0;
 static bool  need_saving = true;
 static bool  vscreen_swapped = false;
-static char    *sbuf = NULL;
-static int      sa_bufsize;
-static char    *zbuf = NULL;
 static struct ea *defaults_buf = NULL;
+static struct ea *row_buf = NULL;
 
 /* Thumb state: */
 /*   Fraction of blank area above thumb (0.0 to 1.0) */
@@ -90,6 +123,146 @@ static void sync_scroll(int sb);
 static void save_image(void);
 static void scroll_reset(void);
 
+/*
+ * Test two cells for matching attributes.
+ */
+static bool
+same_attrs(const struct ea *a, const struct ea *b)
+{
+    return a->fa == b->fa && a->fg == b->fg && a->bg == b->bg &&
+	a->gr == b->gr && a->cs == b->cs && a->ic == b->ic && a->db == b->db;
+}
+
+/*
+ * Compress a row of <ncols> cells.
+ */
+static srow_t *
+srow_compress(const struct ea *ea, int ncols)
+{
+    int i;
+    int n_runs = 0;
+    int n_ec = 0;
+    int n_ucs4 = 0;
+    srow_t *r;
+    srun_t *run = NULL;
+    unsigned char *ec;
+    ucs4_t *ucs4;
+
+    for (i = 0; i < ncols; i++) {
+	if (i == 0 || !same_attrs(&ea[i], &ea[i - 1])) {
+	    n_runs++;
+	}
+	if (ea[i].ec) {
+	    n_ec = i + 1;
+	}
+	if (ea[i].ucs4) {
+	    n_ucs4 = i + 1;
+	}
+    }
+
+    /* Share the default row. */
+    if (blank_row != NULL && n_runs == 1 && !n_ec && !n_ucs4 &&
+	    same_attrs(ea, defaults_buf)) {
+	return blank_row;
+    }
+
+    r = (srow_t *)Malloc(sizeof(srow_t) + (n_ucs4 * sizeof(ucs4_t)) +
+	    (n_runs * sizeof(srun_t)) + n_ec);
+    r->n_runs = n_runs;
+    r->n_ec = n_ec;
+    r->n_ucs4 = n_ucs4;
+    r->pad = 0;
+
+    ucs4 = SROW_UCS4(r);
+    for (i = 0; i < n_ucs4; i++) {
+	ucs4[i] = ea[i].ucs4;
+    }
+    ec = SROW_EC(r);
+    for (i = 0; i < n_ec; i++) {
+	ec[i] = ea[i].ec;
+    }
+    for (i = 0; i < ncols; i++) {
+	if (i == 0 || !same_attrs(&ea[i], &ea[i - 1])) {
+	    run = (run == NULL)? SROW_RUNS(r): run + 1;
+	    run->count = 0;
+	    run->fa = ea[i].fa;
+	    run->fg = ea[i].fg;
+	    run->bg = ea[i].bg;
+	    run->gr = ea[i].gr;
+	    run->cs = ea[i].cs;
+	    run->ic = ea[i].ic;
+	    run->db = ea[i].db;
+	}
+	run->count++;
+    }
+    return r;
+}
+
+/*
+ * Expand a compressed row into <ncols> cells.
+ */
+static void
+srow_expand(const srow_t *r, struct ea *ea, int ncols)
+{
+    const srun_t *run;
+    const unsigned char *ec;
+    const ucs4_t *ucs4;
+    int i;
+    int j;
+    int n;
+
+    memset(ea, 0, ncols * sizeof(struct ea));
+    if (r == NULL) {
+	return;
+    }
+
+    run = SROW_RUNS(r);
+    for (i = 0, j = 0; j < r->n_runs && i < ncols; j++, run++) {
+	for (n = 0; n < run->count && i < ncols; n++, i++) {
+	    ea[i].fa = run->fa;
+	    ea[i].fg = run->fg;
+	    ea[i].bg = run->bg;
+	    ea[i].gr = run->gr;
+	    ea[i].cs = run->cs;
+	    ea[i].ic = run->ic;
+	    ea[i].db = run->db;
+	}
+    }
+    ec = SROW_EC(r);
+    for (i = 0; i < r->n_ec && i < ncols; i++) {
+	ea[i].ec = ec[i];
+    }
+    ucs4 = SROW_UCS4(r);
+    for (i = 0; i < r->n_ucs4 && i < ncols; i++) {
+	ea[i].ucs4 = ucs4[i];
+    }
+}
+
+/*
+ * Replace a saved row.
+ */
+static void
+row_store(int slot, srow_t *r)
+{
+    if (row_save[slot] != NULL && row_save[slot] != blank_row) {
+	Free(row_save[slot]);
+    }
+    row_save[slot] = r;
+}
+
+/*
+ * Free all of the saved rows.
+ */
+static void
+rows_free(void)
+{
+    int i;
+
+    for (i = 0; i < n_row_save; i++) {
+	row_store(i, NULL);
+    }
+}
+
 /*
  * Initialize (or re-initialize) the scrolling parameters and save area.
  */
@@ -97,8 +270,6 @@ void
 scroll_buf_init(void)
 {
     register int i;
-    int sa_size;
-    unsigned char *s;
 
     /* Set the number of rows to save, as a multiple of maxROWS. */
     scroll_max = appres.interactive.save_lines;
@@ -108,19 +279,19 @@ scroll_buf_init(void)
     if (scroll_max < maxROWS * 5) {
 	scroll_max = maxROWS * 5;
     }
-    if (sbuf != NULL) {
-	Free(sbuf);
-	Free(zbuf);
+    if (row_save != NULL) {
+	rows_free();
+	Free(row_save);
+	Free(blank_row);
+	blank_row = NULL;
+	Free(image_save);
 	Free(defaults_buf);
-	Free(ea_save);
-    }
-    sa_size = scroll_max + maxROWS;
-    ea_save = (struct ea **)Calloc(sizeof(struct ea *), sa_size);
-    sa_bufsize = (sa_size *
-	    (sizeof(unsigned char) + sizeof(struct ea))) * maxCOLS;
-    sbuf = Malloc(sa_bufsize);
-    zbuf = Malloc(maxCOLS);
-    memset(zbuf, '\0', maxCOLS);
+	Free(row_buf);
+    }
+    n_row_save = scroll_max;
+    row_save = (srow_t **)Calloc(sizeof(srow_t *), n_row_save);
+    image_save = (struct ea *)Calloc(maxROWS * maxCOLS, sizeof(struct ea));
+    row_buf = (struct ea *)Calloc(maxCOLS, sizeof(struct ea));
     defaults_buf = Calloc(maxCOLS, sizeof(struct ea));
     for (i = 0; i < maxCOLS; i++) {
 	/*
@@ -131,10 +302,7 @@ scroll_buf_init(void)
 	defaults_buf[i].bg = HOST_COLOR_BLACK;
 	defaults_buf[i].gr = XAH_INTENSIFY & 0x0f;
     }
-    s = (unsigned char *)sbuf;
-    for (i = 0; i < sa_size; s += (maxCOLS * sizeof(struct ea)), i++) {
-	ea_save[i] = (struct ea *)s;
-    }
+    blank_row = srow_compress(defaults_buf, maxCOLS);
     scroll_reset();
     scroll_initted = true;
 }
@@ -160,7 +328,8 @@ screen_set_thumb_traced(float top, float shown, int saved, int screen,
 static void
 scroll_reset(void)
 {
-    memset(sbuf, 0, sa_bufsize);
+    rows_free();
+    memset(image_save, 0, maxROWS * maxCOLS * sizeof(struct ea));
     scroll_next = 0;
     n_saved = 0;
     scrolled_back = 0;
@@ -193,16 +362,14 @@ scroll_save(int n)
     /* Save the screen contents. */
     for (row = 0; row < n; row++) {
 	if (row < ROWS) {
-	    memmove(ea_save[scroll_next],
-		    ea_buf + (row * COLS),
-		    COLS * sizeof(struct ea));
+	    memcpy(row_buf, ea_buf + (row * COLS), COLS * sizeof(struct ea));
 	    if (COLS < maxCOLS) {
-		memcpy(ea_save[scroll_next] + COLS, defaults_buf,
+		memcpy(row_buf + COLS, defaults_buf,
 			(maxCOLS - COLS) * sizeof(struct ea));
 	    }
+	    row_store(scroll_next, srow_compress(row_buf, maxCOLS));
 	} else {
-	    memcpy(ea_save[scroll_next], defaults_buf,
-		    maxCOLS * sizeof(struct ea));
+	    row_store(scroll_next, blank_row);
 	}
 	scroll_next = (scroll_next + 1) % scroll_max;
 	if (n_saved < scroll_max) {
@@ -211,8 +378,7 @@ scroll_save(int n)
     }
     if (n == ROWS && n < maxROWS) {
 	for (row = n; row < maxROWS; row++) {
-	    memcpy(ea_save[scroll_next], defaults_buf,
-		    maxCOLS * sizeof(struct ea));
+	    row_store(scroll_next, blank_row);
 	}
 	scroll_next = (scroll_next + 1) % scroll_max;
 	if (n_saved < scroll_max) {
@@ -229,8 +395,7 @@ scroll_save(int n)
 	int pad;
 
 	for (pad = maxROWS - (scroll_next % maxROWS); pad; pad--) {
-	    memcpy(ea_save[scroll_next], defaults_buf,
-		    maxCOLS * sizeof(struct ea));
+	    row_store(scroll_next, blank_row);
 	    scroll_next = (scroll_next + 1) % scroll_max;
 	    if (n_saved < scroll_max) {
 		n_saved++;
@@ -281,7 +446,7 @@ save_image(void)
 #endif /*]*/
 
     for (i = 0; i < maxROWS; i++) {
-	memmove(ea_save[scroll_max + i],
+	memmove(image_save + (i * maxCOLS),
 		(ea_buf + (i * COLS)), COLS * sizeof(struct ea));
     }
     need_saving = false;
@@ -357,12 +522,11 @@ sync_scroll(int sb)
     /* Update the screen. */
     for (i = 0; i < maxROWS; i++) {
 	if (i < sb) {
-	    memmove((ea_buf + (i * COLS)),
-		    ea_save[(scroll_first + i) % scroll_max],
-		    COLS * sizeof(struct ea));
+	    srow_expand(row_save[(scroll_first + i) % scroll_max],
+		    ea_buf + (i * COLS), COLS);
 	} else {
 	    memmove((ea_buf + (i * COLS)),
-		    ea_save[scroll_max + i - sb],
+		    image_save + ((i - sb) * maxCOLS),
 		    COLS * sizeof(struct ea));
 	}
     }
@@ -166,6 +166,12 @@ typedef struct task {
     struct {
 	char   *text;	/* text to match */
 	size_t	len;	/* length of match */
+	size_t *fail;	/* KMP failure function */
+	size_t	state;	/* number of characters matched so far */
+	bool	matched; /* true if a match has been seen */
+	bool	active;	/* true if on the expecting list */
+	uint64_t match_end; /* nvt_save_total at the end of the match */
+	struct task *next; /* next task on the expecting list */
     } expect;
 
     /* Macro fields. */
@@ -210,6 +216,11 @@ typedef struct _owait {
 } owait_t;
 static owait_t *owait_list = NULL;
 
+/* Freed task structures, kept for re-use. */
+#define TASK_FREE_MAX	8
+static task_t *task_free_list = NULL;
+static int task_free_count = 0;
+
 static const char *task_state_name[] = {
     "IDLE",
     "RUNNING",
@@ -236,6 +247,8 @@ static struct macro_def *macro_last = (struct macro_def *) NULL;
 static unsigned char *nvt_save_buf;
 static size_t   nvt_save_cnt = 0;
 static int      nvt_save_ix = 0;
+static uint64_t nvt_save_total = 0;	/* characters ever stored */
+static task_t  *expecting = NULL;	/* tasks with an active Expect() */
 static const char *st_name[NUM_ST] = {
     "Macro",		/* MACRO */
     "Callback"		/* CB */
@@ -254,6 +267,7 @@ static void task_pop(void);
 static void wait_timed_out(ioid_t id);
 static task_t *task_redirect_to(void);
 static bool expect_matches(task_t *task);
+static void expect_stop(task_t *task);
 
 /* Macro that defines that the keyboard is locked due to user input. */
 #define KBWAIT_MASK	(KL_OIA_LOCKED|KL_OIA_TWAIT|KL_DEFERRED_UNLOCK|KL_ENTER_INHIBIT|KL_AWAITING_FIRST|KL_FT|KL_BID)
@@ -677,7 +691,14 @@ new_task(enum task_type type, taskq_t *q)
 {
     task_t *s;
 
-    s = (task_t *)Calloc(1, sizeof(task_t));
+    if (task_free_list != NULL) {
+	s = task_free_list;
+	task_free_list = s->next;
+	task_free_count--;
+	memset(s, 0, sizeof(task_t));
+    } else {
+	s = (task_t *)Calloc(1, sizeof(task_t));
+    }
 
     s->taskq = q;
     s->next = q->top;
@@ -765,7 +786,7 @@ free_task(task_t *t)
 
     /* Free auxiliary buffers. */
     Replace(t->macro.msc, NULL);
-    Replace(t->expect.text, NULL);
+    expect_stop(t);
     if (t->macro.cmds != NULL) {
 	int i, j;
 	cmd_t *c;
@@ -784,8 +805,14 @@ free_task(task_t *t)
     }
     Replace(t->match.string, NULL);
     
-    /* Free the structure. */
-    Free(t);
+    /* Free the structure, or keep it for re-use. */
+    if (task_free_count < TASK_FREE_MAX) {
+	t->next = task_free_list;
+	task_free_list = t;
+	task_free_count++;
+    } else {
+	Free(t);
+    }
 }
 
 /* Pop a task off the stack. */
@@ -948,33 +975,17 @@ static action_elt_t *
 lookup_action(const char *action, char **errorp)
 {
     action_elt_t *e;
-    action_elt_t *any = NULL;
-    action_elt_t *exact = NULL;
-
-    /* Search the action list. */
-    FOREACH_LLIST(&actions_list, e, action_elt_t *) {
-	if (!strcasecmp(action, e->t.name)) {
-	    exact = any = e;
-	    break;
-	}
-    } FOREACH_LLIST_END(&actions_list, e, action_elt_t *);
-    if (exact == NULL) {
-	FOREACH_LLIST(&actions_list, e, action_elt_t *) {
-	    if (!strncasecmp(action, e->t.name, strlen(action))) {
-		if (any != NULL) {
-		    *errorp = Asprintf("Ambiguous action name: %s", action);
-		    return NULL;
-		}
-		any = e;
-	    }
-	} FOREACH_LLIST_END(&actions_list, e, action_elt_t *);
-    }
+    bool ambiguous;
 
-    if (any == NULL) {
+    /* Search the action indices. */
+    e = find_action_abbrev(action, &ambiguous);
+    if (ambiguous) {
+	*errorp = Asprintf("Ambiguous action name: %s", action);
+    } else if (e == NULL) {
 	*errorp = Asprintf("Unknown action: %s", action);
     }
 
-    return any;
+    return e;
 }
 
 /**
@@ -984,7 +995,8 @@ lookup_action(const char *action, char **errorp)
  * @param[in] offset	offset into string for error message
  * @param[out] np	returned pointer to additional commands
  * @param[out] entryp	returned action entry
- * @param[out] argsp	returned arguments
+ * @param[out] argsp	returned arguments, in a single block to be freed
+ *                      with one call to Free()
  * @param[out] errorp	returned error text (if false returned)
  *
  * @returns true for success, false for failure
@@ -1016,12 +1028,14 @@ parse_command(const char *s, int offset, const char **np,
     char aname[MAX_ANAME+1];
     int nx = 0;
     unsigned param_count = 0;	/* parameter count */
-    unsigned vbcount = 0;	/* allocated parameter count */
-    varbuf_t *r = NULL;		/* accumulated parameters */
+    unsigned vbcount = 0;	/* started parameter count */
+    varbuf_t r;			/* accumulated parameters, NUL-separated */
     int failreason = 0;
     unsigned i;
     bool rc = false;	/* failure return code */
     const char *s_orig = s;
+    const char *args_text;
+    char *t;
     static const char *fail_text[] = {
 	/*1*/ "Action name must begin with an alphanumeric character",
 	/*2*/ "Syntax error in action name",
@@ -1036,13 +1050,15 @@ parse_command(const char *s, int offset, const char **np,
     *entryp = NULL;
     *argsp = NULL;
     *errorp = NULL;
+    vb_init(&r);
 
     while ((c = *s++)) {
 
 	if ((param_count + 1) > vbcount) {
-	    /* Allocate a varbuf for the next parameter. */
-	    r = (varbuf_t *)Realloc(r, (param_count + 1) * sizeof(varbuf_t));
-	    vb_init(&r[param_count]);
+	    /* Start the next parameter. */
+	    if (vbcount) {
+		vb_append(&r, "", 1);
+	    }
 	    vbcount = param_count + 1;
 	}
 
@@ -1091,7 +1107,7 @@ parse_command(const char *s, int offset, const char **np,
 	    } else {
 		state = ME_S_PARM;
 		nx = 0;
-		vb_append(&r[param_count], &c, 1);
+		vb_append(&r, &c, 1);
 	    }
 	    break;
 	case ME_LPAREN:
@@ -1107,7 +1123,7 @@ parse_command(const char *s, int offset, const char **np,
 		goto success;
 	    } else {
 		state = ME_P_PARM;
-		vb_append(&r[param_count], &c, 1);
+		vb_append(&r, &c, 1);
 	    }
 	    break;
 	case ME_P_PARM:
@@ -1121,17 +1137,17 @@ parse_command(const char *s, int offset, const char **np,
 		param_count++;
 		state = ME_LPAREN_COMMA;
 	    } else {
-		vb_append(&r[param_count], &c, 1);
+		vb_append(&r, &c, 1);
 	    }
 	    break;
 	case ME_P_BSL:
 	    if (c != '"') {
-		vb_append(&r[param_count], "\\", 1);
+		vb_append(&r, "\\", 1);
 	    }
 	    if (c == '\\') {
 		state = ME_P_BSL2;
 	    } else {
-		vb_append(&r[param_count], &c, 1);
+		vb_append(&r, &c, 1);
 		state = ME_P_QPARM;
 	    }
 	    break;
@@ -1140,9 +1156,9 @@ parse_command(const char *s, int offset, const char **np,
 		param_count++;
 		state = ME_P_PARMx;
 	    } else {
-		vb_append(&r[param_count], "\\", 1);
+		vb_append(&r, "\\", 1);
 		if (c != '\\') {
-		    vb_append(&r[param_count], &c, 1);
+		    vb_append(&r, &c, 1);
 		    state = ME_P_QPARM;
 		}
 	    }
@@ -1154,7 +1170,7 @@ parse_command(const char *s, int offset, const char **np,
 	    } else if (c == '\\') {
 		state = ME_P_BSL;
 	    } else {
-		vb_append(&r[param_count], &c, 1);
+		vb_append(&r, &c, 1);
 	    }
 	    break;
 	case ME_P_PARMx:
@@ -1173,17 +1189,17 @@ parse_command(const char *s, int offset, const char **np,
 		param_count++;
 		state = ME_S_PARMx;
 	    } else {
-		vb_append(&r[param_count], &c, 1);
+		vb_append(&r, &c, 1);
 	    }
 	    break;
 	case ME_S_BSL:
 	    if (c != '"') {
-		vb_append(&r[param_count], "\\", 1);
+		vb_append(&r, "\\", 1);
 	    }
 	    if (c == '\\') {
 		state = ME_S_BSL2;
 	    } else {
-		vb_append(&r[param_count], &c, 1);
+		vb_append(&r, &c, 1);
 		state = ME_S_QPARM;
 	    }
 	    break;
@@ -1192,9 +1208,9 @@ parse_command(const char *s, int offset, const char **np,
 		param_count++;
 		state = ME_S_PARMx;
 	    } else {
-		vb_append(&r[param_count], "\\", 1);
+		vb_append(&r, "\\", 1);
 		if (c != '\\') {
-		    vb_append(&r[param_count], &c, 1);
+		    vb_append(&r, &c, 1);
 		    state = ME_S_QPARM;
 		}
 	    }
@@ -1206,7 +1222,7 @@ parse_command(const char *s, int offset, const char **np,
 	    } else if (c == '\\') {
 		state = ME_S_BSL;
 	    } else {
-		vb_append(&r[param_count], &c, 1);
+		vb_append(&r, &c, 1);
 	    }
 	    break;
 	case ME_S_PARMx:
@@ -1215,7 +1231,7 @@ parse_command(const char *s, int offset, const char **np,
 	    } else if (c == '"') {
 		state = ME_S_QPARM;
 	    } else {
-		vb_append(&r[param_count], &c, 1);
+		vb_append(&r, &c, 1);
 		state = ME_S_PARM;
 	    }
 	    break;
@@ -1284,13 +1300,19 @@ success:
 	goto silent_failure;
     }
 
-    /* Return the arguments. */
-    *argsp = (char **)Malloc((param_count + 1) * sizeof(const char *));
+    /* Return the arguments, with the vector and the text in one block. */
+    *argsp = (char **)Malloc((param_count + 1) * sizeof(char *) +
+	    vb_len(&r) + 1);
+    t = (char *)(*argsp + param_count + 1);
+    args_text = (vb_buf(&r) != NULL)? vb_buf(&r): "";
+    memcpy(t, args_text, vb_len(&r));
+    t[vb_len(&r)] = '\0';
     for (i = 0; i < param_count; i++) {
-	(*argsp)[i] = vb_consume(&r[i]);
+	(*argsp)[i] = t;
+	t += strlen(t) + 1;
     }
     (*argsp)[i] = NULL;
-    Free(r);
+    vb_free(&r);
 
     return true;
 
@@ -1298,12 +1320,7 @@ failure:
     *errorp = Asprintf("%s at column %d", fail_text[failreason-1],
 	    (int)(s - s_orig) + offset);
 silent_failure:
-    if (vbcount) {
-	for (i = 0; i < vbcount; i++) {
-	    vb_free(&r[i]);
-	}
-	Free(r);
-    }
+    vb_free(&r);
     return rc;
 
 #undef fail
@@ -1424,7 +1441,6 @@ execute_command(enum iaction cause, const char *s, const char **np, char *last,
     action_elt_t *entry;
     char **args;
     char *error;
-    int i;
 
     /* Parse the command. */
     stat = parse_command(s, 0, np, &entry, &args, &error);
@@ -1444,10 +1460,7 @@ execute_command(enum iaction cause, const char *s, const char **np, char *last,
 	    last_len, cbx);
 
     /* Free the arguments. */
-    for (i = 0; args[i] != NULL; i++) {
-	Free(args[i]);
-    }
-    Replace(args, NULL);
+    Free(args);
     return stat;
 }
 
@@ -1466,7 +1479,6 @@ validate_command(const char *command, int offset, char **error)
     action_elt_t *entry;
     const char *np;
     char **args = NULL;
-    int i;
 
     np = command;
     while (*np) {
@@ -1474,10 +1486,7 @@ validate_command(const char *command, int offset, char **error)
 		    &args, error)) {
 	    return false;
 	}
-	for (i = 0; args[i] != NULL; i++) {
-	    Free(args[i]);
-	}
-	Free(args);
+	Replace(args, NULL);
     }
     return true;
 }
@@ -2095,6 +2104,97 @@ task_ft_complete(const char *msg, bool is_error)
     }
 }
 
+/**
+ * Convert a range of screen cells to text.
+ *
+ * Base character set cells are translated with a cached table; NVT,
+ * DBCS and other character set cells are translated individually.
+ * Non-display fields and field attributes are rendered as blanks, and the
+ * right halves of DBCS characters are skipped.
+ *
+ * @param[in] buf	display buffer
+ * @param[in] size	number of cells in buf
+ * @param[in] baddr	buffer address to start at (wraps at size)
+ * @param[in] ncells	number of cells to convert, or -1 for no limit
+ * @param[in] limit	stop when this many bytes have been produced
+ * @param[in,out] is_zero true if in a non-display field
+ * @param[in] force_utf8 true to force UTF-8 output
+ * @param[out] out	output buffer, with room for the smaller of
+ *			limit + E2MB_MAX and ncells * E2MB_MAX + 1 bytes
+ * @param[out] nshown	returned number of cells not skipped, or NULL
+ *
+ * @return number of bytes written, not including the terminating NUL
+ */
+static size_t
+screen_text(struct ea *buf, int size, int baddr, int ncells, size_t limit,
+	bool *is_zero, bool force_utf8, char *out, int *nshown)
+{
+    bool monocase = toggled(MONOCASE);
+    unsigned flags = EUO_BLANK_UNDEF | (monocase? EUO_TOUPPER: 0);
+    const e2mb_table_t *t = ebcdic_to_multibyte_table(CS_BASE, flags,
+	    force_utf8);
+    size_t len = 0;
+    int shown = 0;
+    int i;
+
+    for (i = 0; (ncells < 0 || i < ncells) && len < limit; i++) {
+	int a = (baddr + i) % size;
+	struct ea *ea = &buf[a];
+	enum dbcs_state d;
+	ucs4_t uc;
+	size_t xlen;
+
+	if (ea->fa) {
+	    *is_zero = FA_IS_ZERO(ea->fa);
+	    out[len++] = ' ';
+	    shown++;
+	    continue;
+	}
+	if (*is_zero) {
+	    out[len++] = ' ';
+	    shown++;
+	    continue;
+	}
+	d = ctlr_dbcs_state_ea(a, buf);
+	if (IS_RIGHT(d)) {
+	    continue;
+	}
+	shown++;
+	if (is_nvt(ea, false, &uc)) {
+	    /* NVT-mode text. */
+	    if (uc >= UPRIV2_Aunderbar && uc <= UPRIV2_Zunderbar) {
+		uc -= UPRIV2;
+	    }
+	    if (monocase) {
+		uc = u_toupper(uc);
+	    }
+	    xlen = unicode_to_multibyte_f(uc, out + len, E2MB_MAX,
+		    force_utf8);
+	} else if (IS_LEFT(d)) {
+	    /* 3270-mode DBCS text. */
+	    xlen = ebcdic_to_multibyte_f((ea->ec << 8) |
+		    buf[(a + 1) % size].ec, out + len, E2MB_MAX,
+		    force_utf8);
+	} else if (ea->cs == CS_BASE) {
+	    /* 3270-mode text in the base character set. */
+	    xlen = t->len[ea->ec];
+	    memcpy(out + len, t->mb[ea->ec], xlen);
+	} else {
+	    /* 3270-mode text in another character set. */
+	    xlen = ebcdic_to_multibyte_fx(ea->ec, ea->cs, out + len,
+		    E2MB_MAX, flags, &uc, force_utf8);
+	}
+	if (xlen > 0) {
+	    len += xlen - 1;
+	}
+    }
+    out[len] = '\0';
+    if (nshown != NULL) {
+	*nshown = shown;
+    }
+    return len;
+}
+
 /**
  * Grabs a string from an offset on the screen.
  * Returns the string.
@@ -2112,70 +2212,12 @@ task_ft_complete(const char *msg, bool is_error)
 static char *
 grab_string(int baddr, size_t len, struct ea *buf, bool force_utf8)
 {
-    int i;
-    bool is_zero = false;
-    varbuf_t r;
     char *ret;
+    bool is_zero = FA_IS_ZERO(get_field_attribute(baddr));
 
-    vb_init(&r);
-
-    is_zero = FA_IS_ZERO(get_field_attribute(baddr));
-
-    for (i = 0; vb_len(&r) < len; i++) {
-	char mb[16];
-	ucs4_t uc;
-	size_t j;
-	size_t xlen;
-	struct ea *ea = &buf[(baddr + i) % (ROWS * COLS)];
-
-	if (ea->fa) {
-	    is_zero = FA_IS_ZERO(ea->fa);
-	    vb_appends(&r, " ");
-	} else if (is_zero) {
-	    vb_appends(&r, " ");
-	} else if (IS_RIGHT(ctlr_dbcs_state(baddr + i))) {
-	    continue;
-	} else {
-	    if (is_nvt(ea, false, &uc)) {
-		/* NVT-mode text. */
-		if (uc >= UPRIV2_Aunderbar && uc <= UPRIV2_Zunderbar) {
-		    uc -= UPRIV2;
-		}
-		if (toggled(MONOCASE)) {
-		    uc = u_toupper(uc);
-		}
-		xlen = unicode_to_multibyte_f(uc, mb, sizeof(mb), force_utf8);
-		for (j = 0; j < xlen - 1; j++) {
-		    vb_appendf(&r, "%c", mb[j]);
-		}
-	    } else {
-		/* 3270-mode text. */
-		if (IS_LEFT(ctlr_dbcs_state(baddr + i))) {
-		    xlen = ebcdic_to_multibyte_f((ea->ec << 8) |
-			    buf[(baddr + i + 1) % (ROWS * COLS)].ec,
-			    mb, sizeof(mb), force_utf8);
-		    for (j = 0; j < xlen - 1; j++) {
-			vb_appendf(&r, "%c", mb[j]);
-		    }
-		} else {
-		    xlen = ebcdic_to_multibyte_fx(ea->ec, ea->cs, mb,
-			    sizeof(mb),
-			    EUO_BLANK_UNDEF |
-			     (toggled(MONOCASE)? EUO_TOUPPER: 0),
-			    &uc, force_utf8);
-		    for (j = 0; j < xlen - 1; j++) {
-			vb_appendf(&r, "%c", mb[j]);
-		    }
-		}
-	    }
-	}
-    }
-
-    ret = NewString(vb_buf(&r));
-    if (ret == NULL) {
-	ret = NewString("");
-    }
-    vb_free(&r);
+    ret = Malloc(len + E2MB_MAX);
+    screen_text(buf, ROWS * COLS, baddr, -1, len, &is_zero, force_utf8, ret,
+	    NULL);
     return ret;
 }
 
@@ -2470,15 +2512,13 @@ set_output_needed(bool needed)
  */
 static bool
 dump_range(int first, int len, bool in_ascii, struct ea *buf,
-    int rel_rows _is_unused, int rel_cols, bool force_utf8)
+    int rel_rows, int rel_cols, bool force_utf8)
 {
     int i;
     bool any = false;
     bool is_zero = false;
     varbuf_t r;
 
-    vb_init(&r);
-
     /*
      * If the client has looked at the live screen, then if they later
      * execute 'Wait(output)', they will need to wait for output from the
@@ -2498,78 +2538,56 @@ dump_range(int first, int len, bool in_ascii, struct ea *buf,
 
     is_zero = FA_IS_ZERO(get_field_attribute(first));
 
+    if (in_ascii) {
+	char *text = Malloc((rel_cols * E2MB_MAX) + 1);
+	int size = rel_rows * rel_cols;
+
+	/* Convert one row at a time. */
+	for (i = 0; i < len; ) {
+	    int n = rel_cols - ((first + i) % rel_cols);
+	    int shown;
+
+	    if (n > len - i) {
+		n = len - i;
+	    }
+	    if (i) {
+		action_output("%s", text);
+	    }
+	    screen_text(buf, size, first + i, n, (size_t)-1, &is_zero,
+		    force_utf8, text, &shown);
+	    any = shown > 0;
+	    i += n;
+	}
+	if (any) {
+	    action_output("%s", text);
+	}
+	Free(text);
+	return any;
+    }
+
+    vb_init(&r);
     for (i = 0; i < len; i++) {
+	ebc_t ebc = 0;
+
 	if (i && !((first + i) % rel_cols)) {
 	    action_output("%s", vb_buf(&r));
 	    vb_reset(&r);
 	    any = false;
 	}
-	if (in_ascii) {
-	    char mb[16];
-	    ucs4_t uc;
-	    size_t j;
-	    size_t xlen;
-
-	    if (buf[first + i].fa) {
-		is_zero = FA_IS_ZERO(buf[first + i].fa);
-		vb_appends(&r, " ");
-	    } else if (is_zero) {
-		vb_appends(&r, " ");
-	    } else if (IS_RIGHT(ctlr_dbcs_state(first + i))) {
+	if (buf[first + i].ucs4) {
+	    /* NVT-mode text. */
+	    if (IS_RIGHT(ctlr_dbcs_state(first + i))) {
 		continue;
-	    } else {
-		if (is_nvt(&buf[first + i], false, &uc)) {
-		    /* NVT-mode text. */
-		    if (uc >= UPRIV2_Aunderbar && uc <= UPRIV2_Zunderbar) {
-			uc -= UPRIV2;
-		    }
-		    if (toggled(MONOCASE)) {
-			uc = u_toupper(uc);
-		    }
-		    xlen = unicode_to_multibyte_f(uc, mb, sizeof(mb),
-			    force_utf8);
-		    for (j = 0; j < xlen - 1; j++) {
-			vb_appendf(&r, "%c", mb[j]);
-		    }
-		} else {
-		    /* 3270-mode text. */
-		    if (IS_LEFT(ctlr_dbcs_state(first + i))) {
-			xlen = ebcdic_to_multibyte_f((buf[first + i].ec << 8) |
-				buf[first + i + 1].ec,
-				mb, sizeof(mb), force_utf8);
-			for (j = 0; j < xlen - 1; j++) {
-			    vb_appendf(&r, "%c", mb[j]);
-			}
-		    } else {
-			xlen = ebcdic_to_multibyte_fx(buf[first + i].ec,
-				buf[first + i].cs, mb, sizeof(mb),
-				EUO_BLANK_UNDEF |
-				 (toggled(MONOCASE)? EUO_TOUPPER: 0),
-				&uc, force_utf8);
-			for (j = 0; j < xlen - 1; j++) {
-			    vb_appendf(&r, "%c", mb[j]);
-			}
-		    }
-		}
 	    }
-	} else {
-	    ebc_t ebc = 0;
-
-	    if (buf[first + i].ucs4) {
-		/* NVT-mode text. */
-		if (IS_RIGHT(ctlr_dbcs_state(first + i))) {
-		    continue;
-		}
-		if (buf[first + i].cs != CS_LINEDRAW) {
-		    /* Try to translate to EBCDIC. */
-		    ebc = unicode_to_ebcdic(buf[first + i].ucs4);
-		}
-	    } else {
-		/* 3270-mode text. */
-		ebc = buf[first + i].ec;
+	    if (buf[first + i].cs != CS_LINEDRAW) {
+		/* Try to translate to EBCDIC. */
+		ebc = unicode_to_ebcdic(buf[first + i].ucs4);
 	    }
-	    vb_appendf(&r, "%s%02x", any ? " " : "", ebc);
+	} else {
+	    /* 3270-mode text. */
+	    ebc = buf[first + i].ec;
 	}
+	vb_appendf(&r, "%s%02x", any ? " " : "", ebc);
 	any = true;
     }
     if (any) {
@@ -2777,6 +2795,7 @@ do_read_buffer(const char **params, unsigned num_params, struct ea *buf,
     bool field = false;
     int field_baddr = 0;
     bool any = false;
+    const e2mb_table_t *t = NULL;
 
     if (num_params > 0) {
 	unsigned i;
@@ -2830,6 +2849,10 @@ do_read_buffer(const char **params, unsigned num_params, struct ea *buf,
 	baddr = 0;
     }
 
+    if (mode == RB_ASCII) {
+	t = ebcdic_to_multibyte_table(CS_BASE, EUO_NONE, force_utf8);
+    }
+
     vb_init(&r);
     for (;;) {
 	if (!field && !(baddr % COLS)) {
@@ -2960,8 +2983,17 @@ do_read_buffer(const char **params, unsigned num_params, struct ea *buf,
 			mb[1] = '\0';
 			break;
 		    default:
-			ebcdic_to_multibyte_fx(buf[baddr].ec, buf[baddr].cs,
-				mb, sizeof(mb), EUO_NONE, &uc, force_utf8);
+			if (buf[baddr].cs == CS_BASE) {
+			    memcpy(mb, t->mb[buf[baddr].ec],
+				    t->len[buf[baddr].ec]);
+			    if (t->len[buf[baddr].ec] == 0) {
+				mb[0] = '\0';
+			    }
+			} else {
+			    ebcdic_to_multibyte_fx(buf[baddr].ec,
+				    buf[baddr].cs, mb, sizeof(mb), EUO_NONE,
+				    &uc, force_utf8);
+			}
 			break;
 		    }
 		}
@@ -3880,53 +3912,175 @@ expand_expect(task_t *task, const char *s)
     task->expect.len = t - task->expect.text;
 }
 
-/* 'mem' version of strstr */
-static char *
-memstr(char *s1, char *s2, int n1, int n2)
+/*
+ * Feed one NVT character to a task's Expect() matcher.
+ *
+ * @param[in,out] task	Task
+ * @param[in] c		Character
+ * @param[in] pos	nvt_save_total just after the character
+ */
+static void
+expect_feed(task_t *task, unsigned char c, uint64_t pos)
 {
-    int i;
+    const unsigned char *text = (const unsigned char *)task->expect.text;
+    size_t state = task->expect.state;
+
+    while (state > 0 && text[state] != c) {
+	state = task->expect.fail[state - 1];
+    }
+    if (text[state] == c) {
+	state++;
+    }
+    if (state == task->expect.len) {
+	task->expect.matched = true;
+	task->expect.match_end = pos;
+	state = task->expect.fail[state - 1];
+    }
+    task->expect.state = state;
+}
 
-    for (i = 0; i <= n1 - n2; i++, s1++) {
-	if (*s1 == *s2 && !memcmp(s1, s2, n2)) {
-	    return s1;
+/*
+ * Scan the unconsumed NVT data from the beginning for a task's Expect()
+ * string.
+ *
+ * @param[in,out] task	Task
+ */
+static void
+expect_scan(task_t *task)
+{
+    uint64_t oldest = nvt_save_total - nvt_save_cnt;
+    size_t ix, i;
+
+    task->expect.state = 0;
+    task->expect.matched = false;
+    if (task->expect.len == 0) {
+	task->expect.matched = true;
+	task->expect.match_end = oldest;
+	return;
+    }
+
+    ix = (nvt_save_ix + NVT_SAVE_SIZE - nvt_save_cnt) % NVT_SAVE_SIZE;
+    for (i = 0; i < nvt_save_cnt && !task->expect.matched; i++) {
+	expect_feed(task, nvt_save_buf[(ix + i) % NVT_SAVE_SIZE],
+		oldest + i + 1);
+    }
+}
+
+/*
+ * Start matching an Expect() string, already set up by expand_expect().
+ *
+ * @param[in,out] task	Task
+ */
+static void
+expect_start(task_t *task)
+{
+    const unsigned char *text = (const unsigned char *)task->expect.text;
+    size_t len = task->expect.len;
+    size_t i, k;
+
+    /* Compute the KMP failure function. */
+    task->expect.fail = (size_t *)Malloc((len? len: 1) * sizeof(size_t));
+    task->expect.fail[0] = 0;
+    for (i = 1, k = 0; i < len; i++) {
+	while (k > 0 && text[i] != text[k]) {
+	    k = task->expect.fail[k - 1];
+	}
+	if (text[i] == text[k]) {
+	    k++;
 	}
+	task->expect.fail[i] = k;
+    }
+
+    task->expect.next = expecting;
+    expecting = task;
+    task->expect.active = true;
+
+    expect_scan(task);
+}
+
+/*
+ * Stop matching an Expect() string.
+ *
+ * @param[in,out] task	Task
+ */
+static void
+expect_stop(task_t *task)
+{
+    if (task->expect.active) {
+	task_t **tp;
+
+	for (tp = &expecting; *tp != NULL; tp = &(*tp)->expect.next) {
+	    if (*tp == task) {
+		*tp = task->expect.next;
+		break;
+	    }
+	}
+	task->expect.active = false;
+	task->expect.next = NULL;
+    }
+    Replace(task->expect.fail, NULL);
+    Replace(task->expect.text, NULL);
+}
+
+/*
+ * NVT data has been consumed. Rescan what is left for all of the other
+ * pending Expect() strings.
+ */
+static void
+expect_rescan_all(void)
+{
+    task_t *t;
+
+    for (t = expecting; t != NULL; t = t->expect.next) {
+	expect_scan(t);
     }
-    return NULL;
 }
 
 /* Check for a match against an expect string. */
 static bool
 expect_matches(task_t *task)
 {
-    size_t ix, i;
-    unsigned char buf[NVT_SAVE_SIZE];
-    char *t;
+    if (!task->expect.active) {
+	return false;
+    }
 
-    ix = (nvt_save_ix + NVT_SAVE_SIZE - nvt_save_cnt) % NVT_SAVE_SIZE;
-    for (i = 0; i < nvt_save_cnt; i++) {
-	buf[i] = nvt_save_buf[(ix + i) % NVT_SAVE_SIZE];
+    /* If the match has been pushed out of the buffer, look again. */
+    if (task->expect.matched &&
+	    task->expect.match_end - task->expect.len <
+		nvt_save_total - nvt_save_cnt) {
+	expect_scan(task);
     }
-    t = memstr((char *)buf, task->expect.text, (int)nvt_save_cnt,
-	    (int)task->expect.len);
-    if (t != NULL) {
-	nvt_save_cnt -= ((unsigned char *)t - buf) + task->expect.len;
-	Replace(task->expect.text, NULL);
-	return true;
-    } else {
+    if (!task->expect.matched) {
 	return false;
     }
+
+    /* Consume everything through the end of the match. */
+    nvt_save_cnt = (size_t)(nvt_save_total - task->expect.match_end);
+    expect_stop(task);
+    expect_rescan_all();
+    return true;
 }
 
 /* Store an NVT character for use by the Expect action. */
 void
 task_store(unsigned char c)
 {
+    task_t *t;
+
     /* Save the character in the buffer. */
     nvt_save_buf[nvt_save_ix++] = c;
     nvt_save_ix %= NVT_SAVE_SIZE;
     if (nvt_save_cnt < NVT_SAVE_SIZE) {
 	nvt_save_cnt++;
     }
+    nvt_save_total++;
+
+    /* Feed it to the pending Expect() strings. */
+    for (t = expecting; t != NULL; t = t->expect.next) {
+	if (!t->expect.matched) {
+	    expect_feed(t, c, nvt_save_total);
+	}
+    }
 }
 
 /* Dump whatever NVT data has been sent by the host since last called. */
@@ -3975,6 +4129,7 @@ NvtText_action(ia_t ia, unsigned argc, const char **argv)
     vb_free(&r);
     nvt_save_cnt = 0;
     nvt_save_ix = 0;
+    expect_rescan_all();
     return true;
 }
 
@@ -4050,7 +4205,7 @@ expect_timed_out(ioid_t id)
 	return;
     }
 
-    Replace(s->expect.text, NULL);
+    expect_stop(s);
 
     current_task = s;
     popup_an_error(AnExpect "(): Timed out");
@@ -4136,6 +4291,7 @@ Expect_action(ia_t ia, unsigned argc, const char **argv)
 
     /* See if the text is there already; if not, wait for it. */
     expand_expect(current_task, argv[0]);
+    expect_start(current_task);
     if (!expect_matches(current_task)) {
 	current_task->expect_id = AddTimeOut(tmo * 1000, expect_timed_out);
 	task_set_state(current_task, TS_EXPECTING, AnExpect "()");
@@ -154,7 +154,7 @@ static bool deferred_will_ttype;
 static unsigned char *ibuf = (unsigned char *) NULL;
 			/* 3270 input buffer */
 static unsigned char *ibptr;
-static int      ibuf_size = 0;	/* size of ibuf */
+static size_t   ibuf_size = 0;	/* size of ibuf */
 static unsigned char *obuf_base = NULL;
 static int	obuf_size = 0;
 static unsigned char *netrbuf = NULL;
@@ -227,6 +227,9 @@ static bool telnet_fsm(unsigned char c);
 static void net_rawout(unsigned const char *buf, size_t len);
 static void check_in3270(void);
 static void store3270in(unsigned char c);
+static void store3270in_n(unsigned const char *buf, size_t len);
+static void space3270in(size_t n);
+static size_t telnet_fsm_bulk(unsigned const char *buf, size_t len);
 static void check_linemode(bool init);
 static int non_blocking(bool on);
 static void net_connected(void);
@@ -565,14 +568,40 @@ connect_to(int ix, bool noisy, bool *pending)
 #endif /*]*/
 }
 
+/*
+ * Returns true if the TLS context needs to be set up before connecting.
+ *
+ * That is the case for a TLS host, and when any TLS option is configured,
+ * because the options are checked (and a client certificate loaded, possibly
+ * prompting for a password) when the context is set up, and errors in them
+ * should be reported at connect time.
+ * Otherwise, setting up the context (which includes loading the default CA
+ * certificates) is deferred until the host asks for STARTTLS, so plain
+ * connections do not pay for it.
+ */
+static bool
+tls_setup_early(void)
+{
+    return HOST_FLAG(TLS_HOST) ||
+	appres.tls.ca_dir != NULL ||
+	appres.tls.ca_file != NULL ||
+	appres.tls.cert_file != NULL ||
+	appres.tls.chain_file != NULL ||
+	appres.tls.key_file != NULL ||
+	appres.tls.client_cert != NULL ||
+	appres.tls.min_protocol != NULL ||
+	appres.tls.max_protocol != NULL ||
+	appres.tls.security_level != NULL;
+}
+
 /* Complete a connection, now that the hostname has been resolved. */
 static net_connect_t
 finish_connect(iosrc_t *iosrc)
 {
     iosrc_t s;
 
-    /* Set up the TLS context, whether this is an TLS host or not. */
-    if (sio_supported()) {
+    /* Set up the TLS context, if it is needed up front. */
+    if (sio_supported() && tls_setup_early()) {
 	bool pending = false;
 
 	sio = sio_init_wrapper(NULL, HOST_FLAG(NO_VERIFY_CERT_HOST),
@@ -1533,6 +1562,12 @@ net_input(iosrc_t fd _is_unused, ioid_t id _is_unused)
 	    nvt_process((unsigned int) *cp);
 	} else {
 #endif /*]*/
+	    size_t nb = telnet_fsm_bulk(cp, (netrbuf + nr) - cp);
+
+	    if (nb > 0) {
+		cp += nb - 1;
+		continue;
+	    }
 	    if (!telnet_fsm(*cp)) {
 		ctlr_dbcs_postprocess();
 		host_disconnect(true);
@@ -1669,6 +1704,59 @@ force_local(char *s)
 #define force_local(s)
 #endif /*]*/
 
+/*
+ * telnet_fsm_bulk
+ *	Fast path for the Telnet finite-state machine. When receiving 3270
+ *	data, stores everything up to the next IAC in one step, leaving the
+ *	IAC and what follows it to telnet_fsm(). NVT data is passed to the
+ *	NVT emulator the same way, unless it needs to be traced a character
+ *	at a time.
+ *	Returns the number of bytes consumed, which may be 0.
+ */
+static size_t
+telnet_fsm_bulk(unsigned const char *buf, size_t len)
+{
+    unsigned const char *iac = NULL;
+    size_t span;
+    bool nvt = IN_NVT && !IN_E;
+
+    if (telnet_state != TNS_DATA ||
+	    cstate == TELNET_PENDING ||
+	    (nvt && toggled(TRACING))) {
+	return 0;
+    }
+
+    if (!HOST_FLAG(NO_TELNET_HOST)) {
+	iac = memchr(buf, IAC, len);
+    }
+    span = (iac != NULL)? (size_t)(iac - buf): len;
+    if (span == 0) {
+	return 0;
+    }
+
+    if (!nvt) {
+	store3270in_n(buf, span);
+    } else if (!syncing) {
+	if ((linemode && appres.linemode.onlcr) ||
+		(!linemode && charmode_onlcr)) {
+	    unsigned const char *p = buf;
+	    unsigned const char *end = buf + span;
+	    unsigned const char *nl;
+
+	    /* Expand each newline to CR/LF. */
+	    while ((nl = memchr(p, '\n', end - p)) != NULL) {
+		nvt_process_n(p, nl - p);
+		nvt_process_n((unsigned const char *)"\r\n", 2);
+		p = nl + 1;
+	    }
+	    nvt_process_n(p, end - p);
+	} else {
+	    nvt_process_n(buf, span);
+	}
+    }
+    return span;
+}
+
 /*
  * telnet_fsm
  *	Telnet finite-state machine.
@@ -1909,6 +1997,17 @@ telnet_fsm(unsigned char c)
 		}
 		goto wont;
 	    }
+	    if (c == TELOPT_STARTTLS && sio == NULL) {
+		bool pending;
+
+		/* Set up the deferred TLS context. */
+		vtrace("Setting up TLS context for STARTTLS\n");
+		sio = sio_init_wrapper(NULL, HOST_FLAG(NO_VERIFY_CERT_HOST),
+			net_accept, &pending);
+		if (sio == NULL) {
+		    return false;
+		}
+	    }
 	case TELOPT_NEW_ENVIRON:
 	    if (c == TELOPT_TN3270E && HOST_FLAG(NON_TN3270E_HOST)) {
 		goto wont;
@@ -2660,7 +2759,6 @@ process_eor(void)
 
     if (IN_E) {
 	tn3270e_header *h = (tn3270e_header *)ibuf;
-	unsigned char *s;
 	enum pds rv;
 	bool bid_success;
 
@@ -2762,9 +2860,7 @@ process_eor(void)
 	    tn3270e_submode = E_NVT;
 	    check_in3270();
 	    trace_envt_in(ibuf + EH_SIZE, ibptr - (ibuf + EH_SIZE));
-	    for (s = ibuf + EH_SIZE; s < ibptr; s++) {
-		nvt_process((unsigned int)*s);
-	    }
+	    nvt_process_n(ibuf + EH_SIZE, ibptr - (ibuf + EH_SIZE));
 	    if (h->response_flag == TN3270E_RSF_ALWAYS_RESPONSE) {
 		tn3270e_ack();
 	    }
@@ -3098,6 +3194,30 @@ check_in3270(void)
     }
 }
 
+/*
+ * space3270in
+ *	Ensure that <n> more characters will fit in the 3270 input buffer.
+ *	Grows the buffer geometrically, so a large record is copied only a
+ *	few times as it accumulates.
+ */
+static void
+space3270in(size_t n)
+{
+    size_t nc = ibptr - ibuf;	/* amount of data currently in ibuf */
+    size_t new_size;
+
+    if (nc + n <= ibuf_size) {
+	return;
+    }
+    new_size = ibuf_size? ibuf_size: BUFSIZ;
+    while (new_size < nc + n) {
+	new_size *= 2;
+    }
+    ibuf = (unsigned char *)Realloc((char *)ibuf, new_size);
+    ibuf_size = new_size;
+    ibptr = ibuf + nc;
+}
+
 /*
  * store3270in
  *	Store a character in the 3270 input buffer, checking for buffer
@@ -3106,14 +3226,24 @@ check_in3270(void)
 static void
 store3270in(unsigned char c)
 {
-    if (ibptr - ibuf >= ibuf_size) {
-	ibuf_size += BUFSIZ;
-	ibuf = (unsigned char *)Realloc((char *)ibuf, ibuf_size);
-	ibptr = ibuf + ibuf_size - BUFSIZ;
+    if ((size_t)(ibptr - ibuf) >= ibuf_size) {
+	space3270in(1);
     }
     *ibptr++ = c;
 }
 
+/*
+ * store3270in_n
+ *	Store a block of characters in the 3270 input buffer.
+ */
+static void
+store3270in_n(unsigned const char *buf, size_t len)
+{
+    space3270in(len);
+    memcpy(ibptr, buf, len);
+    ibptr += len;
+}
+
 /*
  * space3270out
  *	Ensure that <n> more characters will fit in the 3270 output buffer.
@@ -3248,7 +3378,7 @@ trace_netdata(char direction, unsigned const char *buf, size_t len)
 {
     size_t offset;
 
-    if (!toggled(TRACING)) {
+    if (!toggled(TRACING) || trace_netdata_bin(direction, buf, len)) {
 	    return;
     }
     for (offset = 0; offset < len; offset++) {
@@ -63,6 +63,7 @@
 #include "telnet_core.h"
 #include "toggles.h"
 #include "trace.h"
+#include "trace_bin.h"
 #include "trace_gui.h"
 #include "txa.h"
 #include "utf8.h"
@@ -86,6 +87,10 @@
 #define MIN_TRACEFILE_SIZE	(64*1024)
 #define MIN_TRACEFILE_SIZE_NAME	"64K"
 
+/* Size and number of the preallocated chunks used for buffered tracing. */
+#define TRACE_CHUNK_SIZE	(16*1024)
+#define TRACE_CHUNKS		8
+
 /* System calls which may not be there. */
 #if !defined(HAVE_FSEEKO) /*[*/
 #define fseeko(s, o, w)	fseek(s, (long)o, w)
@@ -99,6 +104,10 @@
 #endif /*]*/
 
 /* Typedefs */
+typedef struct {
+    size_t len;				/* bytes used */
+    char data[TRACE_CHUNK_SIZE];	/* buffered trace text */
+} trace_chunk_t;
 
 /* Statics */
 static size_t   dscnt = 0;
@@ -112,11 +121,20 @@ static char    *tracef_bufptr = NULL;
 static off_t	tracef_size = 0;
 static off_t	tracef_max = 0;
 static char    *onetime_tracefile_name = NULL;
+static trace_chunk_t *trace_chunks = NULL;
+static unsigned	trace_chunk_cur = 0;
+static bool	trace_buffered = false;
+static bool	trace_binary = false;
+static uint64_t	trace_bin_start = 0;
+static ioid_t	trace_flush_id = NULL_IOID;
+static char    *trace_fmtbuf = NULL;
+static size_t	trace_fmtbuf_size = 0;
 
 static void	vwtrace(bool do_ts, const char *fmt, va_list args);
 static void	wtrace(bool do_ts, const char *fmt, ...);
 static char    *create_tracefile_header(const char *mode);
 static void	stop_tracing(void);
+static bool	trace_flush(void);
 
 /* Globals */
 bool		trace_skipping = false;
@@ -302,17 +320,300 @@ gen_ts(void)
 	    (int)(tv.tv_usec / 1000L));
 }
 
+/*
+ * Format a trace message into a reusable buffer.
+ *
+ * @param[in] fmt	printf format
+ * @param[in] args	arguments
+ * @param[out] lenp	returned length
+ *
+ * @return Formatted text. Valid until the next call.
+ */
+static char *
+trace_vformat(const char *fmt, va_list args, size_t *lenp)
+{
+    va_list aq;
+    int len;
+
+    va_copy(aq, args);
+#if defined(_WIN32) /*[*/
+    len = vscprintf(fmt, aq);
+#else /*][*/
+    len = vsnprintf(trace_fmtbuf, trace_fmtbuf_size, fmt, aq);
+#endif /*]*/
+    va_end(aq);
+    if (len < 0) {
+	Error("trace_vformat: vsnprintf failure");
+    }
+    if ((size_t)len >= trace_fmtbuf_size) {
+	trace_fmtbuf_size = (len + 1024) & ~1023;
+	Replace(trace_fmtbuf, Malloc(trace_fmtbuf_size));
+	vsnprintf(trace_fmtbuf, trace_fmtbuf_size, fmt, args);
+#if defined(_WIN32) /*[*/
+    } else {
+	vsnprintf(trace_fmtbuf, trace_fmtbuf_size, fmt, args);
+#endif /*]*/
+    }
+    *lenp = len;
+    return trace_fmtbuf;
+}
+
+/* The flush interval expired. */
+static void
+trace_flush_timeout(ioid_t id _is_unused)
+{
+    trace_flush_id = NULL_IOID;
+    trace_flush();
+}
+
+/*
+ * Append text to the trace chunks, flushing them if they fill up.
+ *
+ * @param[in] s		Text to append
+ * @param[in] len	Length of text
+ *
+ * @return true for success, false if the trace file could not be written
+ */
+static bool
+trace_buffer(const char *s, size_t len)
+{
+    while (len > 0) {
+	trace_chunk_t *c = &trace_chunks[trace_chunk_cur];
+	size_t n = TRACE_CHUNK_SIZE - c->len;
+
+	if (n == 0) {
+	    if (trace_chunk_cur + 1 < TRACE_CHUNKS) {
+		trace_chunk_cur++;
+	    } else if (!trace_flush()) {
+		return false;
+	    }
+	    continue;
+	}
+	if (n > len) {
+	    n = len;
+	}
+	memcpy(c->data + c->len, s, n);
+	c->len += n;
+	s += n;
+	len -= n;
+	tracef_size += n;
+    }
+
+    if (trace_flush_id == NULL_IOID) {
+	trace_flush_id = AddTimeOut(appres.trace_flush_interval,
+		trace_flush_timeout);
+    }
+    return true;
+}
+
+/*
+ * Write out the trace chunks.
+ *
+ * @return true for success, false if the trace file could not be written
+ */
+static bool
+trace_flush(void)
+{
+    unsigned i;
+    bool any = false;
+    bool failed = false;
+    int save_errno = 0;
+
+    if (trace_flush_id != NULL_IOID) {
+	RemoveTimeOut(trace_flush_id);
+	trace_flush_id = NULL_IOID;
+    }
+    if (trace_chunks == NULL) {
+	return true;
+    }
+
+    for (i = 0; i <= trace_chunk_cur; i++) {
+	trace_chunk_t *c = &trace_chunks[i];
+
+	if (c->len > 0) {
+	    any = true;
+	    if (!failed && tracef != NULL &&
+		    fwrite(c->data, c->len, 1, tracef) != 1) {
+		failed = true;
+		save_errno = errno;
+	    }
+	    c->len = 0;
+	}
+    }
+    trace_chunk_cur = 0;
+    if (!any || tracef == NULL) {
+	return true;
+    }
+    if (!failed && fflush(tracef) != 0) {
+	failed = true;
+	save_errno = errno;
+    }
+
+    if (failed) {
+	/* Stop first, so the pop-up does not try to trace. */
+	stop_tracing();
+	if (save_errno != EPIPE) {
+	    popup_an_errno(save_errno, "Write to trace file failed");
+	}
+	return false;
+    }
+    return true;
+}
+
+/* Flush buffered trace data on exit. */
+static void
+trace_exiting(bool ignored _is_unused)
+{
+    trace_flush();
+}
+
+/* Flush buffered trace data when the process exits without notice. */
+static void
+trace_atexit(void)
+{
+    trace_flush();
+}
+
+/*
+ * Set up buffered tracing, if a flush interval is configured.
+ */
+static void
+trace_buffer_init(void)
+{
+    static bool initted = false;
+
+    trace_buffered = appres.trace_flush_interval > 0;
+    if (!trace_buffered || initted) {
+	return;
+    }
+    initted = true;
+
+    trace_chunks = (trace_chunk_t *)Malloc(TRACE_CHUNKS *
+	    sizeof(trace_chunk_t));
+    memset(trace_chunks, 0, TRACE_CHUNKS * sizeof(trace_chunk_t));
+    trace_chunk_cur = 0;
+
+    register_schange(ST_EXITING, trace_exiting);
+    atexit(trace_atexit);
+}
+
+/*
+ * Write raw data to the trace file, or to the trace chunks if buffering.
+ *
+ * @param[in] s		Data to write
+ * @param[in] len	Length of data
+ *
+ * @return true for success, false if tracing has been stopped
+ */
+static bool
+trace_write(const char *s, size_t len)
+{
+    if (trace_buffered) {
+	return trace_buffer(s, len);
+    }
+    if (fwrite(s, len, 1, tracef) == 1) {
+	fflush(tracef);
+	return true;
+    }
+    if (errno != EPIPE && !IS_EILSEQ(errno)) {
+	popup_an_errno(errno, "Write to trace file failed");
+    }
+    if (!IS_EILSEQ(errno)) {
+	stop_tracing();
+	return false;
+    }
+    return true;
+}
+
+/* Store a big-endian value. */
+static void
+trace_bin_put(unsigned char *p, uint64_t v, int n)
+{
+    while (n-- > 0) {
+	p[n] = (unsigned char)(v & 0xff);
+	v >>= 8;
+    }
+}
+
+/* Write a binary trace file header. */
+static void
+trace_bin_file_header(void)
+{
+    unsigned char hdr[TRACE_BIN_FILE_HDR_LEN];
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    trace_bin_start = monotonic_us();
+    memcpy(hdr, TRACE_BIN_MAGIC, TRACE_BIN_MAGIC_LEN);
+    hdr[TRACE_BIN_MAGIC_LEN] = TRACE_BIN_VERSION;
+    trace_bin_put(hdr + TRACE_BIN_MAGIC_LEN + 1,
+	    ((uint64_t)tv.tv_sec * 1000000ULL) + tv.tv_usec, 8);
+    if (trace_write((char *)hdr, sizeof(hdr)) && !trace_buffered) {
+	tracef_size = ftello(tracef);
+    }
+}
+
+/*
+ * Write a binary trace record.
+ *
+ * @param[in] type	Record type
+ * @param[in] arg	Type-specific argument
+ * @param[in] data	Record data
+ * @param[in] len	Length of data
+ */
+static void
+trace_bin_record(trace_bin_type_t type, unsigned char arg, const char *data,
+	size_t len)
+{
+    unsigned char hdr[TRACE_BIN_REC_HDR_LEN];
+
+    hdr[0] = type;
+    hdr[1] = arg;
+    trace_bin_put(hdr + 2, len, 4);
+    trace_bin_put(hdr + 6, monotonic_us() - trace_bin_start, 8);
+    if (trace_write((char *)hdr, sizeof(hdr)) &&
+	    (len == 0 || trace_write(data, len)) &&
+	    !trace_buffered) {
+	tracef_size = ftello(tracef);
+    }
+}
+
+/*
+ * Trace network data in binary form, if the binary trace format is in use.
+ *
+ * @param[in] direction	'<' for input, '>' for output
+ * @param[in] buf	Data
+ * @param[in] len	Length of data
+ *
+ * @return true if the data was traced, false if it needs to be traced as text
+ */
+bool
+trace_netdata_bin(char direction, unsigned const char *buf, size_t len)
+{
+    if (!trace_binary || tracef == NULL || tracef_bufptr != NULL) {
+	return false;
+    }
+    trace_bin_record(TRB_NETDATA, direction, (const char *)buf, len);
+    return true;
+}
+
 /*
  * Write to the trace file, varargs style.
  * This is the only function that actually does output to the trace file --
  * all others are wrappers around this function.
+ *
+ * If a flush interval is configured, output is accumulated in the trace
+ * chunks and written out when the interval expires or the chunks fill up.
+ * Otherwise, each line is written and flushed immediately.
+ *
+ * In binary format, the whole message becomes one text record, and
+ * timestamps are added by the decoder.
  */
 static void
 vwtrace(bool do_ts, const char *fmt, va_list args)
 {
-    size_t n2w_left, n2w, nw;
+    size_t n2w_left, n2w;
     char *ts;
-    char *buf = NULL;
     char *bp;
 
     /* Ugly hack to write into a memory buffer. */
@@ -330,9 +631,12 @@ vwtrace(bool do_ts, const char *fmt, va_list args)
 
     ts = NULL;
 
-    buf = Vasprintf(fmt, args);
-    n2w_left = strlen(buf);
-    bp = buf;
+    bp = trace_vformat(fmt, args, &n2w_left);
+
+    if (trace_binary) {
+	trace_bin_record(TRB_TEXT, do_ts, bp, n2w_left);
+	return;
+    }
 
     while (n2w_left > 0) {
 	char *nl;
@@ -342,12 +646,13 @@ vwtrace(bool do_ts, const char *fmt, va_list args)
 	    if (ts == NULL) {
 		ts = gen_ts();
 	    }
-	    fwrite(ts, strlen(ts), 1, tracef);
-	    fflush(tracef);
+	    if (!trace_write(ts, strlen(ts))) {
+		return;
+	    }
 	    wrote_ts = true;
 	}
 
-	nl = strchr(bp, '\n');
+	nl = memchr(bp, '\n', n2w_left);
 	if (nl != NULL) {
 	    wrote_nl = true;
 	    n2w = nl - bp + 1;
@@ -355,17 +660,8 @@ vwtrace(bool do_ts, const char *fmt, va_list args)
 	    n2w = n2w_left;
 	}
 
-	nw = fwrite(bp, n2w, 1, tracef);
-	if (nw == 1) {
-	    fflush(tracef);
-	} else {
-	    if (errno != EPIPE && !IS_EILSEQ(errno)) {
-		popup_an_errno(errno, "Write to trace file failed");
-	    }
-	    if (!IS_EILSEQ(errno)) {
-		stop_tracing();
-		goto done;
-	    }
+	if (!trace_write(bp, n2w)) {
+	    return;
 	}
 
 	if (wrote_nl) {
@@ -376,13 +672,9 @@ vwtrace(bool do_ts, const char *fmt, va_list args)
 	n2w_left -= n2w;
     }
 
-    tracef_size = ftello(tracef);
-
-done:
-    if (buf != NULL) {
-	Free(buf);
+    if (!trace_buffered) {
+	tracef_size = ftello(tracef);
     }
-    return;
 }
 
 /* Write to the trace file. */
@@ -401,6 +693,7 @@ wtrace(bool do_ts, const char *fmt, ...)
 static void
 stop_tracing(void)
 {
+    trace_flush();
     if (tracef != NULL && tracef != stdout) {
 	fclose(tracef);
     }
@@ -429,6 +722,10 @@ trace_rollover_check(void)
 
 	/* Close up this file. */
 	wtrace(true, "Trace rolled over\n");
+	trace_flush();
+	if (tracef == NULL) {
+	    return;
+	}
 	fclose(tracef);
 	tracef = NULL;
 
@@ -447,7 +744,7 @@ trace_rollover_check(void)
 	rename(tracefile_name, alt_filename);
 	Free(alt_filename);
 	alt_filename = NULL;
-	tracef = fopen(tracefile_name, "w");
+	tracef = fopen(tracefile_name, trace_binary? "wb": "w");
 	if (tracef == NULL) {
 	    popup_an_errno(errno, "%s", tracefile_name);
 	    return;
@@ -456,6 +753,9 @@ trace_rollover_check(void)
 	/* Initialize it. */
 	tracef_size = 0L;
 	SETLINEBUF(tracef);
+	if (trace_binary) {
+	    trace_bin_file_header();
+	}
 	new_header = create_tracefile_header("rolled over");
 	wtrace(false, new_header);
 	Free(new_header);
@@ -775,6 +1075,16 @@ tracefile_ok(const char *tfn)
     }
 
     tracef_max = 0;
+    trace_buffer_init();
+    trace_binary = false;
+    if (appres.trace_format != NULL) {
+	if (!strcasecmp(appres.trace_format, "binary")) {
+	    trace_binary = true;
+	} else if (strcasecmp(appres.trace_format, "text")) {
+	    popup_an_error("Invalid %s '%s', using 'text'", ResTraceFormat,
+		    appres.trace_format);
+	}
+    }
 
     if (!strcmp(stfn, "stdout")) {
 	tracef = stdout;
@@ -790,12 +1100,12 @@ tracefile_ok(const char *tfn)
 
 	/* Open and configure the file. */
 	if ((devfd = get_devfd(stfn)) >= 0)
-	    tracef = fdopen(dup(devfd), "a");
+	    tracef = fdopen(dup(devfd), trace_binary? "ab": "a");
 	else if (!strncmp(stfn, ">>", 2)) {
 	    append = true;
-	    tracef = fopen(stfn + 2, "a");
+	    tracef = fopen(stfn + 2, trace_binary? "ab": "a");
 	} else {
-	    tracef = fopen(stfn, "w");
+	    tracef = fopen(stfn, trace_binary? "wb": "w");
 	}
 	if (tracef == NULL) {
 	    popup_an_errno(errno, "%s", stfn);
@@ -823,6 +1133,10 @@ tracefile_ok(const char *tfn)
 
     Free(stfn);
 
+    if (trace_binary) {
+	trace_bin_file_header();
+    }
+
     /* We're really tracing, turn the flag on. */
     set_toggle(trace_reason, true);
     menubar_retoggle(trace_reason);
@@ -0,0 +1,250 @@
+/*
+ * Copyright (c) 2024 Paul Mattes.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of Paul Mattes nor the names of his contributors
+ *       may be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+/*
+ *	trcdecode.c
+ *		Decode a binary trace file into the text trace format.
+ */
+
+#include "globals.h"
+
+#if defined(_WIN32) /*[*/
+# include <fcntl.h>
+# include <io.h>
+#endif /*]*/
+
+#include "trace_bin.h"
+
+#define LINEDUMP_MAX	32
+
+static char *me;
+static bool wrote_ts = false;
+static uint64_t wall_start = 0;
+
+void
+usage(const char *s)
+{
+    if (s != NULL) {
+	fprintf(stderr, "%s\n", s);
+    }
+    fprintf(stderr, "usage: %s [file]\n", me);
+    exit(1);
+}
+
+/* Fetch a big-endian value. */
+static uint64_t
+get_be(const unsigned char *p, int n)
+{
+    uint64_t v = 0;
+
+    while (n-- > 0) {
+	v = (v << 8) | *p++;
+    }
+    return v;
+}
+
+/* Print a timestamp in the same form as the emulator does. */
+static void
+print_ts(uint64_t offset_us)
+{
+    uint64_t us = wall_start + offset_us;
+    time_t t = (time_t)(us / 1000000ULL);
+    struct tm *tm = localtime(&t);
+
+    printf("%d%02d%02d.%02d%02d%02d.%03d ",
+	    tm->tm_year + 1900,
+	    tm->tm_mon + 1,
+	    tm->tm_mday,
+	    tm->tm_hour,
+	    tm->tm_min,
+	    tm->tm_sec,
+	    (int)((us % 1000000ULL) / 1000ULL));
+}
+
+/* Decode a text record, adding timestamps at the start of each line. */
+static void
+decode_text(const char *buf, size_t len, bool do_ts, uint64_t when)
+{
+    while (len > 0) {
+	const char *nl;
+	size_t n2w;
+
+	if (do_ts && !wrote_ts) {
+	    print_ts(when);
+	    wrote_ts = true;
+	}
+	nl = memchr(buf, '\n', len);
+	n2w = (nl != NULL)? (size_t)(nl - buf + 1): len;
+	fwrite(buf, n2w, 1, stdout);
+	if (nl != NULL) {
+	    wrote_ts = false;
+	}
+	buf += n2w;
+	len -= n2w;
+    }
+}
+
+/* Decode a network data record into a hex dump. */
+static void
+decode_netdata(char direction, const unsigned char *buf, size_t len)
+{
+    size_t offset;
+
+    for (offset = 0; offset < len; offset++) {
+	if (!(offset % LINEDUMP_MAX)) {
+	    printf("%s%c 0x%-3x ", (offset? "\n": ""), direction,
+		    (unsigned)offset);
+	}
+	printf("%02x", buf[offset]);
+    }
+    printf("\n");
+    wrote_ts = false;
+}
+
+/* Read exactly n bytes. Returns false at EOF. */
+static bool
+read_n(FILE *f, void *buf, size_t n, const char *what)
+{
+    size_t nr;
+
+    if (n == 0) {
+	return true;
+    }
+    nr = fread(buf, 1, n, f);
+    if (nr == n) {
+	return true;
+    }
+    if (ferror(f)) {
+	perror(me);
+	exit(1);
+    }
+    if (nr != 0 || what != NULL) {
+	fprintf(stderr, "%s: truncated %s\n", me, what? what: "record");
+	exit(1);
+    }
+    return false;
+}
+
+/* Decode a whole file. */
+static void
+decode(FILE *f)
+{
+    unsigned char hdr[TRACE_BIN_REC_HDR_LEN];
+    unsigned char *data = NULL;
+    size_t data_size = 0;
+    bool first = true;
+
+    while (read_n(f, hdr, 1, first? "file header": NULL)) {
+	size_t len;
+	uint64_t when;
+
+	/* A file header can appear anywhere a record can. */
+	if (hdr[0] == TRACE_BIN_MAGIC[0]) {
+	    unsigned char fhdr[TRACE_BIN_FILE_HDR_LEN];
+
+	    fhdr[0] = hdr[0];
+	    read_n(f, fhdr + 1, sizeof(fhdr) - 1, "file header");
+	    if (memcmp(fhdr, TRACE_BIN_MAGIC, TRACE_BIN_MAGIC_LEN)) {
+		fprintf(stderr, "%s: not a binary trace file\n", me);
+		exit(1);
+	    }
+	    if (fhdr[TRACE_BIN_MAGIC_LEN] != TRACE_BIN_VERSION) {
+		fprintf(stderr, "%s: unsupported format version %d\n", me,
+			fhdr[TRACE_BIN_MAGIC_LEN]);
+		exit(1);
+	    }
+	    wall_start = get_be(fhdr + TRACE_BIN_MAGIC_LEN + 1, 8);
+	    first = false;
+	    continue;
+	}
+	if (first) {
+	    fprintf(stderr, "%s: not a binary trace file\n", me);
+	    exit(1);
+	}
+
+	read_n(f, hdr + 1, sizeof(hdr) - 1, "record header");
+	len = (size_t)get_be(hdr + 2, 4);
+	when = get_be(hdr + 6, 8);
+	if (len > data_size) {
+	    data_size = len;
+	    data = realloc(data, data_size);
+	    if (data == NULL) {
+		fprintf(stderr, "%s: out of memory\n", me);
+		exit(1);
+	    }
+	}
+	read_n(f, data, len, "record");
+
+	switch (hdr[0]) {
+	case TRB_TEXT:
+	    decode_text((char *)data, len, hdr[1] != 0, when);
+	    break;
+	case TRB_NETDATA:
+	    decode_netdata((char)hdr[1], data, len);
+	    break;
+	default:
+	    /* Skip unknown record types. */
+	    break;
+	}
+    }
+    free(data);
+}
+
+int
+main(int argc, char *argv[])
+{
+    FILE *f = stdin;
+
+    if ((me = strrchr(argv[0], '/')) != NULL) {
+	me++;
+    } else {
+	me = argv[0];
+    }
+
+    if (argc > 2 || (argc == 2 && argv[1][0] == '-' && argv[1][1])) {
+	usage(NULL);
+    }
+    if (argc == 2 && strcmp(argv[1], "-")) {
+	f = fopen(argv[1], "rb");
+	if (f == NULL) {
+	    perror(argv[1]);
+	    exit(1);
+	}
+    }
+#if defined(_WIN32) /*[*/
+    else {
+	_setmode(_fileno(stdin), _O_BINARY);
+    }
+#endif /*]*/
+
+    decode(f);
+    if (f != stdin) {
+	fclose(f);
+    }
+    return 0;
+}
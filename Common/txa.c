@@ -52,6 +52,27 @@ static txa_block_t **last_block = &blocks;
 static txa_block_t *current_block;
 static int slot_ix = 0;
 
+/*
+ * Short-lived strings are carved out of arena chunks, which are reset in one
+ * shot by txflush() instead of being freed one at a time. The most recent
+ * chunk and the first slot block are kept across transactions, so a typical
+ * transaction does not call malloc at all.
+ */
+#define ARENA_SIZE	16384	/* bytes per arena chunk */
+#define ARENA_ALIGN	16	/* alignment of arena allocations */
+#define ARENA_ROUND(n)	(((n) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+#define ARENA_MAX	(ARENA_SIZE / 4) /* largest arena allocation */
+
+typedef struct txa_arena {
+    struct txa_arena *next;
+    size_t used;
+    union {
+	char data[ARENA_SIZE];
+	long double align;
+    } u;
+} txa_arena_t;
+static txa_arena_t *arena;	/* current arena chunk, most recent first */
+
 /**
  * Do a deferred free on a malloc'd block of memory.
  *
@@ -76,7 +97,59 @@ txdFree(void *buf)
 }
 
 /**
- * Format a string into malloc'd memory and do a deferred free on it.
+ * Start a new arena chunk.
+ */
+static void
+arena_new(void)
+{
+    txa_arena_t *a = (txa_arena_t *)Malloc(sizeof(txa_arena_t));
+
+    a->next = arena;
+    a->used = 0;
+    arena = a;
+}
+
+/**
+ * Allocate transaction memory from the arena.
+ *
+ * @param[in] len	Length needed
+ *
+ * @return Buffer, or NULL if len is too big for an arena chunk
+ */
+static void *
+arena_alloc(size_t len)
+{
+    void *r;
+
+    if (len > ARENA_MAX) {
+	return NULL;
+    }
+    len = ARENA_ROUND(len);
+    if (arena == NULL || arena->used + len > ARENA_SIZE) {
+	arena_new();
+    }
+    r = arena->u.data + arena->used;
+    arena->used += len;
+    return r;
+}
+
+/**
+ * Allocate memory that will be freed at the end of the transaction.
+ *
+ * @param[in] len	Length needed
+ *
+ * @return Buffer
+ */
+static void *
+tx_alloc(size_t len)
+{
+    void *r = arena_alloc(len);
+
+    return (r != NULL)? r: txdFree(Malloc(len));
+}
+
+/**
+ * Format a string into transaction memory.
  *
  * @param[in] fmt	Format
  *
@@ -89,13 +162,13 @@ txAsprintf(const char *fmt, ...)
     char *r;
 
     va_start(args, fmt);
-    r = Vasprintf(fmt, args);
+    r = txVasprintf(fmt, args);
     va_end(args);
-    return txdFree(r);
+    return r;
 }
 
 /**
- * Format a string into malloc'd memory and do a deferred free on it.
+ * Format a string into transaction memory.
  * Varargs version.
  *
  * @param[in] fmt	Format
@@ -106,7 +179,42 @@ txAsprintf(const char *fmt, ...)
 char *
 txVasprintf(const char *fmt, va_list args)
 {
-    return txdFree(Vasprintf(fmt, args));
+    va_list ap;
+    size_t room;
+    char *r;
+    int len;
+
+    if (arena == NULL || arena->used >= ARENA_SIZE) {
+	arena_new();
+    }
+    room = ARENA_SIZE - arena->used;
+    r = arena->u.data + arena->used;
+
+    /* Try formatting directly into the free space in the current chunk. */
+    va_copy(ap, args);
+#if defined(_WIN32) /*[*/
+    len = vscprintf(fmt, ap);
+#else /*][*/
+    len = vsnprintf(r, room, fmt, ap);
+#endif /*]*/
+    va_end(ap);
+    if (len < 0) {
+	Error("txVasprintf: vsnprintf failure");
+    }
+    if ((size_t)len >= room) {
+	/* Too big. Now that the length is known, allocate and try again. */
+	r = tx_alloc((size_t)len + 1);
+	vsnprintf(r, (size_t)len + 1, fmt, args);
+    } else {
+#if defined(_WIN32) /*[*/
+	vsnprintf(r, room, fmt, args);
+#endif /*]*/
+	arena->used += ARENA_ROUND((size_t)len + 1);
+	if (arena->used > ARENA_SIZE) {
+	    arena->used = ARENA_SIZE;
+	}
+    }
+    return r;
 }
 
 /**
@@ -116,10 +224,12 @@ void
 txflush(void)
 {
     unsigned nf = 0;
+    size_t na = 0;
 #if defined(HAVE_MALLOC_USABLE_SIZE) /*[*/
     size_t nb = 0;
 #endif /*]*/
     txa_block_t *r, *next = NULL;
+    txa_arena_t *a, *next_a = NULL;
 
     for (r = blocks; r != NULL; r = next) {
 	int i;
@@ -131,25 +241,45 @@ txflush(void)
 		nb += malloc_usable_size(r->slot[i]);
 #endif /*]*/
 		Free(r->slot[i]);
+		r->slot[i] = NULL;
 		nf++;
 	    }
 	}
-	Free(r);
+	if (r != blocks) {
+	    Free(r);
+	}
     }
 
-    current_block = NULL;
-    blocks = NULL;
-    last_block = &blocks;
+    /* Keep the first slot block. */
+    if (blocks != NULL) {
+	blocks->next = NULL;
+	last_block = &blocks->next;
+    }
+    current_block = blocks;
     slot_ix = 0;
 
+    /* Reset the arena, keeping the most recent chunk. */
+    for (a = arena; a != NULL; a = next_a) {
+	next_a = a->next;
+	na += a->used;
+	if (a != arena) {
+	    Free(a);
+	}
+    }
+    if (arena != NULL) {
+	arena->next = NULL;
+	arena->used = 0;
+    }
+
 #if defined(HAVE_MALLOC_USABLE_SIZE) /*[*/
-    if (nf > 10 || nb > 1024) {
-	vtrace("txflush: %u slot%s, %zu bytes\n", nf, (nf == 1)? "": "s",
-		nb);
+    if (nf > 10 || nb + na > 1024) {
+	vtrace("txflush: %u slot%s, %zu bytes, %zu arena bytes\n", nf,
+		(nf == 1)? "": "s", nb, na);
     }
 #else /*][*/
-    if (nf > 10) {
-	vtrace("txflush: %u slot%s\n", nf, (nf == 1)? "": "s");
+    if (nf > 10 || na > 1024) {
+	vtrace("txflush: %u slot%s, %zu arena bytes\n", nf,
+		(nf == 1)? "": "s", na);
     }
 #endif /*]*/
 }
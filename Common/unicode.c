@@ -363,6 +363,32 @@ cpalias_t cpaliases[] = {
 
 static uni_t *cur_uni = NULL;
 
+/*
+ * Unicode-to-EBCDIC translation maps. These are two-level tables indexed by
+ * the high and low bytes of a BMP code point, with pages allocated only
+ * where there are translations.
+ */
+typedef struct {
+    unsigned char *page[256];
+} u2e_map_t;
+static u2e_map_t u2e_base;	/* current code page */
+static u2e_map_t u2e_apl;	/* APL (GE) characters */
+static bool u2e_apl_built = false;
+
+/*
+ * Cached EBCDIC-to-multibyte tables for the current code page. Tables are
+ * not freed until the code page changes, so callers can hold on to them.
+ */
+static e2mb_table_t **e2mb_cache = NULL;
+static int e2mb_count = 0;
+static e2mb_table_t *e2mb_last = NULL;
+
+static size_t e2mb_xlate(ebc_t ebc, unsigned char cs, char mb[],
+	size_t mb_len, unsigned flags, ucs4_t *ucp);
+static size_t e2utf8_xlate(ebc_t ebc, unsigned char cs, char mb[],
+	size_t mb_len, unsigned flags, ucs4_t *ucp);
+static void e2mb_flush(void);
+
 static void
 codepage_list_one(bool dbcs)
 {
@@ -500,6 +526,53 @@ ebcdic_base_to_unicode(ebc_t c, unsigned flags)
     }
 }
 
+/*
+ * Look up a character in a Unicode-to-EBCDIC map.
+ * Returns 0 if there is no translation.
+ */
+static unsigned char
+u2e_map_get(const u2e_map_t *m, ucs4_t u)
+{
+    if (u > 0xffff || m->page[u >> 8] == NULL) {
+	return 0;
+    }
+    return m->page[u >> 8][u & 0xff];
+}
+
+/*
+ * Add a translation to a Unicode-to-EBCDIC map. The first translation added
+ * for a given character wins.
+ */
+static void
+u2e_map_add(u2e_map_t *m, ucs4_t u, unsigned char e)
+{
+    if (u == 0 || u > 0xffff) {
+	return;
+    }
+    if (m->page[u >> 8] == NULL) {
+	m->page[u >> 8] = (unsigned char *)Calloc(256, 1);
+    }
+    if (m->page[u >> 8][u & 0xff] == 0) {
+	m->page[u >> 8][u & 0xff] = e;
+    }
+}
+
+/*
+ * Empty a Unicode-to-EBCDIC map.
+ */
+static void
+u2e_map_clear(u2e_map_t *m)
+{
+    int i;
+
+    for (i = 0; i < 256; i++) {
+	if (m->page[i] != NULL) {
+	    Free(m->page[i]);
+	    m->page[i] = NULL;
+	}
+    }
+}
+
 /*
  * Map a UCS-4 character to an EBCDIC character.
  * Returns 0 for failure, nonzero for success.
@@ -507,7 +580,7 @@ ebcdic_base_to_unicode(ebc_t c, unsigned flags)
 ebc_t
 unicode_to_ebcdic(ucs4_t u)
 {
-    int i;
+    ebc_t e;
     ebc_t d;
 
     if (!u) {
@@ -517,10 +590,8 @@ unicode_to_ebcdic(ucs4_t u)
 	return 0x40;
     }
 
-    for (i = 0; i < UT_SIZE; i++) {
-	if (cur_uni->code[i] == u) {
-	    return UT_OFFSET + i;
-	}
+    if ((e = u2e_map_get(&u2e_base, u)) != 0) {
+	return e;
     }
     /* See if it's DBCS. */
     d = unicode_to_ebcdic_dbcs(u);
@@ -546,14 +617,17 @@ unicode_to_ebcdic_ge(ucs4_t u, bool *ge, bool prefer_apl)
     e_cur = unicode_to_ebcdic(u);
 
     /* Find the character in the APL code page. */
-    for (e_apl = 0x70; e_apl <= 0xfe; e_apl++) {
-	if ((ucs4_t)apl_to_unicode(e_apl, EUO_NONE) == u) {
-	    break;
+    if (!u2e_apl_built) {
+	for (e_apl = 0x70; e_apl <= 0xfe; e_apl++) {
+	    int iuc = apl_to_unicode(e_apl, EUO_NONE);
+
+	    if (iuc > 0) {
+		u2e_map_add(&u2e_apl, (ucs4_t)iuc, (unsigned char)e_apl);
+	    }
 	}
+	u2e_apl_built = true;
     }
-    if (e_apl > 0xfe) {
-	e_apl = 0;
-    }
+    e_apl = u2e_map_get(&u2e_apl, u);
 
     if (e_apl != 0 && ((e_cur == 0) || prefer_apl)) {
 	*ge = true;
@@ -638,7 +712,16 @@ set_uni(const char *cpname, int local_cp _is_unused,
 	    continue;
 	}
 	if (!strcasecmp(realname, uni[i].name)) {
+	    int j;
+
 	    cur_uni = &uni[i];
+
+	    /* Rebuild the translation tables. */
+	    u2e_map_clear(&u2e_base);
+	    for (j = 0; j < UT_SIZE; j++) {
+		u2e_map_add(&u2e_base, cur_uni->code[j], UT_OFFSET + j);
+	    }
+	    e2mb_flush();
 	    *host_codepage = uni[i].host_codepage;
 	    *cgcsgid = uni[i].cgcsgid;
 	    if (realnamep != NULL) {
@@ -892,6 +975,28 @@ fail:
 size_t
 ebcdic_to_multibyte_x(ebc_t ebc, unsigned char cs, char mb[],
 	size_t mb_len, unsigned flags, ucs4_t *ucp)
+{
+    if (ebc < 0x100 && cur_uni != NULL) {
+	const e2mb_table_t *t = ebcdic_to_multibyte_table(cs, flags, false);
+
+	if (mb_len >= t->len[ebc]) {
+	    memcpy(mb, t->mb[ebc], t->len[ebc]);
+	    if (ucp != NULL) {
+		*ucp = t->uc[ebc];
+	    }
+	    return t->len[ebc];
+	}
+    }
+    return e2mb_xlate(ebc, cs, mb, mb_len, flags, ucp);
+}
+
+/*
+ * Translate an EBCDIC character to the current locale's multi-byte
+ * representation, without using the cached tables.
+ */
+static size_t
+e2mb_xlate(ebc_t ebc, unsigned char cs, char mb[], size_t mb_len,
+	unsigned flags, ucs4_t *ucp)
 {
     ucs4_t uc;
 #if defined(_WIN32) /*[*/
@@ -1054,29 +1159,109 @@ ebcdic_to_multibyte_fx(ebc_t ebc, unsigned char cs, char mb[], size_t mb_len,
 	unsigned flags, ucs4_t *ucp, bool force_utf8)
 {
     if (force_utf8) {
-	ucs4_t ucs4;
-	int len;
-
 	if (mb_len < 7) {
 	    mb[0] = '\0';
 	    return 1;
 	}
-	ucs4 = ebcdic_to_unicode(ebc, cs, flags);
-	if (ucs4 == 0 && (flags & EUO_BLANK_UNDEF) != 0) {
-	    ucs4 = ' ';
-	}
-	*ucp = ucs4;
-	len = unicode_to_utf8(ucs4, mb);
-	if (len < 0) {
-	    len = 0;
+	if (ebc < 0x100 && cur_uni != NULL) {
+	    const e2mb_table_t *t = ebcdic_to_multibyte_table(cs, flags, true);
+
+	    memcpy(mb, t->mb[ebc], t->len[ebc]);
+	    *ucp = t->uc[ebc];
+	    return t->len[ebc];
 	}
-	mb[len++] = '\0';
-	return len;
+	return e2utf8_xlate(ebc, cs, mb, mb_len, flags, ucp);
     } else {
 	return ebcdic_to_multibyte_x(ebc, cs, mb, mb_len, flags, ucp);
     }
 }
 
+/*
+ * Translate an EBCDIC character to UTF-8, without using the cached tables.
+ */
+static size_t
+e2utf8_xlate(ebc_t ebc, unsigned char cs, char mb[], size_t mb_len _is_unused,
+	unsigned flags, ucs4_t *ucp)
+{
+    ucs4_t ucs4;
+    int len;
+
+    ucs4 = ebcdic_to_unicode(ebc, cs, flags);
+    if (ucs4 == 0 && (flags & EUO_BLANK_UNDEF) != 0) {
+	ucs4 = ' ';
+    }
+    *ucp = ucs4;
+    len = unicode_to_utf8(ucs4, mb);
+    if (len < 0) {
+	len = 0;
+    }
+    mb[len++] = '\0';
+    return len;
+}
+
+/*
+ * Discard the cached EBCDIC-to-multibyte tables.
+ */
+static void
+e2mb_flush(void)
+{
+    int i;
+
+    for (i = 0; i < e2mb_count; i++) {
+	Free(e2mb_cache[i]);
+    }
+    Replace(e2mb_cache, NULL);
+    e2mb_count = 0;
+    e2mb_last = NULL;
+}
+
+/*
+ * Return the SBCS EBCDIC-to-multibyte translation table for a character set
+ * and set of EUO_XXX flags in the current code page, building it if
+ * necessary. Each entry is what ebcdic_to_multibyte_fx() would return for
+ * that EBCDIC code.
+ */
+const e2mb_table_t *
+ebcdic_to_multibyte_table(unsigned char cs, unsigned flags, bool force_utf8)
+{
+    e2mb_table_t *t;
+    int i;
+
+    if (e2mb_last != NULL && e2mb_last->cs == cs &&
+	    e2mb_last->flags == flags && e2mb_last->force_utf8 == force_utf8) {
+	return e2mb_last;
+    }
+    for (i = 0; i < e2mb_count; i++) {
+	t = e2mb_cache[i];
+	if (t->cs == cs && t->flags == flags && t->force_utf8 == force_utf8) {
+	    e2mb_last = t;
+	    return t;
+	}
+    }
+
+    /* Build a new one. */
+    t = (e2mb_table_t *)Malloc(sizeof(e2mb_table_t));
+    e2mb_cache = (e2mb_table_t **)Realloc(e2mb_cache,
+	    (e2mb_count + 1) * sizeof(e2mb_table_t *));
+    e2mb_cache[e2mb_count++] = t;
+    t->cs = cs;
+    t->flags = flags;
+    t->force_utf8 = force_utf8;
+    for (i = 0; i < 256; i++) {
+	size_t len;
+
+	t->uc[i] = 0;
+	if (force_utf8) {
+	    len = e2utf8_xlate(i, cs, t->mb[i], E2MB_MAX, flags, &t->uc[i]);
+	} else {
+	    len = e2mb_xlate(i, cs, t->mb[i], E2MB_MAX, flags, &t->uc[i]);
+	}
+	t->len[i] = (unsigned char)len;
+    }
+    e2mb_last = t;
+    return t;
+}
+
 /*
  * Convert an EBCDIC string to a multibyte string.
  * Makes lots of assumptions: standard character set, EUO_BLANK_UNDEF.
@@ -1086,12 +1271,18 @@ size_t
 ebcdic_to_multibyte_string(unsigned char *ebc, size_t ebc_len, char mb[],
 	size_t mb_len)
 {
+    const e2mb_table_t *t = ebcdic_to_multibyte_table(CS_BASE,
+	    EUO_BLANK_UNDEF, false);
     size_t nmb = 0;
 
     while (ebc_len && mb_len) {
-	size_t xlen;
+	size_t xlen = t->len[*ebc];
 
-	xlen = ebcdic_to_multibyte(*ebc, mb, mb_len);
+	if (mb_len < xlen) {
+	    xlen = ebcdic_to_multibyte(*ebc, mb, mb_len);
+	} else {
+	    memcpy(mb, t->mb[*ebc], xlen);
+	}
 	if (xlen) {
 	    mb += xlen - 1;
 	    mb_len -= (xlen - 1);
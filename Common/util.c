@@ -1008,6 +1008,25 @@ display_scale(double d)
     }
 }
 
+/* Return the current monotonic time, in microseconds. */
+uint64_t
+monotonic_us(void)
+{
+#if defined(_WIN32) /*[*/
+    return (uint64_t)GetTickCount64() * 1000ULL;
+#elif defined(CLOCK_MONOTONIC) /*][*/
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((uint64_t)ts.tv_sec * 1000000ULL) + (ts.tv_nsec / 1000);
+#else /*][*/
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+    return ((uint64_t)tv.tv_sec * 1000000ULL) + tv.tv_usec;
+#endif /*]*/
+}
+
 /* Add an element to a dynamically-allocated array. */
 void
 array_add(const char ***s, int ix, const char *v)
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# b3270 file transfer tests
+
+import json
+from subprocess import Popen, PIPE
+import unittest
+
+import Common.Test.pipeq as pipeq
+import Common.Test.playback as playback
+import Common.Test.cti as cti
+
+class TestB3270Ft(cti.cti):
+
+    # b3270 file transfer statistics test
+    def test_b3270_ft_stats(self):
+
+        # Start 'playback' to talk to b3270.
+        playback_port, ts = cti.unused_port()
+        with playback.playback(self, 's3270/Test/ft_dft.trc', port=playback_port) as p:
+            ts.close()
+
+            # Start b3270.
+            b3270 = Popen(cti.vgwrap(['b3270', '-json', '-set', 'wrongTerminalName']), stdin=PIPE, stdout=PIPE)
+            self.children.append(b3270)
+            pq = pipeq.pipeq(self, b3270.stdout)
+
+            # Connect and do the transfer.
+            j = { "run": { "actions": [
+                { "action": "Open", "args": [f"127.0.0.1:{playback_port}"] },
+                { "action": "Transfer", "args": ["direction=send", "host=tso", "localfile=s3270/Test/fttext", "hostfile=fttext"] },
+                { "action": "PF", "args": ["3"] } ] } }
+            b3270.stdin.write(json.dumps(j).encode('utf8') + b'\n')
+            b3270.stdin.flush()
+            p.match()
+
+            # Collect the file transfer indications, up to the end of the run.
+            fts = []
+            while True:
+                out = json.loads(pq.get(2, 'b3270 did not complete the transfer').decode('utf8'))
+                if 'ft' in out:
+                    fts.append(out['ft'])
+                if 'run-result' in out:
+                    self.assertTrue(out['run-result']['success'])
+                    break
+
+        # Check the statistics.
+        running = [ft for ft in fts if ft['state'] == 'running' and 'buffers' in ft]
+        self.assertNotEqual([], running)
+        for ft in running:
+            self.assertIn('host-wait', ft)
+            self.assertIn('local-time', ft)
+        complete = [ft for ft in fts if ft['state'] == 'complete']
+        self.assertEqual(1, len(complete))
+        ft = complete[0]
+        self.assertTrue(ft['success'])
+        self.assertGreater(ft['buffers'], 0)
+        self.assertGreaterEqual(ft['buffers'], running[-1]['buffers'])
+        self.assertLessEqual(ft['host-wait-max'], ft['host-wait'])
+        self.assertLessEqual(ft['host-wait'] + ft['local-time'], ft['time'])
+
+        # Clean up.
+        b3270.stdin.write(b'"quit"\n')
+        b3270.stdin.flush()
+        b3270.stdin.close()
+        self.vgwait(b3270)
+        pq.close()
+        b3270.stdout.close()
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,84 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# b3270 stdout tests
+
+import os
+from subprocess import Popen, PIPE
+import unittest
+
+import Common.Test.cti as cti
+import Common.Test.pipeq as pipeq
+
+class TestB3270Stdout(cti.cti):
+
+    # b3270 stdout flags test
+    @unittest.skipUnless(os.path.isdir('/proc/self/fdinfo'), 'test requires /proc')
+    def test_b3270_stdout_blocking(self):
+
+        # Start b3270.
+        b3270 = Popen(cti.vgwrap(['b3270', '-json']), stdin=PIPE, stdout=PIPE)
+        self.children.append(b3270)
+
+        # Wait for b3270's initialization output.
+        pq = pipeq.pipeq(self, b3270.stdout, limit=1)
+        pq.get(2, 'b3270 did not start')
+
+        # Make sure b3270 has not made its stdout non-blocking. It shares the
+        # open file with whoever started it.
+        with open(f'/proc/{b3270.pid}/fdinfo/1') as f:
+            flags = [int(line.split()[1], 8) for line in f if line.startswith('flags:')][0]
+        self.assertEqual(0, flags & os.O_NONBLOCK)
+
+        # Wait for the process to exit.
+        pq.close()
+        b3270.stdout.close()
+        b3270.stdin.close()
+        self.vgwait(b3270)
+
+    # b3270 slow reader test
+    def test_b3270_stdout_slow_reader(self):
+
+        # Start b3270.
+        b3270 = Popen(cti.vgwrap(['b3270', '-json']), stdin=PIPE, stdout=PIPE)
+        self.children.append(b3270)
+
+        # Generate much more output than the pipe holds, without reading it.
+        count = 200
+        for i in range(count):
+            b3270.stdin.write(b'"readbuffer"\n')
+        b3270.stdin.flush()
+
+        # Read it all back. Every action should have produced its result.
+        out = b3270.communicate(timeout=10)[0].decode('utf8').split('\n')
+        self.assertEqual(count, len([line for line in out if '"run-result"' in line]))
+
+        # Wait for the process to exit.
+        self.vgwait(b3270)
+
+if __name__ == '__main__':
+    unittest.main()
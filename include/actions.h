@@ -65,6 +65,8 @@ bool run_action_entry(action_elt_t *e, enum iaction cause, unsigned count,
 int check_argc(const char *aname, unsigned nargs, unsigned nargs_min,
 	unsigned nargs_max);
 void register_actions(action_table_t *actions, unsigned count);
+action_elt_t *find_action(const char *name);
+action_elt_t *find_action_abbrev(const char *name, bool *ambiguous);
 char *safe_param(const char *s);
 void disable_keyboard(bool disable, bool explicit, const char *why);
 #define DISABLE		true
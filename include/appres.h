@@ -104,6 +104,8 @@ typedef struct {
     char	*trace_dir;
     char	*trace_file;
     char	*trace_file_size;
+    int		 trace_flush_interval;
+    char	*trace_format;
     bool	 trace_monitor;
     bool	 unlock_delay;
     int		 unlock_delay_ms;
@@ -91,6 +91,7 @@
 #define AttrAttribute	"attribute"
 #define AttrBack	"back"
 #define AttrBg		"bg"
+#define AttrBuffers	"buffers"
 #define AttrBuild	"build"
 #define AttrBytes	"bytes"
 #define AttrBytesReceived "bytes-received"
@@ -113,9 +114,12 @@
 #define AttrHost	"host"
 #define AttrHostCert	"host-cert"
 #define AttrHostIp	"host-ip"
+#define AttrHostWait	"host-wait"
+#define AttrHostWaitMax	"host-wait-max"
 #define AttrFg		"fg"
 #define AttrField	"field"
 #define AttrLine	"line"
+#define AttrLocalTime	"local-time"
 #define AttrLogicalColumns "logical-columns"
 #define AttrLogicalRows	"logical-rows"
 #define AttrLu		"lu"
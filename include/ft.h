@@ -48,6 +48,8 @@ void ft_complete(const char *errmsg);
 void ft_init(void);
 void ft_running(bool is_cut);
 void ft_update_length(void);
+void ft_stats_request(void);
+void ft_stats_reply(void);
 bool ft_do_cancel(void);
 void ft_register(void);
 
@@ -109,4 +109,19 @@ typedef struct {
 } ft_tstate_t;
 extern ft_tstate_t fts;
 
+/* Transfer statistics. */
+#define FT_LATENCY_BUCKETS	5	/* <1ms, <10ms, <100ms, <1s, >=1s */
+typedef struct {
+    bool valid;			/* a transfer has started */
+    bool is_cut;		/* CUT mode (else DFT) */
+    size_t length;		/* bytes transferred */
+    unsigned long buffers;	/* host requests processed */
+    uint64_t elapsed_us;	/* total time */
+    uint64_t host_us;		/* time spent waiting for the host */
+    uint64_t host_max_us;	/* longest wait for the host */
+    uint64_t local_us;		/* time spent processing host requests */
+    unsigned long latency[FT_LATENCY_BUCKETS];	/* host wait histogram */
+} ft_stats_t;
+const ft_stats_t *ft_get_stats(void);
+
 #define __FT_PRIVATE_H
@@ -85,6 +85,8 @@ void httpd_set_alias(void *nhandle, const char *text);
 void *httpd_mhandle(void *dhandle);
 void *httpd_new(void *mhandle, const char *client_name);
 httpd_status_t httpd_input(void *dhandle, const char *data, size_t len);
+bool httpd_queued(void *dhandle);
+httpd_status_t httpd_input_queued(void *dhandle);
 void httpd_close(void *dhandle, const char *why);
 
 /* Callable from methods. */
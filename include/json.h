@@ -95,6 +95,28 @@ json_parse_error_t *_json_free_error(json_parse_error_t *error);
 char *json_write_o(const json_t *json, unsigned options);
 #define json_write(j)	json_write_o(j, JW_NONE)
 
+/* Streaming writer, producing the same text as json_write_o(). */
+typedef struct json_writer json_writer_t;
+json_writer_t *json_writer_new(unsigned options);
+json_writer_t *_json_writer_free(json_writer_t *w);
+#define json_writer_free(w) do { \
+    w = _json_writer_free(w); \
+} while (false)
+void json_writer_begin_object(json_writer_t *w, const char *key);
+void json_writer_end_object(json_writer_t *w);
+void json_writer_begin_array(json_writer_t *w, const char *key);
+void json_writer_end_array(json_writer_t *w);
+void json_writer_string(json_writer_t *w, const char *key, const char *value,
+	ssize_t length);
+void json_writer_integer(json_writer_t *w, const char *key, int64_t value);
+void json_writer_double(json_writer_t *w, const char *key, double value);
+void json_writer_boolean(json_writer_t *w, const char *key, bool value);
+void json_writer_node(json_writer_t *w, const char *key, const json_t *json);
+int json_writer_depth(const json_writer_t *w);
+bool json_writer_in_array(const json_writer_t *w);
+const char *json_writer_buf(const json_writer_t *w, size_t *len);
+void json_writer_reset(json_writer_t *w);
+
 /* Returns the type of a JSON object. Works for NULL. */
 json_type_t json_type(const json_t *json);
 #define json_is_null(j)		((j) == NULL)
@@ -51,6 +51,8 @@ struct json {
 	struct {		/* value if object */
 	    unsigned length;
 	    key_value_t *key_values;
+	    unsigned *hash;	/* member index + 1 by key hash, or NULL */
+	    unsigned hash_size;	/* number of hash slots (power of 2) */
 	} v_object;
 	struct {		/* value if array */
 	    unsigned length;
@@ -58,3 +60,18 @@ struct json {
 	} v_array;
     } value;
 };
+
+/* One level of streaming writer nesting. */
+typedef struct {
+    bool is_array;		/* true if array, false if object */
+    bool any;			/* true if any members have been written */
+} json_writer_level_t;
+
+/* Streaming writer state. */
+struct json_writer {
+    varbuf_t r;			/* output buffer */
+    unsigned options;		/* JW_XXX option flags */
+    int depth;			/* current nesting depth */
+    int max_depth;		/* allocated nesting depth */
+    json_writer_level_t *level;	/* nesting stack */
+};
@@ -198,6 +198,7 @@
 #define KwCursor	"Cursor"
 #define KwCursor1	"Cursor1"
 #define KwFormatted	"Formatted"
+#define KwFtStats	"FtStats"
 #define KwHost		"Host"
 #define KwKeymap	"Keymap"
 #define KwLocalEncoding	"LocalEncoding"
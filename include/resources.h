@@ -237,6 +237,8 @@
 #define ResTraceDir		"traceDir"
 #define ResTraceFile		"traceFile"
 #define ResTraceFileSize	"traceFileSize"
+#define ResTraceFlushInterval	"traceFlushInterval"
+#define ResTraceFormat		"traceFormat"
 #define ResTraceMonitor		"traceMonitor"
 #define ResTypeahead		"typeahead"
 #define ResUnderscore		"underscore"
@@ -485,6 +487,8 @@
 #define ClsTraceDir		"TraceDir"
 #define ClsTraceFile		"TraceFile"
 #define ClsTraceFileSize	"TraceFileSize"
+#define ClsTraceFlushInterval	"TraceFlushInterval"
+#define ClsTraceFormat		"TraceFormat"
 #define ClsTraceMonitor		"TraceMonitor"
 #define ClsTypeahead		"Typeahead"
 #define ClsUnderscoreBlankFill	"UnderscoreBlankFill"
@@ -46,6 +46,7 @@ void ntvtrace(const char *fmt, ...) printflike(1, 2);
 void trace_set_trace_file(const char *path);
 void trace_rollover_check(void);
 void tracefile_ok(const char *tfn);
+bool trace_netdata_bin(char direction, unsigned const char *buf, size_t len);
 #if defined(_WIN32) /*[*/
 const char *default_trace_dir(void);
 #endif
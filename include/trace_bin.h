@@ -0,0 +1,60 @@
+/*
+ * Copyright (c) 2024 Paul Mattes.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in the
+ *       documentation and/or other materials provided with the distribution.
+ *     * Neither the names of Paul Mattes nor the names of his contributors
+ *       may be used to endorse or promote products derived from this software
+ *       without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+ * WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+ * EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+ * ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *	trace_bin.h
+ *		Binary trace file format.
+ */
+
+/*
+ * A binary trace file starts with a file header:
+ *   8 bytes	magic number, TRACE_BIN_MAGIC
+ *   1 byte	format version, TRACE_BIN_VERSION
+ *   8 bytes	wall-clock time the file was started, in microseconds since
+ *		the epoch
+ *
+ * The header is followed by records:
+ *   1 byte	record type, a trace_bin_type_t
+ *   1 byte	type-specific argument
+ *   4 bytes	data length
+ *   8 bytes	monotonic time since the file was started, in microseconds
+ *   n bytes	data
+ *
+ * Multi-byte values are big-endian. A file header may appear again in the
+ * middle of a file that was appended to.
+ */
+
+#define TRACE_BIN_MAGIC		"x3trcbin"
+#define TRACE_BIN_MAGIC_LEN	8
+#define TRACE_BIN_VERSION	1
+#define TRACE_BIN_FILE_HDR_LEN	(TRACE_BIN_MAGIC_LEN + 1 + 8)
+#define TRACE_BIN_REC_HDR_LEN	(1 + 1 + 4 + 8)
+
+typedef enum {
+    TRB_TEXT = 1,	/* trace text; argument is 1 if lines get timestamps */
+    TRB_NETDATA = 2	/* network data; argument is the direction, '<' or '>' */
+} trace_bin_type_t;
@@ -48,6 +48,7 @@ typedef enum {
 
 /* Common functions. */
 void ui_io_init(void);
+void ui_flush(void);
 void ui_leaf(const char *name, ...);
 void ui_add_element(const char *name, ui_attr_t attr, ...);
 
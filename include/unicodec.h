@@ -43,6 +43,17 @@ extern bool dbcs_allowed;
 
 #define IS_UNICODE_DBCS(u)	((u) >= 0x2e80 && (u) <= 0x9fff)
 
+/* SBCS EBCDIC-to-multibyte translation table. */
+#define E2MB_MAX	16	/* maximum translation length, with the NUL */
+typedef struct {
+    unsigned char cs;		/* character set */
+    unsigned flags;		/* EUO_XXX flags */
+    bool force_utf8;		/* UTF-8 override */
+    unsigned char len[256];	/* length of each translation, with the NUL */
+    ucs4_t uc[256];		/* Unicode for each EBCDIC code */
+    char mb[256][E2MB_MAX];	/* multibyte for each EBCDIC code */
+} e2mb_table_t;
+
 bool codepage_matches_alias(const char *alias, const char *canon);
 ucs4_t ebcdic_to_unicode(ebc_t e, unsigned char cs, unsigned flags);
 ucs4_t ebcdic_base_to_unicode(ebc_t e, unsigned flags);
@@ -61,6 +72,8 @@ size_t ebcdic_to_multibyte_string(unsigned char *ebc, size_t ebc_len,
 	char mb[], size_t mb_len);
 size_t ebcdic_to_multibyte_x(ebc_t ebc, unsigned char cs, char mb[],
 	size_t mb_len, unsigned flags, ucs4_t *uc);
+const e2mb_table_t *ebcdic_to_multibyte_table(unsigned char cs,
+	unsigned flags, bool force_utf8);
 int mb_max_len(int len);
 enum me_fail {
     ME_NONE,		/* no error */
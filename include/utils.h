@@ -58,9 +58,11 @@ void xs_error(const char *fmt, ...) printflike(1, 2);
 void xs_warning(const char *fmt, ...) printflike(1, 2);
 
 typedef void (*iofn_t)(iosrc_t, ioid_t id);
+typedef void (*iodatafn_t)(iosrc_t, ioid_t id, void *data);
 typedef void (*tofn_t)(ioid_t id);
 typedef void (*childfn_t)(ioid_t id, int status);
 ioid_t AddInput(iosrc_t fd, iofn_t fn);
+ioid_t AddInputData(iosrc_t fd, iodatafn_t fn, void *data);
 ioid_t AddExcept(iosrc_t fd, iofn_t fn);
 ioid_t AddOutput(iosrc_t fd, iofn_t fn);
 #if !defined(_WIN32) /*[*/
@@ -79,6 +81,7 @@ void free_parents(char **parents);
 const char *build_options(void);
 void dump_version(void);
 const char *display_scale(double d);
+uint64_t monotonic_us(void);
 void array_add(const char ***s, int ix, const char *v);
 
 /* Doubly-linked lists. */
@@ -1,2 +1,2 @@
 # Unix-specific object files for lib3270.
-LIB3270U_OBJECTS = find_console.o print_command.o
+LIB3270U_OBJECTS = find_console.o iomux.o print_command.o
@@ -0,0 +1,202 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# pr3287 -lufile tests
+
+import unittest
+from subprocess import Popen, PIPE, DEVNULL
+import os
+import pathlib
+import signal
+import sys
+import tempfile
+import Common.Test.playback as playback
+import Common.Test.cti as cti
+
+@unittest.skipIf(sys.platform.startswith('win'), 'Does not run on Windows')
+@unittest.skipIf(sys.platform == 'cygwin', 'This does some very strange things on Cygwin')
+class TestPr3287Lufile(cti.cti):
+
+    # test for the print-outs being complete
+    def output_check(self, tempdir: str, ref: bytes, names=['out1', 'out2']):
+        for name in names:
+            path = os.path.join(tempdir, name)
+            if not os.path.exists(path) or not pathlib.Path(path).read_bytes().endswith(ref):
+                return False
+        return True
+
+    # pr3287 -lufile test
+    def test_pr3287_lufile(self):
+
+        # Grab the expected output.
+        ref_printout = pathlib.Path('pr3287/Test/smoke.out').read_bytes()
+
+        with tempfile.TemporaryDirectory() as tempdir:
+            # Start two copies of 'playback' to feed data to pr3287.
+            port1, ts1 = cti.unused_port()
+            port2, ts2 = cti.unused_port()
+            with playback.playback(self, 'pr3287/Test/smoke.trc', port=port1) as p1:
+                with playback.playback(self, 'pr3287/Test/smoke.trc', port=port2) as p2:
+                    ts1.close()
+                    ts2.close()
+
+                    # Create the LU file. The first session has its own
+                    # command, the second uses the default.
+                    lufile = os.path.join(tempdir, 'lufile')
+                    with open(lufile, 'w') as f:
+                        f.write('# Test sessions\n\n')
+                        f.write(f"127.0.0.1:{port1} cat >>'{tempdir}/out1'\n")
+                        f.write(f'127.0.0.1:{port2}\n')
+
+                    # Start pr3287.
+                    pr3287 = Popen(cti.vgwrap(['pr3287', '-command',
+                        f"cat >>'{tempdir}/out2'", '-lufile', lufile]))
+                    self.children.append(pr3287)
+
+                    # Play the traces to pr3287.
+                    p1.send_to_mark(1, send_tm=False)
+                    p2.send_to_mark(1, send_tm=False)
+
+                    # Wait for both print-outs to appear.
+                    self.try_until((lambda: self.output_check(tempdir, ref_printout)), 2,
+                        'pr3287 did not produce output')
+
+                    # Stop the sessions through the parent process.
+                    pr3287.send_signal(signal.SIGTERM)
+                    self.children.remove(pr3287)
+                    self.vgwait(pr3287)
+
+    # Start two sessions and send each one the first print job, without the
+    # PRINT-EOJ that ends it. Returns the pr3287 process.
+    def start_partial_jobs(self, tempdir: str, p1, p2, port1: int, port2: int):
+        lufile = os.path.join(tempdir, 'lufile')
+        with open(lufile, 'w') as f:
+            for n, port in [(1, port1), (2, port2)]:
+                f.write(f"127.0.0.1:{port} cat >>'{tempdir}/out{n}'; date >'{tempdir}/done{n}'\n")
+        pr3287 = Popen(cti.vgwrap(['pr3287', '-lufile', lufile]))
+        self.children.append(pr3287)
+
+        # Send the BIND and the four data records, and wait for the response
+        # to the last one, so pr3287 has processed them.
+        for p in [p1, p2]:
+            p.send_records(5, send_tm=False)
+            sent = b''
+            while not sent.endswith(bytes.fromhex('020000000400ffef')):
+                sent += p.nread(1)
+        return pr3287
+
+    # test for both print commands having finished
+    def done_check(self, tempdir: str):
+        return all(os.path.exists(os.path.join(tempdir, f'done{n}')) for n in [1, 2])
+
+    # pr3287 -lufile SIGUSR1 test
+    def test_pr3287_lufile_usr1(self):
+
+        with tempfile.TemporaryDirectory() as tempdir:
+            port1, ts1 = cti.unused_port()
+            port2, ts2 = cti.unused_port()
+            with playback.playback(self, 'pr3287/Test/smoke.trc', port=port1) as p1:
+                with playback.playback(self, 'pr3287/Test/smoke.trc', port=port2) as p2:
+                    ts1.close()
+                    ts2.close()
+                    pr3287 = self.start_partial_jobs(tempdir, p1, p2, port1, port2)
+
+                    # SIGUSR1 flushes both sessions' print jobs.
+                    pr3287.send_signal(signal.SIGUSR1)
+                    self.try_until((lambda: self.done_check(tempdir)), 2,
+                        'pr3287 did not flush the print jobs')
+                    for n in [1, 2]:
+                        self.assertNotEqual(0, os.path.getsize(os.path.join(tempdir, f'out{n}')))
+
+                    # The sessions keep running and print the jobs that
+                    # follow.
+                    self.assertIsNone(pr3287.poll())
+                    for n in [1, 2]:
+                        os.unlink(os.path.join(tempdir, f'done{n}'))
+                    p1.send_to_mark(1, send_tm=False)
+                    p2.send_to_mark(1, send_tm=False)
+                    self.try_until((lambda: self.done_check(tempdir)), 2,
+                        'pr3287 did not print the following jobs')
+
+                    pr3287.send_signal(signal.SIGTERM)
+                    self.children.remove(pr3287)
+                    self.vgwait(pr3287)
+
+    # pr3287 -lufile SIGTERM test
+    def test_pr3287_lufile_term(self):
+
+        with tempfile.TemporaryDirectory() as tempdir:
+            port1, ts1 = cti.unused_port()
+            port2, ts2 = cti.unused_port()
+            with playback.playback(self, 'pr3287/Test/smoke.trc', port=port1) as p1:
+                with playback.playback(self, 'pr3287/Test/smoke.trc', port=port2) as p2:
+                    ts1.close()
+                    ts2.close()
+                    pr3287 = self.start_partial_jobs(tempdir, p1, p2, port1, port2)
+
+                    # SIGTERM flushes both sessions' print jobs, then exits.
+                    pr3287.send_signal(signal.SIGTERM)
+                    self.children.remove(pr3287)
+                    self.vgwait(pr3287)
+                    self.assertTrue(self.done_check(tempdir), 'pr3287 did not flush the print jobs')
+
+    # pr3287 -lufile session failure test
+    def test_pr3287_lufile_status(self):
+
+        # Grab the expected output.
+        ref_printout = pathlib.Path('pr3287/Test/smoke.out').read_bytes()
+
+        with tempfile.TemporaryDirectory() as tempdir:
+            # Nothing listens on the first port.
+            port1, ts1 = cti.unused_port()
+            port2, ts2 = cti.unused_port()
+            with playback.playback(self, 'pr3287/Test/smoke.trc', port=port2) as p2:
+                ts1.close()
+                ts2.close()
+
+                lufile = os.path.join(tempdir, 'lufile')
+                with open(lufile, 'w') as f:
+                    f.write(f'127.0.0.1:{port1}\n')
+                    f.write(f"127.0.0.1:{port2} cat >>'{tempdir}/out2'\n")
+                pr3287 = Popen(cti.vgwrap(['pr3287', '-lufile', lufile]),
+                    stderr=PIPE)
+                self.children.append(pr3287)
+
+                # The other session still prints.
+                p2.send_to_mark(1, send_tm=False)
+                self.try_until((lambda: self.output_check(tempdir, ref_printout, ['out2'])), 2,
+                    'pr3287 did not produce output')
+
+            # Once the host disconnects, pr3287 exits and reports the failure.
+            self.children.remove(pr3287)
+            stderr = pr3287.communicate(timeout=5)[1].decode()
+            self.vgwait(pr3287, assertOnFailure=False)
+            self.assertEqual(1, pr3287.returncode)
+            self.assertIn(f'Session 127.0.0.1:{port1} exited with status 1', stderr)
+
+if __name__ == '__main__':
+    unittest.main()
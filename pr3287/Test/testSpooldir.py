@@ -0,0 +1,94 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# pr3287 -spooldir tests
+
+import unittest
+from subprocess import Popen, PIPE, DEVNULL
+import os
+import pathlib
+import sys
+import tempfile
+import Common.Test.playback as playback
+import Common.Test.cti as cti
+
+@unittest.skipIf(sys.platform.startswith('win'), 'Does not run on Windows')
+@unittest.skipIf(sys.platform == 'cygwin', 'This does some very strange things on Cygwin')
+class TestPr3287Spooldir(cti.cti):
+
+    # test for both spool command runs being complete
+    def done_check(self, logdir: str):
+        return len(os.listdir(logdir)) == 2
+
+    # pr3287 -spooldir test
+    def test_pr3287_spooldir(self):
+
+        # Grab the expected output.
+        ref_printout = pathlib.Path('pr3287/Test/smoke.out').read_bytes()
+
+        with tempfile.TemporaryDirectory() as spooldir, tempfile.TemporaryDirectory() as logdir:
+            # Start 'playback' to feed data to pr3287.
+            port, ts = cti.unused_port()
+            with playback.playback(self, 'pr3287/Test/smoke.trc', port=port) as p:
+                ts.close()
+
+                # Start pr3287. The spool command copies each file to logdir.
+                pr3287 = Popen(cti.vgwrap(['pr3287', '-spooldir', spooldir,
+                    '-spoolcommand', f'cat >"{logdir}/$(basename "$1")"',
+                    f'127.0.0.1:{port}']))
+                self.children.append(pr3287)
+
+                # Play the trace to pr3287.
+                p.send_to_mark(1, send_tm=False)
+
+                # Wait for the spool command to run for both jobs.
+                self.try_until((lambda: self.done_check(logdir)), 2,
+                    'pr3287 did not run the spool command')
+
+            # Wait for the processes to exit.
+            pr3287.kill()
+            self.children.remove(pr3287)
+            self.vgwait(pr3287, assertOnFailure=False)
+
+            # There should be two spool files, and nothing else.
+            files = sorted(os.listdir(spooldir))
+            self.assertEqual(2, len(files))
+            self.assertTrue(all(file.startswith('print-') for file in files))
+
+            # The spool command should have been given each file.
+            self.assertEqual(files, sorted(os.listdir(logdir)))
+            for file in files:
+                self.assertEqual(pathlib.Path(os.path.join(spooldir, file)).read_bytes(),
+                    pathlib.Path(os.path.join(logdir, file)).read_bytes())
+
+            # The reference file is the second of the two print-outs, which
+            # gets the later (or suffixed) name.
+            self.assertEqual(ref_printout,
+                pathlib.Path(os.path.join(spooldir, files[-1])).read_bytes())
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,200 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# s3270 field navigation tests
+
+import requests
+from subprocess import Popen, DEVNULL
+import threading
+import unittest
+import Common.Test.playback as playback
+import Common.Test.cti as cti
+
+class TestS3270Fields(cti.cti):
+
+    # Send an action to s3270.
+    def action(self, sport: int, action: str):
+        r = requests.get(f'http://127.0.0.1:{sport}/3270/rest/json/{action}')
+        self.assertTrue(r.ok, f'{action} failed')
+        return r.json()['result']
+
+    # Read the screen into a list of cells, each a field attribute or a character.
+    def read_cells(self, sport: int):
+        cells = []
+        for line in self.action(sport, 'ReadBuffer(Ascii)'):
+            for token in line.split():
+                if token.startswith('SF('):
+                    fa = [int(a[3:], 16) for a in token[3:-1].split(',') if a.startswith('c0=')]
+                    cells.append(('fa', fa[0]))
+                else:
+                    cells.append(('ch', int(token, 16)))
+        return cells
+
+    # Where Tab should go, according to the screen contents.
+    def expect_tab(self, cells, baddr: int) -> int:
+        n = len(cells)
+        for i in range(n):
+            b = (baddr + i) % n
+            if cells[b][0] == 'fa' and not cells[b][1] & 0x20 and cells[(b + 1) % n][0] != 'fa':
+                return (b + 1) % n
+        return 0
+
+    # Where FieldEnd should go, according to the screen contents.
+    def expect_field_end(self, cells, baddr: int) -> int:
+        n = len(cells)
+        faddr = baddr
+        while cells[faddr][0] != 'fa':
+            faddr = (faddr - 1) % n
+        if faddr == baddr or cells[faddr][1] & 0x20:
+            return baddr
+        last = -1
+        b = (faddr + 1) % n
+        while cells[b][0] != 'fa':
+            if cells[b][1] not in [0x00, 0x20]:
+                last = b
+            b = (b + 1) % n
+        if last == -1:
+            return (faddr + 1) % n
+        if cells[(last + 1) % n][0] == 'fa':
+            return last
+        return (last + 1) % n
+
+    # Move around the screen with Tab and FieldEnd, checking where the cursor
+    # lands against the field attributes in the buffer.
+    def walk(self, sport: int, cols: int):
+        cells = self.read_cells(sport)
+        fas = [b for b in range(len(cells)) if cells[b][0] == 'fa']
+        self.assertNotEqual([], fas)
+
+        def cursor() -> int:
+            row, col = self.action(sport, 'Query(Cursor)')[0].split()
+            return int(row) * cols + int(col)
+        start = cursor()
+
+        # Tab through every field, and to the end of each.
+        baddr = start
+        for _ in range(len(fas) + 1):
+            self.action(sport, 'Tab()')
+            baddr = self.expect_tab(cells, baddr)
+            self.assertEqual(baddr, cursor())
+            self.action(sport, 'FieldEnd()')
+            baddr = self.expect_field_end(cells, baddr)
+            self.assertEqual(baddr, cursor())
+
+        # Start from each field attribute and its neighbors.
+        starts = set()
+        for b in fas:
+            starts |= {(b - 1) % len(cells), b, (b + 1) % len(cells)}
+        for b in sorted(starts):
+            self.action(sport, f'MoveCursor({b // cols},{b % cols})')
+            self.action(sport, 'Tab()')
+            self.assertEqual(self.expect_tab(cells, b), cursor())
+            self.action(sport, f'MoveCursor({b // cols},{b % cols})')
+            self.action(sport, 'FieldEnd()')
+            self.assertEqual(self.expect_field_end(cells, b), cursor())
+
+        # Put the cursor back.
+        self.action(sport, f'MoveCursor({start // cols},{start % cols})')
+
+    # s3270 field navigation test, on a screen with many fields.
+    def test_s3270_fields(self):
+
+        # Start 'playback' to read s3270's output.
+        pport, socket = cti.unused_port()
+        with playback.playback(self, 's3270/Test/sruvm.trc', pport) as p:
+            socket.close()
+
+            # Start s3270.
+            sport, socket = cti.unused_port()
+            s3270 = Popen(cti.vgwrap(['s3270', '-httpd', str(sport),
+                    f'127.0.0.1:{pport}']), stdin=DEVNULL, stdout=DEVNULL)
+            self.children.append(s3270)
+            self.check_listen(sport)
+            socket.close()
+
+            # Fill in the screen, and type into the COMMAND field.
+            p.send_records(2)
+            self.action(sport, 'Tab()')
+            self.action(sport, 'Tab()')
+            self.action(sport, 'String("abc def")')
+
+            # Walk the fields.
+            self.walk(sport, 80)
+
+        # Wait for the processes to exit.
+        requests.get(f'http://127.0.0.1:{sport}/3270/rest/json/Quit()')
+        self.vgwait(s3270)
+
+    # s3270 field navigation test, after a CUT-mode file transfer.
+    def test_s3270_fields_ft_cut(self):
+
+        # Start 'playback' to read s3270's output.
+        port, socket = cti.unused_port()
+        with playback.playback(self, 's3270/Test/ft_cut.trc', port=port) as p:
+            socket.close()
+
+            # Start s3270.
+            sport, socket = cti.unused_port()
+            s3270 = Popen(cti.vgwrap(['s3270', '-model', '2', '-httpd', str(sport),
+                    f'127.0.0.1:{port}']), stdin=DEVNULL, stdout=DEVNULL)
+            self.children.append(s3270)
+            self.check_listen(sport)
+            socket.close()
+
+            # Play the host side in the background.
+            failures = []
+            def match():
+                try:
+                    p.match()
+                except Exception as e:
+                    failures.append(e)
+            mthread = threading.Thread(target=match)
+            mthread.start()
+
+            # Do the transfer. During the transfer, the data field attribute
+            # is rewritten in place for each buffer. Afterwards, the host
+            # writes the field attributes already on the screen again.
+            self.action(sport, 'Wait(2,InputField)')
+            self.action(sport, 'Transfer(direction=send,host=vm,"localfile=s3270/Test/fttext","hostfile=ft text a")')
+            self.try_until(lambda: self.action(sport, 'Ascii1(2,1,6)')[0] == 'Ready;',
+                2, 'Ready screen not displayed')
+
+            # Walk the fields.
+            self.walk(sport, 80)
+
+            # Finish the session.
+            self.action(sport, 'String(logoff)')
+            self.action(sport, 'Enter()')
+            mthread.join()
+            self.assertEqual([], failures)
+
+        # Wait for the process to exit.
+        requests.get(f'http://127.0.0.1:{sport}/3270/rest/json/Quit()')
+        self.vgwait(s3270)
+
+if __name__ == '__main__':
+    unittest.main()
@@ -29,6 +29,7 @@
 
 import requests
 from subprocess import Popen, PIPE, DEVNULL
+import re
 import threading
 import time
 import unittest
@@ -37,6 +38,29 @@ import Common.Test.cti as cti
 
 class TestS3270ft(cti.cti):
 
+    # Check the transfer statistics in the Transfer() result and in the
+    # Query(FtStats) output that follows it.
+    def check_stats(self, stdout, mode: str, length: int):
+        m = re.search(r', (\d+) buffers, host wait (\d+\.\d{3})s, local (\d+\.\d{3})s$', stdout[1].strip())
+        self.assertIsNotNone(m, 'Missing statistics in Transfer() result')
+        buffers = int(m.group(1))
+        self.assertGreater(buffers, 0)
+
+        self.assertTrue(stdout[4].startswith('data: '))
+        words = stdout[4].strip().split()[1:]
+        stats = dict(zip(words[0::2], words[1::2]))
+        self.assertEqual(mode, stats['mode'])
+        self.assertEqual('complete', stats['state'])
+        self.assertEqual(length, int(stats['bytes']))
+        self.assertEqual(buffers, int(stats['buffers']))
+        self.assertAlmostEqual(float(m.group(2)), float(stats['host-wait']), delta=0.0006)
+        self.assertAlmostEqual(float(m.group(3)), float(stats['local']), delta=0.0006)
+        self.assertLessEqual(float(stats['host-wait-max']), float(stats['host-wait']))
+        self.assertLessEqual(float(stats['host-wait']) + float(stats['local']), float(stats['elapsed']))
+        # Each request but the first follows a host turnaround.
+        self.assertEqual(buffers - 1, sum([int(stats[f'latency-{b}']) for b in ['1ms', '10ms', '100ms', '1s', 'over-1s']]))
+        self.assertEqual('ok', stdout[6].strip())
+
     # s3270 DFT-mode file transfer test
     def test_s3270_ft_dft(self):
 
@@ -52,6 +76,7 @@ class TestS3270ft(cti.cti):
 
             # Feed s3270 some actions.
             s3270.stdin.write(b'transfer direction=send host=tso localfile=s3270/Test/fttext hostfile=fttext\n')
+            s3270.stdin.write(b"Query(FtStats)\n")
             s3270.stdin.write(b"PF(3)\n")
             s3270.stdin.flush()
 
@@ -63,6 +88,7 @@ class TestS3270ft(cti.cti):
             self.assertEqual('data: Transfer complete, 19925 bytes transferred', stdout[0].strip())
             self.assertTrue('bytes/sec in DFT mode' in stdout[1])
             self.assertEqual('ok', stdout[3].strip())
+            self.check_stats(stdout, 'DFT', 19925)
 
         # Wait for the process to exit.
         s3270.stdin.close()
@@ -83,6 +109,7 @@ class TestS3270ft(cti.cti):
 
             # Feed s3270 some actions.
             s3270.stdin.write(b'transfer direction=send host=vm "localfile=s3270/Test/fttext" "hostfile=ft text a"\n')
+            s3270.stdin.write(b"Query(FtStats)\n")
             s3270.stdin.write(b"String(logoff)\n")
             s3270.stdin.write(b"Enter()\n")
             s3270.stdin.flush()
@@ -95,6 +122,7 @@ class TestS3270ft(cti.cti):
             self.assertEqual('data: Transfer complete, 19580 bytes transferred', stdout[0].strip())
             self.assertTrue('bytes/sec in CUT mode' in stdout[1])
             self.assertEqual('ok', stdout[3].strip())
+            self.check_stats(stdout, 'CUT', 19580)
 
         # Wait for the process to exit.
         s3270.stdin.close()
@@ -27,6 +27,9 @@
 #
 # s3270 HTTPS tests
 
+import json
+import socket
+import time
 import unittest
 from subprocess import Popen, PIPE, DEVNULL
 import requests
@@ -64,6 +67,89 @@ class TestS3270Httpd(cti.cti):
         s.close()
         self.vgwait(s3270)
 
+    # Read n HTTP responses from a socket.
+    def read_responses(self, s: socket.socket, n: int):
+        responses = []
+        buf = b''
+        s.settimeout(5)
+        while len(responses) < n:
+            chunk = s.recv(4096)
+            self.assertNotEqual(b'', chunk, 'Unexpected EOF')
+            buf += chunk
+            while b'\r\n\r\n' in buf:
+                header, rest = buf.split(b'\r\n\r\n', 1)
+                lines = header.decode().split('\r\n')
+                length = [int(line.split(':')[1]) for line in lines if line.lower().startswith('content-length:')][0]
+                if len(rest) < length:
+                    break
+                responses.append((lines[0], rest[:length]))
+                buf = rest[length:]
+        return responses
+
+    # s3270 HTTPD pipelining test.
+    def test_s3270_httpd_pipeline(self):
+
+        # Start s3270.
+        port, ts = cti.unused_port()
+        s3270 = Popen(cti.vgwrap(['s3270', '-httpd', str(port)]))
+        self.children.append(s3270)
+        self.check_listen(port)
+        ts.close()
+
+        # Send three requests in one write. The first one does not complete
+        # right away, so the other two have to wait for it.
+        s = socket.create_connection(('127.0.0.1', port))
+        request = ''
+        for action in ['Wait(0.3,seconds)', 'Query(Host)', 'Set(monoCase)']:
+            request += f'GET /3270/rest/json/{action} HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n'
+        start = time.monotonic()
+        s.sendall(request.encode())
+
+        # Check the responses, which should come back in order.
+        responses = self.read_responses(s, 3)
+        self.assertGreaterEqual(time.monotonic() - start, 0.3)
+        for status, _ in responses:
+            self.assertIn(' 200 ', status)
+        results = [json.loads(body)['result'] for _, body in responses]
+        self.assertEqual([], results[0])
+        self.assertEqual([''], results[1])
+        self.assertEqual(['false'], results[2])
+        s.close()
+
+        # Wait for the process to exit successfully.
+        requests.get(f'http://127.0.0.1:{port}/3270/rest/json/Quit()')
+        self.vgwait(s3270)
+
+    # s3270 HTTPD close with requests queued test.
+    def test_s3270_httpd_pipeline_close(self):
+
+        # Start s3270.
+        port, ts = cti.unused_port()
+        s3270 = Popen(cti.vgwrap(['s3270', '-httpd', str(port)]))
+        self.children.append(s3270)
+        self.check_listen(port)
+        ts.close()
+
+        # Send a request that does not complete right away and queue two more
+        # behind it, then close the connection.
+        s = socket.create_connection(('127.0.0.1', port))
+        request = ''
+        for action in ['Wait(0.3,seconds)', 'Set(monoCase)', 'Set(monoCase)']:
+            request += f'GET /3270/rest/json/{action} HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n'
+        s.sendall(request.encode())
+        s.close()
+
+        # Make sure s3270 is still answering after the first request would
+        # have completed.
+        time.sleep(0.5)
+        r = requests.get(f'http://127.0.0.1:{port}/3270/rest/json/Set(monoCase)')
+        self.assertEqual(requests.codes.ok, r.status_code)
+        self.assertEqual('false', r.json()['result'][0])
+
+        # Wait for the process to exit successfully.
+        requests.get(f'http://127.0.0.1:{port}/3270/rest/json/Quit()')
+        self.vgwait(s3270)
+
     # s3270 HTTPD stext error test.
     def s3270_httpd_stext_error_test(self, actions:str, content:str):
 
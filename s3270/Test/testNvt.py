@@ -30,6 +30,8 @@
 import unittest
 from subprocess import Popen, PIPE, DEVNULL
 import requests
+import threading
+import time
 import Common.Test.cti as cti
 
 class TestS3270Nvt(cti.cti):
@@ -91,5 +93,48 @@ class TestS3270Nvt(cti.cti):
     def test_nvt_1049_save(self):
         self.nvt_1049(b'h', b'r')
 
+    # Expect test.
+    def test_nvt_expect(self):
+
+        # Start a server to throw NVT text at s3270.
+        s = cti.sendserver(self)
+
+        # Start s3270.
+        hport, ts = cti.unused_port()
+        s3270 = Popen(cti.vgwrap(['s3270', '-httpd', str(hport), f'a:c:t:127.0.0.1:{s.port}']))
+        self.children.append(s3270)
+        self.check_listen(hport)
+        ts.close()
+
+        # Match text that is already there, with overlapping partial matches.
+        s.send(b'xaab')
+        s.send(b'aabaabz')
+        r = requests.get(f'http://127.0.0.1:{hport}/3270/rest/json/Expect(aabaab,1)')
+        self.assertEqual(requests.codes.ok, r.status_code)
+
+        # The text after the match is still available, but the match is gone.
+        r = requests.get(f'http://127.0.0.1:{hport}/3270/rest/json/Expect(z,1)')
+        self.assertEqual(requests.codes.ok, r.status_code)
+        r = requests.get(f'http://127.0.0.1:{hport}/3270/rest/json/Expect(aab,1)')
+        self.assertNotEqual(requests.codes.ok, r.status_code)
+
+        # Match text that arrives in pieces while waiting.
+        result = {}
+        def expect():
+            result['r'] = requests.get(f'http://127.0.0.1:{hport}/3270/rest/json/Expect("split here",5)')
+        t = threading.Thread(target=expect)
+        t.start()
+        time.sleep(0.5)
+        s.send(b'splispl')
+        time.sleep(0.1)
+        s.send(b'it here')
+        t.join()
+        self.assertEqual(requests.codes.ok, result['r'].status_code)
+
+        # Clean up.
+        s.close()
+        requests.get(f'http://127.0.0.1:{hport}/3270/rest/json/Quit()')
+        self.vgwait(s3270)
+
 if __name__ == '__main__':
     unittest.main()
@@ -31,6 +31,7 @@ import os
 import requests
 from subprocess import Popen, PIPE, DEVNULL
 import sys
+import tempfile
 import threading
 import unittest
 import Common.Test.setupCert as setupCert
@@ -106,6 +107,38 @@ class TestS3270Tls(cti.cti):
         s3270.stdin.close()
         self.vgwait(s3270)
 
+    # s3270 STARTTLS test, with the TLS context set up when the host asks
+    def test_s3270_starttls_deferred(self):
+
+        # Start a server to read s3270's output.
+        port, ts = cti.unused_port()
+        with tls_server.tls_server('Common/Test/tls/TEST.crt', 'Common/Test/tls/TEST.key', self, 's3270/Test/ibmlink.trc', port) as server, \
+                tempfile.TemporaryDirectory() as tempdir:
+            ts.close()
+
+            # Start s3270, without any of the TLS options that make it set up
+            # the TLS context before connecting.
+            tracefile = os.path.join(tempdir, 'trace')
+            args = ['s3270', '-xrm', 's3270.contentionResolution: false', '-noverifycert',
+                    '-trace', '-tracefile', tracefile, f'127.0.0.1:{port}']
+            s3270 = Popen(cti.vgwrap(args), stdin=PIPE, stdout=DEVNULL)
+            self.children.append(s3270)
+
+            # Make sure it all works.
+            server.starttls()
+            s3270.stdin.write(b"PF(3)\n")
+            s3270.stdin.write(b"Quit()\n")
+            s3270.stdin.flush()
+            server.match()
+
+            # Wait for the process to exit.
+            s3270.stdin.close()
+            self.vgwait(s3270)
+
+            # Make sure the context was set up late.
+            with open(tracefile) as f:
+                self.assertIn('Setting up TLS context for STARTTLS', f.read())
+
     # s3270 TLS minimum version test
     @unittest.skipUnless(sys.platform == 'linux', 'Linux-only test') # Linux-only for now.
     def test_s3270_tls_min(self):
@@ -0,0 +1,198 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2024 Paul Mattes.
+# All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions are met:
+#     * Redistributions of source code must retain the above copyright
+#       notice, this list of conditions and the following disclaimer.
+#     * Redistributions in binary form must reproduce the above copyright
+#       notice, this list of conditions and the following disclaimer in the
+#       documentation and/or other materials provided with the distribution.
+#     * Neither the names of Paul Mattes nor the names of his contributors
+#       may be used to endorse or promote products derived from this software
+#       without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY PAUL MATTES "AS IS" AND ANY EXPRESS OR IMPLIED
+# WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+# MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO
+# EVENT SHALL PAUL MATTES BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+# SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+# OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+# WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+# OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF
+# ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+#
+# s3270 trace file tests
+
+import os
+from datetime import datetime
+import re
+import shutil
+from subprocess import Popen, PIPE, DEVNULL, run
+import tempfile
+import time
+import unittest
+import Common.Test.playback as playback
+import Common.Test.cti as cti
+
+# Find trcdecode, which is built with playback.
+def trcdecode_path():
+    s3270 = shutil.which('s3270')
+    if s3270 != None:
+        path = os.path.join(os.path.split(s3270)[0], '..', 'playback', 'trcdecode')
+        if os.path.exists(path):
+            return os.path.abspath(path)
+    return shutil.which('trcdecode')
+
+# Pull the network data out of a text trace, one byte string per direction.
+# Comparing the whole streams means it doesn't matter how the data was split
+# into reads.
+def netdata(text: str):
+    data = { '<': b'', '>': b'' }
+    for line in text.splitlines():
+        m = re.match(r'^(?:\d{8}\.\d{6}\.\d{3} )?([<>]) 0x[0-9a-f]+ +([0-9a-f]+)$', line)
+        if m != None:
+            data[m.group(1)] += bytes.fromhex(m.group(2))
+    return data
+
+# Return the trace file header, less the parts that differ between runs.
+def header(text: str):
+    out = []
+    for line in text.splitlines():
+        line = re.sub(r'^\d{8}\.\d{6}\.\d{3} ', '', line)
+        if line.startswith('Trying '):
+            break
+        if not line.startswith(' Command:'):
+            out.append(line)
+    return out
+
+class TestS3270Trace(cti.cti):
+
+    # Wait for a string to appear in a file, returning how long it took.
+    def wait_for(self, path: str, text: str, timeout: float):
+        start = time.monotonic()
+        while True:
+            if os.path.exists(path):
+                with open(path, 'r', errors='replace') as f:
+                    if text in f.read():
+                        return time.monotonic() - start
+            if time.monotonic() - start >= timeout:
+                return None
+            time.sleep(0.05)
+
+    # s3270 traceFlushInterval test
+    def test_s3270_trace_flush_interval(self):
+
+        interval = 0.5
+        with tempfile.TemporaryDirectory() as tempdir:
+            tracefile = os.path.join(tempdir, 'trace')
+
+            # Start s3270 with buffered tracing.
+            s3270 = Popen(cti.vgwrap(['s3270', '-trace', '-tracefile', tracefile,
+                '-set', f'traceFlushInterval={int(interval * 1000)}']),
+                stdin=PIPE, stdout=DEVNULL)
+            self.children.append(s3270)
+
+            # Each action should reach the trace file within the flush
+            # interval, plus some slack for scheduling.
+            for i in range(3):
+                marker = f'flush-marker-{i}'
+                s3270.stdin.write(f'Echo({marker})\n'.encode())
+                s3270.stdin.flush()
+                elapsed = self.wait_for(tracefile, marker, interval + 2.0)
+                self.assertIsNotNone(elapsed, f'{marker} never reached the trace file')
+                self.assertLessEqual(elapsed, interval + 1.0,
+                    f'{marker} took {elapsed:.3f}s to reach the trace file')
+
+            # Anything still buffered is written when s3270 exits.
+            s3270.stdin.write(b'Echo(exit-marker)\n')
+            s3270.stdin.write(b'Quit()\n')
+            s3270.stdin.flush()
+            s3270.stdin.close()
+            self.vgwait(s3270)
+            self.children.remove(s3270)
+            self.assertIsNotNone(self.wait_for(tracefile, 'exit-marker', 0),
+                'exit-marker was not flushed at exit')
+
+    # Run a short 3270 session with tracing in the given format.
+    def capture(self, tracefile: str, format: str):
+        port, ts = cti.unused_port()
+        with playback.playback(self, 's3270/Test/ibmlink-cr.trc', port=port) as p:
+            ts.close()
+            s3270 = Popen(cti.vgwrap(['s3270', '-trace', '-tracefile', tracefile,
+                '-set', f'traceFormat={format}', f'127.0.0.1:{port}']),
+                stdin=PIPE, stdout=DEVNULL)
+            self.children.append(s3270)
+            # Wait for the host to disconnect, so all of its data is traced.
+            s3270.stdin.write(b'PF(3)\n')
+            s3270.stdin.write(b'Wait(Disconnect)\n')
+            s3270.stdin.write(b'Quit()\n')
+            s3270.stdin.flush()
+            p.match()
+        s3270.stdin.close()
+        self.vgwait(s3270)
+        self.children.remove(s3270)
+
+    # Binary trace test: trcdecode output matches a text trace
+    @unittest.skipIf(trcdecode_path() == None, 'trcdecode not built')
+    def test_s3270_trace_binary(self):
+        with tempfile.TemporaryDirectory() as tempdir:
+            textfile = os.path.join(tempdir, 'trace.txt')
+            binfile = os.path.join(tempdir, 'trace.bin')
+            self.capture(textfile, 'text')
+            start = time.time()
+            self.capture(binfile, 'binary')
+            end = time.time()
+
+            # Decode the binary trace.
+            r = run([trcdecode_path(), binfile], capture_output=True)
+            self.assertEqual(0, r.returncode, r.stderr.decode())
+            decoded = r.stdout.decode()
+
+            # Compare it with the text trace of the same traffic.
+            with open(textfile, 'r') as f:
+                text = f.read()
+            self.assertEqual(header(text), header(decoded))
+            data = netdata(decoded)
+            self.assertNotEqual(b'', data['<'])
+            self.assertNotEqual(b'', data['>'])
+            self.assertEqual(netdata(text), data)
+
+            # The decoded timestamps fall within the capture and never go
+            # backwards.
+            stamps = [datetime.strptime(m, '%Y%m%d.%H%M%S.%f').timestamp()
+                for m in re.findall(r'^(\d{8}\.\d{6}\.\d{3}) ', decoded, re.MULTILINE)]
+            self.assertTrue(len(stamps) > 0)
+            self.assertEqual(sorted(stamps), stamps)
+            self.assertGreaterEqual(stamps[0], start - 1)
+            self.assertLessEqual(stamps[-1], end + 1)
+
+    # Binary trace test: a truncated final record is reported
+    @unittest.skipIf(trcdecode_path() == None, 'trcdecode not built')
+    def test_s3270_trace_binary_truncated(self):
+        with tempfile.TemporaryDirectory() as tempdir:
+            binfile = os.path.join(tempdir, 'trace.bin')
+            self.capture(binfile, 'binary')
+            full = run([trcdecode_path(), binfile], capture_output=True)
+            self.assertEqual(0, full.returncode)
+
+            # Cut the file off in the middle of the last record.
+            truncfile = os.path.join(tempdir, 'trunc.bin')
+            with open(binfile, 'rb') as f:
+                data = f.read()
+            with open(truncfile, 'wb') as f:
+                f.write(data[:-3])
+            r = run([trcdecode_path(), truncfile], capture_output=True)
+
+            # Everything before the last record is decoded, then it fails.
+            self.assertNotEqual(0, r.returncode)
+            self.assertIn('truncated record', r.stderr.decode())
+            self.assertTrue(len(r.stdout) > 0)
+            self.assertTrue(full.stdout.startswith(r.stdout))
+            self.assertNotEqual(full.stdout, r.stdout)
+
+if __name__ == '__main__':
+    unittest.main()
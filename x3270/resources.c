@@ -90,6 +90,10 @@ XtResource resources[] = {
       offset(trace_file), XtRString, 0 },
     { ResTraceFileSize, ClsTraceFileSize, XtRString, sizeof(char *),
       offset(trace_file_size), XtRString, 0 },
+    { ResTraceFlushInterval, ClsTraceFlushInterval, XtRInt, sizeof(int),
+      offset(trace_flush_interval), XtRString, "0" },
+    { ResTraceFormat, ClsTraceFormat, XtRString, sizeof(char *),
+      offset(trace_format), XtRString, 0 },
     { ResScreenTraceFile, ClsScreenTraceFile, XtRString, sizeof(char *),
       offset(screentrace.file), XtRString, 0 },
     { ResScreenTraceTarget, ClsScreenTraceTarget, XtRString, sizeof(char *),
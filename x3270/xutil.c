@@ -89,6 +89,8 @@ typedef void voidfn(void);
 
 typedef struct iorec {
     iofn_t 	  fn;
+    iodatafn_t	  data_fn;
+    void	 *data;
     XtInputId	  id;
     struct iorec *next;
 } iorec_t;
@@ -98,13 +100,12 @@ static iorec_t *iorecs = NULL;
 static void
 io_fn(XtPointer closure, int *source, XtInputId *id)
 {
-    iorec_t *iorec;
+    iorec_t *iorec = (iorec_t *)closure;
 
-    for (iorec = iorecs; iorec != NULL; iorec = iorec->next) {
-	if (iorec->id == *id) {
-	    (*iorec->fn)(*source, *id);
-	    break;
-	}
+    if (iorec->data_fn != NULL) {
+	(*iorec->data_fn)(*source, *id, iorec->data);
+    } else {
+	(*iorec->fn)(*source, *id);
     }
 }
 
@@ -115,8 +116,27 @@ AddInput(iosrc_t sock, iofn_t fn)
 
     iorec = (iorec_t *)XtMalloc(sizeof(iorec_t));
     iorec->fn = fn;
+    iorec->data_fn = NULL;
+    iorec->id = XtAppAddInput(appcontext, sock, (XtPointer)XtInputReadMask,
+	    io_fn, (XtPointer)iorec);
+
+    iorec->next = iorecs;
+    iorecs = iorec;
+
+    return iorec->id;
+}
+
+ioid_t
+AddInputData(iosrc_t sock, iodatafn_t fn, void *data)
+{
+    iorec_t *iorec;
+
+    iorec = (iorec_t *)XtMalloc(sizeof(iorec_t));
+    iorec->fn = NULL;
+    iorec->data_fn = fn;
+    iorec->data = data;
     iorec->id = XtAppAddInput(appcontext, sock, (XtPointer)XtInputReadMask,
-	    io_fn, NULL);
+	    io_fn, (XtPointer)iorec);
 
     iorec->next = iorecs;
     iorecs = iorec;
@@ -131,8 +151,9 @@ AddExcept(iosrc_t sock, iofn_t fn)
 
     iorec = (iorec_t *)XtMalloc(sizeof(iorec_t));
     iorec->fn = fn;
+    iorec->data_fn = NULL;
     iorec->id = XtAppAddInput(appcontext, sock, (XtPointer)XtInputExceptMask,
-	    io_fn, NULL);
+	    io_fn, (XtPointer)iorec);
     iorec->next = iorecs;
     iorecs = iorec;
 
@@ -146,8 +167,9 @@ AddOutput(iosrc_t sock, iofn_t fn)
 
     iorec = (iorec_t *)XtMalloc(sizeof(iorec_t));
     iorec->fn = fn;
+    iorec->data_fn = NULL;
     iorec->id = XtAppAddInput(appcontext, sock, (XtPointer)XtInputWriteMask,
-	    io_fn, NULL);
+	    io_fn, (XtPointer)iorec);
     iorec->next = iorecs;
     iorecs = iorec;
 